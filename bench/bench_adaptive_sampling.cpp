@@ -0,0 +1,176 @@
+// Benchmark: adaptive frame sampling.
+//
+// Usage: bench_adaptive_sampling [flights]
+// A synthetic 8-minute flight (climb, fast pass, hover, slow survey, landing)
+// with 30 Hz SRT samples is sampled at fixed 1 and 2 fps and adaptively for
+// 80% forward overlap. Reports frames, the largest ground gap between
+// consecutive frames (coverage) and the planning time. The generated select
+// expression is evaluated for every 30 fps video frame to check that it
+// passes exactly the planned frames.
+
+#include "adaptive_sampling.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+const double kMetresPerDegree = 6378137.0 * 3.14159265358979323846 / 180.0;
+
+// Phases of (seconds, horizontal speed m/s, climb rate m/s), flying east at 47 N
+static std::vector<TrackPoint> makeFlight() {
+    struct Phase {
+        double seconds, speed, climb;
+    };
+    const Phase phases[] = {{20, 0, 4}, {120, 15, 0}, {40, 0, 0}, {240, 3, 0}, {60, 2, -1.3}};
+    std::vector<TrackPoint> track;
+    double t = 0.0, east = 0.0, height = 0.0;
+    const double lat0 = 47.0, lon0 = 8.0, ground = 420.0;
+    const double dt = 1.0 / 30.0;
+    for (const Phase& phase : phases) {
+        for (double s = 0.0; s < phase.seconds; s += dt) {
+            track.push_back({t, lat0, lon0 + east / (kMetresPerDegree * std::cos(lat0 * 3.14159265358979323846 / 180.0)),
+                             ground + height});
+            t += dt;
+            east += phase.speed * dt;
+            height = std::max(0.0, height + phase.climb * dt);
+        }
+    }
+    return track;
+}
+
+// East position of the flight at time t
+static double eastAt(const std::vector<TrackPoint>& track, double t) {
+    size_t i = std::min(track.size() - 1, static_cast<size_t>(t * 30.0));
+    return (track[i].longitude - 8.0) * kMetresPerDegree * std::cos(47.0 * 3.14159265358979323846 / 180.0);
+}
+
+static double largestGap(const std::vector<TrackPoint>& track, const std::vector<double>& times) {
+    double gap = 0.0;
+    for (size_t i = 1; i < times.size(); i++) {
+        gap = std::max(gap, eastAt(track, times[i]) - eastAt(track, times[i - 1]));
+    }
+    return gap;
+}
+
+// Evaluates the subset of ffmpeg's expression language buildSelectFilter emits
+class SelectEvaluator {
+public:
+    explicit SelectEvaluator(const std::string& filter) : m_text(filter) {}
+
+    bool select(double t, double prevT) {
+        m_t = t;
+        m_prevT = prevT;
+        m_pos = std::strlen("select='");
+        return evaluate() != 0.0;
+    }
+
+private:
+    double evaluate() {
+        if (m_text.compare(m_pos, 3, "if(") == 0) {
+            m_pos += 3;
+            double condition = evaluate();
+            m_pos++;
+            // Both branches are parsed; only the taken one counts
+            double a = evaluate();
+            m_pos++;
+            double b = evaluate();
+            m_pos++;
+            return condition != 0.0 ? a : b;
+        }
+        if (m_text.compare(m_pos, 3, "lt(") == 0 || m_text.compare(m_pos, 4, "gte(") == 0) {
+            bool less = m_text[m_pos] == 'l';
+            m_pos += less ? 3 : 4;
+            double a = evaluate();
+            m_pos++;
+            double b = evaluate();
+            m_pos++;
+            return less ? (a < b) : (a >= b);
+        }
+        if (m_text.compare(m_pos, 4, "not(") == 0) {
+            m_pos += 4;
+            double a = evaluate();
+            m_pos++;
+            return a == 0.0;
+        }
+        if (m_text.compare(m_pos, 6, "prev_t") == 0) {
+            m_pos += 6;
+            return m_prevT;
+        }
+        if (m_text[m_pos] == 't') {
+            m_pos++;
+            return m_t;
+        }
+        char* end = nullptr;
+        double value = std::strtod(m_text.c_str() + m_pos, &end);
+        m_pos = end - m_text.c_str();
+        return value;
+    }
+
+    const std::string& m_text;
+    size_t m_pos = 0;
+    double m_t = 0.0, m_prevT = NAN;
+};
+
+int main(int argc, char** argv) {
+    const int flights = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100;
+    const std::vector<TrackPoint> track = makeFlight();
+    const double duration = track.back().timestamp;
+    bool ok = true;
+
+    std::printf("Synthetic flight: %.0f s, %zu SRT samples\n", duration, track.size());
+    for (double fps : {1.0, 2.0}) {
+        std::vector<double> times;
+        for (double t = 0.0; t <= duration; t += 1.0 / fps) {
+            times.push_back(t);
+        }
+        std::printf("  fixed %.0f fps       %5zu frames  largest gap %6.1f m\n", fps, times.size(),
+                    largestGap(track, times));
+    }
+
+    SamplingOptions options;
+    SamplingPlan plan;
+    auto start = Clock::now();
+    for (int i = 0; i < flights; i++) {
+        plan = planSampling(track, options);
+    }
+    const double planSeconds = secondsSince(start) / flights;
+    const double gap = largestGap(track, plan.timestamps);
+    // At most one spacing, plus the distance flown in one SRT sample
+    const bool covered = gap <= plan.maxSpacing + 15.0 / 30.0 + 1e-6;
+    ok = ok && covered;
+    std::printf("  adaptive 80%%       %5zu frames  largest gap %6.1f m  (%.1f-%.1f m target)  %s\n",
+                plan.timestamps.size(), gap, plan.minSpacing, plan.maxSpacing, covered ? "covered" : "GAP");
+    std::printf("  planning: %.3f ms per flight\n", planSeconds * 1e3);
+
+    // Decode simulation at 30 fps through the select expression
+    const std::string filter = buildSelectFilter(plan.timestamps);
+    std::vector<double> selected;
+    SelectEvaluator evaluator(filter);
+    double prevT = NAN;
+    for (size_t n = 0; n / 30.0 <= duration + 1.0; n++) {
+        double t = n / 30.0;
+        if (evaluator.select(t, prevT)) {
+            selected.push_back(t);
+        }
+        prevT = t;
+    }
+    bool matches = selected.size() == plan.timestamps.size();
+    for (size_t i = 0; matches && i < selected.size(); i++) {
+        matches = selected[i] >= plan.timestamps[i] - 1e-6 && selected[i] < plan.timestamps[i] + 1.0 / 30.0 + 1e-6;
+    }
+    ok = ok && matches;
+    std::printf("Select filter: %zu chars, %zu of %zu video frames passed  %s\n", filter.size(),
+                selected.size(), static_cast<size_t>(duration * 30.0), matches ? "identical" : "MISMATCH");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// Benchmark: reading and writing a COLMAP sparse model in text and binary form.
+//
+// Usage: bench_colmap_model [images] [points]
+// A synthetic model (default 500 images, 300000 points, 5 observations per
+// point) is written once per format, then read back and converted.
+
+#include "colmap_model.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static ColmapModel makeModel(int imageCount, int pointCount) {
+    const int trackLength = 5;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> coordinate(-100.0, 100.0);
+    std::uniform_int_distribution<int> image(0, imageCount - 1);
+
+    ColmapModel model;
+    ColmapCamera camera;
+    camera.id = 1;
+    camera.model = colmapCameraModelId("SIMPLE_RADIAL");
+    camera.width = 3840;
+    camera.height = 2160;
+    camera.params = {2800.0, 1920.0, 1080.0, -0.01};
+    model.cameras.push_back(camera);
+
+    model.images.resize(static_cast<size_t>(imageCount));
+    for (int i = 0; i < imageCount; i++) {
+        ColmapImage& img = model.images[static_cast<size_t>(i)];
+        img.id = static_cast<uint32_t>(i + 1);
+        img.camera = 1;
+        img.name = "flight_frame_" + std::to_string(i + 1) + ".jpg";
+        img.tvec[0] = coordinate(rng);
+    }
+    model.points.resize(static_cast<size_t>(pointCount));
+    for (int p = 0; p < pointCount; p++) {
+        ColmapPoint3D& point = model.points[static_cast<size_t>(p)];
+        point.id = static_cast<uint64_t>(p + 1);
+        for (double& x : point.xyz) x = coordinate(rng);
+        point.rgb[0] = static_cast<uint8_t>(p);
+        point.error = 0.7;
+        for (int t = 0; t < trackLength; t++) {
+            ColmapImage& img = model.images[static_cast<size_t>(image(rng))];
+            point.track.push_back({img.id, static_cast<uint32_t>(img.points.size())});
+            img.points.push_back({coordinate(rng) + 1000.0, coordinate(rng) + 500.0, point.id});
+        }
+    }
+    return model;
+}
+
+static uint64_t folderSize(const fs::path& dir) {
+    uint64_t size = 0;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        size += entry.file_size();
+    }
+    return size;
+}
+
+static void report(const char* name, Clock::duration elapsed, uint64_t bytes) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::printf("%-28s %9.3f s  %8.1f MB  %8.1f MB/s\n", name, seconds, bytes / 1e6, bytes / 1e6 / seconds);
+}
+
+int main(int argc, char** argv) {
+    int images = argc > 1 ? std::atoi(argv[1]) : 500;
+    int points = argc > 2 ? std::atoi(argv[2]) : 300000;
+    if (images <= 0) images = 500;
+    if (points <= 0) points = 300000;
+
+    fs::path root = fs::temp_directory_path() / "dronerecon_bench_colmap";
+    fs::remove_all(root);
+    ColmapModel model = makeModel(images, points);
+    std::printf("%d images, %d points\n", images, points);
+
+    const struct {
+        const char* name;
+        ColmapFormat format;
+    } formats[] = {{"text", ColmapFormat::Text}, {"binary", ColmapFormat::Binary}};
+
+    for (const auto& format : formats) {
+        fs::path dir = root / format.name;
+        std::string error;
+        auto start = Clock::now();
+        if (!writeColmapModel(model, dir, format.format, &error)) {
+            std::fprintf(stderr, "write failed: %s\n", error.c_str());
+            return 1;
+        }
+        const uint64_t bytes = folderSize(dir);
+        report((std::string("write ") + format.name).c_str(), Clock::now() - start, bytes);
+
+        ColmapModel loaded;
+        start = Clock::now();
+        if (!readColmapModel(dir, loaded, &error) || loaded.points.size() != model.points.size()) {
+            std::fprintf(stderr, "read failed: %s\n", error.c_str());
+            return 1;
+        }
+        report((std::string("read ") + format.name).c_str(), Clock::now() - start, bytes);
+
+        ColmapModelCheck check;
+        start = Clock::now();
+        if (!convertColmapModel(dir, fs::path(), format.format, nullptr, check, &error) || !check.ok()) {
+            std::fprintf(stderr, "check failed: %s\n", check.problems.empty() ? error.c_str() : check.problems[0].c_str());
+            return 1;
+        }
+        report((std::string("check ") + format.name).c_str(), Clock::now() - start, bytes);
+    }
+
+    ColmapModelCheck check;
+    auto start = Clock::now();
+    if (!convertColmapModel(root / "text", root / "converted", ColmapFormat::Binary, nullptr, check)) {
+        std::fprintf(stderr, "conversion failed\n");
+        return 1;
+    }
+    report("convert text -> binary", Clock::now() - start, folderSize(root / "text"));
+
+    fs::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,287 @@
+// Benchmark suite: GPS and command-building hot paths of DroneReconCore.
+//
+// Usage: bench_core [--quick] [--out results.tsv] [--baseline results.tsv]
+// 1. parseSRT on synthetic subtitle files: a 10 s clip, an hour-long flight in
+//    each DJI format, and the same flight with CRLF line endings.
+// 2. Position lookup on the hour-long track: getGPSForTimestamp (linear scan)
+//    and GpsTrack (single and batch lookups, evenly and unevenly spaced).
+// 3. decimalToDMS, generateExiftoolCommand, frameFileName and the adaptive
+//    sampling select filter.
+// Every case runs on fixed input and reports the best of several runs, so two
+// commits can be compared on the same machine: --out writes one
+// "name<TAB>value<TAB>unit" line per case, --baseline reads such a file and
+// prints the change next to each result. Exits 1 if a result is wrong.
+
+#include "adaptive_sampling.h"
+#include "frame_paths.h"
+#include "gps_embed.h"
+#include "gps_track.h"
+#include "synthetic_srt.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    std::string name;
+    double value;
+    std::string unit;  // "MB/s" is better when higher, "ns/..." when lower
+};
+
+static std::vector<Result> g_results;
+static std::map<std::string, double> g_baseline;
+static std::string g_baselineMode;
+static bool g_ok = true;
+
+// Keeps results alive so the optimizer cannot drop the measured work
+static volatile size_t g_sink = 0;
+
+static void consume(size_t value) {
+    g_sink = g_sink + value;
+}
+
+// Best wall time of runs calls of work, in seconds
+template <typename Work>
+static double bestSeconds(int runs, Work work) {
+    double best = 1e30;
+    for (int run = 0; run < runs; run++) {
+        auto start = Clock::now();
+        work();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+static void record(const std::string& name, double value, const std::string& unit) {
+    g_results.push_back({name, value, unit});
+    std::printf("  %-34s %12.2f %-12s", name.c_str(), value, unit.c_str());
+    auto base = g_baseline.find(name);
+    if (base != g_baseline.end() && base->second > 0.0 && value > 0.0) {
+        bool higherIsBetter = unit.find("/s") != std::string::npos;
+        double speedup = higherIsBetter ? value / base->second : base->second / value;
+        std::printf("  %5.2fx %s", speedup >= 1.0 ? speedup : 1.0 / speedup, speedup >= 1.0 ? "faster" : "slower");
+    }
+    std::printf("\n");
+}
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        std::printf("  CHECK FAILED: %s\n", what);
+        g_ok = false;
+    }
+}
+
+static bool loadResults(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.rfind("# mode ", 0) == 0) {
+            g_baselineMode = line.substr(7);
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string name, unit;
+        double value = 0.0;
+        if (std::getline(fields, name, '\t') && fields >> value) {
+            g_baseline[name] = value;
+        }
+    }
+    return true;
+}
+
+static bool saveResults(const std::string& path, const std::string& mode) {
+    std::ofstream file(path);
+    file << "# mode " << mode << '\n';
+    for (const Result& result : g_results) {
+        file << result.name << '\t' << result.value << '\t' << result.unit << '\n';
+    }
+    return file.good();
+}
+
+static void benchParse(const fs::path& dir, const std::string& name, int blocks, SrtFormat format, bool crlf,
+                       int runs) {
+    fs::path path = dir / (name + ".srt");
+    writeSyntheticSrt(path, blocks, format, crlf);
+    const double megabytes = fs::file_size(path) / (1024.0 * 1024.0);
+
+    std::vector<GPSData> samples;
+    double seconds = bestSeconds(runs, [&]() { samples = parseSRT(path.string()); });
+    check(samples.size() == static_cast<size_t>(blocks), "every SRT block parsed");
+    record("parse " + name, megabytes / seconds, "MB/s");
+    fs::remove(path);
+}
+
+int main(int argc, char** argv) {
+    bool quick = false;
+    std::string outPath, baselinePath;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baselinePath = argv[++i];
+        } else {
+            std::fprintf(stderr, "Usage: bench_core [--quick] [--out results.tsv] [--baseline results.tsv]\n");
+            return 2;
+        }
+    }
+    if (!baselinePath.empty() && !loadResults(baselinePath)) {
+        std::fprintf(stderr, "Cannot read baseline %s\n", baselinePath.c_str());
+        return 2;
+    }
+
+    // One SRT block per 30 fps frame: an hour is 108k blocks (~40 MB)
+    const int hourBlocks = quick ? 18000 : 108000;
+    const int runs = quick ? 2 : 5;
+    const char* flight = quick ? "10 min" : "1 h";
+    const std::string mode = quick ? "quick" : "full";
+    if (!g_baselineMode.empty() && g_baselineMode != mode) {
+        std::printf("Baseline was a %s run, this is a %s run: input sizes differ\n", g_baselineMode.c_str(),
+                    mode.c_str());
+    }
+    fs::path dir = fs::temp_directory_path() / "dronerecon_bench_core";
+    fs::create_directories(dir);
+
+    std::printf("SRT parsing (%s flight, 30 blocks/s)\n", flight);
+    benchParse(dir, "clip 10s", 300, SrtFormat::BracketTags, false, runs * 20);
+    benchParse(dir, "flight brackets", hourBlocks, SrtFormat::BracketTags, false, runs);
+    benchParse(dir, "flight gps pair", hourBlocks, SrtFormat::GpsPair, false, runs);
+    benchParse(dir, "flight mixed", hourBlocks, SrtFormat::Mixed, false, runs);
+    benchParse(dir, "flight brackets crlf", hourBlocks, SrtFormat::BracketTags, true, runs);
+
+    // Lookups at 1 fps frame times plus a random offset, over the whole flight
+    fs::path trackPath = dir / "track.srt";
+    writeSyntheticSrt(trackPath, hourBlocks, SrtFormat::BracketTags);
+    std::vector<GPSData> samples = parseSRT(trackPath.string());
+    fs::remove(trackPath);
+    const double duration = samples.empty() ? 0.0 : samples.back().timestamp;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> anyTime(0.0, duration);
+    std::vector<double> randomTimes(quick ? 200 : 1000);
+    for (double& t : randomTimes) {
+        t = anyTime(rng);
+    }
+    std::vector<double> frameTimes;
+    for (double t = 0.0; t <= duration; t += 1.0 / 30.0) {
+        frameTimes.push_back(t);
+    }
+
+    // The same positions 20-46 ms apart (dropped and late subtitle blocks)
+    // take the binary-search path
+    std::vector<GPSData> jittered = samples;
+    std::uniform_real_distribution<double> gap(0.020, 0.046);
+    double jitteredTime = 0.0;
+    for (GPSData& sample : jittered) {
+        sample.timestamp = jitteredTime;
+        jitteredTime += gap(rng);
+    }
+    GpsTrack uniformTrack(samples);
+    GpsTrack unevenTrack(jittered);
+    check(uniformTrack.isUniform() && !unevenTrack.isUniform(), "track spacing detected");
+
+    std::printf("GPS lookup (%zu samples)\n", samples.size());
+    double seconds = bestSeconds(runs, [&]() {
+        size_t valid = 0;
+        for (double t : randomTimes) valid += getGPSForTimestamp(samples, t).valid;
+        consume(valid);
+    });
+    record("lookup linear scan", seconds * 1e9 / randomTimes.size(), "ns/lookup");
+
+    const int lookupRepeats = 200;
+    seconds = bestSeconds(runs, [&]() {
+        size_t valid = 0;
+        for (int r = 0; r < lookupRepeats; r++)
+            for (double t : randomTimes) valid += uniformTrack.at(t).valid;
+        consume(valid);
+    });
+    record("lookup track uniform", seconds * 1e9 / (randomTimes.size() * lookupRepeats), "ns/lookup");
+
+    seconds = bestSeconds(runs, [&]() {
+        size_t valid = 0;
+        for (int r = 0; r < lookupRepeats; r++)
+            for (double t : randomTimes) valid += unevenTrack.at(t).valid;
+        consume(valid);
+    });
+    record("lookup track uneven", seconds * 1e9 / (randomTimes.size() * lookupRepeats), "ns/lookup");
+
+    std::vector<GPSData> batch;
+    seconds = bestSeconds(runs, [&]() { batch = uniformTrack.at(frameTimes); });
+    check(batch.size() == frameTimes.size(), "batch lookup size");
+    record("lookup track batch", seconds * 1e9 / frameTimes.size(), "ns/frame");
+
+    GPSData nearest = getGPSForTimestamp(samples, randomTimes[0]);
+    GPSData tracked = uniformTrack.at(randomTimes[0], GpsInterpolation::Nearest);
+    check(nearest.latitude == tracked.latitude && nearest.longitude == tracked.longitude,
+          "GpsTrack nearest matches getGPSForTimestamp");
+
+    // Strings written for every frame
+    std::printf("Formatting and commands\n");
+    const int formatCount = quick ? 20000 : 100000;
+    std::vector<double> degrees(formatCount);
+    std::uniform_real_distribution<double> anyDegree(-180.0, 180.0);
+    for (double& value : degrees) {
+        value = anyDegree(rng);
+    }
+    seconds = bestSeconds(runs, [&]() {
+        size_t length = 0;
+        for (double value : degrees) length += decimalToDMS(value).size();
+        consume(length);
+    });
+    record("decimalToDMS", seconds * 1e9 / formatCount, "ns/call");
+    check(decimalToDMS(-22.5430961) == "22 32 35.1460", "decimalToDMS output");
+
+    const int commandCount = formatCount / 10;
+    seconds = bestSeconds(runs, [&]() {
+        size_t length = 0;
+        for (int i = 0; i < commandCount; i++) {
+            const GPSData& gps = samples[i % samples.size()];
+            length += generateExiftoolCommand("C:\\Tools\\exiftool.exe", frameFileName("DJI_0042", i + 1),
+                                              gps.latitude, gps.longitude, gps.altitude).size();
+        }
+        consume(length);
+    });
+    record("generateExiftoolCommand", seconds * 1e9 / commandCount, "ns/call");
+
+    seconds = bestSeconds(runs, [&]() {
+        size_t length = 0;
+        for (int i = 0; i < formatCount; i++) length += frameFileName("DJI_0042", i + 1).size();
+        consume(length);
+    });
+    record("frameFileName", seconds * 1e9 / formatCount, "ns/call");
+    check(frameFileName("DJI_0042", 7) == "DJI_0042_frame_0007.jpg", "frameFileName output");
+
+    // One planned frame every ~2 s of the flight
+    std::vector<double> planned;
+    for (double t = 0.0; t < duration; t += 2.0) {
+        planned.push_back(t);
+    }
+    std::string filter;
+    seconds = bestSeconds(runs, [&]() { filter = buildSelectFilter(planned); });
+    record("buildSelectFilter", seconds * 1e9 / std::max<size_t>(1, planned.size()), "ns/frame");
+
+    fs::remove_all(dir);
+
+    if (!outPath.empty()) {
+        if (!saveResults(outPath, mode)) {
+            std::fprintf(stderr, "Cannot write %s\n", outPath.c_str());
+            return 2;
+        }
+        std::printf("Results written to %s\n", outPath.c_str());
+    }
+    return g_ok ? 0 : 1;
+}
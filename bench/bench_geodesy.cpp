@@ -0,0 +1,198 @@
+// Benchmark: batch WGS84 conversions and DMS formatting.
+//
+// Usage: bench_geodesy [points]
+// A synthetic flight (default 50000 positions, a 3 km lawnmower pattern) is
+// converted geodetic -> ENU, ECEF and UTM and back in structure-of-arrays
+// batches, against a point-at-a-time array-of-structures loop like the one
+// the spatial matcher used. Round trips and a few exact reference values are
+// checked to the millimetre. DMS strings are formatted with formatDms()
+// and, for comparison, through an ostringstream.
+
+#include "geodesy.h"
+#include "gps_embed.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const double kPi = 3.14159265358979323846;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename F>
+static double bestOf(int runs, F&& f) {
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = Clock::now();
+        f();
+        best = std::min(best, secondsSince(start));
+    }
+    return best;
+}
+
+static CoordinateArrays makeFlight(size_t count) {
+    CoordinateArrays flight;
+    flight.reserve(count);
+    const size_t perLine = 500;
+    for (size_t i = 0; i < count; i++) {
+        const size_t line = i / perLine;
+        double along = static_cast<double>(i % perLine) / perLine;
+        if (line % 2) along = 1.0 - along;
+        flight.push_back(47.38 + 0.0004 * static_cast<double>(line % 70), 8.54 + 0.04 * along,
+                         480.0 + 20.0 * std::sin(i * 0.01));
+    }
+    return flight;
+}
+
+// Point-at-a-time reference: one struct per position, ECEF then ENU
+struct Position {
+    double latitude, longitude, altitude;
+};
+
+static Vec3 scalarEnu(const GeoOrigin& origin, const Position& p) {
+    auto ecef = [](double latitude, double longitude, double altitude) -> Vec3 {
+        const double lat = latitude * kPi / 180.0, lon = longitude * kPi / 180.0;
+        const double n = wgs84::kSemiMajorAxis / std::sqrt(1.0 - wgs84::kEccentricity2 * std::sin(lat) * std::sin(lat));
+        return {(n + altitude) * std::cos(lat) * std::cos(lon), (n + altitude) * std::cos(lat) * std::sin(lon),
+                (n * (1.0 - wgs84::kEccentricity2) + altitude) * std::sin(lat)};
+    };
+    const Vec3 a = ecef(p.latitude, p.longitude, p.altitude);
+    const Vec3 o = ecef(origin.latitude, origin.longitude, origin.altitude);
+    const double d[3] = {a[0] - o[0], a[1] - o[1], a[2] - o[2]};
+    const double lat = origin.latitude * kPi / 180.0, lon = origin.longitude * kPi / 180.0;
+    return {-std::sin(lon) * d[0] + std::cos(lon) * d[1],
+            -std::sin(lat) * std::cos(lon) * d[0] - std::sin(lat) * std::sin(lon) * d[1] + std::cos(lat) * d[2],
+            std::cos(lat) * std::cos(lon) * d[0] + std::cos(lat) * std::sin(lon) * d[1] + std::sin(lat) * d[2]};
+}
+
+// Largest 3D distance in metres between two geodetic arrays
+static double geodeticError(const CoordinateArrays& a, const CoordinateArrays& b) {
+    double worst = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        const double metresPerDegree = 111320.0;
+        const double dn = (a.x[i] - b.x[i]) * metresPerDegree;
+        const double de = (a.y[i] - b.y[i]) * metresPerDegree * std::cos(a.x[i] * kPi / 180.0);
+        worst = std::max(worst, std::sqrt(dn * dn + de * de + (a.z[i] - b.z[i]) * (a.z[i] - b.z[i])));
+    }
+    return worst;
+}
+
+static bool check(const char* name, double error, double tolerance) {
+    const bool ok = error <= tolerance;
+    std::printf("  %-34s %10.2e m  %s\n", name, error, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 && std::atoi(argv[1]) > 0 ? static_cast<size_t>(std::atoi(argv[1])) : 50000;
+    const CoordinateArrays flight = makeFlight(count);
+    const GeoOrigin origin{47.394, 8.56, 480.0};
+    const int zone = utmZone(origin.latitude, origin.longitude);
+    bool ok = true;
+
+    std::printf("%zu positions (UTM zone %d), best of 5, million points/s\n", count, zone);
+    std::vector<Position> positions(count);
+    for (size_t i = 0; i < count; i++) {
+        positions[i] = {flight.x[i], flight.y[i], flight.z[i]};
+    }
+    std::vector<Vec3> scalar(count);
+    const double scalarSeconds = bestOf(5, [&]() {
+        for (size_t i = 0; i < count; i++) scalar[i] = scalarEnu(origin, positions[i]);
+    });
+
+    CoordinateArrays enu, ecef, utm, back;
+    const double enuSeconds = bestOf(5, [&]() { geodeticToEnu(origin, flight, enu); });
+    const double enuBackSeconds = bestOf(5, [&]() { enuToGeodetic(origin, enu, back); });
+    const double enuError = geodeticError(flight, back);
+    const double ecefSeconds = bestOf(5, [&]() { geodeticToEcef(flight, ecef); });
+    const double ecefBackSeconds = bestOf(5, [&]() { ecefToGeodetic(ecef, back); });
+    const double ecefError = geodeticError(flight, back);
+    const double utmSeconds = bestOf(5, [&]() { geodeticToUtm(zone, true, flight, utm); });
+    const double utmBackSeconds = bestOf(5, [&]() { utmToGeodetic(zone, true, utm, back); });
+    const double utmError = geodeticError(flight, back);
+
+    auto rate = [count](double seconds) { return count / seconds / 1e6; };
+    std::printf("  geodetic -> ENU, point at a time  %8.2f\n", rate(scalarSeconds));
+    std::printf("  geodetic -> ENU, batch            %8.2f  (%.1fx)\n", rate(enuSeconds), scalarSeconds / enuSeconds);
+    std::printf("  ENU -> geodetic, batch            %8.2f\n", rate(enuBackSeconds));
+    std::printf("  geodetic -> ECEF, batch           %8.2f\n", rate(ecefSeconds));
+    std::printf("  ECEF -> geodetic, batch           %8.2f\n", rate(ecefBackSeconds));
+    std::printf("  geodetic -> UTM, batch            %8.2f\n", rate(utmSeconds));
+    std::printf("  UTM -> geodetic, batch            %8.2f\n", rate(utmBackSeconds));
+
+    std::printf("Accuracy (limit 1 mm)\n");
+    double agreement = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        agreement = std::max(agreement, std::hypot(std::hypot(enu.x[i] - scalar[i][0], enu.y[i] - scalar[i][1]),
+                                                   enu.z[i] - scalar[i][2]));
+    }
+    ok = check("batch ENU vs point at a time", agreement, 1e-3) && ok;
+    ok = check("ENU round trip", enuError, 1e-3) && ok;
+    ok = check("ECEF round trip", ecefError, 1e-3) && ok;
+    ok = check("UTM round trip", utmError, 1e-3) && ok;
+
+    // Exact references: the equator and pole on the ellipsoid, and UTM on the
+    // central meridian, where the northing is k0 times the meridian arc
+    CoordinateArrays reference;
+    reference.push_back(0.0, 0.0, 0.0);
+    reference.push_back(90.0, 0.0, 0.0);
+    reference.push_back(0.0, 90.0, 100.0);
+    geodeticToEcef(reference, ecef);
+    const double ecefReference =
+        std::max({std::abs(ecef.x[0] - wgs84::kSemiMajorAxis), std::abs(ecef.z[1] - wgs84::kSemiMinorAxis),
+                  std::abs(ecef.y[2] - wgs84::kSemiMajorAxis - 100.0), std::abs(ecef.x[1]), std::abs(ecef.y[0])});
+    ok = check("ECEF of equator and pole", ecefReference, 1e-3) && ok;
+
+    const double latitude = 47.4;
+    double arc = 0.0;
+    const int steps = 100000;
+    for (int k = 0; k < steps; k++) {
+        const double phi = (k + 0.5) * latitude * kPi / 180.0 / steps;
+        const double s = std::sin(phi);
+        arc += wgs84::kSemiMajorAxis * (1.0 - wgs84::kEccentricity2) /
+               std::pow(1.0 - wgs84::kEccentricity2 * s * s, 1.5) * latitude * kPi / 180.0 / steps;
+    }
+    CoordinateArrays meridian;
+    meridian.push_back(latitude, 6.0 * zone - 183.0, 0.0);
+    geodeticToUtm(zone, true, meridian, meridian);
+    ok = check("UTM northing vs meridian arc",
+               std::max(std::abs(meridian.y[0] - 0.9996 * arc), std::abs(meridian.x[0] - 500000.0)), 1e-3) && ok;
+
+    std::printf("DMS formatting, million values/s\n");
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; i++) values[i] = flight.x[i];
+    size_t total = 0;
+    const double bufferSeconds = bestOf(5, [&]() {
+        char buffer[kDmsBufferSize];
+        for (double value : values) total += formatDms(value, buffer, sizeof(buffer));
+    });
+    const double streamSeconds = bestOf(5, [&]() {
+        for (double value : values) {
+            const double absolute = std::abs(value);
+            const int degrees = static_cast<int>(absolute);
+            const double minutes = (absolute - degrees) * 60.0;
+            std::ostringstream stream;
+            stream << degrees << " " << static_cast<int>(minutes) << " " << std::fixed << std::setprecision(4)
+                   << (minutes - static_cast<int>(minutes)) * 60.0;
+            total += stream.str().size();
+        }
+    });
+    std::printf("  formatDms                         %8.2f  (%.1fx)\n", rate(bufferSeconds),
+                streamSeconds / bufferSeconds);
+    std::printf("  ostringstream                     %8.2f\n", rate(streamSeconds));
+
+    const bool carry = decimalToDMS(47.99999999) == "48 0 0.0000" && decimalToDMS(-8.5) == "8 30 0.0000";
+    std::printf("  rounding carries into minutes     %s\n", carry ? "ok" : "FAILED");
+    ok = ok && carry && total > 0;
+
+    return ok ? 0 : 1;
+}
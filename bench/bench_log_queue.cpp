@@ -0,0 +1,134 @@
+// Benchmark: GUI log path (LogQueue + Scrollback).
+//
+// Usage: bench_log_queue [lines-per-producer]
+// 1. Producer cost per line for 1, 2 and 4 threads: lock-free LogQueue vs. a
+//    mutex-protected vector, while a consumer drains every millisecond. Every
+//    line is checked to arrive exactly once and in per-producer order.
+// 2. Scrollback: lines/s through the capped view and how often it resets.
+
+#include "log_queue.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// The obvious alternative: producers and consumer share one lock
+class MutexLogQueue {
+public:
+    bool push(std::string line) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lines.push_back(std::move(line));
+        return true;
+    }
+
+    size_t drain(std::vector<std::string>& out) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& line : m_lines) {
+            out.push_back(std::move(line));
+        }
+        m_lines.clear();
+        return 0;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::string> m_lines;
+};
+
+// "<producer> <sequence> <padding>"; returns false if any line is lost, duplicated or reordered
+template <typename Queue>
+static bool runProducers(Queue& queue, int producers, size_t linesEach, double& nsPerLine) {
+    std::atomic<int> running{producers};
+    std::vector<std::string> received;
+    received.reserve(producers * linesEach);
+
+    std::thread consumer([&]() {
+        while (running.load() > 0) {
+            queue.drain(received);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        queue.drain(received);
+    });
+
+    std::vector<double> seconds(producers);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            char line[96];
+            auto start = Clock::now();
+            for (size_t i = 0; i < linesEach; i++) {
+                std::snprintf(line, sizeof(line), "%d %zu Matching block [%zu/%zu]", p, i, i, linesEach);
+                queue.push(line);
+            }
+            seconds[p] = secondsSince(start);
+            running--;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    consumer.join();
+
+    nsPerLine = *std::max_element(seconds.begin(), seconds.end()) * 1e9 / linesEach;
+
+    std::vector<size_t> next(producers, 0);
+    for (const auto& line : received) {
+        int p = std::atoi(line.c_str());
+        size_t i = std::strtoul(line.c_str() + line.find(' ') + 1, nullptr, 10);
+        if (p < 0 || p >= producers || i != next[p]) {
+            return false;
+        }
+        next[p]++;
+    }
+    return received.size() == producers * linesEach;
+}
+
+int main(int argc, char** argv) {
+    const size_t linesEach = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    bool ok = true;
+
+    std::printf("Producer cost, %zu lines per producer\n", linesEach);
+    for (int producers : {1, 2, 4}) {
+        double lockFree = 0.0, locked = 0.0;
+        LogQueue queue;
+        MutexLogQueue mutexQueue;
+        bool same = runProducers(queue, producers, linesEach, lockFree) &&
+                    runProducers(mutexQueue, producers, linesEach, locked);
+        ok = ok && same;
+        std::printf("  %d producer(s)  LogQueue %7.1f ns/line  mutex queue %7.1f ns/line  %s\n",
+                    producers, lockFree, locked, same ? "ordered" : "MISMATCH");
+    }
+
+    // 50 ms timer batches of a chatty tool at ~20k lines/s
+    const size_t batchLines = 1000;
+    const size_t batches = std::max<size_t>(1, linesEach / batchLines);
+    Scrollback scrollback(512 * 1024);
+    std::vector<std::string> batch(batchLines, std::string(60, 'x'));
+    size_t resets = 0;
+    size_t maxSize = 0;
+    auto start = Clock::now();
+    for (size_t b = 0; b < batches; b++) {
+        Scrollback::Update update = scrollback.append(batch);
+        resets += update.replaceAll ? 1 : 0;
+        maxSize = std::max(maxSize, scrollback.size());
+    }
+    double seconds = secondsSince(start);
+    bool capped = maxSize <= 512 * 1024;
+    ok = ok && capped;
+    std::printf("Scrollback (512 KB cap), %zu batches of %zu lines\n", batches, batchLines);
+    std::printf("  %.1f M lines/s  %zu resets  max size %zu chars  %s\n",
+                batches * batchLines / seconds / 1e6, resets, maxSize, capped ? "capped" : "OVER CAP");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+// Benchmark: keyframe sharpness scoring.
+//
+// Usage: bench_sharpness [iterations]
+// Variance of the Laplacian on synthetic frames at the scoring size (480 px
+// wide) and at 1080p: SSE2 kernel vs. the scalar reference, in megapixels/s,
+// with a check that both give the same score. Also checks that a blurred
+// frame scores lower than the sharp original.
+
+#include "sharpness.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Random texture with some hard edges, like ground seen from a drone
+static GrayImage makeFrame(size_t width, size_t height, unsigned seed) {
+    GrayImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(width * height);
+    std::mt19937 rng(seed);
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            int base = ((x / 24 + y / 24) % 2) ? 170 : 70;
+            image.pixels[y * width + x] = static_cast<uint8_t>(base + static_cast<int>(rng() % 41) - 20);
+        }
+    }
+    return image;
+}
+
+// Horizontal box blur, a crude stand-in for motion blur
+static GrayImage blurred(const GrayImage& image, int radius) {
+    GrayImage out = image;
+    for (size_t y = 0; y < image.height; y++) {
+        for (size_t x = 0; x < image.width; x++) {
+            int sum = 0, count = 0;
+            for (int d = -radius; d <= radius; d++) {
+                long sx = static_cast<long>(x) + d;
+                if (sx >= 0 && sx < static_cast<long>(image.width)) {
+                    sum += image.pixels[y * image.width + sx];
+                    count++;
+                }
+            }
+            out.pixels[y * image.width + x] = static_cast<uint8_t>(sum / count);
+        }
+    }
+    return out;
+}
+
+template <typename F>
+static double bestOf(int runs, F&& f) {
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = Clock::now();
+        f();
+        best = std::min(best, secondsSince(start));
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20;
+    bool ok = true;
+
+    std::printf("Variance of Laplacian, best of 3 x %d frames\n", iterations);
+    for (auto size : {std::make_pair(size_t(480), size_t(270)), std::make_pair(size_t(1920), size_t(1080))}) {
+        GrayImage frame = makeFrame(size.first, size.second, 1);
+        const double megapixels = size.first * size.second / 1e6 * iterations;
+        double fast = 0.0, reference = 0.0;
+        double fastSeconds = bestOf(3, [&]() {
+            for (int i = 0; i < iterations; i++) fast = laplacianVariance(frame);
+        });
+        double scalarSeconds = bestOf(3, [&]() {
+            for (int i = 0; i < iterations; i++) {
+                reference = laplacianVarianceScalar(frame.pixels.data(), frame.width, frame.height, frame.width);
+            }
+        });
+        bool same = fast == reference;
+        ok = ok && same;
+        std::printf("  %4zux%-4zu  kernel %8.1f MP/s  scalar %8.1f MP/s  speedup %4.1fx  %s\n",
+                    size.first, size.second, megapixels / fastSeconds, megapixels / scalarSeconds,
+                    scalarSeconds / fastSeconds, same ? "identical" : "MISMATCH");
+    }
+
+    GrayImage sharp = makeFrame(480, 270, 2);
+    double sharpScore = laplacianVariance(sharp);
+    double blurScore = laplacianVariance(blurred(sharp, 4));
+    bool ordered = blurScore < sharpScore;
+    ok = ok && ordered;
+    std::printf("Sharp frame %.1f, blurred frame %.1f  %s\n", sharpScore, blurScore,
+                ordered ? "blur detected" : "NOT DETECTED");
+
+    return ok ? 0 : 1;
+}
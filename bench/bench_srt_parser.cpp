@@ -0,0 +1,144 @@
+// Benchmark: streaming SRT scanner vs. the original regex-based parser.
+//
+// Usage: bench_srt_parser [blocks]
+// Generates synthetic DJI SRT files in each supported format, checks that both
+// parsers produce identical GPSData and reports throughput in MB/s.
+
+#include "gps_embed.h"
+#include "synthetic_srt.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+// The parser as it was before the streaming rewrite, kept as the reference
+static std::vector<GPSData> parseSRTRegex(const std::string& srtPath) {
+    std::vector<GPSData> frames;
+    std::ifstream file(srtPath);
+    if (!file.is_open()) {
+        return frames;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::regex blockRegex("\\n\\n+");
+    std::sregex_token_iterator iter(content.begin(), content.end(), blockRegex, -1);
+    std::sregex_token_iterator end;
+
+    std::regex timeRegex("(\\d{2}):(\\d{2}):(\\d{2}),(\\d{3})");
+    std::regex gpsRegex("GPS:\\s*\\(([\\-\\d\\.]+)\\s*,\\s*([\\-\\d\\.]+)\\)");
+    std::regex latRegex("\\[latitude:\\s*([\\-\\d\\.]+)\\]", std::regex::icase);
+    std::regex lonRegex("\\[longtitude:\\s*([\\-\\d\\.]+)\\]", std::regex::icase);
+    std::regex altRegex1("H:\\s*([\\-\\d\\.]+)m");
+    std::regex altRegex2("\\[altitude:\\s*([\\-\\d\\.]+)\\]", std::regex::icase);
+
+    for (; iter != end; ++iter) {
+        std::string block = iter->str();
+        std::istringstream iss(block);
+        std::string line;
+        std::vector<std::string> lines;
+        while (std::getline(iss, line)) {
+            if (!line.empty() && line != "\\r") {
+                lines.push_back(line);
+            }
+        }
+        if (lines.size() < 3) continue;
+
+        std::smatch timeMatch;
+        if (!std::regex_search(lines[1], timeMatch, timeRegex)) continue;
+        double timestamp = std::stoi(timeMatch[1]) * 3600 + std::stoi(timeMatch[2]) * 60 +
+                           std::stoi(timeMatch[3]) + std::stoi(timeMatch[4]) / 1000.0;
+
+        std::string metadata;
+        for (size_t i = 2; i < lines.size(); i++) {
+            metadata += lines[i] + " ";
+        }
+
+        GPSData data;
+        data.timestamp = timestamp;
+        std::smatch gpsMatch;
+        if (std::regex_search(metadata, gpsMatch, gpsRegex)) {
+            data.longitude = std::stod(gpsMatch[1]);
+            data.latitude = std::stod(gpsMatch[2]);
+            data.valid = true;
+        } else {
+            std::smatch latMatch, lonMatch;
+            if (std::regex_search(metadata, latMatch, latRegex)) {
+                data.latitude = std::stod(latMatch[1]);
+            }
+            if (std::regex_search(metadata, lonMatch, lonRegex)) {
+                data.longitude = std::stod(lonMatch[1]);
+            }
+            if (latMatch.size() > 0 && lonMatch.size() > 0) {
+                data.valid = true;
+            }
+        }
+        std::smatch altMatch;
+        if (std::regex_search(metadata, altMatch, altRegex1)) {
+            data.altitude = std::stod(altMatch[1]);
+        } else if (std::regex_search(metadata, altMatch, altRegex2)) {
+            data.altitude = std::stod(altMatch[1]);
+        }
+        if (data.valid) {
+            frames.push_back(data);
+        }
+    }
+    return frames;
+}
+
+static bool sameFrames(const std::vector<GPSData>& a, const std::vector<GPSData>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].latitude != b[i].latitude || a[i].longitude != b[i].longitude ||
+            a[i].altitude != b[i].altitude || a[i].timestamp != b[i].timestamp || a[i].valid != b[i].valid) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Best of several runs, to keep page-cache and scheduler noise out of the number
+template <typename Parser>
+static double throughput(Parser parse, const fs::path& path, double megabytes, std::vector<GPSData>& result,
+                         int runs) {
+    double best = 1e30;
+    for (int run = 0; run < runs; run++) {
+        auto start = Clock::now();
+        result = parse(path.string());
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return megabytes / best;
+}
+
+int main(int argc, char** argv) {
+    int blocks = argc > 1 ? std::atoi(argv[1]) : 20000;
+    if (blocks <= 0) blocks = 20000;
+
+    fs::path path = fs::temp_directory_path() / "dronerecon_bench.srt";
+    bool allMatch = true;
+
+    for (SrtFormat format : {SrtFormat::BracketTags, SrtFormat::GpsPair, SrtFormat::Mixed}) {
+        writeSyntheticSrt(path, blocks, format);
+        double megabytes = fs::file_size(path) / (1024.0 * 1024.0);
+
+        std::vector<GPSData> streamed, reference;
+        double streamedRate = throughput(parseSRT, path, megabytes, streamed, 5);
+        double regexRate = throughput(parseSRTRegex, path, megabytes, reference, 1);
+        bool match = sameFrames(streamed, reference);
+        allMatch = allMatch && match;
+
+        std::printf("%-14s %7.2f MB %7zu entries  streaming %8.1f MB/s  regex %6.1f MB/s  speedup %6.1fx  %s\n",
+                    srtFormatName(format), megabytes, streamed.size(), streamedRate, regexRate,
+                    streamedRate / regexRate, match ? "identical" : "MISMATCH");
+    }
+
+    fs::remove(path);
+    return allMatch ? 0 : 1;
+}
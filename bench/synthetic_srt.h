@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// Synthetic DJI subtitle files for the benchmarks. The content only depends on
+// the arguments, so results stay comparable between builds and machines.
+
+enum class SrtFormat {
+    BracketTags,  // DJI Mini/Air: "[latitude: ..] [longtitude: ..] [rel_alt: .. abs_alt: ..]"
+    GpsPair,      // older models: "GPS:(lon, lat), ... H: ..m"
+    Mixed         // alternating blocks of both
+};
+
+inline const char* srtFormatName(SrtFormat format) {
+    switch (format) {
+        case SrtFormat::BracketTags: return "bracket tags";
+        case SrtFormat::GpsPair: return "GPS:(lon,lat)";
+        case SrtFormat::Mixed: return "mixed";
+    }
+    return "unknown";
+}
+
+inline std::string srtTime(int ms) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d,%03d",
+                  ms / 3600000, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000);
+    return buffer;
+}
+
+// One block per frameMs milliseconds of video (33 = one per 30 fps frame, as
+// DJI writes them); crlf writes Windows line endings
+inline void writeSyntheticSrt(const std::filesystem::path& path, int blocks, SrtFormat format,
+                              bool crlf = false, int frameMs = 33) {
+    std::ofstream out(path, std::ios::binary);
+    const char* eol = crlf ? "\r\n" : "\n";
+    for (int i = 0; i < blocks; i++) {
+        int startMs = i * frameMs;
+        double lat = 22.543096 + i * 1e-6;
+        double lon = 113.958313 + i * 2e-6;
+        double alt = 95.0 + (i % 100) * 0.1;
+        out << (i + 1) << eol << srtTime(startMs) << " --> " << srtTime(startMs + frameMs) << eol;
+        bool brackets = format == SrtFormat::BracketTags || (format == SrtFormat::Mixed && i % 2 == 0);
+        char line[512];
+        if (brackets) {
+            std::snprintf(line, sizeof(line),
+                "<font size=\"28\">FrameCnt: %d, DiffTime: %dms%s"
+                "2025-12-06 14:03:%02d.%03d%s"
+                "[iso: 100] [shutter: 1/640.0] [fnum: 1.7] [ev: 0] [color_md: default] [focal_len: 24.00] "
+                "[latitude: %.6f] [longtitude: %.6f] [rel_alt: 40.100 abs_alt: %.3f] [ct: 5234] </font>%s",
+                i + 1, frameMs, eol, (startMs / 1000) % 60, startMs % 1000, eol, lat, lon, alt, eol);
+        } else {
+            std::snprintf(line, sizeof(line),
+                "F/2.8, SS 1000, ISO 100, EV 0, GPS:(%.6f, %.6f), D 12.34m, H: %.2fm, H.S 5.10m/s, V.S 0.00m/s%s",
+                lon, lat, alt, eol);
+        }
+        out << line << eol;
+    }
+}
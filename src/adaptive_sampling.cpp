@@ -0,0 +1,132 @@
+#include "adaptive_sampling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const double kEarthRadius = 6378137.0;
+const double kPi = 3.14159265358979323846;
+
+// "if(lt(t,Tmid),left,right)" down to one timestamp per leaf. A frame in
+// [T_k, T_k+1) is selected if the previous frame was still before T_k.
+void appendSearch(const std::vector<double>& timestamps, size_t lo, size_t hi, std::string& out) {
+    char number[32];
+    if (hi - lo == 1) {
+        std::snprintf(number, sizeof(number), "%.6f", timestamps[lo]);
+        out += "not(gte(prev_t,";
+        out += number;
+        out += "))";
+        return;
+    }
+    const size_t mid = lo + (hi - lo) / 2;
+    std::snprintf(number, sizeof(number), "%.6f", timestamps[mid]);
+    out += "if(lt(t,";
+    out += number;
+    out += "),";
+    appendSearch(timestamps, lo, mid, out);
+    out += ',';
+    appendSearch(timestamps, mid, hi, out);
+    out += ')';
+}
+
+} // namespace
+
+SamplingPlan planSampling(const std::vector<TrackPoint>& track, const SamplingOptions& options) {
+    SamplingPlan plan;
+    if (track.size() < 2) {
+        return plan;
+    }
+
+    // Cumulative horizontal distance at every sample (equirectangular per segment)
+    std::vector<double> distance(track.size(), 0.0);
+    const double metresPerDegree = kEarthRadius * kPi / 180.0;
+    for (size_t i = 1; i < track.size(); i++) {
+        const double lat = (track[i].latitude + track[i - 1].latitude) * 0.5;
+        const double dx = (track[i].longitude - track[i - 1].longitude) * metresPerDegree * std::cos(lat * kPi / 180.0);
+        const double dy = (track[i].latitude - track[i - 1].latitude) * metresPerDegree;
+        distance[i] = distance[i - 1] + std::sqrt(dx * dx + dy * dy);
+    }
+    plan.trackLength = distance.back();
+
+    double ground = track.front().altitude;
+    for (const auto& point : track) {
+        ground = std::min(ground, point.altitude);
+    }
+    const double footprintPerMetre = 2.0 * std::tan(options.fovDegrees * kPi / 360.0);
+    const double overlap = std::clamp(options.overlap, 0.0, 0.99);
+    auto spacingAt = [&](size_t i) {
+        if (options.groundDistance > 0.0) {
+            return options.groundDistance;
+        }
+        const double height = options.height > 0.0 ? options.height
+                                                    : std::max(options.minHeight, track[i].altitude - ground);
+        return height * footprintPerMetre * (1.0 - overlap);
+    };
+
+    // Distance flown and track index at time t (segment walks forward only)
+    size_t segment = 0;
+    auto advanceTo = [&](double t) {
+        while (segment + 2 < track.size() && t >= track[segment + 1].timestamp) {
+            segment++;
+        }
+    };
+    auto distanceAt = [&](double t) {
+        advanceTo(t);
+        const TrackPoint& a = track[segment];
+        const TrackPoint& b = track[segment + 1];
+        const double span = b.timestamp - a.timestamp;
+        const double u = span > 0.0 ? std::clamp((t - a.timestamp) / span, 0.0, 1.0) : 1.0;
+        return distance[segment] + (distance[segment + 1] - distance[segment]) * u;
+    };
+
+    const double end = track.back().timestamp;
+    double t = std::max(0.0, track.front().timestamp);
+    plan.minSpacing = plan.maxSpacing = spacingAt(0);
+    while (t <= end) {
+        plan.timestamps.push_back(t);
+        advanceTo(t);
+        const double spacing = spacingAt(segment);
+        plan.minSpacing = std::min(plan.minSpacing, spacing);
+        plan.maxSpacing = std::max(plan.maxSpacing, spacing);
+
+        // First sample whose distance reaches the target, then interpolate inside its segment
+        const double target = distanceAt(t) + spacing;
+        size_t i = segment + 1;
+        while (i < track.size() && distance[i] < target) {
+            i++;
+        }
+        double next;
+        if (i >= track.size()) {
+            next = end + 1.0;  // the rest of the track is shorter than one spacing
+        } else {
+            const double d0 = distance[i - 1];
+            const double d1 = distance[i];
+            const double u = d1 > d0 ? (target - d0) / (d1 - d0) : 1.0;
+            next = track[i - 1].timestamp + (track[i].timestamp - track[i - 1].timestamp) * u;
+        }
+
+        next = std::max(next, t + std::max(options.minInterval, 1e-3));
+        if (options.maxInterval > 0.0) {
+            next = std::min(next, t + options.maxInterval);
+        }
+        t = next;
+    }
+    return plan;
+}
+
+std::string buildSelectFilter(const std::vector<double>& timestamps) {
+    if (timestamps.empty()) {
+        return "select='0'";
+    }
+    std::string expression;
+    expression.reserve(timestamps.size() * 48);
+    char first[32];
+    std::snprintf(first, sizeof(first), "%.6f", timestamps.front());
+    expression += "select='if(lt(t,";
+    expression += first;
+    expression += "),0,";
+    appendSearch(timestamps, 0, timestamps.size(), expression);
+    expression += ")'";
+    return expression;
+}
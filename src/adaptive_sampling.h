@@ -0,0 +1,44 @@
+#ifndef ADAPTIVE_SAMPLING_H
+#define ADAPTIVE_SAMPLING_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One SRT sample (altitude in metres, as parsed from the subtitle file)
+struct TrackPoint {
+    double timestamp = 0.0;
+    double latitude = 0.0;
+    double longitude = 0.0;
+    double altitude = 0.0;
+};
+
+// How far apart consecutive frames should be on the ground
+struct SamplingOptions {
+    double overlap = 0.8;          // forward overlap between consecutive frames (0..1)
+    double groundDistance = 0.0;   // metres between frames; overrides overlap when > 0
+    double fovDegrees = 45.0;      // camera field of view along the flight direction
+    double height = 0.0;           // metres above ground, 0 = altitude above the track's lowest point
+    double minHeight = 5.0;        // floor for the derived height (take-off, landing)
+    double minInterval = 0.1;      // seconds, fastest frame rate ever used
+    double maxInterval = 10.0;     // seconds, a frame at least this often (hover, turns); 0 = never
+};
+
+struct SamplingPlan {
+    std::vector<double> timestamps;  // ascending, seconds from the start of the video
+    double trackLength = 0.0;        // horizontal metres flown
+    double minSpacing = 0.0;         // smallest and largest ground spacing used
+    double maxSpacing = 0.0;
+};
+
+// Frame times for the track: a new frame whenever the drone has moved the
+// ground spacing for its current height (footprint x (1 - overlap)), limited
+// by minInterval / maxInterval. Empty if the track has fewer than two points.
+SamplingPlan planSampling(const std::vector<TrackPoint>& track, const SamplingOptions& options);
+
+// ffmpeg "select" filter that passes the first decoded frame at or after each
+// timestamp. The expression is a binary search over the sorted timestamps, so
+// each decoded frame costs O(log n) comparisons. Use with -fps_mode vfr.
+std::string buildSelectFilter(const std::vector<double>& timestamps);
+
+#endif // ADAPTIVE_SAMPLING_H
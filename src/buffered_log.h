@@ -0,0 +1,45 @@
+#pragma once
+#include "pipeline.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Log sink for one of several concurrently running jobs.
+// Lines are collected while the job runs and written to the shared sink as one
+// contiguous block, so output from parallel jobs never interleaves.
+class BufferedLog {
+public:
+    BufferedLog(LogCallback sink, std::mutex& sinkMutex, std::string prefix = "")
+        : m_sink(std::move(sink)), m_sinkMutex(sinkMutex), m_prefix(std::move(prefix)) {}
+
+    // Callback to hand to the job; safe to call from any thread
+    LogCallback callback() {
+        return [this](const std::string& line) {
+            std::lock_guard<std::mutex> lock(m_linesMutex);
+            m_lines.push_back(m_prefix + line);
+        };
+    }
+
+    // Emit everything collected so far as one block, optionally under a header line
+    void flush(const std::string& header = "") {
+        std::vector<std::string> lines;
+        {
+            std::lock_guard<std::mutex> lock(m_linesMutex);
+            lines.swap(m_lines);
+        }
+        std::lock_guard<std::mutex> lock(m_sinkMutex);
+        if (!header.empty()) {
+            m_sink(header);
+        }
+        for (const auto& line : lines) {
+            m_sink(line);
+        }
+    }
+
+private:
+    LogCallback m_sink;
+    std::mutex& m_sinkMutex;
+    std::string m_prefix;
+    std::mutex m_linesMutex;
+    std::vector<std::string> m_lines;
+};
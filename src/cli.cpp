@@ -0,0 +1,830 @@
+#include "cli.h"
+#include "pipeline.h"
+#include "matching_strategy.h"
+#include "perf_report.h"
+#include "image_pyramid.h"
+#include "colmap_model.h"
+#include "disk_budget.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Set by SIGINT / SIGTERM; running jobs stop and pending ones are skipped
+std::atomic<bool> g_interrupted{false};
+
+void onInterrupt(int signal) {
+    g_interrupted = true;
+    std::signal(signal, SIG_DFL);  // a second one ends the program at once
+}
+
+struct CliJob {
+    std::string name;
+    PipelineConfig config;
+    int line = 0;  // job file line of the [job] header, 0 for command-line jobs
+};
+
+struct JobResult {
+    bool success = false;
+    bool cancelled = false;  // interrupted, or never started because of that
+    double seconds = 0.0;
+    std::string logPath;
+    std::string error;
+};
+
+void printUsage() {
+    std::cout <<
+        "Usage: DroneReconCLI [options]\n"
+        "       DroneReconCLI --job-file FILE [--jobs N] [options]\n"
+        "       DroneReconCLI --convert-model IN_DIR OUT_DIR [--model-format binary|text]\n"
+        "\n"
+        "Runs the reconstruction pipeline without a GUI.\n"
+        "\n"
+        "Job options (defaults for every job when a job file is used):\n"
+        "  --video PATH            video file or folder of videos\n"
+        "  --output DIR            output directory\n"
+        "  --fps N                 frames per second to extract (default 1.0)\n"
+        "  --method NAME           colmap, metashape or realityscan (default colmap)\n"
+        "  --ffmpeg PATH           ffmpeg executable (default: vendor/ next to this program, then PATH)\n"
+        "  --colmap PATH           colmap executable (default: vendor/ next to this program, then PATH)\n"
+        "  --metashape PATH        Metashape executable\n"
+        "  --realityscan PATH      RealityScan executable\n"
+        "  --parallel-videos N     videos extracted at once in folder mode (0 = auto)\n"
+        "  --ffmpeg-threads N      threads per ffmpeg process (0 = auto)\n"
+        "  --matching MODE         COLMAP pair selection: auto, exhaustive, sequential, spatial,\n"
+        "                          vocab_tree or pairs (default auto)\n"
+        "  --vocab-tree FILE       vocabulary tree for loop detection / vocab_tree matching\n"
+        "  --mapper-options ARGS   extra arguments for COLMAP's mapper\n"
+        "  --no-geo-registration   leave COLMAP's model in its arbitrary frame instead of fitting\n"
+        "                          it to the frames' GPS positions (metres, east-north-up)\n"
+        "  --geo-max-error M       geo-registration: cameras further than M metres from their\n"
+        "                          GPS position are outliers (default 5)\n"
+        "  --tile-frames N         COLMAP: above N frames, reconstruct overlapping spatial tiles of\n"
+        "                          up to N frames as separate jobs and merge them (0 = off)\n"
+        "  --tile-overlap M        tiles also take the frames within M metres (default 30)\n"
+        "  --tile-jobs N           tiles reconstructed at once (0 = a quarter of the cores)\n"
+        "  --timeout [STAGE=]S     kill a tool that runs longer than S seconds, and fail its stage\n"
+        "  --stall-timeout [STAGE=]S  kill a tool that prints nothing for S seconds\n"
+        "                          STAGE: extract, features, matching, mapper, undistort, pyramid,\n"
+        "                          metashape, realityscan or all (the default); repeatable\n"
+        "  --disk-budget SIZE      most the output directory may hold, e.g. 500G (default: the free\n"
+        "                          space of its volume); checked against an estimate before extraction\n"
+        "  --disk-budget-action A  when the estimate exceeds it: warn (default), refuse, or adapt\n"
+        "                          (clean up intermediates, then lower JPEG quality and fps)\n"
+        "  --cleanup-intermediates remove each COLMAP database once its model is built\n"
+        "  --remove-distorted-frames  remove the extracted frames once the images are undistorted\n"
+        "                          (COLMAP, RealityScan); a rerun extracts them again but keeps\n"
+        "                          the reconstruction while the inputs are unchanged\n"
+        "  --no-resume             rerun every stage even if <output>/pipeline_manifest.txt\n"
+        "                          records it as complete with the same inputs\n"
+        "  --per-video-links       also link each video's frames into frames/<video>/\n"
+        "  --keyframes             keep the sharpest of several candidates per extracted frame\n"
+        "  --keyframe-oversample N candidates decoded per extracted frame (default 4)\n"
+        "  --keyframe-blur-ratio X skip an interval whose sharpest candidate scores below X times\n"
+        "                          the recent median (default 0.3, 0 = never skip)\n"
+        "  --adaptive-sampling     pick frame times from the SRT track (distance flown, height)\n"
+        "                          instead of a fixed --fps\n"
+        "  --overlap X             adaptive: forward overlap between frames (default 0.8)\n"
+        "  --ground-distance M     adaptive: metres between frames, overrides --overlap\n"
+        "  --camera-fov DEG        adaptive: along-track field of view (default 45)\n"
+        "  --height M              adaptive: height above ground (default: from the track)\n"
+        "  --max-interval S        adaptive: at least one frame every S seconds (default 10, 0 = off)\n"
+        "  --pyramid N             also write every frame and reconstruction image at 1/2 .. 1/2^N\n"
+        "                          size (images_2/, images_4/, ...) from the same decode (max 4)\n"
+        "  --pyramid-quality LIST  ffmpeg -q:v per level, full size first (default 2,3,3,4)\n"
+        "  --log-lines-per-second N  cap on tool output lines logged per second (0 = all)\n"
+        "\n"
+        "Runner options:\n"
+        "  --job-file FILE         run the [job] sections of FILE\n"
+        "  --jobs N                number of jobs run at the same time (default 1)\n"
+        "  --summary FILE          write a JSON summary of all jobs to FILE\n"
+        "  --quiet                 only print RESULT lines (full logs still go to <output>/pipeline.log)\n"
+        "  --progress[=S]          print a PROGRESS line per job every S seconds (default 10)\n"
+        "                          and whenever a stage finishes\n"
+        "  --convert-model IN OUT  check the COLMAP model in IN (text or binary) and write it to\n"
+        "                          OUT, then exit; 1 if it cannot be read or is inconsistent\n"
+        "  --model-format FORMAT   format --convert-model writes: binary (default) or text\n"
+        "  --help                  show this help\n"
+        "\n"
+        "Job file format (settings.ini keys, one [job] section per job; keys before\n"
+        "the first section apply to every job):\n"
+        "  [job]\n"
+        "  name=flight1\n"
+        "  video_path=/data/flight1\n"
+        "  output_path=/scratch/flight1\n"
+        "  fps=2\n"
+        "  method=colmap\n"
+        "\n"
+        "Exit codes: 0 all jobs succeeded, 1 at least one job failed, 2 usage or job file error,\n"
+        "130 interrupted. Ctrl+C (or SIGTERM) stops the running tools, removes their partial\n"
+        "output and skips the jobs not started yet; a second one exits at once.\n"
+        "Each finished job prints one line:\n"
+        "  RESULT job=<name> status=ok|failed|cancelled seconds=<s> log=<path>\n"
+        "With --progress, running jobs also print (-1 = not known yet):\n"
+        "  PROGRESS job=<name> stage=\"<stage>\" done=<n> total=<n> unit=<unit> rate=<n/s> eta=<s>\n"
+        "           overall=<percent> overall_eta=<s> elapsed=<s>\n";
+}
+
+std::string trim(const std::string& text) {
+    const char* spaces = " \t\r\n";
+    size_t begin = text.find_first_not_of(spaces);
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(spaces);
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+bool parseInt(const std::string& value, int& out) {
+    char* end = nullptr;
+    long number = std::strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || number < 0 || number > 1000000) {
+        return false;
+    }
+    out = static_cast<int>(number);
+    return true;
+}
+
+// Number within [min, max]
+bool parseNumber(const std::string& value, double min, double max, double& out) {
+    char* end = nullptr;
+    double number = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0' || !(number >= min && number <= max)) {
+        return false;
+    }
+    out = number;
+    return true;
+}
+
+bool parseBool(const std::string& value, bool& out) {
+    std::string lower = toLower(value);
+    if (lower == "1" || lower == "true" || lower == "yes" || lower == "on") {
+        out = true;
+    } else if (lower == "0" || lower == "false" || lower == "no" || lower == "off") {
+        out = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// "[stage=]seconds" for one of the tool watchdogs of config; 0 turns it off.
+// error is completed by the caller with the key in front.
+bool parseToolTimeout(const std::string& value, bool stall, PipelineConfig& config, std::string& error) {
+    static const char* const stages[] = {"all", "extract", "features", "matching", "mapper",
+                                         "undistort", "pyramid", "metashape", "realityscan"};
+    const size_t eq = value.find('=');
+    const std::string stage = eq == std::string::npos ? "all" : toLower(trim(value.substr(0, eq)));
+    const std::string seconds = eq == std::string::npos ? value : trim(value.substr(eq + 1));
+    if (std::find(std::begin(stages), std::end(stages), stage) == std::end(stages)) {
+        error = " names an unknown stage '" + stage + "' (extract, features, matching, mapper, undistort, pyramid, "
+                "metashape, realityscan or all)";
+        return false;
+    }
+    ToolTimeout& timeout = config.toolTimeouts[stage];
+    if (!parseNumber(seconds, 0.0, 1e7, stall ? timeout.stallSeconds : timeout.seconds)) {
+        error = " must be [stage=]seconds, got '" + value + "'";
+        return false;
+    }
+    return true;
+}
+
+// Apply one settings.ini-style key to a job. Returns false with a message on bad input.
+bool applySetting(CliJob& job, const std::string& key, const std::string& value, std::string& error) {
+    PipelineConfig& config = job.config;
+    if (key == "name") {
+        job.name = value;
+    } else if (key == "video_path") {
+        config.videoPath = value;
+    } else if (key == "output_path") {
+        config.outputBaseDir = value;
+    } else if (key == "fps") {
+        char* end = nullptr;
+        double fps = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0' || !(fps > 0.0)) {
+            error = "fps must be a positive number, got '" + value + "'";
+            return false;
+        }
+        config.frameRate = fps;
+    } else if (key == "method") {
+        std::string method = toLower(value);
+        if (method == "colmap") {
+            config.method = ReconMethod::COLMAP;
+        } else if (method == "metashape") {
+            config.method = ReconMethod::METASHAPE;
+        } else if (method == "realityscan") {
+            config.method = ReconMethod::REALITYSCAN;
+        } else {
+            error = "unknown method '" + value + "' (colmap, metashape or realityscan)";
+            return false;
+        }
+    } else if (key == "metashape_path") {
+        config.metashapeExePath = value;
+    } else if (key == "realityscan_path") {
+        config.realityscanExePath = value;
+    } else if (key == "ffmpeg_path") {
+        config.ffmpegPath = value;
+    } else if (key == "colmap_path") {
+        config.colmapPath = value;
+    } else if (key == "parallel_videos") {
+        if (!parseInt(value, config.maxParallelVideos)) {
+            error = "parallel_videos must be a non-negative integer, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "ffmpeg_threads") {
+        if (!parseInt(value, config.ffmpegThreads)) {
+            error = "ffmpeg_threads must be a non-negative integer, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "log_lines_per_second") {
+        if (!parseInt(value, config.maxLogLinesPerSecond)) {
+            error = "log_lines_per_second must be a non-negative integer, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "matching") {
+        if (!parseMatchingMode(toLower(value), config.matchingMode)) {
+            error = "unknown matching mode '" + value + "' (auto, exhaustive, sequential, spatial, vocab_tree or pairs)";
+            return false;
+        }
+    } else if (key == "vocab_tree_path") {
+        config.vocabTreePath = value;
+    } else if (key == "per_video_links") {
+        if (!parseBool(value, config.perVideoFrameLinks)) {
+            error = "per_video_links must be true or false, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "keyframes") {
+        if (!parseBool(value, config.keyframeSelection)) {
+            error = "keyframes must be true or false, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "keyframe_oversample") {
+        if (!parseInt(value, config.keyframeOversample) || config.keyframeOversample < 1) {
+            error = "keyframe_oversample must be a positive integer, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "keyframe_blur_ratio") {
+        if (!parseNumber(value, 0.0, 1.0, config.keyframeBlurRatio)) {
+            error = "keyframe_blur_ratio must be between 0 and 1, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "mapper_options") {
+        config.colmapMapperOptions = value;
+    } else if (key == "geo_registration") {
+        if (!parseBool(value, config.geoRegistration)) {
+            error = "geo_registration must be true or false, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "geo_max_error") {
+        if (!parseNumber(value, 0.1, 1000.0, config.geoMaxError)) {
+            error = "geo_max_error must be a distance in metres, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "tile_frames") {
+        if (!parseInt(value, config.tileMaxFrames) || (config.tileMaxFrames > 0 && config.tileMaxFrames < 10)) {
+            error = "tile_frames must be 0 or at least 10, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "tile_overlap") {
+        if (!parseNumber(value, 0.0, 10000.0, config.tileOverlap)) {
+            error = "tile_overlap must be a distance in metres, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "tile_jobs") {
+        if (!parseInt(value, config.tileJobs)) {
+            error = "tile_jobs must be a non-negative integer, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "timeout" || key == "stall_timeout") {
+        if (!parseToolTimeout(value, key == "stall_timeout", config, error)) {
+            error = key + error;
+            return false;
+        }
+    } else if (key == "disk_budget") {
+        if (!parseByteSize(value, config.diskBudgetBytes)) {
+            error = "disk_budget must be a size such as 500G or 800M, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "disk_budget_action") {
+        const std::string action = toLower(value);
+        if (action == "warn") {
+            config.diskBudgetAction = DiskBudgetAction::Warn;
+        } else if (action == "refuse") {
+            config.diskBudgetAction = DiskBudgetAction::Refuse;
+        } else if (action == "adapt") {
+            config.diskBudgetAction = DiskBudgetAction::Adapt;
+        } else {
+            error = "unknown disk_budget_action '" + value + "' (warn, refuse or adapt)";
+            return false;
+        }
+    } else if (key == "cleanup_intermediates") {
+        if (!parseBool(value, config.cleanupIntermediates)) {
+            error = "cleanup_intermediates must be true or false, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "remove_distorted_frames") {
+        if (!parseBool(value, config.removeDistortedFrames)) {
+            error = "remove_distorted_frames must be true or false, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "resume") {
+        if (!parseBool(value, config.resume)) {
+            error = "resume must be true or false, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "adaptive_sampling") {
+        if (!parseBool(value, config.adaptiveSampling)) {
+            error = "adaptive_sampling must be true or false, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "sampling_overlap") {
+        if (!parseNumber(value, 0.0, 0.95, config.samplingOverlap)) {
+            error = "sampling_overlap must be between 0 and 0.95, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "sampling_ground_distance") {
+        if (!parseNumber(value, 0.0, 10000.0, config.samplingGroundDistance)) {
+            error = "sampling_ground_distance must be a distance in metres, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "camera_fov") {
+        if (!parseNumber(value, 1.0, 170.0, config.cameraFovDegrees)) {
+            error = "camera_fov must be between 1 and 170 degrees, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "sampling_height") {
+        if (!parseNumber(value, 0.0, 10000.0, config.samplingHeight)) {
+            error = "sampling_height must be a height in metres, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "sampling_max_interval") {
+        if (!parseNumber(value, 0.0, 3600.0, config.samplingMaxInterval)) {
+            error = "sampling_max_interval must be a number of seconds, got '" + value + "'";
+            return false;
+        }
+    } else if (key == "pyramid_levels") {
+        if (!parseInt(value, config.pyramidLevels) || config.pyramidLevels > kMaxPyramidLevels) {
+            error = "pyramid_levels must be between 0 and " + std::to_string(kMaxPyramidLevels) + ", got '" + value + "'";
+            return false;
+        }
+    } else if (key == "pyramid_quality") {
+        if (!parsePyramidQuality(value, config.pyramidQuality)) {
+            error = "pyramid_quality must be a comma-separated list of ffmpeg -q:v values (2-31), got '" + value + "'";
+            return false;
+        }
+    } else {
+        error = "unknown key '" + key + "'";
+        return false;
+    }
+    return true;
+}
+
+// Read [job] sections from a job file. Keys before the first section are
+// layered over the command-line defaults and inherited by every job.
+bool loadJobFile(const std::string& path, const CliJob& defaults, std::vector<CliJob>& jobs, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open job file: " + path;
+        return false;
+    }
+
+    CliJob common = defaults;
+    CliJob* current = nullptr;
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';') {
+            continue;
+        }
+
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                error = path + ":" + std::to_string(lineNumber) + ": malformed section header";
+                return false;
+            }
+            // "[job]" or "[job name]"
+            std::string section = trim(line.substr(1, line.size() - 2));
+            if (toLower(section.substr(0, 3)) != "job" || (section.size() > 3 && section[3] != ' ')) {
+                error = path + ":" + std::to_string(lineNumber) + ": unknown section '" + section + "'";
+                return false;
+            }
+            jobs.push_back(common);
+            current = &jobs.back();
+            current->line = lineNumber;
+            current->name = trim(section.substr(3));
+            continue;
+        }
+
+        size_t pos = line.find('=');
+        if (pos == std::string::npos) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected key=value";
+            return false;
+        }
+        std::string key = toLower(trim(line.substr(0, pos)));
+        std::string value = trim(line.substr(pos + 1));
+        std::string message;
+        if (!applySetting(current ? *current : common, key, value, message)) {
+            error = path + ":" + std::to_string(lineNumber) + ": " + message;
+            return false;
+        }
+    }
+
+    if (jobs.empty()) {
+        error = "job file contains no [job] sections: " + path;
+        return false;
+    }
+    return true;
+}
+
+const char* methodName(ReconMethod method) {
+    switch (method) {
+        case ReconMethod::COLMAP: return "colmap";
+        case ReconMethod::METASHAPE: return "metashape";
+        case ReconMethod::REALITYSCAN: return "realityscan";
+    }
+    return "unknown";
+}
+
+const char* jobStatus(const JobResult& result) {
+    return result.success ? "ok" : result.cancelled ? "cancelled" : "failed";
+}
+
+bool writeSummary(const std::string& path, const std::vector<CliJob>& jobs, const std::vector<JobResult>& results,
+                  double totalSeconds) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    size_t succeeded = std::count_if(results.begin(), results.end(), [](const JobResult& r) { return r.success; });
+    size_t cancelled = std::count_if(results.begin(), results.end(), [](const JobResult& r) { return r.cancelled; });
+    file << "{\n";
+    file << "  \"total\": " << jobs.size() << ",\n";
+    file << "  \"succeeded\": " << succeeded << ",\n";
+    file << "  \"failed\": " << (jobs.size() - succeeded - cancelled) << ",\n";
+    file << "  \"cancelled\": " << cancelled << ",\n";
+    file << "  \"seconds\": " << totalSeconds << ",\n";
+    file << "  \"jobs\": [\n";
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const PipelineConfig& config = jobs[i].config;
+        file << "    {\"name\": \"" << jsonEscape(jobs[i].name) << "\""
+             << ", \"status\": \"" << jobStatus(results[i]) << "\""
+             << ", \"seconds\": " << results[i].seconds
+             << ", \"video\": \"" << jsonEscape(config.videoPath) << "\""
+             << ", \"output\": \"" << jsonEscape(config.outputBaseDir) << "\""
+             << ", \"method\": \"" << methodName(config.method) << "\""
+             << ", \"fps\": " << config.frameRate
+             << ", \"log\": \"" << jsonEscape(results[i].logPath) << "\"";
+        if (!results[i].error.empty()) {
+            file << ", \"error\": \"" << jsonEscape(results[i].error) << "\"";
+        }
+        file << "}" << (i + 1 < jobs.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n";
+    file << "}\n";
+    return file.good();
+}
+
+// Run one job, logging to <output>/pipeline.log and (unless quiet) to stdout
+// Machine-readable progress line; -1 for values not known yet
+std::string progressLine(const std::string& job, const ProgressEvent& event) {
+    char numbers[256];
+    snprintf(numbers, sizeof(numbers),
+             " done=%.0f total=%.0f unit=%s rate=%.3g eta=%.0f overall=%.1f overall_eta=%.0f elapsed=%.0f",
+             event.done, event.total > 0.0 ? event.total : -1.0, event.unit.empty() ? "-" : event.unit.c_str(),
+             event.rate, event.etaSeconds, event.overallFraction * 100.0, event.overallEtaSeconds,
+             event.elapsedSeconds);
+    return "PROGRESS job=" + job + " stage=\"" + event.stage + "\"" + numbers;
+}
+
+JobResult runJob(const CliJob& job, bool quiet, double progressInterval, std::mutex& stdoutMutex) {
+    JobResult result;
+    auto start = std::chrono::steady_clock::now();
+
+    fs::path logPath = fs::path(job.config.outputBaseDir) / "pipeline.log";
+    result.logPath = logPath.string();
+
+    std::ofstream logFile;
+    std::error_code ec;
+    fs::create_directories(job.config.outputBaseDir, ec);
+    logFile.open(logPath, std::ios::out | std::ios::trunc);
+    if (!logFile.is_open()) {
+        result.logPath.clear();
+    }
+
+    std::mutex logMutex;
+    std::string firstError;
+    const std::string prefix = "[" + job.name + "] ";
+    LogCallback log = [&](const std::string& line) {
+        {
+            std::lock_guard<std::mutex> lock(logMutex);
+            if (logFile.is_open()) {
+                logFile << line << '\n';
+            }
+            if (firstError.empty() && line.rfind("ERROR", 0) == 0) {
+                firstError = line;
+            }
+        }
+        if (!quiet) {
+            std::lock_guard<std::mutex> lock(stdoutMutex);
+            std::cout << prefix << line << '\n';
+        }
+    };
+
+    // At most one PROGRESS line per interval, plus one per finished stage
+    ProgressCallback progress;
+    std::mutex progressMutex;
+    auto lastProgress = std::chrono::steady_clock::now();
+    if (progressInterval > 0.0) {
+        progress = [&](const ProgressEvent& event) {
+            {
+                std::lock_guard<std::mutex> lock(progressMutex);
+                auto now = std::chrono::steady_clock::now();
+                if (!event.finished && std::chrono::duration<double>(now - lastProgress).count() < progressInterval) {
+                    return;
+                }
+                lastProgress = now;
+            }
+            std::lock_guard<std::mutex> lock(stdoutMutex);
+            std::cout << progressLine(job.name, event) << std::endl;
+        };
+    }
+
+    try {
+        result.success = runPipeline(job.config, log, progress, &g_interrupted);
+    } catch (const std::exception& e) {
+        log("ERROR: " + std::string(e.what()));
+        result.success = false;
+    }
+
+    logFile.flush();
+    result.cancelled = !result.success && g_interrupted;
+    result.error = result.success ? "" : firstError;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+int convertModel(const std::string& input, const std::string& output, ColmapFormat format) {
+    ColmapModelCheck check;
+    std::string error;
+    if (!convertColmapModel(input, output, format, nullptr, check, &error)) {
+        std::cerr << "error: " << error << "\n";
+        return CLI_EXIT_JOB_FAILED;
+    }
+    for (const auto& problem : check.problems) {
+        std::cerr << "warning: " << problem << "\n";
+    }
+    std::cout << "MODEL cameras=" << check.cameras << " images=" << check.images << " points=" << check.points
+              << " mean_track_length=" << check.meanTrackLength << " mean_error=" << check.meanError
+              << " problems=" << check.problemCount << std::endl;
+    return check.ok() ? CLI_EXIT_OK : CLI_EXIT_JOB_FAILED;
+}
+
+} // namespace
+
+int runCLI(int argc, char** argv) {
+    CliJob defaults;
+    defaults.config.frameRate = 1.0;
+    defaults.config.method = ReconMethod::COLMAP;
+    defaults.config.interactive = false;
+
+    std::string jobFile;
+    std::string summaryPath;
+    int concurrentJobs = 1;
+    bool quiet = false;
+    double progressInterval = 0.0;
+    std::string modelInput;
+    std::string modelOutput;
+    ColmapFormat modelFormat = ColmapFormat::Binary;
+
+    // Command-line options that map onto job file keys
+    const std::vector<std::pair<std::string, std::string>> optionKeys = {
+        {"--video", "video_path"}, {"--output", "output_path"}, {"--fps", "fps"},
+        {"--method", "method"}, {"--ffmpeg", "ffmpeg_path"}, {"--colmap", "colmap_path"},
+        {"--metashape", "metashape_path"}, {"--realityscan", "realityscan_path"},
+        {"--parallel-videos", "parallel_videos"}, {"--ffmpeg-threads", "ffmpeg_threads"},
+        {"--log-lines-per-second", "log_lines_per_second"}, {"--matching", "matching"},
+        {"--vocab-tree", "vocab_tree_path"}, {"--name", "name"},
+        {"--keyframe-oversample", "keyframe_oversample"}, {"--keyframe-blur-ratio", "keyframe_blur_ratio"},
+        {"--overlap", "sampling_overlap"}, {"--ground-distance", "sampling_ground_distance"},
+        {"--camera-fov", "camera_fov"}, {"--height", "sampling_height"},
+        {"--max-interval", "sampling_max_interval"}, {"--mapper-options", "mapper_options"},
+        {"--geo-max-error", "geo_max_error"}, {"--tile-frames", "tile_frames"},
+        {"--tile-overlap", "tile_overlap"}, {"--tile-jobs", "tile_jobs"},
+        {"--timeout", "timeout"}, {"--stall-timeout", "stall_timeout"},
+        {"--disk-budget", "disk_budget"}, {"--disk-budget-action", "disk_budget_action"},
+        {"--pyramid", "pyramid_levels"}, {"--pyramid-quality", "pyramid_quality"},
+    };
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value;
+        bool hasValue = false;
+        size_t eq = arg.find('=');
+        if (arg.rfind("--", 0) == 0 && eq != std::string::npos) {
+            value = arg.substr(eq + 1);
+            arg = arg.substr(0, eq);
+            hasValue = true;
+        }
+
+        auto takeValue = [&]() -> bool {
+            if (hasValue) {
+                return true;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "error: " << arg << " needs a value\n";
+                return false;
+            }
+            value = argv[++i];
+            return true;
+        };
+
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return CLI_EXIT_OK;
+        } else if (arg == "--quiet" || arg == "-q") {
+            quiet = true;
+        } else if (arg == "--progress") {
+            progressInterval = 10.0;
+            if (hasValue && !parseNumber(value, 0.1, 86400.0, progressInterval)) {
+                std::cerr << "error: --progress must be a number of seconds\n";
+                return CLI_EXIT_USAGE;
+            }
+        } else if (arg == "--per-video-links") {
+            defaults.config.perVideoFrameLinks = true;
+        } else if (arg == "--keyframes") {
+            defaults.config.keyframeSelection = true;
+        } else if (arg == "--adaptive-sampling") {
+            defaults.config.adaptiveSampling = true;
+        } else if (arg == "--no-geo-registration") {
+            defaults.config.geoRegistration = false;
+        } else if (arg == "--cleanup-intermediates") {
+            defaults.config.cleanupIntermediates = true;
+        } else if (arg == "--remove-distorted-frames") {
+            defaults.config.removeDistortedFrames = true;
+        } else if (arg == "--no-resume") {
+            defaults.config.resume = false;
+        } else if (arg == "--convert-model") {
+            if (!takeValue()) return CLI_EXIT_USAGE;
+            modelInput = value;
+            if (i + 1 >= argc) {
+                std::cerr << "error: --convert-model needs an input and an output folder\n";
+                return CLI_EXIT_USAGE;
+            }
+            modelOutput = argv[++i];
+        } else if (arg == "--model-format") {
+            if (!takeValue()) return CLI_EXIT_USAGE;
+            if (toLower(value) == "binary") {
+                modelFormat = ColmapFormat::Binary;
+            } else if (toLower(value) == "text") {
+                modelFormat = ColmapFormat::Text;
+            } else {
+                std::cerr << "error: --model-format must be binary or text\n";
+                return CLI_EXIT_USAGE;
+            }
+        } else if (arg == "--job-file") {
+            if (!takeValue()) return CLI_EXIT_USAGE;
+            jobFile = value;
+        } else if (arg == "--summary") {
+            if (!takeValue()) return CLI_EXIT_USAGE;
+            summaryPath = value;
+        } else if (arg == "--jobs" || arg == "-j") {
+            if (!takeValue()) return CLI_EXIT_USAGE;
+            if (!parseInt(value, concurrentJobs) || concurrentJobs < 1) {
+                std::cerr << "error: --jobs must be a positive integer\n";
+                return CLI_EXIT_USAGE;
+            }
+        } else {
+            auto option = std::find_if(optionKeys.begin(), optionKeys.end(),
+                                       [&](const auto& entry) { return entry.first == arg; });
+            if (option == optionKeys.end()) {
+                std::cerr << "error: unknown option " << arg << " (see --help)\n";
+                return CLI_EXIT_USAGE;
+            }
+            if (!takeValue()) return CLI_EXIT_USAGE;
+            std::string error;
+            if (!applySetting(defaults, option->second, value, error)) {
+                std::cerr << "error: " << arg << ": " << error << "\n";
+                return CLI_EXIT_USAGE;
+            }
+        }
+    }
+
+    if (!modelInput.empty()) {
+        return convertModel(modelInput, modelOutput, modelFormat);
+    }
+
+    std::vector<CliJob> jobs;
+    if (!jobFile.empty()) {
+        std::string error;
+        if (!loadJobFile(jobFile, defaults, jobs, error)) {
+            std::cerr << "error: " << error << "\n";
+            return CLI_EXIT_USAGE;
+        }
+    } else {
+        jobs.push_back(defaults);
+    }
+
+    // Check every job before starting any, so a typo does not surface hours into a batch
+    for (size_t i = 0; i < jobs.size(); i++) {
+        CliJob& job = jobs[i];
+        if (job.name.empty()) {
+            job.name = "job" + std::to_string(i + 1);
+        }
+        std::string where = job.line > 0 ? jobFile + ":" + std::to_string(job.line) + ": " : "";
+        if (job.config.videoPath.empty() || job.config.outputBaseDir.empty()) {
+            std::cerr << "error: " << where << "job '" << job.name << "' needs a video path and an output directory\n";
+            return CLI_EXIT_USAGE;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (fs::weakly_canonical(jobs[j].config.outputBaseDir) == fs::weakly_canonical(job.config.outputBaseDir)) {
+                std::cerr << "error: " << where << "jobs '" << jobs[j].name << "' and '" << job.name
+                          << "' share the output directory " << job.config.outputBaseDir << "\n";
+                return CLI_EXIT_USAGE;
+            }
+        }
+    }
+
+    concurrentJobs = std::min<int>(concurrentJobs, static_cast<int>(jobs.size()));
+
+    // Concurrent jobs share the machine: split the cores unless the job says otherwise
+    if (concurrentJobs > 1) {
+        const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        const int coresPerJob = std::max(1, cores / concurrentJobs);
+        for (auto& job : jobs) {
+            if (job.config.maxParallelVideos == 0) {
+                job.config.maxParallelVideos = std::max(1, coresPerJob / 4);
+            }
+            if (job.config.ffmpegThreads == 0) {
+                job.config.ffmpegThreads = std::max(1, coresPerJob / job.config.maxParallelVideos);
+            }
+        }
+    }
+
+    std::mutex stdoutMutex;
+    std::vector<JobResult> results(jobs.size());
+    auto start = std::chrono::steady_clock::now();
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+
+    {
+        ThreadPool pool(static_cast<size_t>(concurrentJobs));
+        std::vector<std::future<void>> pending;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            pending.push_back(pool.submit([&, i]() {
+                if (g_interrupted) {
+                    results[i].cancelled = true;
+                } else {
+                    results[i] = runJob(jobs[i], quiet, progressInterval, stdoutMutex);
+                }
+                std::lock_guard<std::mutex> lock(stdoutMutex);
+                std::cout << "RESULT job=" << jobs[i].name << " status=" << jobStatus(results[i])
+                          << " seconds=" << results[i].seconds
+                          << " log=" << results[i].logPath << std::endl;
+            }));
+        }
+        for (auto& job : pending) {
+            job.get();
+        }
+    }
+
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t failed = std::count_if(results.begin(), results.end(), [](const JobResult& r) { return !r.success; });
+    size_t cancelled = std::count_if(results.begin(), results.end(), [](const JobResult& r) { return r.cancelled; });
+
+    if (!summaryPath.empty() && !writeSummary(summaryPath, jobs, results, totalSeconds)) {
+        std::cerr << "error: cannot write summary: " << summaryPath << "\n";
+    }
+
+    std::cout << "SUMMARY total=" << jobs.size() << " succeeded=" << (jobs.size() - failed)
+              << " failed=" << (failed - cancelled) << " cancelled=" << cancelled
+              << " seconds=" << totalSeconds << std::endl;
+
+    if (cancelled > 0) {
+        return CLI_EXIT_CANCELLED;
+    }
+    return failed == 0 ? CLI_EXIT_OK : CLI_EXIT_JOB_FAILED;
+}
@@ -0,0 +1,15 @@
+#ifndef CLI_H
+#define CLI_H
+
+// Exit codes of the command-line runner
+enum CliExitCode {
+    CLI_EXIT_OK = 0,          // every job succeeded
+    CLI_EXIT_JOB_FAILED = 1,  // at least one job failed
+    CLI_EXIT_USAGE = 2,       // bad arguments or unreadable job file; nothing was run
+    CLI_EXIT_CANCELLED = 130  // interrupted (SIGINT / SIGTERM); the jobs were stopped
+};
+
+// Headless entry point: parses arguments / job file and runs the jobs
+int runCLI(int argc, char** argv);
+
+#endif // CLI_H
@@ -0,0 +1,874 @@
+#include "colmap_model.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+// Keypoints and track elements are read and written as whole arrays
+static_assert(sizeof(ColmapPoint2D) == 24, "ColmapPoint2D must match the images.bin record");
+static_assert(sizeof(ColmapTrackElement) == 8, "ColmapTrackElement must match the points3D.bin record");
+
+namespace {
+
+struct CameraModelInfo {
+    const char* name;
+    int params;
+};
+
+// Indexed by COLMAP's model id (colmap/sensor/models.h)
+const CameraModelInfo kCameraModels[] = {
+    {"SIMPLE_PINHOLE", 3}, {"PINHOLE", 4},        {"SIMPLE_RADIAL", 4},         {"RADIAL", 5},
+    {"OPENCV", 8},         {"OPENCV_FISHEYE", 8}, {"FULL_OPENCV", 12},          {"FOV", 5},
+    {"SIMPLE_RADIAL_FISHEYE", 4}, {"RADIAL_FISHEYE", 5}, {"THIN_PRISM_FISHEYE", 12},
+};
+constexpr int kCameraModelCount = static_cast<int>(sizeof(kCameraModels) / sizeof(kCameraModels[0]));
+
+void setError(std::string* error, const std::string& message) {
+    if (error) *error = message;
+}
+
+// Whitespace-separated fields of one text line, parsed in place
+class Fields {
+public:
+    explicit Fields(std::string_view line) : m_rest(line) {}
+
+    std::string_view next() {
+        size_t begin = m_rest.find_first_not_of(" \t\r");
+        if (begin == std::string_view::npos) {
+            m_rest = {};
+            return {};
+        }
+        m_rest.remove_prefix(begin);
+        size_t end = std::min(m_rest.find_first_of(" \t\r"), m_rest.size());
+        std::string_view field = m_rest.substr(0, end);
+        m_rest.remove_prefix(end);
+        return field;
+    }
+
+    template <typename T>
+    bool next(T& value) {
+        std::string_view field = next();
+        if (field.empty()) {
+            return false;
+        }
+        auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+        return result.ec == std::errc() && result.ptr == field.data() + field.size();
+    }
+
+    // The rest of the line without surrounding blanks
+    std::string_view rest() const {
+        std::string_view rest = m_rest;
+        size_t begin = rest.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) {
+            return {};
+        }
+        rest.remove_prefix(begin);
+        size_t end = rest.find_last_not_of(" \t\r");
+        return rest.substr(0, end + 1);
+    }
+
+    bool empty() const { return m_rest.find_first_not_of(" \t\r") == std::string_view::npos; }
+
+private:
+    std::string_view m_rest;
+};
+
+bool isDataLine(const std::string& line) {
+    size_t first = line.find_first_not_of(" \t\r");
+    return first != std::string::npos && line[first] != '#';
+}
+
+// Input file with a large buffer; the model files are read front to back once
+class ModelFile {
+public:
+    bool open(const fs::path& path, ColmapFormat format, std::string* error) {
+        m_buffer.resize(1 << 20);
+        m_in.rdbuf()->pubsetbuf(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_in.open(path, format == ColmapFormat::Binary ? std::ios::binary : std::ios::in);
+        if (!m_in.is_open()) {
+            setError(error, "cannot open " + path.string());
+            return false;
+        }
+        std::error_code ec;
+        m_size = fs::file_size(path, ec);
+        return true;
+    }
+
+    // COLMAP's binary files are little-endian, like every platform we build for
+    template <typename T>
+    bool read(T& value) {
+        return static_cast<bool>(m_in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    // Records laid out exactly as in the file, read in one go
+    template <typename T>
+    bool readArray(std::vector<T>& values) {
+        return static_cast<bool>(m_in.read(reinterpret_cast<char*>(values.data()),
+                                           static_cast<std::streamsize>(values.size() * sizeof(T))));
+    }
+
+    // Count read from a header, capped by what the file can hold, for reserve()
+    size_t plausible(uint64_t count, size_t minimumRecord) const {
+        return static_cast<size_t>(std::min<uint64_t>(count, m_size / minimumRecord));
+    }
+
+    std::ifstream& stream() { return m_in; }
+
+private:
+    std::vector<char> m_buffer;
+    std::ifstream m_in;
+    uint64_t m_size = 0;
+};
+
+template <typename T>
+void append(std::string& line, T value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    line.append(buffer, result.ptr);
+}
+
+void appendPoint3DId(std::string& line, uint64_t id) {
+    if (id == kColmapNoPoint3D) {
+        line += "-1";
+    } else {
+        append(line, id);
+    }
+}
+
+template <typename T>
+void writeBinary(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Written to "<path>.tmp" and renamed over path once complete, so a reader
+// never sees half a file and a model can be rewritten in place
+class ModelOutput {
+public:
+    bool open(const fs::path& path, ColmapFormat format, std::string* error) {
+        m_path = path;
+        m_temporary = path;
+        m_temporary += ".tmp";
+        m_out.open(m_temporary, format == ColmapFormat::Binary ? std::ios::binary : std::ios::out);
+        if (!m_out.is_open()) {
+            setError(error, "cannot write " + m_temporary.string());
+            return false;
+        }
+        return true;
+    }
+
+    bool commit(std::string* error) {
+        m_out.close();
+        std::error_code ec;
+        if (!m_out) {
+            fs::remove(m_temporary, ec);
+            setError(error, "write failed: " + m_temporary.string());
+            return false;
+        }
+        fs::rename(m_temporary, m_path, ec);
+        if (ec) {
+            fs::remove(m_temporary, ec);
+            setError(error, "cannot replace " + m_path.string() + ": " + ec.message());
+            return false;
+        }
+        return true;
+    }
+
+    std::ofstream& stream() { return m_out; }
+
+private:
+    fs::path m_path;
+    fs::path m_temporary;
+    std::ofstream m_out;
+};
+
+const char* modelFileName(const char* stem, ColmapFormat format) {
+    static const std::string names[] = {"cameras.txt", "images.txt", "points3D.txt",
+                                        "cameras.bin", "images.bin", "points3D.bin"};
+    int index = std::strcmp(stem, "cameras") == 0 ? 0 : std::strcmp(stem, "images") == 0 ? 1 : 2;
+    return names[index + (format == ColmapFormat::Binary ? 3 : 0)].c_str();
+}
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+} // namespace
+
+int colmapCameraModelId(const std::string& name) {
+    for (int i = 0; i < kCameraModelCount; i++) {
+        if (name == kCameraModels[i].name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* colmapCameraModelName(int model) {
+    return model >= 0 && model < kCameraModelCount ? kCameraModels[model].name : nullptr;
+}
+
+int colmapCameraParamCount(int model) {
+    return model >= 0 && model < kCameraModelCount ? kCameraModels[model].params : -1;
+}
+
+bool findColmapModel(const fs::path& dir, ColmapModelFiles& files) {
+    std::error_code ec;
+    fs::path found[2][3];  // [binary][cameras, images, points3D]
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (!entry.is_regular_file(ec)) {
+            continue;
+        }
+        const std::string name = lowercase(entry.path().filename().string());
+        for (int binary = 0; binary < 2; binary++) {
+            const ColmapFormat format = binary ? ColmapFormat::Binary : ColmapFormat::Text;
+            const char* stems[] = {"cameras", "images", "points3D"};
+            for (int file = 0; file < 3; file++) {
+                if (name == lowercase(modelFileName(stems[file], format))) {
+                    found[binary][file] = entry.path();
+                }
+            }
+        }
+    }
+    for (int binary = 1; binary >= 0; binary--) {
+        if (!found[binary][0].empty() && !found[binary][1].empty() && !found[binary][2].empty()) {
+            files.format = binary ? ColmapFormat::Binary : ColmapFormat::Text;
+            files.cameras = found[binary][0];
+            files.images = found[binary][1];
+            files.points = found[binary][2];
+            return true;
+        }
+    }
+    return false;
+}
+
+void removeColmapModel(const fs::path& dir) {
+    std::error_code ec;
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        const std::string name = lowercase(entry.path().filename().string());
+        for (ColmapFormat format : {ColmapFormat::Text, ColmapFormat::Binary}) {
+            for (const char* stem : {"cameras", "images", "points3D"}) {
+                if (name == lowercase(modelFileName(stem, format))) {
+                    files.push_back(entry.path());
+                }
+            }
+        }
+    }
+    for (const auto& file : files) {
+        fs::remove(file, ec);
+    }
+}
+
+bool readColmapCameras(const fs::path& path, ColmapFormat format, std::vector<ColmapCamera>& cameras,
+                       std::string* error) {
+    ModelFile file;
+    if (!file.open(path, format, error)) {
+        return false;
+    }
+    cameras.clear();
+
+    if (format == ColmapFormat::Binary) {
+        uint64_t count = 0;
+        if (!file.read(count)) {
+            setError(error, path.string() + ": missing camera count");
+            return false;
+        }
+        cameras.reserve(file.plausible(count, 24));
+        for (uint64_t i = 0; i < count; i++) {
+            ColmapCamera camera;
+            int32_t model = 0;
+            if (!file.read(camera.id) || !file.read(model) || !file.read(camera.width) || !file.read(camera.height)) {
+                setError(error, path.string() + ": truncated at camera " + std::to_string(i + 1));
+                return false;
+            }
+            camera.model = model;
+            const int params = colmapCameraParamCount(model);
+            if (params < 0) {
+                setError(error, path.string() + ": camera " + std::to_string(camera.id) + " has unknown model " +
+                                std::to_string(model));
+                return false;
+            }
+            camera.params.resize(static_cast<size_t>(params));
+            for (double& param : camera.params) {
+                if (!file.read(param)) {
+                    setError(error, path.string() + ": truncated at camera " + std::to_string(camera.id));
+                    return false;
+                }
+            }
+            cameras.push_back(std::move(camera));
+        }
+        return true;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file.stream(), line)) {
+        lineNumber++;
+        if (!isDataLine(line)) {
+            continue;
+        }
+        Fields fields(line);
+        ColmapCamera camera;
+        std::string_view model;
+        bool valid = fields.next(camera.id) && !(model = fields.next()).empty() && fields.next(camera.width) &&
+                     fields.next(camera.height);
+        camera.model = colmapCameraModelId(std::string(model));
+        double param = 0.0;
+        while (valid && !fields.empty()) {
+            valid = fields.next(param);
+            camera.params.push_back(param);
+        }
+        if (!valid || camera.model < 0) {
+            setError(error, path.string() + ":" + std::to_string(lineNumber) + ": not a camera line");
+            return false;
+        }
+        cameras.push_back(std::move(camera));
+    }
+    return true;
+}
+
+bool readColmapImages(const fs::path& path, ColmapFormat format, std::vector<ColmapImage>& images,
+                      std::string* error) {
+    ModelFile file;
+    if (!file.open(path, format, error)) {
+        return false;
+    }
+    images.clear();
+
+    if (format == ColmapFormat::Binary) {
+        uint64_t count = 0;
+        if (!file.read(count)) {
+            setError(error, path.string() + ": missing image count");
+            return false;
+        }
+        images.reserve(file.plausible(count, 73));
+        for (uint64_t i = 0; i < count; i++) {
+            ColmapImage image;
+            bool valid = file.read(image.id);
+            for (double& q : image.qvec) valid = valid && file.read(q);
+            for (double& t : image.tvec) valid = valid && file.read(t);
+            valid = valid && file.read(image.camera);
+            char c = 0;
+            while (valid && (valid = file.read(c)) && c != '\0') {
+                image.name += c;
+            }
+            uint64_t points = 0;
+            if (!valid || !file.read(points)) {
+                setError(error, path.string() + ": truncated at image " + std::to_string(i + 1));
+                return false;
+            }
+            image.points.resize(file.plausible(points, 24));
+            if (image.points.size() != points) {
+                setError(error, path.string() + ": image " + image.name + " claims " + std::to_string(points) +
+                                " keypoints, more than the file holds");
+                return false;
+            }
+            if (!file.readArray(image.points)) {
+                setError(error, path.string() + ": truncated in the keypoints of " + image.name);
+                return false;
+            }
+            images.push_back(std::move(image));
+        }
+        return true;
+    }
+
+    // Two lines per image; the keypoint line may be empty
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file.stream(), line)) {
+        lineNumber++;
+        if (!isDataLine(line)) {
+            continue;
+        }
+        Fields fields(line);
+        ColmapImage image;
+        bool valid = fields.next(image.id);
+        for (double& q : image.qvec) valid = valid && fields.next(q);
+        for (double& t : image.tvec) valid = valid && fields.next(t);
+        valid = valid && fields.next(image.camera);
+        image.name = std::string(fields.rest());
+        if (!valid || image.name.empty()) {
+            setError(error, path.string() + ":" + std::to_string(lineNumber) + ": not an image line");
+            return false;
+        }
+
+        if (!std::getline(file.stream(), line)) {
+            line.clear();
+        }
+        lineNumber++;
+        Fields points(line);
+        while (!points.empty()) {
+            ColmapPoint2D point;
+            int64_t id = -1;
+            if (!points.next(point.x) || !points.next(point.y) || !points.next(id)) {
+                setError(error, path.string() + ":" + std::to_string(lineNumber) + ": keypoints of " + image.name +
+                                " are not (X, Y, POINT3D_ID) triples");
+                return false;
+            }
+            point.point3D = id < 0 ? kColmapNoPoint3D : static_cast<uint64_t>(id);
+            image.points.push_back(point);
+        }
+        images.push_back(std::move(image));
+    }
+    return true;
+}
+
+bool readColmapPoints(const fs::path& path, ColmapFormat format,
+                      const std::function<bool(const ColmapPoint3D&)>& visit, std::string* error) {
+    ModelFile file;
+    if (!file.open(path, format, error)) {
+        return false;
+    }
+    ColmapPoint3D point;
+
+    if (format == ColmapFormat::Binary) {
+        uint64_t count = 0;
+        if (!file.read(count)) {
+            setError(error, path.string() + ": missing point count");
+            return false;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            bool valid = file.read(point.id);
+            for (double& x : point.xyz) valid = valid && file.read(x);
+            for (uint8_t& c : point.rgb) valid = valid && file.read(c);
+            uint64_t length = 0;
+            valid = valid && file.read(point.error) && file.read(length);
+            if (valid) {
+                point.track.resize(file.plausible(length, 8));
+                valid = point.track.size() == length;
+            }
+            valid = valid && file.readArray(point.track);
+            if (!valid) {
+                setError(error, path.string() + ": truncated at point " + std::to_string(i + 1));
+                return false;
+            }
+            if (!visit(point)) {
+                setError(error, path.string() + ": reading stopped at point " + std::to_string(point.id));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file.stream(), line)) {
+        lineNumber++;
+        if (!isDataLine(line)) {
+            continue;
+        }
+        Fields fields(line);
+        bool valid = fields.next(point.id);
+        for (double& x : point.xyz) valid = valid && fields.next(x);
+        for (uint8_t& c : point.rgb) {
+            unsigned value = 0;
+            valid = valid && fields.next(value) && value <= 255;
+            c = static_cast<uint8_t>(value);
+        }
+        valid = valid && fields.next(point.error);
+        point.track.clear();
+        while (valid && !fields.empty()) {
+            ColmapTrackElement element;
+            valid = fields.next(element.image) && fields.next(element.point2D);
+            point.track.push_back(element);
+        }
+        if (!valid) {
+            setError(error, path.string() + ":" + std::to_string(lineNumber) + ": not a 3D point line");
+            return false;
+        }
+        if (!visit(point)) {
+            setError(error, path.string() + ": reading stopped at point " + std::to_string(point.id));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool readColmapModel(const fs::path& dir, ColmapModel& model, std::string* error) {
+    ColmapModelFiles files;
+    if (!findColmapModel(dir, files)) {
+        setError(error, "no COLMAP model (cameras, images, points3D) in " + dir.string());
+        return false;
+    }
+    model.points.clear();
+    return readColmapCameras(files.cameras, files.format, model.cameras, error) &&
+           readColmapImages(files.images, files.format, model.images, error) &&
+           readColmapPoints(files.points, files.format, [&](const ColmapPoint3D& point) {
+               model.points.push_back(point);
+               return true;
+           }, error);
+}
+
+bool writeColmapCameras(const fs::path& path, ColmapFormat format, const std::vector<ColmapCamera>& cameras,
+                        std::string* error) {
+    for (const ColmapCamera& camera : cameras) {
+        if (static_cast<int>(camera.params.size()) != colmapCameraParamCount(camera.model)) {
+            setError(error, "camera " + std::to_string(camera.id) + ": model " + std::to_string(camera.model) +
+                            " does not take " + std::to_string(camera.params.size()) + " parameters");
+            return false;
+        }
+    }
+
+    ModelOutput output;
+    if (!output.open(path, format, error)) {
+        return false;
+    }
+    std::ofstream& out = output.stream();
+    if (format == ColmapFormat::Binary) {
+        writeBinary(out, static_cast<uint64_t>(cameras.size()));
+        for (const ColmapCamera& camera : cameras) {
+            writeBinary(out, camera.id);
+            writeBinary(out, static_cast<int32_t>(camera.model));
+            writeBinary(out, camera.width);
+            writeBinary(out, camera.height);
+            out.write(reinterpret_cast<const char*>(camera.params.data()),
+                      static_cast<std::streamsize>(camera.params.size() * sizeof(double)));
+        }
+    } else {
+        out << "# Camera list with one line of data per camera:\n"
+            << "#   CAMERA_ID, MODEL, WIDTH, HEIGHT, PARAMS[]\n"
+            << "# Number of cameras: " << cameras.size() << "\n";
+        std::string line;
+        for (const ColmapCamera& camera : cameras) {
+            line.clear();
+            append(line, camera.id);
+            line += ' ';
+            line += colmapCameraModelName(camera.model);
+            line += ' ';
+            append(line, camera.width);
+            line += ' ';
+            append(line, camera.height);
+            for (double param : camera.params) {
+                line += ' ';
+                append(line, param);
+            }
+            line += '\n';
+            out << line;
+        }
+    }
+    return output.commit(error);
+}
+
+bool writeColmapImages(const fs::path& path, ColmapFormat format, const std::vector<ColmapImage>& images,
+                       std::string* error) {
+    ModelOutput output;
+    if (!output.open(path, format, error)) {
+        return false;
+    }
+    std::ofstream& out = output.stream();
+    if (format == ColmapFormat::Binary) {
+        writeBinary(out, static_cast<uint64_t>(images.size()));
+        for (const ColmapImage& image : images) {
+            writeBinary(out, image.id);
+            out.write(reinterpret_cast<const char*>(image.qvec), sizeof(image.qvec));
+            out.write(reinterpret_cast<const char*>(image.tvec), sizeof(image.tvec));
+            writeBinary(out, image.camera);
+            out.write(image.name.c_str(), static_cast<std::streamsize>(image.name.size() + 1));
+            writeBinary(out, static_cast<uint64_t>(image.points.size()));
+            out.write(reinterpret_cast<const char*>(image.points.data()),
+                      static_cast<std::streamsize>(image.points.size() * sizeof(ColmapPoint2D)));
+        }
+    } else {
+        size_t observations = 0;
+        for (const ColmapImage& image : images) {
+            for (const ColmapPoint2D& point : image.points) {
+                observations += point.point3D != kColmapNoPoint3D;
+            }
+        }
+        out << "# Image list with two lines of data per image:\n"
+            << "#   IMAGE_ID, QW, QX, QY, QZ, TX, TY, TZ, CAMERA_ID, NAME\n"
+            << "#   POINTS2D[] as (X, Y, POINT3D_ID)\n"
+            << "# Number of images: " << images.size() << ", mean observations per image: "
+            << (images.empty() ? 0.0 : static_cast<double>(observations) / images.size()) << "\n";
+        std::string line;
+        for (const ColmapImage& image : images) {
+            line.clear();
+            append(line, image.id);
+            for (double q : image.qvec) {
+                line += ' ';
+                append(line, q);
+            }
+            for (double t : image.tvec) {
+                line += ' ';
+                append(line, t);
+            }
+            line += ' ';
+            append(line, image.camera);
+            line += ' ';
+            line += image.name;
+            line += '\n';
+            for (size_t i = 0; i < image.points.size(); i++) {
+                if (i > 0) line += ' ';
+                append(line, image.points[i].x);
+                line += ' ';
+                append(line, image.points[i].y);
+                line += ' ';
+                appendPoint3DId(line, image.points[i].point3D);
+            }
+            line += '\n';
+            out << line;
+        }
+    }
+    return output.commit(error);
+}
+
+bool writeColmapModel(const ColmapModel& model, const fs::path& dir, ColmapFormat format, std::string* error) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (!writeColmapCameras(dir / modelFileName("cameras", format), format, model.cameras, error) ||
+        !writeColmapImages(dir / modelFileName("images", format), format, model.images, error)) {
+        return false;
+    }
+    ColmapPointWriter points;
+    if (!points.open(dir / modelFileName("points3D", format), format, error)) {
+        return false;
+    }
+    for (const ColmapPoint3D& point : model.points) {
+        points.write(point);
+    }
+    return points.close(error);
+}
+
+// The header's count fields are fixed-width so close() can fill them in
+static const size_t kCountWidth = 20;
+
+bool ColmapPointWriter::open(const fs::path& path, ColmapFormat format, std::string* error) {
+    m_path = path;
+    m_format = format;
+    m_count = 0;
+    m_observations = 0;
+    fs::path temporary = path;
+    temporary += ".tmp";
+    m_out.open(temporary, format == ColmapFormat::Binary ? std::ios::binary : std::ios::out);
+    if (!m_out.is_open()) {
+        setError(error, "cannot write " + temporary.string());
+        return false;
+    }
+    if (format == ColmapFormat::Binary) {
+        m_countPosition = m_out.tellp();
+        writeBinary(m_out, uint64_t(0));
+    } else {
+        m_out << "# 3D point list with one line of data per point:\n"
+              << "#   POINT3D_ID, X, Y, Z, R, G, B, ERROR, TRACK[] as (IMAGE_ID, POINT2D_IDX)\n";
+        m_countPosition = m_out.tellp();
+        m_out << "# Number of points: " << std::string(kCountWidth, ' ') << ", mean track length: "
+              << std::string(kCountWidth, ' ') << "\n";
+    }
+    return static_cast<bool>(m_out);
+}
+
+bool ColmapPointWriter::write(const ColmapPoint3D& point) {
+    m_count++;
+    m_observations += point.track.size();
+    if (m_format == ColmapFormat::Binary) {
+        writeBinary(m_out, point.id);
+        m_out.write(reinterpret_cast<const char*>(point.xyz), sizeof(point.xyz));
+        m_out.write(reinterpret_cast<const char*>(point.rgb), sizeof(point.rgb));
+        writeBinary(m_out, point.error);
+        writeBinary(m_out, static_cast<uint64_t>(point.track.size()));
+        m_out.write(reinterpret_cast<const char*>(point.track.data()),
+                    static_cast<std::streamsize>(point.track.size() * sizeof(ColmapTrackElement)));
+        return static_cast<bool>(m_out);
+    }
+
+    m_line.clear();
+    append(m_line, point.id);
+    for (double x : point.xyz) {
+        m_line += ' ';
+        append(m_line, x);
+    }
+    for (uint8_t c : point.rgb) {
+        m_line += ' ';
+        append(m_line, static_cast<unsigned>(c));
+    }
+    m_line += ' ';
+    append(m_line, point.error);
+    for (const ColmapTrackElement& element : point.track) {
+        m_line += ' ';
+        append(m_line, element.image);
+        m_line += ' ';
+        append(m_line, element.point2D);
+    }
+    m_line += '\n';
+    m_out << m_line;
+    return static_cast<bool>(m_out);
+}
+
+bool ColmapPointWriter::close(std::string* error) {
+    m_out.seekp(m_countPosition);
+    if (m_format == ColmapFormat::Binary) {
+        writeBinary(m_out, m_count);
+    } else {
+        auto padded = [](std::string text) {
+            text.resize(kCountWidth, ' ');
+            return text;
+        };
+        std::string mean;
+        append(mean, m_count == 0 ? 0.0 : static_cast<double>(m_observations) / m_count);
+        m_out << "# Number of points: " << padded(std::to_string(m_count)) << ", mean track length: "
+              << padded(mean.substr(0, kCountWidth));
+    }
+    m_out.close();
+
+    fs::path temporary = m_path;
+    temporary += ".tmp";
+    std::error_code ec;
+    if (!m_out) {
+        fs::remove(temporary, ec);
+        setError(error, "write failed: " + temporary.string());
+        return false;
+    }
+    fs::rename(temporary, m_path, ec);
+    if (ec) {
+        fs::remove(temporary, ec);
+        setError(error, "cannot replace " + m_path.string() + ": " + ec.message());
+        return false;
+    }
+    return true;
+}
+
+void ColmapPointWriter::discard() {
+    m_out.close();
+    fs::path temporary = m_path;
+    temporary += ".tmp";
+    std::error_code ec;
+    fs::remove(temporary, ec);
+}
+
+bool convertColmapModel(const fs::path& inputDir, const fs::path& outputDir, ColmapFormat format,
+                        const std::set<std::string>* imageNames, ColmapModelCheck& check, std::string* error) {
+    check = ColmapModelCheck();
+    auto problem = [&](const std::string& message) {
+        check.problemCount++;
+        if (check.problems.size() < 10) {
+            check.problems.push_back(message);
+        }
+    };
+
+    ColmapModelFiles files;
+    if (!findColmapModel(inputDir, files)) {
+        setError(error, "no COLMAP model (cameras, images, points3D) in " + inputDir.string());
+        return false;
+    }
+    std::vector<ColmapCamera> cameras;
+    std::vector<ColmapImage> images;
+    if (!readColmapCameras(files.cameras, files.format, cameras, error) ||
+        !readColmapImages(files.images, files.format, images, error)) {
+        return false;
+    }
+    check.cameras = cameras.size();
+    check.images = images.size();
+
+    std::unordered_set<uint32_t> cameraIds;
+    for (const ColmapCamera& camera : cameras) {
+        const std::string what = "camera " + std::to_string(camera.id);
+        if (!cameraIds.insert(camera.id).second) {
+            problem(what + " is listed twice");
+        }
+        if (static_cast<int>(camera.params.size()) != colmapCameraParamCount(camera.model)) {
+            problem(what + " (" + colmapCameraModelName(camera.model) + ") has " +
+                    std::to_string(camera.params.size()) + " parameters, expected " +
+                    std::to_string(colmapCameraParamCount(camera.model)));
+        }
+        if (camera.width == 0 || camera.height == 0) {
+            problem(what + " has no size");
+        }
+    }
+
+    std::unordered_map<uint32_t, const ColmapImage*> imagesById;
+    std::unordered_set<std::string> names;
+    for (const ColmapImage& image : images) {
+        if (!imagesById.emplace(image.id, &image).second) {
+            problem("image id " + std::to_string(image.id) + " is listed twice");
+        }
+        if (!names.insert(image.name).second) {
+            problem("image " + image.name + " is listed twice");
+        }
+        if (!cameraIds.count(image.camera)) {
+            problem("image " + image.name + " uses camera " + std::to_string(image.camera) + ", which does not exist");
+        }
+        if (imageNames && !imageNames->count(image.name)) {
+            problem("image " + image.name + " is not one of the input images");
+        }
+    }
+
+    ColmapPointWriter writer;
+    const bool writing = !outputDir.empty();
+    if (writing) {
+        std::error_code ec;
+        fs::create_directories(outputDir, ec);
+        if (!writeColmapCameras(outputDir / modelFileName("cameras", format), format, cameras, error) ||
+            !writeColmapImages(outputDir / modelFileName("images", format), format, images, error) ||
+            !writer.open(outputDir / modelFileName("points3D", format), format, error)) {
+            return false;
+        }
+    }
+
+    std::vector<uint64_t> pointIds;
+    double errorSum = 0.0;
+    bool written = true;
+    bool read = readColmapPoints(files.points, files.format, [&](const ColmapPoint3D& point) {
+        pointIds.push_back(point.id);
+        check.observations += point.track.size();
+        errorSum += point.error;
+        for (const ColmapTrackElement& element : point.track) {
+            auto image = imagesById.find(element.image);
+            if (image == imagesById.end()) {
+                problem("point " + std::to_string(point.id) + " is seen by image " + std::to_string(element.image) +
+                        ", which does not exist");
+                continue;
+            }
+            // Exports without keypoints (empty POINTS2D lines) have nothing to match
+            const std::vector<ColmapPoint2D>& keypoints = image->second->points;
+            if (!keypoints.empty() &&
+                (element.point2D >= keypoints.size() || keypoints[element.point2D].point3D != point.id)) {
+                problem("point " + std::to_string(point.id) + " and keypoint " + std::to_string(element.point2D) +
+                        " of " + image->second->name + " do not refer to each other");
+            }
+        }
+        if (writing) {
+            written = writer.write(point) && written;
+        }
+        return true;
+    }, error);
+    if (!read || (writing && !written)) {
+        if (writing) {
+            writer.discard();
+            if (read) {
+                setError(error, "cannot write the points to " + outputDir.string());
+            }
+        }
+        return false;
+    }
+    if (writing && !writer.close(error)) {
+        return false;
+    }
+
+    check.points = pointIds.size();
+    if (check.points > 0) {
+        check.meanTrackLength = static_cast<double>(check.observations) / check.points;
+        check.meanError = errorSum / check.points;
+    }
+    std::sort(pointIds.begin(), pointIds.end());
+    auto duplicate = std::adjacent_find(pointIds.begin(), pointIds.end());
+    if (duplicate != pointIds.end()) {
+        problem("point " + std::to_string(*duplicate) + " is listed twice");
+    }
+    for (const ColmapImage& image : images) {
+        for (const ColmapPoint2D& keypoint : image.points) {
+            if (keypoint.point3D != kColmapNoPoint3D &&
+                !std::binary_search(pointIds.begin(), pointIds.end(), keypoint.point3D)) {
+                problem("image " + image.name + " refers to point " + std::to_string(keypoint.point3D) +
+                        ", which does not exist");
+                break;
+            }
+        }
+    }
+    return true;
+}
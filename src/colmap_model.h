@@ -0,0 +1,143 @@
+#ifndef COLMAP_MODEL_H
+#define COLMAP_MODEL_H
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+// COLMAP sparse models (cameras, images, points3D) in COLMAP's text (.txt)
+// and binary (.bin) layouts, as read by COLMAP itself and by Gaussian
+// splatting trainers. Cameras and images are held in memory; points, the
+// bulk of a model, are streamed one at a time.
+
+enum class ColmapFormat { Text, Binary };
+
+// Unobserved keypoint: -1 in images.txt
+constexpr uint64_t kColmapNoPoint3D = UINT64_MAX;
+
+struct ColmapCamera {
+    uint32_t id = 0;
+    int model = 0;  // COLMAP camera model id, e.g. 1 = PINHOLE
+    uint64_t width = 0;
+    uint64_t height = 0;
+    std::vector<double> params;
+};
+
+struct ColmapPoint2D {
+    double x = 0.0;
+    double y = 0.0;
+    uint64_t point3D = kColmapNoPoint3D;
+};
+
+struct ColmapImage {
+    uint32_t id = 0;
+    double qvec[4] = {1.0, 0.0, 0.0, 0.0};  // world-to-camera rotation, w x y z
+    double tvec[3] = {0.0, 0.0, 0.0};
+    uint32_t camera = 0;
+    std::string name;  // relative to the image folder
+    std::vector<ColmapPoint2D> points;
+};
+
+struct ColmapTrackElement {
+    uint32_t image = 0;
+    uint32_t point2D = 0;  // index into that image's points
+};
+
+struct ColmapPoint3D {
+    uint64_t id = 0;
+    double xyz[3] = {0.0, 0.0, 0.0};
+    uint8_t rgb[3] = {0, 0, 0};
+    double error = 0.0;  // mean reprojection error in pixels
+    std::vector<ColmapTrackElement> track;
+};
+
+struct ColmapModel {
+    std::vector<ColmapCamera> cameras;
+    std::vector<ColmapImage> images;
+    std::vector<ColmapPoint3D> points;
+};
+
+// The model files of one folder (e.g. sparse/0). Binary is preferred when
+// both exist; names are matched ignoring case (RealityScan writes Images.txt).
+struct ColmapModelFiles {
+    ColmapFormat format = ColmapFormat::Binary;
+    std::filesystem::path cameras;
+    std::filesystem::path images;
+    std::filesystem::path points;
+};
+
+bool findColmapModel(const std::filesystem::path& dir, ColmapModelFiles& files);
+// Delete the model files of both formats from dir, e.g. before a tool exports a new model there
+void removeColmapModel(const std::filesystem::path& dir);
+
+// Camera model names and parameter counts; -1 / nullptr for unknown models
+int colmapCameraModelId(const std::string& name);
+const char* colmapCameraModelName(int model);
+int colmapCameraParamCount(int model);
+
+bool readColmapCameras(const std::filesystem::path& path, ColmapFormat format, std::vector<ColmapCamera>& cameras,
+                       std::string* error = nullptr);
+bool readColmapImages(const std::filesystem::path& path, ColmapFormat format, std::vector<ColmapImage>& images,
+                      std::string* error = nullptr);
+// Calls visit for every point in file order; the point is reused between
+// calls. visit returning false stops reading (the read then fails).
+bool readColmapPoints(const std::filesystem::path& path, ColmapFormat format,
+                      const std::function<bool(const ColmapPoint3D&)>& visit, std::string* error = nullptr);
+bool readColmapModel(const std::filesystem::path& dir, ColmapModel& model, std::string* error = nullptr);
+
+bool writeColmapCameras(const std::filesystem::path& path, ColmapFormat format,
+                        const std::vector<ColmapCamera>& cameras, std::string* error = nullptr);
+bool writeColmapImages(const std::filesystem::path& path, ColmapFormat format, const std::vector<ColmapImage>& images,
+                       std::string* error = nullptr);
+bool writeColmapModel(const ColmapModel& model, const std::filesystem::path& dir, ColmapFormat format,
+                      std::string* error = nullptr);
+
+// Writes points3D one at a time; the count in the header is filled in by close()
+class ColmapPointWriter {
+public:
+    bool open(const std::filesystem::path& path, ColmapFormat format, std::string* error = nullptr);
+    bool write(const ColmapPoint3D& point);
+    bool close(std::string* error = nullptr);
+    // Drop what was written; the previous file at path stays
+    void discard();
+
+private:
+    std::ofstream m_out;
+    std::filesystem::path m_path;
+    ColmapFormat m_format = ColmapFormat::Binary;
+    std::streampos m_countPosition;
+    uint64_t m_count = 0;
+    uint64_t m_observations = 0;
+    std::string m_line;
+};
+
+// What convertColmapModel found
+struct ColmapModelCheck {
+    size_t cameras = 0;
+    size_t images = 0;
+    size_t points = 0;
+    size_t observations = 0;  // track elements over all points
+    double meanTrackLength = 0.0;
+    double meanError = 0.0;
+    size_t problemCount = 0;
+    std::vector<std::string> problems;  // the first few inconsistencies, readable
+
+    bool ok() const { return problemCount == 0; }
+};
+
+// Read the model in inputDir and check that it is consistent: every image's
+// camera exists with the right number of parameters, ids and names are
+// unique, tracks and keypoints refer to each other, and (with imageNames)
+// every image is one of the given files. When outputDir is not empty the
+// model is written there in `format`, points streamed straight through. A
+// model that cannot be read is an error; inconsistencies are reported in
+// check and do not stop the conversion.
+bool convertColmapModel(const std::filesystem::path& inputDir, const std::filesystem::path& outputDir,
+                        ColmapFormat format, const std::set<std::string>* imageNames, ColmapModelCheck& check,
+                        std::string* error = nullptr);
+
+#endif // COLMAP_MODEL_H
@@ -0,0 +1,218 @@
+#include "disk_budget.h"
+#include "image_pyramid.h"
+#include "matching_strategy.h"
+#include "progress.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Frame size assumed when ffmpeg did not report one (DJI 4K)
+const int kAssumedWidth = 3840;
+const int kAssumedHeight = 2160;
+// Bitrate assumed when the length is unknown: frames from the file size
+const double kVideoBytesPerSecond = 12.5e6;
+// 8192 SIFT features an image (128-byte descriptors, keypoints), and the raw
+// plus verified matches of one image pair
+const double kFeatureBytesPerImage = 1.25e6;
+const double kMatchBytesPerPair = 24e3;
+// Tie points and thumbnails a Metashape or RealityScan project keeps an image
+const double kProjectBytesPerImage = 1.5e6;
+// COLMAP and RealityScan write their undistorted JPEGs at about this -q:v
+const int kUndistortedQuality = 3;
+// Share of a tile's frames that it shares with its neighbours
+const double kTileOverlap = 0.2;
+
+// Bytes per pixel of ffmpeg's MJPEG encoder on drone footage: about 0.3 at
+// -q:v 2 (2.5 MB for a 4K frame), falling with the quantizer
+double jpegBytesPerPixel(int quality) {
+    return 0.3 * std::pow(2.0 / std::max(2, quality), 0.75);
+}
+
+// Image pairs COLMAP matches for n frames
+double matchedPairs(double n, MatchingMode mode) {
+    const MatchingOptions defaults;
+    if (mode == MatchingMode::Exhaustive || (mode == MatchingMode::Auto && n <= defaults.exhaustiveMaxFrames)) {
+        return n * std::max(0.0, n - 1.0) / 2.0;
+    }
+    return n * static_cast<double>(defaults.sequentialOverlap + defaults.spatialNeighbors);
+}
+
+double colmapDatabaseBytes(double n, MatchingMode mode) {
+    return n * kFeatureBytesPerImage + matchedPairs(n, mode) * kMatchBytesPerPair;
+}
+
+// First "<width>x<height>" word in text; ids such as "0x31637661" are no frame size
+bool findFrameSize(std::string_view text, int& width, int& height) {
+    for (size_t i = 0; i < text.size(); i++) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i])) || (i > 0 && text[i - 1] != ' ' && text[i - 1] != ',')) {
+            continue;
+        }
+        size_t x = i;
+        while (x < text.size() && std::isdigit(static_cast<unsigned char>(text[x]))) x++;
+        size_t end = x + 1;
+        while (end < text.size() && std::isdigit(static_cast<unsigned char>(text[end]))) end++;
+        if (x >= text.size() || text[x] != 'x' || end == x + 1) {
+            continue;
+        }
+        const int w = std::atoi(std::string(text.substr(i, x - i)).c_str());
+        const int h = std::atoi(std::string(text.substr(x + 1, end - x - 1)).c_str());
+        if (w >= 16 && h >= 16) {
+            width = w;
+            height = h;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool parseVideoInfoLine(std::string_view line, VideoInfo& info) {
+    const size_t duration = line.find("Duration: ");
+    if (duration != std::string_view::npos) {
+        double seconds = 0.0;
+        if (!parseFfmpegClock(line.substr(duration + 10), seconds) || seconds <= 0.0) {
+            return false;
+        }
+        info.seconds = seconds;
+        return true;
+    }
+    const size_t video = line.find(": Video: ");
+    if (video != std::string_view::npos && line.find("Stream #") != std::string_view::npos && info.width == 0) {
+        return findFrameSize(line.substr(video + 9), info.width, info.height);
+    }
+    return false;
+}
+
+DiskEstimate estimateDiskUsage(const std::vector<VideoInfo>& videos, const PipelineConfig& config) {
+    DiskEstimate estimate;
+    const std::vector<int> factors = pyramidFactors(config.pyramidLevels);
+
+    // Frames of every video at every level, and the full-size pixels for
+    // the images the method writes itself
+    double frameBytes = 0.0;
+    double fullPixels = 0.0;
+    for (const auto& video : videos) {
+        const double seconds = video.seconds > 0.0 ? video.seconds : video.bytes / kVideoBytesPerSecond;
+        const double frames = std::floor(seconds * config.frameRate);
+        double pixels = static_cast<double>(kAssumedWidth) * kAssumedHeight;
+        if (video.width > 0 && video.height > 0) {
+            pixels = static_cast<double>(video.width) * video.height;
+        } else {
+            estimate.sizeAssumed = true;
+        }
+        for (size_t level = 0; level < factors.size(); level++) {
+            const double scale = 1.0 / (static_cast<double>(factors[level]) * factors[level]);
+            frameBytes += frames * pixels * scale * jpegBytesPerPixel(pyramidQuality(config.pyramidQuality, level));
+        }
+        fullPixels += frames * pixels;
+        estimate.frames += frames;
+    }
+
+    // The method's images/ and its pyramid; Metashape's are links to the frames
+    double imageBytes = 0.0;
+    if (config.method != ReconMethod::METASHAPE) {
+        imageBytes = fullPixels * jpegBytesPerPixel(kUndistortedQuality);
+        for (size_t level = 1; level < factors.size(); level++) {
+            const double scale = 1.0 / (static_cast<double>(factors[level]) * factors[level]);
+            imageBytes += fullPixels * scale * jpegBytesPerPixel(pyramidQuality(config.pyramidQuality, level));
+        }
+    }
+
+    const double n = estimate.frames;
+    double databaseBytes = n * kProjectBytesPerImage;
+    if (config.method == ReconMethod::COLMAP) {
+        const size_t maxFrames = config.tileMaxFrames > 0 ? static_cast<size_t>(config.tileMaxFrames) : 0;
+        if (maxFrames > 0 && n > maxFrames) {
+            const double tiles = std::ceil(n / maxFrames);
+            databaseBytes = tiles * colmapDatabaseBytes(n / tiles * (1.0 + kTileOverlap), config.matchingMode);
+        } else {
+            databaseBytes = colmapDatabaseBytes(n, config.matchingMode);
+        }
+    }
+
+    // Phases: reconstruction (frames, database), writing the images, then
+    // the image pyramid. Cleanup only applies to what the method lets go of.
+    const bool ownImages = config.method != ReconMethod::METASHAPE;
+    const double keptDatabase = config.cleanupIntermediates && config.method == ReconMethod::COLMAP ? 0.0 : databaseBytes;
+    const double keptFrames = config.removeDistortedFrames && ownImages ? 0.0 : frameBytes;
+    const double fullImages = ownImages ? fullPixels * jpegBytesPerPixel(kUndistortedQuality) : 0.0;
+    const double reconstruction = frameBytes + databaseBytes;
+    const double undistortion = frameBytes + keptDatabase + fullImages;
+    const double finished = keptFrames + keptDatabase + imageBytes;
+
+    estimate.frameBytes = static_cast<uint64_t>(frameBytes);
+    estimate.databaseBytes = static_cast<uint64_t>(databaseBytes);
+    estimate.imageBytes = static_cast<uint64_t>(imageBytes);
+    estimate.peakBytes = static_cast<uint64_t>(std::max({reconstruction, undistortion, finished}));
+    estimate.finalBytes = static_cast<uint64_t>(finished);
+    return estimate;
+}
+
+uint64_t directoryBytes(const fs::path& dir) {
+    uint64_t bytes = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+         !ec && it != end; it.increment(ec)) {
+        std::error_code fileError;
+        if (!it->is_regular_file(fileError)) {
+            continue;
+        }
+        const uint64_t size = it->file_size(fileError);
+        const uint64_t links = std::max<uint64_t>(1, it->hard_link_count(fileError));
+        if (!fileError) {
+            bytes += size / links;
+        }
+    }
+    return bytes;
+}
+
+std::string formatBytes(uint64_t bytes) {
+    char text[32];
+    const double value = static_cast<double>(bytes);
+    if (value >= 1024.0 * 1024.0 * 1024.0) {
+        std::snprintf(text, sizeof(text), "%.1f GB", value / (1024.0 * 1024.0 * 1024.0));
+    } else {
+        std::snprintf(text, sizeof(text), "%.0f MB", value / (1024.0 * 1024.0));
+    }
+    return text;
+}
+
+bool parseByteSize(const std::string& text, uint64_t& bytes) {
+    char* end = nullptr;
+    const double number = std::strtod(text.c_str(), &end);
+    if (text.empty() || end == text.c_str() || !(number >= 0.0)) {
+        return false;
+    }
+    std::string unit(end);
+    std::transform(unit.begin(), unit.end(), unit.begin(), ::toupper);
+    if (unit.size() > 1 && unit.back() == 'B') {
+        unit.pop_back();  // "GB", "GiB"
+        if (unit.back() == 'I') {
+            unit.pop_back();
+        }
+    }
+    double scale = 1.0;
+    if (unit == "K") {
+        scale = 1024.0;
+    } else if (unit == "M") {
+        scale = 1024.0 * 1024.0;
+    } else if (unit == "G") {
+        scale = 1024.0 * 1024.0 * 1024.0;
+    } else if (unit == "T") {
+        scale = 1024.0 * 1024.0 * 1024.0 * 1024.0;
+    } else if (!unit.empty() && unit != "B") {
+        return false;
+    }
+    if (number * scale > 1.8e19) {
+        return false;
+    }
+    bytes = static_cast<uint64_t>(number * scale);
+    return true;
+}
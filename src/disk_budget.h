@@ -0,0 +1,57 @@
+#ifndef DISK_BUDGET_H
+#define DISK_BUDGET_H
+
+#include "pipeline.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Disk use of a run, estimated before anything is extracted: frames at
+// every pyramid level, the COLMAP database(s) and the method's undistorted
+// images, phase by phase, so the largest amount the output directory holds
+// at one time is known up front. The JPEG and database sizes are rough
+// averages of drone footage (4K frames at -q:v 2 are about 2.5 MB, SIFT
+// features about 1.25 MB an image); the estimate errs on the large side.
+
+// One input video as ffmpeg describes it
+struct VideoInfo {
+    uint64_t bytes = 0;
+    double seconds = 0.0;  // 0 = unknown
+    int width = 0;         // 0 = unknown
+    int height = 0;
+};
+
+// Take the length and frame size from a line of ffmpeg's "-i" banner:
+// "  Duration: 00:12:31.47, start: 0.000000, bitrate: ..." and the first
+// "    Stream #0:0[0x1](und): Video: h264 (High), yuv420p, 3840x2160 [SAR 1:1 DAR 16:9], ..."
+// True if the line carried either.
+bool parseVideoInfoLine(std::string_view line, VideoInfo& info);
+
+struct DiskEstimate {
+    double frames = 0.0;          // frames extracted
+    bool sizeAssumed = false;     // some video's frame size was unknown (3840x2160 assumed)
+    uint64_t frameBytes = 0;      // frames/, every pyramid level
+    uint64_t databaseBytes = 0;   // COLMAP database(s) or the Metashape/RealityScan project
+    uint64_t imageBytes = 0;      // the method's own images/ and their pyramid
+    uint64_t peakBytes = 0;       // most the output directory holds at one time
+    uint64_t finalBytes = 0;      // what it holds at the end
+};
+
+// Estimate for these videos under config: frame rate (also for adaptive
+// sampling, whose frame count depends on the flight), pyramid levels and
+// qualities, method, matching mode, tiles and the cleanup settings
+DiskEstimate estimateDiskUsage(const std::vector<VideoInfo>& videos, const PipelineConfig& config);
+
+// Bytes the files below dir take up; files with several hard links count
+// once in total when all of their links are inside dir
+uint64_t directoryBytes(const std::filesystem::path& dir);
+
+// "1.5 GB", "820 MB"
+std::string formatBytes(uint64_t bytes);
+
+// "500G", "1.5T", "800M", "64K" or a plain number of bytes; false on bad input
+bool parseByteSize(const std::string& text, uint64_t& bytes);
+
+#endif // DISK_BUDGET_H
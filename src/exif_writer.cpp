@@ -0,0 +1,510 @@
+#include "exif_writer.h"
+#include "gps_embed.h"
+#include "stage_manifest.h"
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint8_t kExifHeader[6] = {'E', 'x', 'i', 'f', 0, 0};
+const char kXmpHeader[] = "http://ns.adobe.com/xap/1.0/";  // written with its NUL terminator
+const size_t kXmpHeaderSize = sizeof(kXmpHeader);
+const size_t kMaxSegmentPayload = 0xFFFF - 2;
+
+// TIFF field types and tags used by the GPS IFD
+const uint16_t kTypeByte = 1;
+const uint16_t kTypeAscii = 2;
+const uint16_t kTypeLong = 4;
+const uint16_t kTypeRational = 5;
+const uint16_t kTagGpsInfo = 0x8825;
+
+void setError(std::string* error, const std::string& message) {
+    if (error) {
+        *error = message;
+    }
+}
+
+// Reads and writes TIFF integers in the byte order of the EXIF block
+struct ByteOrder {
+    bool little = true;
+
+    uint16_t get16(const uint8_t* p) const {
+        return little ? static_cast<uint16_t>(p[0] | (p[1] << 8))
+                      : static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    uint32_t get32(const uint8_t* p) const {
+        return little ? (uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24))
+                      : ((uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]));
+    }
+
+    void put16(uint8_t* p, uint16_t v) const {
+        if (little) { p[0] = v & 0xFF; p[1] = v >> 8; }
+        else        { p[0] = v >> 8;   p[1] = v & 0xFF; }
+    }
+
+    void put32(uint8_t* p, uint32_t v) const {
+        if (little) { p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = v >> 24; }
+        else        { p[0] = v >> 24;  p[1] = (v >> 16) & 0xFF; p[2] = (v >> 8) & 0xFF; p[3] = v & 0xFF; }
+    }
+
+    void append16(std::vector<uint8_t>& buf, uint16_t v) const {
+        buf.resize(buf.size() + 2);
+        put16(&buf[buf.size() - 2], v);
+    }
+
+    void append32(std::vector<uint8_t>& buf, uint32_t v) const {
+        buf.resize(buf.size() + 4);
+        put32(&buf[buf.size() - 4], v);
+    }
+};
+
+struct IfdEntry {
+    uint16_t tag;
+    uint16_t type;
+    uint32_t count;
+    std::vector<uint8_t> value;  // raw value bytes, already in the block's byte order
+};
+
+struct Rational {
+    uint32_t numerator;
+    uint32_t denominator;
+};
+
+template <size_t N>
+std::vector<uint8_t> rationalBytes(const ByteOrder& order, const std::array<Rational, N>& values) {
+    std::vector<uint8_t> bytes(8 * N);
+    for (size_t i = 0; i < N; i++) {
+        order.put32(&bytes[8 * i], values[i].numerator);
+        order.put32(&bytes[8 * i + 4], values[i].denominator);
+    }
+    return bytes;
+}
+
+std::vector<uint8_t> asciiBytes(const char* text) {
+    return std::vector<uint8_t>(text, text + std::strlen(text) + 1);
+}
+
+// Same split as decimalToDMS(): seconds to 4 decimals
+std::array<Rational, 3> toDmsRationals(double decimal) {
+    const DmsValue dms = splitDms(decimal);
+    return {{{dms.degrees, 1}, {dms.minutes, 1}, {dms.secondsE4, 10000}}};
+}
+
+Rational toAltitudeRational(double altitude) {
+    return {static_cast<uint32_t>(std::llround(std::abs(altitude) * 1000.0)), 1000};
+}
+
+// Serialize an IFD located at ifdOffset (relative to the TIFF header)
+void appendIfd(const ByteOrder& order, std::vector<IfdEntry> entries, uint32_t nextIfd,
+               std::vector<uint8_t>& tiff) {
+    const uint32_t ifdOffset = static_cast<uint32_t>(tiff.size());
+    const uint32_t dataStart = ifdOffset + 2 + 12 * static_cast<uint32_t>(entries.size()) + 4;
+    std::vector<uint8_t> data;
+
+    order.append16(tiff, static_cast<uint16_t>(entries.size()));
+    for (const IfdEntry& entry : entries) {
+        order.append16(tiff, entry.tag);
+        order.append16(tiff, entry.type);
+        order.append32(tiff, entry.count);
+        if (entry.value.size() <= 4) {
+            // Values of up to 4 bytes live inside the entry, left-justified
+            uint8_t inlineValue[4] = {0, 0, 0, 0};
+            std::memcpy(inlineValue, entry.value.data(), entry.value.size());
+            tiff.insert(tiff.end(), inlineValue, inlineValue + 4);
+        } else {
+            order.append32(tiff, dataStart + static_cast<uint32_t>(data.size()));
+            data.insert(data.end(), entry.value.begin(), entry.value.end());
+            if (data.size() % 2 != 0) {
+                data.push_back(0);
+            }
+        }
+    }
+    order.append32(tiff, nextIfd);
+    tiff.insert(tiff.end(), data.begin(), data.end());
+}
+
+std::vector<IfdEntry> buildGpsEntries(const ByteOrder& order, double latitude, double longitude,
+                                      double altitude) {
+    std::vector<IfdEntry> entries;
+    entries.push_back({0x0000, kTypeByte, 4, {2, 3, 0, 0}});
+    entries.push_back({0x0001, kTypeAscii, 2, asciiBytes(latitude >= 0 ? "N" : "S")});
+    entries.push_back({0x0002, kTypeRational, 3, rationalBytes(order, toDmsRationals(latitude))});
+    entries.push_back({0x0003, kTypeAscii, 2, asciiBytes(longitude >= 0 ? "E" : "W")});
+    entries.push_back({0x0004, kTypeRational, 3, rationalBytes(order, toDmsRationals(longitude))});
+    if (altitude != 0.0) {
+        entries.push_back({0x0005, kTypeByte, 1, {static_cast<uint8_t>(altitude >= 0 ? 0 : 1)}});
+        entries.push_back({0x0006, kTypeRational, 1, rationalBytes(order, std::array<Rational, 1>{toAltitudeRational(altitude)})});
+    }
+    entries.push_back({0x0012, kTypeAscii, 7, asciiBytes("WGS-84")});
+    return entries;
+}
+
+// Build the TIFF block of the EXIF segment. When an existing block is given it is kept
+// byte-for-byte: the new GPS IFD is appended, and IFD0 is either patched in place (it
+// already has a GPSInfo pointer) or re-emitted at the end with the pointer added. No
+// existing data moves, so every offset inside the original block stays valid.
+bool buildTiff(const uint8_t* existing, size_t existingSize, double latitude, double longitude,
+               double altitude, std::vector<uint8_t>& tiff, std::string* error) {
+    if (existing == nullptr) {
+        ByteOrder order;
+        tiff = {'I', 'I', 42, 0, 8, 0, 0, 0};
+        // IFD0 with a single GPSInfo entry; the GPS IFD follows it directly
+        const uint32_t gpsOffset = 8 + 2 + 12 + 4;
+        std::vector<uint8_t> pointer;
+        order.append32(pointer, gpsOffset);
+        appendIfd(order, {{kTagGpsInfo, kTypeLong, 1, pointer}}, 0, tiff);
+        appendIfd(order, buildGpsEntries(order, latitude, longitude, altitude), 0, tiff);
+        return true;
+    }
+
+    if (existingSize < 8) {
+        setError(error, "EXIF block too short");
+        return false;
+    }
+
+    ByteOrder order;
+    if (existing[0] == 'I' && existing[1] == 'I') {
+        order.little = true;
+    } else if (existing[0] == 'M' && existing[1] == 'M') {
+        order.little = false;
+    } else {
+        setError(error, "EXIF block has an invalid byte order mark");
+        return false;
+    }
+
+    const uint32_t ifd0 = order.get32(existing + 4);
+    if (order.get16(existing + 2) != 42 || ifd0 < 8 || size_t(ifd0) + 2 > existingSize) {
+        setError(error, "EXIF block has an invalid IFD0 offset");
+        return false;
+    }
+    const uint16_t entryCount = order.get16(existing + ifd0);
+    if (size_t(ifd0) + 2 + 12 * size_t(entryCount) + 4 > existingSize) {
+        setError(error, "EXIF IFD0 is truncated");
+        return false;
+    }
+
+    tiff.assign(existing, existing + existingSize);
+    if (tiff.size() % 2 != 0) {
+        tiff.push_back(0);
+    }
+
+    size_t gpsEntryPos = 0;
+    for (uint16_t i = 0; i < entryCount; i++) {
+        size_t pos = ifd0 + 2 + 12 * size_t(i);
+        if (order.get16(&tiff[pos]) == kTagGpsInfo) {
+            gpsEntryPos = pos;
+            break;
+        }
+    }
+
+    if (gpsEntryPos != 0) {
+        // Redirect the existing GPSInfo pointer; the old GPS IFD becomes unreferenced
+        order.put16(&tiff[gpsEntryPos + 2], kTypeLong);
+        order.put32(&tiff[gpsEntryPos + 4], 1);
+        order.put32(&tiff[gpsEntryPos + 8], static_cast<uint32_t>(tiff.size()));
+    } else {
+        // Re-emit IFD0 with a GPSInfo entry inserted in tag order
+        const uint32_t newIfd0 = static_cast<uint32_t>(tiff.size());
+        const uint32_t newIfd0Size = 2 + 12 * (uint32_t(entryCount) + 1) + 4;
+        std::vector<uint8_t> ifd;
+        order.append16(ifd, static_cast<uint16_t>(entryCount + 1));
+        bool inserted = false;
+        for (uint16_t i = 0; i < entryCount; i++) {
+            const uint8_t* entry = existing + ifd0 + 2 + 12 * size_t(i);
+            if (!inserted && order.get16(entry) > kTagGpsInfo) {
+                order.append16(ifd, kTagGpsInfo);
+                order.append16(ifd, kTypeLong);
+                order.append32(ifd, 1);
+                order.append32(ifd, newIfd0 + newIfd0Size);
+                inserted = true;
+            }
+            ifd.insert(ifd.end(), entry, entry + 12);
+        }
+        if (!inserted) {
+            order.append16(ifd, kTagGpsInfo);
+            order.append16(ifd, kTypeLong);
+            order.append32(ifd, 1);
+            order.append32(ifd, newIfd0 + newIfd0Size);
+        }
+        const uint8_t* nextIfd = existing + ifd0 + 2 + 12 * size_t(entryCount);
+        ifd.insert(ifd.end(), nextIfd, nextIfd + 4);
+
+        tiff.insert(tiff.end(), ifd.begin(), ifd.end());
+        order.put32(&tiff[4], newIfd0);
+    }
+
+    appendIfd(order, buildGpsEntries(order, latitude, longitude, altitude), 0, tiff);
+    return true;
+}
+
+// XMP stores coordinates as "DDD,MM.mmmmmmmmR" (XMP spec, exif namespace).
+// Rounded once to 1e-8 minutes as a whole, like splitDms, so a value just
+// below a whole degree carries into the degrees instead of printing 60 minutes.
+std::string xmpCoordinate(double decimal, char positiveRef, char negativeRef) {
+    const unsigned long long total = static_cast<unsigned long long>(std::llround(std::abs(decimal) * 60.0 * 1e8));
+    const unsigned long long minutes = total % 6000000000ull;
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%llu,%llu.%08llu%c", total / 6000000000ull, minutes / 100000000ull,
+                  minutes % 100000000ull, decimal >= 0 ? positiveRef : negativeRef);
+    return buffer;
+}
+
+std::string buildXmpAttributes(double latitude, double longitude, double altitude) {
+    std::string attrs;
+    attrs += "\n  exif:GPSLatitude='" + xmpCoordinate(latitude, 'N', 'S') + "'";
+    attrs += "\n  exif:GPSLongitude='" + xmpCoordinate(longitude, 'E', 'W') + "'";
+    if (altitude != 0.0) {
+        Rational alt = toAltitudeRational(altitude);
+        attrs += "\n  exif:GPSAltitude='" + std::to_string(alt.numerator) + "/" +
+                 std::to_string(alt.denominator) + "'";
+        attrs += std::string("\n  exif:GPSAltitudeRef='") + (altitude >= 0 ? "0" : "1") + "'";
+    }
+    return attrs;
+}
+
+std::string buildXmpPacket(double latitude, double longitude, double altitude) {
+    std::string packet;
+    packet += "<?xpacket begin='\xEF\xBB\xBF' id='W5M0MpCehiHzreSzNTczkc9d'?>\n";
+    packet += "<x:xmpmeta xmlns:x='adobe:ns:meta/'>\n";
+    packet += "<rdf:RDF xmlns:rdf='http://www.w3.org/1999/02/22-rdf-syntax-ns#'>\n";
+    packet += " <rdf:Description rdf:about=''\n  xmlns:exif='http://ns.adobe.com/exif/1.0/'";
+    packet += buildXmpAttributes(latitude, longitude, altitude);
+    packet += "/>\n</rdf:RDF>\n</x:xmpmeta>\n<?xpacket end='w'?>";
+    return packet;
+}
+
+// Drop a property written either as an attribute (name='v') or as an element (<name>v</name>)
+void removeXmpProperty(std::string& packet, const std::string& name) {
+    const std::string attr = name + "=";
+    size_t pos;
+    while ((pos = packet.find(attr)) != std::string::npos) {
+        size_t quotePos = pos + attr.size();
+        if (quotePos >= packet.size() || (packet[quotePos] != '\'' && packet[quotePos] != '"')) break;
+        size_t endQuote = packet.find(packet[quotePos], quotePos + 1);
+        if (endQuote == std::string::npos) break;
+        size_t start = pos;
+        while (start > 0 && std::isspace(static_cast<unsigned char>(packet[start - 1]))) start--;
+        packet.erase(start, endQuote + 1 - start);
+    }
+
+    const std::string open = "<" + name + ">";
+    const std::string close = "</" + name + ">";
+    while ((pos = packet.find(open)) != std::string::npos) {
+        size_t end = packet.find(close, pos);
+        if (end == std::string::npos) break;
+        packet.erase(pos, end + close.size() - pos);
+    }
+}
+
+std::string updateXmpPacket(std::string packet, double latitude, double longitude, double altitude) {
+    for (const char* name : {"exif:GPSLatitude", "exif:GPSLongitude", "exif:GPSAltitude", "exif:GPSAltitudeRef"}) {
+        removeXmpProperty(packet, name);
+    }
+
+    const std::string descTag = "<rdf:Description";
+    size_t descPos = packet.find(descTag);
+    if (descPos == std::string::npos) {
+        return buildXmpPacket(latitude, longitude, altitude);
+    }
+
+    size_t tagEnd = packet.find('>', descPos);
+    std::string attrs;
+    if (packet.substr(descPos, tagEnd - descPos).find("xmlns:exif=") == std::string::npos) {
+        attrs += "\n  xmlns:exif='http://ns.adobe.com/exif/1.0/'";
+    }
+    attrs += buildXmpAttributes(latitude, longitude, altitude);
+    packet.insert(descPos + descTag.size(), attrs);
+    return packet;
+}
+
+struct Segment {
+    uint8_t marker;
+    size_t offset;  // position of the 0xFF marker byte
+    size_t size;    // marker + length field + payload
+};
+
+void appendSegment(std::vector<uint8_t>& out, uint8_t marker, const uint8_t* header, size_t headerSize,
+                   const uint8_t* payload, size_t payloadSize) {
+    const size_t length = 2 + headerSize + payloadSize;
+    out.push_back(0xFF);
+    out.push_back(marker);
+    out.push_back(static_cast<uint8_t>(length >> 8));
+    out.push_back(static_cast<uint8_t>(length & 0xFF));
+    out.insert(out.end(), header, header + headerSize);
+    out.insert(out.end(), payload, payload + payloadSize);
+}
+
+} // namespace
+
+bool embedGpsMetadata(const std::vector<uint8_t>& jpeg, double latitude, double longitude,
+                      double altitude, std::vector<uint8_t>& out, std::string* error) {
+    const size_t size = jpeg.size();
+    if (size < 4 || jpeg[0] != 0xFF || jpeg[1] != 0xD8) {
+        setError(error, "not a JPEG file");
+        return false;
+    }
+
+    // Walk the header segments up to the start of scan
+    std::vector<Segment> segments;
+    size_t pos = 2;
+    size_t scanStart = 0;
+    while (pos + 1 < size) {
+        if (jpeg[pos] != 0xFF) {
+            setError(error, "corrupt JPEG marker at offset " + std::to_string(pos));
+            return false;
+        }
+        while (pos + 1 < size && jpeg[pos + 1] == 0xFF) {
+            pos++;  // fill bytes
+        }
+        if (pos + 1 >= size) break;
+        const uint8_t marker = jpeg[pos + 1];
+        if (marker == 0xDA || marker == 0xD9) {
+            scanStart = pos;
+            break;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            segments.push_back({marker, pos, 2});
+            pos += 2;
+            continue;
+        }
+        if (pos + 4 > size) break;
+        const size_t length = (size_t(jpeg[pos + 2]) << 8) | jpeg[pos + 3];
+        if (length < 2 || pos + 2 + length > size) {
+            setError(error, "truncated JPEG segment at offset " + std::to_string(pos));
+            return false;
+        }
+        segments.push_back({marker, pos, 2 + length});
+        pos += 2 + length;
+    }
+    if (scanStart == 0) {
+        setError(error, "JPEG has no image data");
+        return false;
+    }
+
+    const Segment* exifSegment = nullptr;
+    const Segment* xmpSegment = nullptr;
+    for (const Segment& seg : segments) {
+        if (seg.marker != 0xE1) continue;
+        const uint8_t* payload = jpeg.data() + seg.offset + 4;
+        const size_t payloadSize = seg.size - 4;
+        if (!exifSegment && payloadSize >= sizeof(kExifHeader) &&
+            std::memcmp(payload, kExifHeader, sizeof(kExifHeader)) == 0) {
+            exifSegment = &seg;
+        } else if (!xmpSegment && payloadSize >= kXmpHeaderSize &&
+                   std::memcmp(payload, kXmpHeader, kXmpHeaderSize) == 0) {
+            xmpSegment = &seg;
+        }
+    }
+
+    std::vector<uint8_t> tiff;
+    if (exifSegment) {
+        const uint8_t* tiffData = jpeg.data() + exifSegment->offset + 4 + sizeof(kExifHeader);
+        const size_t tiffSize = exifSegment->size - 4 - sizeof(kExifHeader);
+        if (!buildTiff(tiffData, tiffSize, latitude, longitude, altitude, tiff, error)) {
+            return false;
+        }
+    } else {
+        buildTiff(nullptr, 0, latitude, longitude, altitude, tiff, error);
+    }
+    if (sizeof(kExifHeader) + tiff.size() > kMaxSegmentPayload) {
+        setError(error, "EXIF block exceeds 64 KB");
+        return false;
+    }
+
+    std::string xmp;
+    if (xmpSegment) {
+        const char* packet = reinterpret_cast<const char*>(jpeg.data() + xmpSegment->offset + 4 + kXmpHeaderSize);
+        xmp = updateXmpPacket(std::string(packet, xmpSegment->size - 4 - kXmpHeaderSize),
+                              latitude, longitude, altitude);
+    } else {
+        xmp = buildXmpPacket(latitude, longitude, altitude);
+    }
+    if (kXmpHeaderSize + xmp.size() > kMaxSegmentPayload) {
+        setError(error, "XMP packet exceeds 64 KB");
+        return false;
+    }
+
+    out.clear();
+    out.reserve(size + tiff.size() + xmp.size() + 64);
+    out.push_back(0xFF);
+    out.push_back(0xD8);
+
+    // Keep JFIF/JFXX APP0 segments first, then EXIF and XMP, then everything else
+    size_t next = 0;
+    while (next < segments.size() && segments[next].marker == 0xE0) {
+        const Segment& seg = segments[next++];
+        out.insert(out.end(), jpeg.begin() + seg.offset, jpeg.begin() + seg.offset + seg.size);
+    }
+    appendSegment(out, 0xE1, kExifHeader, sizeof(kExifHeader), tiff.data(), tiff.size());
+    appendSegment(out, 0xE1, reinterpret_cast<const uint8_t*>(kXmpHeader), kXmpHeaderSize,
+                  reinterpret_cast<const uint8_t*>(xmp.data()), xmp.size());
+    for (; next < segments.size(); next++) {
+        const Segment& seg = segments[next];
+        if (&seg == exifSegment || &seg == xmpSegment) continue;
+        out.insert(out.end(), jpeg.begin() + seg.offset, jpeg.begin() + seg.offset + seg.size);
+    }
+    out.insert(out.end(), jpeg.begin() + scanStart, jpeg.end());
+    return true;
+}
+
+bool writeGpsMetadata(const std::string& imagePath, double latitude, double longitude,
+                      double altitude, std::string* error, uint64_t* contentHash) {
+    std::vector<uint8_t> jpeg;
+    {
+        std::ifstream in(imagePath, std::ios::binary | std::ios::ate);
+        if (!in.is_open()) {
+            setError(error, "cannot open " + imagePath);
+            return false;
+        }
+        jpeg.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(jpeg.data()), static_cast<std::streamsize>(jpeg.size()))) {
+            setError(error, "read failed for " + imagePath);
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> updated;
+    if (!embedGpsMetadata(jpeg, latitude, longitude, altitude, updated, error)) {
+        return false;
+    }
+
+    // Write next to the original and rename over it so readers never see a partial file
+    fs::path tempPath = fs::path(imagePath);
+    tempPath += ".gps.tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            setError(error, "cannot create " + tempPath.string());
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(updated.data()), static_cast<std::streamsize>(updated.size()));
+        if (!out) {
+            out.close();
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            setError(error, "write failed for " + tempPath.string());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, imagePath, ec);
+    if (ec) {
+        setError(error, "cannot replace " + imagePath + ": " + ec.message());
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    if (contentHash) {
+        *contentHash = fnv1a(updated.data(), updated.size());
+    }
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef EXIF_WRITER_H
+#define EXIF_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Native replacement for the per-frame exiftool call.
+// Writes the same tags as generateExiftoolCommand():
+//   EXIF GPSVersionID, GPSLatitude/Ref, GPSLongitude/Ref, GPSMapDatum,
+//   GPSAltitude/Ref (only when altitude != 0) and the XMP GPS equivalents.
+// An existing EXIF block is kept; only its GPS IFD pointer is added or redirected.
+
+// Rewrite a JPEG buffer with GPS metadata. Returns false (and sets error) if the
+// input is not a JPEG or the metadata would not fit into a single APP1 segment.
+bool embedGpsMetadata(const std::vector<uint8_t>& jpeg, double latitude, double longitude,
+                      double altitude, std::vector<uint8_t>& out, std::string* error = nullptr);
+
+// Embed GPS metadata into a JPEG file. The file is replaced atomically
+// (written to a temporary file next to it, then renamed over the original).
+// contentHash receives the FNV-1a of the bytes written, so callers that track
+// file contents need not read the file again.
+bool writeGpsMetadata(const std::string& imagePath, double latitude, double longitude,
+                      double altitude, std::string* error = nullptr, uint64_t* contentHash = nullptr);
+
+#endif // EXIF_WRITER_H
@@ -0,0 +1,59 @@
+#include "frame_paths.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <map>
+#include <set>
+
+namespace fs = std::filesystem;
+
+fs::path findSrtFile(const fs::path& videoFilePath) {
+    fs::path srtPathUpper = videoFilePath;
+    srtPathUpper.replace_extension(".SRT");
+    fs::path srtPathLower = videoFilePath;
+    srtPathLower.replace_extension(".srt");
+    
+    if (fs::exists(srtPathUpper)) {
+        return srtPathUpper;
+    } else if (fs::exists(srtPathLower)) {
+        return srtPathLower;
+    }
+    return fs::path();
+}
+
+std::string frameFileName(const std::string& framePrefix, size_t n) {
+    char number[32];
+    snprintf(number, sizeof(number), "%04zu", n);
+    return framePrefix + "_frame_" + number + ".jpg";
+}
+
+std::vector<std::string> uniqueFramePrefixes(const std::vector<std::string>& videoFiles) {
+    auto lower = [](std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+        return text;
+    };
+    
+    std::map<std::string, int> stemCounts;
+    for (const auto& video : videoFiles) {
+        stemCounts[lower(fs::path(video).stem().string())]++;
+    }
+    
+    std::vector<std::string> prefixes;
+    std::set<std::string> used;
+    for (const auto& video : videoFiles) {
+        fs::path videoPath(video);
+        std::string prefix = videoPath.stem().string();
+        if (stemCounts[lower(prefix)] > 1) {
+            std::string ext = videoPath.extension().string();
+            prefix += '_';
+            prefix += ext.empty() ? std::string("video") : ext.substr(1);
+        }
+        std::string candidate = prefix;
+        for (int n = 2; used.count(lower(candidate)); n++) {
+            candidate = prefix + "_" + std::to_string(n);
+        }
+        used.insert(lower(candidate));
+        prefixes.push_back(candidate);
+    }
+    return prefixes;
+}
@@ -0,0 +1,19 @@
+#ifndef FRAME_PATHS_H
+#define FRAME_PATHS_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Find the DJI SRT file next to a video (.SRT or .srt), or an empty path
+std::filesystem::path findSrtFile(const std::filesystem::path& videoFilePath);
+
+// File name ffmpeg writes for frame number n (1-based) of "<prefix>_frame_%04d.jpg"
+std::string frameFileName(const std::string& framePrefix, size_t n);
+
+// Frame name prefix per video. Normally the video stem; videos whose stems clash
+// (e.g. DJI_0001.MP4 and DJI_0001.MOV, or different case on Windows) get the
+// extension and, if needed, a counter appended so they can share one folder.
+std::vector<std::string> uniqueFramePrefixes(const std::vector<std::string>& videoFiles);
+
+#endif // FRAME_PATHS_H
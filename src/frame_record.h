@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// One extracted frame as the later pipeline stages see it
+struct FrameRecord {
+    std::string name;        // file name inside the frames folder
+    size_t video = 0;        // index of the source video (sorted input order)
+    size_t index = 0;        // 0-based frame number within its video
+    double timestamp = 0.0;  // seconds from the start of the video
+    bool hasGps = false;     // geotag written from the SRT track
+    double latitude = 0.0;
+    double longitude = 0.0;
+    double altitude = 0.0;
+    uint64_t contentHash = 0;  // FNV-1a of the full-size file as written (0 = not known)
+};
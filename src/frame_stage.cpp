@@ -0,0 +1,227 @@
+#include "frame_stage.h"
+#include "exif_writer.h"
+#include "frame_store.h"
+#include "stage_manifest.h"
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+void FrameHashes::set(const std::string& name, uint64_t hash) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hashes[name] = hash;
+}
+
+uint64_t FrameHashes::get(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_hashes.find(name);
+    return it == m_hashes.end() ? 0 : it->second;
+}
+
+FrameStage::FrameStage(std::string name, WorkStealingPool& pool) : m_name(std::move(name)), m_pool(pool) {}
+
+FrameStage::~FrameStage() {
+    wait();
+}
+
+FrameStage& FrameStage::then(std::string name, FrameOperation operation, size_t maxConcurrent) {
+    auto op = std::make_unique<Operation>();
+    op->name = std::move(name);
+    op->run = std::move(operation);
+    op->maxConcurrent = maxConcurrent;
+    m_operations.push_back(std::move(op));
+    return *this;
+}
+
+FrameStage& FrameStage::stopOnError(bool stop) {
+    m_stopOnError = stop;
+    return *this;
+}
+
+FrameStage& FrameStage::cancelWhen(const std::atomic<bool>* flag) {
+    m_cancel = flag;
+    return *this;
+}
+
+bool FrameStage::stopping() const {
+    return m_stopped || (m_cancel && *m_cancel);
+}
+
+void FrameStage::submit(FrameWork frame) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_started) {
+            m_started = true;
+            m_start = std::chrono::steady_clock::now();
+        }
+        m_outstanding++;
+        m_submitted++;
+    }
+    m_pool.submit([this, frame = std::move(frame)]() mutable { process(frame); });
+}
+
+void FrameStage::process(FrameWork& frame) {
+    bool failed = false;
+    bool cancelled = stopping();
+    for (size_t i = 0; i < m_operations.size() && !failed && !cancelled; i++) {
+        Operation& op = *m_operations[i];
+        if (op.maxConcurrent > 0) {
+            std::unique_lock<std::mutex> lock(op.mutex);
+            op.turn.wait(lock, [&]() { return op.active < op.maxConcurrent; });
+            op.active++;
+        }
+
+        const auto started = std::chrono::steady_clock::now();
+        std::string error;
+        FrameOpResult result = FrameOpResult::Failed;
+        try {
+            result = op.run(frame, error);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        op.busyNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - started).count();
+
+        if (op.maxConcurrent > 0) {
+            {
+                std::lock_guard<std::mutex> lock(op.mutex);
+                op.active--;
+            }
+            op.turn.notify_one();
+        }
+
+        switch (result) {
+            case FrameOpResult::Done: op.done++; break;
+            case FrameOpResult::Skipped: op.skipped++; break;
+            case FrameOpResult::Failed: {
+                op.failed++;
+                failed = true;
+                if (m_stopOnError) {
+                    m_stopped = true;
+                }
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_errors.push_back({frame.name, op.name, error.empty() ? "failed" : error});
+                break;
+            }
+        }
+        cancelled = !failed && i + 1 < m_operations.size() && stopping();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (failed) {
+        m_failed++;
+    } else if (cancelled) {
+        m_cancelled++;
+    } else {
+        m_completed++;
+    }
+    if (--m_outstanding == 0) {
+        m_finished.notify_all();
+    }
+}
+
+FrameStageResult FrameStage::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_outstanding > 0) {
+        // Help instead of idling; matters when the caller is a pool worker
+        lock.unlock();
+        bool ran = m_pool.runOne();
+        lock.lock();
+        if (!ran && m_outstanding > 0) {
+            m_finished.wait_for(lock, std::chrono::milliseconds(2));
+        }
+    }
+
+    FrameStageResult result;
+    result.frames = m_submitted;
+    result.completed = m_completed;
+    result.failed = m_failed;
+    result.cancelled = m_cancelled;
+    result.wasCancelled = stopping();
+    result.errors = m_errors;
+    if (m_started) {
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+    for (const auto& op : m_operations) {
+        FrameOperationStats stats;
+        stats.name = op->name;
+        stats.done = op->done;
+        stats.skipped = op->skipped;
+        stats.failed = op->failed;
+        stats.busySeconds = op->busyNanoseconds.load() * 1e-9;
+        result.operations.push_back(stats);
+    }
+    return result;
+}
+
+FrameStageResult FrameStage::run(std::vector<FrameWork> frames) {
+    for (auto& frame : frames) {
+        submit(std::move(frame));
+    }
+    return wait();
+}
+
+FrameOperation writeGpsOperation() {
+    return [](FrameWork& frame, std::string& error) {
+        if (!frame.gps.valid) {
+            return FrameOpResult::Skipped;
+        }
+        for (const fs::path& file : frame.files) {
+            uint64_t hash = 0;
+            if (!writeGpsMetadata(file.string(), frame.gps.latitude, frame.gps.longitude, frame.gps.altitude,
+                                  &error, &hash)) {
+                error = file.string() + ": " + error;
+                return FrameOpResult::Failed;
+            }
+            if (file == frame.files.front()) {
+                frame.contentHash = hash;
+            }
+        }
+        return FrameOpResult::Done;
+    };
+}
+
+FrameOperation validateJpegOperation() {
+    return [](FrameWork& frame, std::string& error) {
+        for (const fs::path& file : frame.files) {
+            std::ifstream in(file, std::ios::binary | std::ios::ate);
+            const std::streamoff size = in.is_open() ? static_cast<std::streamoff>(in.tellg()) : 0;
+            unsigned char head[2] = {}, tail[2] = {};
+            if (size >= 4) {
+                in.seekg(0);
+                in.read(reinterpret_cast<char*>(head), 2);
+                in.seekg(size - 2);
+                in.read(reinterpret_cast<char*>(tail), 2);
+            }
+            if (!in || head[0] != 0xFF || head[1] != 0xD8 || tail[0] != 0xFF || tail[1] != 0xD9) {
+                error = file.string() + ": not a complete JPEG";
+                return FrameOpResult::Failed;
+            }
+        }
+        return FrameOpResult::Done;
+    };
+}
+
+FrameOperation placeOperation(FrameStore& store, const fs::path& targetDir) {
+    return [&store, targetDir](FrameWork& frame, std::string& error) {
+        if (frame.files.empty()) {
+            return FrameOpResult::Skipped;
+        }
+        return store.place(frame.files.front(), targetDir / frame.name, &error) == FrameStore::Placement::Failed
+                   ? FrameOpResult::Failed
+                   : FrameOpResult::Done;
+    };
+}
+
+FrameOperation contentHashOperation(FrameHashes& hashes) {
+    return [&hashes](FrameWork& frame, std::string& error) {
+        if (frame.files.empty()) {
+            return FrameOpResult::Skipped;
+        }
+        if (frame.contentHash == 0 && !hashFile(frame.files.front().string(), frame.contentHash)) {
+            error = frame.files.front().string() + ": cannot be read";
+            return FrameOpResult::Failed;
+        }
+        hashes.set(frame.name, frame.contentHash);
+        return FrameOpResult::Done;
+    };
+}
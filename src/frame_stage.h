@@ -0,0 +1,160 @@
+#ifndef FRAME_STAGE_H
+#define FRAME_STAGE_H
+
+#include "gps_embed.h"
+#include "work_stealing_pool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FrameStore;
+
+// One frame as it passes through a FrameStage
+struct FrameWork {
+    std::string name;                         // file name, e.g. "DJI_0001_frame_0007.jpg"
+    std::vector<std::filesystem::path> files; // the frame's files, full size first (pyramid levels)
+    GPSData gps;                              // position for metadata operations (valid = false: none)
+    uint64_t contentHash = 0;                 // FNV-1a of the full-size file, once an operation has read or written it
+};
+
+enum class FrameOpResult {
+    Done,
+    Skipped,  // nothing to do for this frame (e.g. no GPS position)
+    Failed    // error set; the frame's remaining operations are not run
+};
+
+// A per-frame operation. Called concurrently for different frames.
+using FrameOperation = std::function<FrameOpResult(FrameWork& frame, std::string& error)>;
+
+struct FrameError {
+    std::string frame;
+    std::string operation;
+    std::string message;
+};
+
+struct FrameOperationStats {
+    std::string name;
+    size_t done = 0;
+    size_t skipped = 0;
+    size_t failed = 0;
+    double busySeconds = 0.0;  // summed over all workers
+};
+
+struct FrameStageResult {
+    size_t frames = 0;     // submitted
+    size_t completed = 0;  // every operation done or skipped
+    size_t failed = 0;
+    size_t cancelled = 0;  // not run because the stage was cancelled or stopped
+    bool wasCancelled = false;
+    double seconds = 0.0;  // wall time from the first submit to the end of wait()
+    std::vector<FrameOperationStats> operations;
+    std::vector<FrameError> errors;
+
+    bool ok() const { return failed == 0 && cancelled == 0; }
+};
+
+// Runs a chain of operations on every frame, frames in parallel on a
+// work-stealing pool. Frames can be submitted up front (run()) or one by one
+// while they are being produced (submit() ... wait()), e.g. as ffmpeg writes them.
+//
+//   FrameStage stage("gps");
+//   stage.then("exif", writeGpsOperation());
+//   FrameStageResult result = stage.run(std::move(frames));
+class FrameStage {
+public:
+    explicit FrameStage(std::string name, WorkStealingPool& pool = WorkStealingPool::shared());
+    // Waits for frames still running
+    ~FrameStage();
+
+    FrameStage(const FrameStage&) = delete;
+    FrameStage& operator=(const FrameStage&) = delete;
+
+    // Append an operation. maxConcurrent > 0 caps how many frames run it at
+    // the same time (for disk-bound steps); a frame waiting for its turn
+    // holds its worker. Add every operation before the first submit().
+    FrameStage& then(std::string name, FrameOperation operation, size_t maxConcurrent = 0);
+    // Stop starting new frames after the first failure (default: collect
+    // every error and carry on)
+    FrameStage& stopOnError(bool stop = true);
+    // Frames not started yet are skipped once *flag is true
+    FrameStage& cancelWhen(const std::atomic<bool>* flag);
+
+    void submit(FrameWork frame);
+    // Blocks until every submitted frame has finished; the calling thread
+    // helps with queued work meanwhile
+    FrameStageResult wait();
+
+    FrameStageResult run(std::vector<FrameWork> frames);
+
+    const std::string& name() const { return m_name; }
+
+private:
+    struct Operation {
+        std::string name;
+        FrameOperation run;
+        size_t maxConcurrent = 0;
+        std::mutex mutex;
+        std::condition_variable turn;
+        size_t active = 0;
+        std::atomic<size_t> done{0};
+        std::atomic<size_t> skipped{0};
+        std::atomic<size_t> failed{0};
+        std::atomic<int64_t> busyNanoseconds{0};
+    };
+
+    void process(FrameWork& frame);
+    bool stopping() const;
+
+    const std::string m_name;
+    WorkStealingPool& m_pool;
+    std::vector<std::unique_ptr<Operation>> m_operations;
+    bool m_stopOnError = false;
+    const std::atomic<bool>* m_cancel = nullptr;
+    std::atomic<bool> m_stopped{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+    size_t m_outstanding = 0;
+    size_t m_submitted = 0;
+    size_t m_completed = 0;
+    size_t m_failed = 0;
+    size_t m_cancelled = 0;
+    std::vector<FrameError> m_errors;
+    bool m_started = false;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Content hashes of a stage's frames by name, filled by contentHashOperation
+class FrameHashes {
+public:
+    void set(const std::string& name, uint64_t hash);
+    // 0 if the frame was not hashed
+    uint64_t get(const std::string& name) const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, uint64_t> m_hashes;
+};
+
+// Building blocks for common per-frame steps
+
+// GPS EXIF/XMP tags into every file of the frame (skipped without a position);
+// sets contentHash from the full-size file it wrote
+FrameOperation writeGpsOperation();
+// Every file is a complete JPEG: starts with SOI and ends with EOI
+FrameOperation validateJpegOperation();
+// The full-size file into targetDir under the frame's name, through the store
+FrameOperation placeOperation(FrameStore& store, const std::filesystem::path& targetDir);
+// Record the full-size file's content hash in hashes, reading the file only
+// if no earlier operation set contentHash
+FrameOperation contentHashOperation(FrameHashes& hashes);
+
+#endif // FRAME_STAGE_H
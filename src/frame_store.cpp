@@ -0,0 +1,223 @@
+#include "frame_store.h"
+#include "stage_manifest.h"
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+bool sameContents(const fs::path& a, const fs::path& b) {
+    std::ifstream fileA(a, std::ios::binary);
+    std::ifstream fileB(b, std::ios::binary);
+    if (!fileA.is_open() || !fileB.is_open()) {
+        return false;
+    }
+    std::vector<char> bufferA(1 << 16), bufferB(1 << 16);
+    for (;;) {
+        fileA.read(bufferA.data(), bufferA.size());
+        fileB.read(bufferB.data(), bufferB.size());
+        if (fileA.gcount() != fileB.gcount() ||
+            std::char_traits<char>::compare(bufferA.data(), bufferB.data(), static_cast<size_t>(fileA.gcount())) != 0) {
+            return false;
+        }
+        if (fileA.gcount() == 0) {
+            return true;
+        }
+    }
+}
+
+// Copy-on-write clone (btrfs, XFS); false where the file system cannot
+bool reflinkFile(const fs::path& from, const fs::path& to) {
+#if defined(__linux__) && defined(FICLONE)
+    int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    int out = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+    bool cloned = ioctl(out, FICLONE, in) == 0;
+    close(out);
+    close(in);
+    if (!cloned) {
+        std::error_code ec;
+        fs::remove(to, ec);
+    }
+    return cloned;
+#else
+    (void)from;
+    (void)to;
+    return false;
+#endif
+}
+
+} // namespace
+
+FrameStore::FrameStore(fs::path root) : m_root(std::move(root)) {}
+
+std::string FrameStore::contentKey(const fs::path& file, uint64_t size, std::string* error) {
+    std::error_code ec;
+    const fs::file_time_type written = fs::last_write_time(file, ec);
+    const std::string path = file.string();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto cached = m_keys.find(path);
+        if (cached != m_keys.end() && std::get<0>(cached->second) == size && std::get<1>(cached->second) == written) {
+            return std::get<2>(cached->second);
+        }
+    }
+
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) {
+        if (error) *error = "cannot read " + path;
+        return "";
+    }
+    uint64_t hash = fnv1a(nullptr, 0);
+    std::vector<char> buffer(1 << 16);
+    while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+        hash = fnv1a(buffer.data(), static_cast<size_t>(in.gcount()), hash);
+    }
+    char key[48];
+    snprintf(key, sizeof(key), "%016llx-%llx", static_cast<unsigned long long>(hash),
+             static_cast<unsigned long long>(size));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_keys[path] = std::make_tuple(size, written, std::string(key));
+    return key;
+}
+
+fs::path FrameStore::objectFor(const fs::path& source, std::string* error) {
+    std::error_code ec;
+    const uint64_t size = fs::file_size(source, ec);
+    if (ec) {
+        if (error) *error = source.string() + ": " + ec.message();
+        return fs::path();
+    }
+    const std::string key = contentKey(source, size, error);
+    if (key.empty()) {
+        return fs::path();
+    }
+    fs::path object = m_root / "objects" / key.substr(0, 2) / (key + source.extension().string());
+
+    // Adding and deduplicating must not race with another thread placing
+    // the same contents
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!fs::exists(object, ec)) {
+        fs::create_directories(object.parent_path(), ec);
+        fs::create_hard_link(source, object, ec);
+        if (ec) {
+            if (error) *error = "cannot link " + source.string() + " into the store: " + ec.message();
+            return fs::path();
+        }
+        return object;
+    }
+    if (fs::equivalent(object, source, ec)) {
+        return object;
+    }
+    if (!sameContents(object, source)) {
+        if (error) *error = "content key collision for " + source.string();
+        return fs::path();
+    }
+
+    // Same bytes under another name: keep one copy
+    fs::path temporary = source;
+    temporary += ".store";
+    fs::remove(temporary, ec);
+    fs::create_hard_link(object, temporary, ec);
+    if (!ec) {
+        fs::rename(temporary, source, ec);
+    }
+    if (ec) {
+        fs::remove(temporary, ec);
+    } else {
+        m_deduplicated++;
+    }
+    return object;
+}
+
+FrameStore::Placement FrameStore::place(const fs::path& source, const fs::path& target, std::string* error) {
+    std::error_code ec;
+    if (fs::equivalent(source, target, ec)) {
+        m_linked++;
+        m_bytesShared += fs::file_size(source, ec);
+        return Placement::Linked;
+    }
+    fs::create_directories(target.parent_path(), ec);
+    fs::remove(target, ec);
+
+    const fs::path object = objectFor(source, error);
+    const uint64_t size = fs::file_size(source, ec);
+    if (!object.empty()) {
+        fs::create_hard_link(object, target, ec);
+        if (!ec) {
+            m_linked++;
+            m_bytesShared += size;
+            return Placement::Linked;
+        }
+    }
+
+    const fs::path& from = object.empty() ? source : object;
+    if (reflinkFile(from, target)) {
+        m_reflinked++;
+        m_bytesShared += size;
+        return Placement::Reflinked;
+    }
+    fs::copy_file(from, target, fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+        if (error) *error = "cannot copy " + from.string() + " to " + target.string() + ": " + ec.message();
+        return Placement::Failed;
+    }
+    m_copied++;
+    return Placement::Copied;
+}
+
+size_t FrameStore::prune() {
+    std::error_code ec;
+    const fs::path objects = m_root / "objects";
+    if (!fs::is_directory(objects, ec)) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t removed = 0;
+    std::vector<fs::path> folders;
+    for (const auto& folder : fs::directory_iterator(objects, ec)) {
+        if (!folder.is_directory(ec)) {
+            continue;
+        }
+        folders.push_back(folder.path());
+        for (const auto& entry : fs::directory_iterator(folder.path(), ec)) {
+            if (entry.is_regular_file(ec) && fs::hard_link_count(entry.path(), ec) == 1 && !ec) {
+                fs::remove(entry.path(), ec);
+                removed++;
+            }
+        }
+    }
+    for (const auto& folder : folders) {
+        if (fs::is_empty(folder, ec)) {
+            fs::remove(folder, ec);
+        }
+    }
+    return removed;
+}
+
+FrameStore::Stats FrameStore::stats() const {
+    Stats stats;
+    stats.linked = m_linked.load();
+    stats.reflinked = m_reflinked.load();
+    stats.copied = m_copied.load();
+    stats.deduplicated = m_deduplicated.load();
+    stats.bytesShared = m_bytesShared.load();
+    return stats;
+}
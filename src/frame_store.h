@@ -0,0 +1,74 @@
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+// Content-addressed image store under the output directory
+// ("<output>/frame_store/objects/ab/<hash>-<size>.jpg"). Every image that a
+// backend needs in its own folder is placed there as a hard link to the
+// store object (a reflink where hard links are not possible, a copy only as
+// the last resort), so one set of image bytes serves frames/, images/ and
+// the pyramid levels of every method run on the flight.
+//
+// Linked files share their bytes: they must only ever be replaced (written
+// to a temporary file and renamed, as ffmpeg -atomic_writing and
+// writeGpsMetadata do), never modified in place.
+class FrameStore {
+public:
+    enum class Placement {
+        Linked,     // hard link to the store object
+        Reflinked,  // copy-on-write clone (Linux FICLONE)
+        Copied,     // plain copy: no links or clones on this file system
+        Failed
+    };
+
+    struct Stats {
+        size_t linked = 0;
+        size_t reflinked = 0;
+        size_t copied = 0;
+        size_t deduplicated = 0;  // sources replaced by a link to an equal object
+        uint64_t bytesShared = 0; // bytes placed without copying them
+    };
+
+    explicit FrameStore(std::filesystem::path root);
+
+    // Make target a file with the contents of source, sharing its bytes
+    // through the store. source is added to the store first (linked, not
+    // copied) and replaced by a link to an existing object with the same
+    // contents. Thread-safe.
+    Placement place(const std::filesystem::path& source, const std::filesystem::path& target,
+                    std::string* error = nullptr);
+
+    // Remove objects that no file outside the store links to any more.
+    // Returns the number of objects removed.
+    size_t prune();
+
+    Stats stats() const;
+    const std::filesystem::path& root() const { return m_root; }
+
+private:
+    // Store object holding source's contents, added if needed; empty if the
+    // file system cannot link source into the store
+    std::filesystem::path objectFor(const std::filesystem::path& source, std::string* error);
+    std::string contentKey(const std::filesystem::path& file, uint64_t size, std::string* error);
+
+    std::filesystem::path m_root;
+
+    // Content keys of files already hashed: path -> (size, write time, key)
+    std::mutex m_mutex;
+    std::map<std::string, std::tuple<uint64_t, std::filesystem::file_time_type, std::string>> m_keys;
+
+    std::atomic<size_t> m_linked{0};
+    std::atomic<size_t> m_reflinked{0};
+    std::atomic<size_t> m_copied{0};
+    std::atomic<size_t> m_deduplicated{0};
+    std::atomic<uint64_t> m_bytesShared{0};
+};
+
+#endif // FRAME_STORE_H
@@ -0,0 +1,477 @@
+#include "geo_registration.h"
+#include "colmap_model.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+Vec3 sub(const Vec3& a, const Vec3& b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+double dot(const Vec3& a, const Vec3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+double norm(const Vec3& a) { return std::sqrt(dot(a, a)); }
+Vec3 cross(const Vec3& a, const Vec3& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+
+double determinant(const double m[3][3]) {
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+           m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+// Eigenvalues (descending) and unit eigenvectors (columns of vectors) of a
+// symmetric 3x3 matrix, by cyclic Jacobi rotations
+void symmetricEigen(const double matrix[3][3], double values[3], double vectors[3][3]) {
+    double a[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            a[i][j] = matrix[i][j];
+            vectors[i][j] = i == j ? 1.0 : 0.0;
+        }
+    }
+    for (int sweep = 0; sweep < 50; sweep++) {
+        const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        const double diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+        if (off <= 1e-30 * diagonal || off == 0.0) {
+            break;
+        }
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (a[p][q] == 0.0) {
+                    continue;
+                }
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (int k = 0; k < 3; k++) {
+                    const double kp = a[k][p], kq = a[k][q];
+                    a[k][p] = c * kp - s * kq;
+                    a[k][q] = s * kp + c * kq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    const double pk = a[p][k], qk = a[q][k];
+                    a[p][k] = c * pk - s * qk;
+                    a[q][k] = s * pk + c * qk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    const double kp = vectors[k][p], kq = vectors[k][q];
+                    vectors[k][p] = c * kp - s * kq;
+                    vectors[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+
+    int order[3] = {0, 1, 2};
+    std::sort(order, order + 3, [&](int x, int y) { return a[x][x] > a[y][y]; });
+    double sorted[3][3];
+    for (int j = 0; j < 3; j++) {
+        values[j] = a[order[j]][order[j]];
+        for (int i = 0; i < 3; i++) {
+            sorted[i][j] = vectors[i][order[j]];
+        }
+    }
+    std::copy(&sorted[0][0], &sorted[0][0] + 9, &vectors[0][0]);
+}
+
+// Standard deviation along the second principal axis relative to the first:
+// near 0 when the points lie on a line
+double planarity(const std::vector<Vec3>& points) {
+    Vec3 mean = {0.0, 0.0, 0.0};
+    for (const Vec3& p : points) {
+        for (int i = 0; i < 3; i++) mean[i] += p[i] / points.size();
+    }
+    double covariance[3][3] = {};
+    for (const Vec3& p : points) {
+        const Vec3 d = sub(p, mean);
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) covariance[i][j] += d[i] * d[j];
+        }
+    }
+    double values[3], vectors[3][3];
+    symmetricEigen(covariance, values, vectors);
+    return values[0] > 0.0 ? std::sqrt(std::max(values[1], 0.0) / values[0]) : 0.0;
+}
+
+std::vector<bool> findInliers(const Similarity& transform, const std::vector<Vec3>& centers,
+                              const std::vector<Vec3>& positions, double maxError, size_t& count) {
+    std::vector<bool> inliers(centers.size());
+    count = 0;
+    for (size_t i = 0; i < centers.size(); i++) {
+        inliers[i] = norm(sub(transform.apply(centers[i]), positions[i])) <= maxError;
+        count += inliers[i];
+    }
+    return inliers;
+}
+
+} // namespace
+
+void quaternionToMatrix(const double q[4], double r[3][3]) {
+    const double n = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    const double w = q[0] / n, x = q[1] / n, y = q[2] / n, z = q[3] / n;
+    r[0][0] = 1 - 2 * (y * y + z * z); r[0][1] = 2 * (x * y - w * z);     r[0][2] = 2 * (x * z + w * y);
+    r[1][0] = 2 * (x * y + w * z);     r[1][1] = 1 - 2 * (x * x + z * z); r[1][2] = 2 * (y * z - w * x);
+    r[2][0] = 2 * (x * z - w * y);     r[2][1] = 2 * (y * z + w * x);     r[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+void matrixToQuaternion(const double r[3][3], double q[4]) {
+    const double trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0.0) {
+        const double s = std::sqrt(trace + 1.0) * 2.0;
+        q[0] = 0.25 * s;
+        q[1] = (r[2][1] - r[1][2]) / s;
+        q[2] = (r[0][2] - r[2][0]) / s;
+        q[3] = (r[1][0] - r[0][1]) / s;
+    } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        const double s = std::sqrt(1.0 + r[0][0] - r[1][1] - r[2][2]) * 2.0;
+        q[0] = (r[2][1] - r[1][2]) / s;
+        q[1] = 0.25 * s;
+        q[2] = (r[0][1] + r[1][0]) / s;
+        q[3] = (r[0][2] + r[2][0]) / s;
+    } else if (r[1][1] > r[2][2]) {
+        const double s = std::sqrt(1.0 + r[1][1] - r[0][0] - r[2][2]) * 2.0;
+        q[0] = (r[0][2] - r[2][0]) / s;
+        q[1] = (r[0][1] + r[1][0]) / s;
+        q[2] = 0.25 * s;
+        q[3] = (r[1][2] + r[2][1]) / s;
+    } else {
+        const double s = std::sqrt(1.0 + r[2][2] - r[0][0] - r[1][1]) * 2.0;
+        q[0] = (r[1][0] - r[0][1]) / s;
+        q[1] = (r[0][2] + r[2][0]) / s;
+        q[2] = (r[1][2] + r[2][1]) / s;
+        q[3] = 0.25 * s;
+    }
+    if (q[0] < 0.0) {
+        for (int i = 0; i < 4; i++) q[i] = -q[i];
+    }
+}
+
+Vec3 cameraCenter(const ColmapImage& image) {
+    double r[3][3];
+    quaternionToMatrix(image.qvec, r);
+    Vec3 center;
+    for (int i = 0; i < 3; i++) {
+        center[i] = -(r[0][i] * image.tvec[0] + r[1][i] * image.tvec[1] + r[2][i] * image.tvec[2]);
+    }
+    return center;
+}
+
+void transformPose(ColmapImage& image, const Similarity& transform) {
+    // World-to-camera pose in the new frame: R' = R S^T, t' = s t - R' T
+    double r[3][3], rotated[3][3];
+    quaternionToMatrix(image.qvec, r);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            rotated[i][j] = r[i][0] * transform.rotation[j][0] + r[i][1] * transform.rotation[j][1] +
+                            r[i][2] * transform.rotation[j][2];
+        }
+    }
+    matrixToQuaternion(rotated, image.qvec);
+    double t[3];
+    for (int i = 0; i < 3; i++) {
+        t[i] = transform.scale * image.tvec[i] - (rotated[i][0] * transform.translation[0] +
+                                                  rotated[i][1] * transform.translation[1] +
+                                                  rotated[i][2] * transform.translation[2]);
+    }
+    std::copy(t, t + 3, image.tvec);
+}
+
+Vec3 Similarity::apply(const Vec3& x) const {
+    Vec3 y;
+    for (int i = 0; i < 3; i++) {
+        y[i] = scale * (rotation[i][0] * x[0] + rotation[i][1] * x[1] + rotation[i][2] * x[2]) + translation[i];
+    }
+    return y;
+}
+
+bool estimateSimilarity(const std::vector<Vec3>& from, const std::vector<Vec3>& to, Similarity& transform) {
+    const size_t n = from.size();
+    if (n < 3 || to.size() != n) {
+        return false;
+    }
+    Vec3 meanFrom = {0.0, 0.0, 0.0}, meanTo = {0.0, 0.0, 0.0};
+    for (size_t i = 0; i < n; i++) {
+        for (int k = 0; k < 3; k++) {
+            meanFrom[k] += from[i][k] / n;
+            meanTo[k] += to[i][k] / n;
+        }
+    }
+    // Cross-covariance of the centred sets and the spread of `from`
+    double covariance[3][3] = {};
+    double variance = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        const Vec3 a = sub(from[i], meanFrom);
+        const Vec3 b = sub(to[i], meanTo);
+        variance += dot(a, a) / n;
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) covariance[r][c] += b[r] * a[c] / n;
+        }
+    }
+    if (variance <= 0.0) {
+        return false;
+    }
+
+    // SVD covariance = U D V^T from the eigen decomposition of covariance^T covariance
+    double gram[3][3] = {};
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            for (int k = 0; k < 3; k++) gram[r][c] += covariance[k][r] * covariance[k][c];
+        }
+    }
+    double values[3], v[3][3];
+    symmetricEigen(gram, values, v);
+    double singular[3];
+    for (int i = 0; i < 3; i++) {
+        singular[i] = std::sqrt(std::max(values[i], 0.0));
+    }
+    if (singular[0] <= 0.0 || singular[1] <= 1e-9 * singular[0]) {
+        return false;
+    }
+    Vec3 u[3];
+    for (int i = 0; i < 2; i++) {
+        for (int r = 0; r < 3; r++) {
+            u[i][r] = (covariance[r][0] * v[0][i] + covariance[r][1] * v[1][i] + covariance[r][2] * v[2][i]) / singular[i];
+        }
+    }
+    // Re-orthonormalise; the third column only needs to complete the basis
+    // (for coplanar points its singular value is zero)
+    const double length0 = norm(u[0]);
+    for (double& x : u[0]) x /= length0;
+    const double along = dot(u[1], u[0]);
+    for (int r = 0; r < 3; r++) u[1][r] -= along * u[0][r];
+    const double length1 = norm(u[1]);
+    for (double& x : u[1]) x /= length1;
+    u[2] = cross(u[0], u[1]);
+    if (singular[2] > 1e-9 * singular[0]) {
+        Vec3 direct;
+        for (int r = 0; r < 3; r++) {
+            direct[r] = covariance[r][0] * v[0][2] + covariance[r][1] * v[1][2] + covariance[r][2] * v[2][2];
+        }
+        if (dot(direct, u[2]) < 0.0) {
+            for (double& x : u[2]) x = -x;
+        }
+    }
+
+    // Reflection guard: flip the weakest axis if det(U) det(V) < 0
+    double uMatrix[3][3];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) uMatrix[r][c] = u[c][r];
+    }
+    const double sign = determinant(uMatrix) * determinant(v) < 0.0 ? -1.0 : 1.0;
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+            transform.rotation[r][c] =
+                uMatrix[r][0] * v[c][0] + uMatrix[r][1] * v[c][1] + sign * uMatrix[r][2] * v[c][2];
+        }
+    }
+    transform.scale = (singular[0] + singular[1] + sign * singular[2]) / variance;
+    for (int i = 0; i < 3; i++) {
+        const double rotated = transform.rotation[i][0] * meanFrom[0] + transform.rotation[i][1] * meanFrom[1] +
+                               transform.rotation[i][2] * meanFrom[2];
+        transform.translation[i] = meanTo[i] - transform.scale * rotated;
+    }
+    return transform.scale > 0.0;
+}
+
+bool registerCenters(const std::vector<Vec3>& centers, const std::vector<Vec3>& positions,
+                     const GeoRegistrationOptions& options, GeoRegistrationResult& result) {
+    const size_t n = centers.size();
+    result.matched = n;
+    const size_t needed = std::max<size_t>(3, options.minInliers);
+    if (n < needed) {
+        result.reason = "only " + std::to_string(n) + " registered images have GPS positions (at least " +
+                        std::to_string(needed) + " needed)";
+        return false;
+    }
+    if (planarity(positions) < 0.02) {
+        result.reason = "the GPS positions lie nearly on a straight line, which leaves the rotation about it undetermined";
+        return false;
+    }
+
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    Similarity best;
+    size_t bestCount = 0;
+    std::vector<Vec3> sampleFrom(3), sampleTo(3);
+    for (int iteration = 0; iteration < options.iterations && bestCount < n; iteration++) {
+        size_t a = pick(rng), b = pick(rng), c = pick(rng);
+        if (a == b || a == c || b == c) {
+            continue;
+        }
+        // Nearly collinear samples give an arbitrary roll
+        const Vec3 ab = sub(positions[b], positions[a]);
+        const Vec3 ac = sub(positions[c], positions[a]);
+        if (norm(cross(ab, ac)) < 0.05 * norm(ab) * norm(ac)) {
+            continue;
+        }
+        sampleFrom = {centers[a], centers[b], centers[c]};
+        sampleTo = {positions[a], positions[b], positions[c]};
+        Similarity candidate;
+        if (!estimateSimilarity(sampleFrom, sampleTo, candidate)) {
+            continue;
+        }
+        size_t count = 0;
+        findInliers(candidate, centers, positions, options.maxError, count);
+        if (count > bestCount) {
+            bestCount = count;
+            best = candidate;
+        }
+    }
+    if (bestCount < 3) {
+        result.reason = "no three cameras agree with their GPS positions within " +
+                        std::to_string(options.maxError) + " m";
+        return false;
+    }
+
+    // Least squares on the consensus set; a second round picks up cameras the
+    // minimal-sample fit was too coarse for
+    Similarity transform = best;
+    std::vector<bool> inliers = findInliers(best, centers, positions, options.maxError, bestCount);
+    for (int round = 0; round < 2; round++) {
+        std::vector<Vec3> from, to;
+        for (size_t i = 0; i < n; i++) {
+            if (inliers[i]) {
+                from.push_back(centers[i]);
+                to.push_back(positions[i]);
+            }
+        }
+        Similarity refined;
+        if (!estimateSimilarity(from, to, refined)) {
+            break;
+        }
+        size_t count = 0;
+        std::vector<bool> refinedInliers = findInliers(refined, centers, positions, options.maxError, count);
+        if (count < bestCount) {
+            break;
+        }
+        transform = refined;
+        inliers = refinedInliers;
+        bestCount = count;
+    }
+
+    result.transform = transform;
+    result.inliers = bestCount;
+    double sum = 0.0;
+    result.maxError = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        if (inliers[i]) {
+            const double error = norm(sub(transform.apply(centers[i]), positions[i]));
+            sum += error * error;
+            result.maxError = std::max(result.maxError, error);
+        }
+    }
+    result.rmsError = std::sqrt(sum / bestCount);
+    if (bestCount < needed || bestCount * 10 < n * 3) {
+        result.reason = "only " + std::to_string(bestCount) + " of " + std::to_string(n) +
+                        " cameras agree with their GPS positions";
+        return false;
+    }
+    return true;
+}
+
+bool geoRegisterColmapModel(const fs::path& inputDir, const fs::path& outputDir,
+                            const std::map<std::string, GPSData>& positions, const GeoRegistrationOptions& options,
+                            GeoRegistrationResult& result, std::string* error) {
+    result = GeoRegistrationResult();
+    ColmapModelFiles files;
+    if (!findColmapModel(inputDir, files)) {
+        if (error) *error = "no COLMAP model (cameras, images, points3D) in " + inputDir.string();
+        return false;
+    }
+    std::vector<ColmapCamera> cameras;
+    std::vector<ColmapImage> images;
+    if (!readColmapCameras(files.cameras, files.format, cameras, error) ||
+        !readColmapImages(files.images, files.format, images, error)) {
+        return false;
+    }
+    result.registered = images.size();
+
+    std::vector<const GPSData*> matched;
+    std::vector<Vec3> centers;
+    for (const ColmapImage& image : images) {
+        auto position = positions.find(image.name);
+        if (position != positions.end() && position->second.valid) {
+            matched.push_back(&position->second);
+            centers.push_back(cameraCenter(image));
+        }
+    }
+    for (const GPSData* gps : matched) {
+        result.origin.latitude += gps->latitude / matched.size();
+        result.origin.longitude += gps->longitude / matched.size();
+        result.origin.altitude += gps->altitude / matched.size();
+    }
+    CoordinateArrays geodetic;
+    geodetic.reserve(matched.size());
+    for (const GPSData* gps : matched) {
+        geodetic.push_back(gps->latitude, gps->longitude, gps->altitude);
+    }
+    geodeticToEnu(result.origin, geodetic, geodetic);
+    std::vector<Vec3> enu(geodetic.size());
+    for (size_t i = 0; i < enu.size(); i++) {
+        enu[i] = geodetic[i];
+    }
+    if (!registerCenters(centers, enu, options, result)) {
+        return false;
+    }
+
+    const Similarity& transform = result.transform;
+    for (ColmapImage& image : images) {
+        transformPose(image, transform);
+    }
+
+    std::error_code ec;
+    fs::create_directories(outputDir, ec);
+    ColmapPointWriter writer;
+    if (!writeColmapCameras(outputDir / "cameras.bin", ColmapFormat::Binary, cameras, error) ||
+        !writeColmapImages(outputDir / "images.bin", ColmapFormat::Binary, images, error) ||
+        !writer.open(outputDir / "points3D.bin", ColmapFormat::Binary, error)) {
+        return false;
+    }
+    bool written = true;
+    ColmapPoint3D moved;
+    bool read = readColmapPoints(files.points, files.format, [&](const ColmapPoint3D& point) {
+        moved = point;
+        const Vec3 xyz = transform.apply({point.xyz[0], point.xyz[1], point.xyz[2]});
+        std::copy(xyz.begin(), xyz.end(), moved.xyz);
+        written = writer.write(moved) && written;
+        return true;
+    }, error);
+    if (!read || !written) {
+        writer.discard();
+        if (read && error) *error = "cannot write the points to " + outputDir.string();
+        return false;
+    }
+    return writer.close(error);
+}
+
+bool writeGeoRegistration(const fs::path& path, const GeoRegistrationResult& result) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+    char line[256];
+    out << "# Similarity transform from the reconstruction frame to local ENU metres\n"
+        << "# (x east, y north, z up at the origin): enu = scale * rotation * x + translation\n";
+    snprintf(line, sizeof(line), "origin = %.9f %.9f %.3f\n", result.origin.latitude, result.origin.longitude,
+             result.origin.altitude);
+    out << line;
+    snprintf(line, sizeof(line), "scale = %.12g\n", result.transform.scale);
+    out << line;
+    const auto& r = result.transform.rotation;
+    snprintf(line, sizeof(line), "rotation = %.12g %.12g %.12g %.12g %.12g %.12g %.12g %.12g %.12g\n", r[0][0],
+             r[0][1], r[0][2], r[1][0], r[1][1], r[1][2], r[2][0], r[2][1], r[2][2]);
+    out << line;
+    const auto& t = result.transform.translation;
+    snprintf(line, sizeof(line), "translation = %.12g %.12g %.12g\n", t[0], t[1], t[2]);
+    out << line;
+    out << "images = " << result.registered << "\n"
+        << "with_gps = " << result.matched << "\n"
+        << "inliers = " << result.inliers << "\n";
+    snprintf(line, sizeof(line), "rms_error_m = %.3f\nmax_error_m = %.3f\n", result.rmsError, result.maxError);
+    out << line;
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,73 @@
+#ifndef GEO_REGISTRATION_H
+#define GEO_REGISTRATION_H
+
+#include "geodesy.h"
+#include "gps_embed.h"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+// x' = scale * rotation * x + translation
+struct Similarity {
+    double scale = 1.0;
+    double rotation[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+    Vec3 translation = {0.0, 0.0, 0.0};
+
+    Vec3 apply(const Vec3& x) const;
+};
+
+// Least-squares similarity mapping `from` onto `to` (Umeyama 1991). False if
+// the points do not span at least a plane, i.e. the rotation about a line
+// through them is undetermined.
+bool estimateSimilarity(const std::vector<Vec3>& from, const std::vector<Vec3>& to, Similarity& transform);
+
+struct ColmapImage;
+
+// Rotation matrix of a unit quaternion (w, x, y, z, as in COLMAP) and back
+void quaternionToMatrix(const double q[4], double r[3][3]);
+void matrixToQuaternion(const double r[3][3], double q[4]);
+// Camera center in world coordinates: -R^T t
+Vec3 cameraCenter(const ColmapImage& image);
+// Move an image's pose into the frame x' = transform(x)
+void transformPose(ColmapImage& image, const Similarity& transform);
+
+struct GeoRegistrationOptions {
+    double maxError = 5.0;  // metres; a camera further from its GPS position is an outlier
+    int iterations = 1000;  // RANSAC samples
+    size_t minInliers = 3;
+    uint32_t seed = 1;      // fixed, so reruns give the same transform
+};
+
+struct GeoRegistrationResult {
+    GeoOrigin origin;
+    Similarity transform;     // reconstruction frame -> ENU at origin
+    size_t registered = 0;    // images in the model
+    size_t matched = 0;       // of those, images with a GPS position
+    size_t inliers = 0;
+    double rmsError = 0.0;    // metres, over the inliers
+    double maxError = 0.0;    // metres, largest inlier residual
+    std::string reason;       // why registration failed
+};
+
+// RANSAC over minimal samples of three correspondences, then a refit on all
+// inliers. positions are the GPS positions in ENU, centers the matching
+// camera centers in the reconstruction frame.
+bool registerCenters(const std::vector<Vec3>& centers, const std::vector<Vec3>& positions,
+                     const GeoRegistrationOptions& options, GeoRegistrationResult& result);
+
+// Align the COLMAP model in inputDir to the GPS positions of its images
+// (by image name) and write it to outputDir as a binary model in metres,
+// x east, y north, z up around the positions' mean. Points are streamed
+// through, so the model is read once. False with result.reason set when too
+// few images have positions or they do not determine the transform; false
+// with error set when the model cannot be read or written.
+bool geoRegisterColmapModel(const std::filesystem::path& inputDir, const std::filesystem::path& outputDir,
+                            const std::map<std::string, GPSData>& positions, const GeoRegistrationOptions& options,
+                            GeoRegistrationResult& result, std::string* error = nullptr);
+
+// "geo_registration.txt": origin, transform and fit, one "key = value" per line
+bool writeGeoRegistration(const std::filesystem::path& path, const GeoRegistrationResult& result);
+
+#endif // GEO_REGISTRATION_H
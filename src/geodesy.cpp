@@ -0,0 +1,300 @@
+#include "geodesy.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+const double kDegree = kPi / 180.0;
+
+// Rotation between ECEF offsets and east-north-up at an origin
+struct EnuFrame {
+    double sinLat, cosLat, sinLon, cosLon;
+    Vec3 originEcef;
+
+    explicit EnuFrame(const GeoOrigin& origin) {
+        const double lat = origin.latitude * kDegree;
+        const double lon = origin.longitude * kDegree;
+        sinLat = std::sin(lat);
+        cosLat = std::cos(lat);
+        sinLon = std::sin(lon);
+        cosLon = std::cos(lon);
+        const double n = wgs84::kSemiMajorAxis / std::sqrt(1.0 - wgs84::kEccentricity2 * sinLat * sinLat);
+        originEcef = {(n + origin.altitude) * cosLat * cosLon, (n + origin.altitude) * cosLat * sinLon,
+                      (n * (1.0 - wgs84::kEccentricity2) + origin.altitude) * sinLat};
+    }
+};
+
+// Transverse Mercator on an ellipsoid (a, f) by Krüger's series in the third
+// flattening n, summed with Clenshaw's recurrence in complex arithmetic
+// (Karney, "Transverse Mercator with an accuracy of a few nanometers", 2011)
+class TransverseMercator {
+public:
+    TransverseMercator(double semiMajorAxis, double flattening) {
+        const double n = flattening / (2.0 - flattening);
+        const double n2 = n * n, n3 = n2 * n, n4 = n3 * n, n5 = n4 * n, n6 = n5 * n;
+        m_e2 = flattening * (2.0 - flattening);
+        m_e = std::sqrt(m_e2);
+        m_rectifyingRadius = semiMajorAxis / (1.0 + n) * (1.0 + n2 / 4.0 + n4 / 64.0 + n6 / 256.0);
+
+        m_alpha[0] = n / 2.0 - 2.0 * n2 / 3.0 + 5.0 * n3 / 16.0 + 41.0 * n4 / 180.0 - 127.0 * n5 / 288.0 +
+                     7891.0 * n6 / 37800.0;
+        m_alpha[1] = 13.0 * n2 / 48.0 - 3.0 * n3 / 5.0 + 557.0 * n4 / 1440.0 + 281.0 * n5 / 630.0 -
+                     1983433.0 * n6 / 1935360.0;
+        m_alpha[2] = 61.0 * n3 / 240.0 - 103.0 * n4 / 140.0 + 15061.0 * n5 / 26880.0 + 167603.0 * n6 / 181440.0;
+        m_alpha[3] = 49561.0 * n4 / 161280.0 - 179.0 * n5 / 168.0 + 6601661.0 * n6 / 7257600.0;
+        m_alpha[4] = 34729.0 * n5 / 80640.0 - 3418889.0 * n6 / 1995840.0;
+        m_alpha[5] = 212378941.0 * n6 / 319334400.0;
+
+        m_beta[0] = n / 2.0 - 2.0 * n2 / 3.0 + 37.0 * n3 / 96.0 - n4 / 360.0 - 81.0 * n5 / 512.0 +
+                    96199.0 * n6 / 604800.0;
+        m_beta[1] = n2 / 48.0 + n3 / 15.0 - 437.0 * n4 / 1440.0 + 46.0 * n5 / 105.0 - 1118711.0 * n6 / 3870720.0;
+        m_beta[2] = 17.0 * n3 / 480.0 - 37.0 * n4 / 840.0 - 209.0 * n5 / 4480.0 + 5569.0 * n6 / 90720.0;
+        m_beta[3] = 4397.0 * n4 / 161280.0 - 11.0 * n5 / 504.0 - 830251.0 * n6 / 7257600.0;
+        m_beta[4] = 4583.0 * n5 / 161280.0 - 108847.0 * n6 / 3991680.0;
+        m_beta[5] = 20648693.0 * n6 / 638668800.0;
+    }
+
+    // Latitude and longitude from the central meridian (radians) to
+    // (easting, northing) in units of the rectifying radius times k0
+    void forward(double phi, double lambda, double& x, double& y) const {
+        const double tau = conformalTan(std::tan(phi));
+        const double cosLambda = std::cos(lambda);
+        const double xi = std::atan2(tau, cosLambda);
+        const double eta = std::asinh(std::sin(lambda) / std::hypot(tau, cosLambda));
+        double dxi, deta;
+        clenshaw(m_alpha, xi, eta, dxi, deta);
+        y = (xi + dxi) * m_rectifyingRadius;
+        x = (eta + deta) * m_rectifyingRadius;
+    }
+
+    void reverse(double x, double y, double& phi, double& lambda) const {
+        const double xi = y / m_rectifyingRadius;
+        const double eta = x / m_rectifyingRadius;
+        double dxi, deta;
+        clenshaw(m_beta, xi, eta, dxi, deta);
+        const double xip = xi - dxi;
+        const double etap = eta - deta;
+        const double sinhEta = std::sinh(etap);
+        const double cosXi = std::cos(xip);
+        // tan of the conformal latitude, then invert the conformal mapping
+        const double taup = std::sin(xip) / std::hypot(sinhEta, cosXi);
+        phi = std::atan(geodeticTan(taup));
+        lambda = std::atan2(sinhEta, cosXi);
+    }
+
+private:
+    // tan(conformal latitude) from tan(latitude)
+    double conformalTan(double tau) const {
+        const double secant = std::hypot(1.0, tau);
+        const double sigma = std::sinh(m_e * std::atanh(m_e * tau / secant));
+        return std::hypot(1.0, sigma) * tau - sigma * secant;
+    }
+
+    // Inverse of conformalTan by Newton's method; three steps from this start
+    // reach full double precision at any latitude a drone flies
+    double geodeticTan(double taup) const {
+        const double e2m = 1.0 - m_e2;
+        double tau = taup / e2m;
+        for (int i = 0; i < 3; i++) {
+            const double taupa = conformalTan(tau);
+            tau += (taup - taupa) * (1.0 + e2m * tau * tau) /
+                   (e2m * std::hypot(1.0, tau) * std::hypot(1.0, taupa));
+        }
+        return tau;
+    }
+
+    // sum_j c[j] sin(2 (j+1) (xi + i eta)), split into real and imaginary part
+    static void clenshaw(const double (&c)[6], double xi, double eta, double& re, double& im) {
+        const double sin2 = std::sin(2.0 * xi), cos2 = std::cos(2.0 * xi);
+        const double sinh2 = std::sinh(2.0 * eta), cosh2 = std::cosh(2.0 * eta);
+        // a = 2 cos(2 zeta)
+        const double ar = 2.0 * cos2 * cosh2, ai = -2.0 * sin2 * sinh2;
+        double y0r = 0.0, y0i = 0.0, y1r = 0.0, y1i = 0.0;
+        for (int j = 5; j >= 0; j--) {
+            const double yr = ar * y0r - ai * y0i - y1r + c[j];
+            const double yi = ar * y0i + ai * y0r - y1i;
+            y1r = y0r;
+            y1i = y0i;
+            y0r = yr;
+            y0i = yi;
+        }
+        // times sin(2 zeta)
+        const double sr = sin2 * cosh2, si = cos2 * sinh2;
+        re = sr * y0r - si * y0i;
+        im = sr * y0i + si * y0r;
+    }
+
+    double m_e2;
+    double m_e;
+    double m_rectifyingRadius;
+    double m_alpha[6];
+    double m_beta[6];
+};
+
+const TransverseMercator& wgs84TransverseMercator() {
+    static const TransverseMercator projection(wgs84::kSemiMajorAxis, wgs84::kFlattening);
+    return projection;
+}
+
+const double kUtmScale = 0.9996;
+const double kUtmFalseEasting = 500000.0;
+const double kUtmFalseNorthing = 10000000.0;
+
+double centralMeridian(int zone) {
+    return (zone * 6.0 - 183.0) * kDegree;
+}
+
+} // namespace
+
+void geodeticToEcef(const CoordinateArrays& geodetic, CoordinateArrays& ecef) {
+    const size_t count = geodetic.size();
+    ecef.resize(count);
+    const double* lat = geodetic.x.data();
+    const double* lon = geodetic.y.data();
+    const double* alt = geodetic.z.data();
+    double* x = ecef.x.data();
+    double* y = ecef.y.data();
+    double* z = ecef.z.data();
+    for (size_t i = 0; i < count; i++) {
+        const double phi = lat[i] * kDegree;
+        const double lambda = lon[i] * kDegree;
+        const double h = alt[i];
+        const double sinPhi = std::sin(phi), cosPhi = std::cos(phi);
+        const double n = wgs84::kSemiMajorAxis / std::sqrt(1.0 - wgs84::kEccentricity2 * sinPhi * sinPhi);
+        x[i] = (n + h) * cosPhi * std::cos(lambda);
+        y[i] = (n + h) * cosPhi * std::sin(lambda);
+        z[i] = (n * (1.0 - wgs84::kEccentricity2) + h) * sinPhi;
+    }
+}
+
+void ecefToGeodetic(const CoordinateArrays& ecef, CoordinateArrays& geodetic) {
+    // Heikkinen (1982), as given by Zhu (1993): closed form, exact to well
+    // below a millimetre for any point more than ~40 km from the centre
+    const double a = wgs84::kSemiMajorAxis;
+    const double b = wgs84::kSemiMinorAxis;
+    const double e2 = wgs84::kEccentricity2;
+    const double e4 = e2 * e2;
+    const double ep2 = (a * a - b * b) / (b * b);
+    const double a2b2 = a * a - b * b;
+
+    const size_t count = ecef.size();
+    geodetic.resize(count);
+    const double* xs = ecef.x.data();
+    const double* ys = ecef.y.data();
+    const double* zs = ecef.z.data();
+    double* lat = geodetic.x.data();
+    double* lon = geodetic.y.data();
+    double* alt = geodetic.z.data();
+    for (size_t i = 0; i < count; i++) {
+        const double x = xs[i], y = ys[i], z = zs[i];
+        const double p2 = x * x + y * y;
+        const double p = std::sqrt(p2);
+        const double f = 54.0 * b * b * z * z;
+        const double g = p2 + (1.0 - e2) * z * z - e2 * a2b2;
+        const double c = e4 * f * p2 / (g * g * g);
+        const double s = std::cbrt(1.0 + c + std::sqrt(c * c + 2.0 * c));
+        const double k = s + 1.0 + 1.0 / s;
+        const double pk = f / (3.0 * k * k * g * g);
+        const double q = std::sqrt(1.0 + 2.0 * e4 * pk);
+        const double r0 = -pk * e2 * p / (1.0 + q) +
+                          std::sqrt(std::max(0.0, 0.5 * a * a * (1.0 + 1.0 / q) -
+                                                      pk * (1.0 - e2) * z * z / (q * (1.0 + q)) - 0.5 * pk * p2));
+        const double d = p - e2 * r0;
+        const double u = std::sqrt(d * d + z * z);
+        const double v = std::sqrt(d * d + (1.0 - e2) * z * z);
+        const double z0 = b * b * z / (a * v);
+        alt[i] = u * (1.0 - b * b / (a * v));
+        lat[i] = std::atan2(z + ep2 * z0, p) / kDegree;
+        lon[i] = std::atan2(y, x) / kDegree;
+    }
+}
+
+void geodeticToEnu(const GeoOrigin& origin, const CoordinateArrays& geodetic, CoordinateArrays& enu) {
+    const EnuFrame frame(origin);
+    geodeticToEcef(geodetic, enu);
+
+    // Pure multiply-add pass over the three arrays: vectorizes
+    const size_t count = enu.size();
+    double* x = enu.x.data();
+    double* y = enu.y.data();
+    double* z = enu.z.data();
+    for (size_t i = 0; i < count; i++) {
+        const double dx = x[i] - frame.originEcef[0];
+        const double dy = y[i] - frame.originEcef[1];
+        const double dz = z[i] - frame.originEcef[2];
+        x[i] = -frame.sinLon * dx + frame.cosLon * dy;
+        y[i] = -frame.sinLat * frame.cosLon * dx - frame.sinLat * frame.sinLon * dy + frame.cosLat * dz;
+        z[i] = frame.cosLat * frame.cosLon * dx + frame.cosLat * frame.sinLon * dy + frame.sinLat * dz;
+    }
+}
+
+void enuToGeodetic(const GeoOrigin& origin, const CoordinateArrays& enu, CoordinateArrays& geodetic) {
+    const EnuFrame frame(origin);
+    const size_t count = enu.size();
+    CoordinateArrays ecef;
+    ecef.resize(count);
+    const double* e = enu.x.data();
+    const double* n = enu.y.data();
+    const double* u = enu.z.data();
+    for (size_t i = 0; i < count; i++) {
+        ecef.x[i] = frame.originEcef[0] - frame.sinLon * e[i] - frame.sinLat * frame.cosLon * n[i] +
+                    frame.cosLat * frame.cosLon * u[i];
+        ecef.y[i] = frame.originEcef[1] + frame.cosLon * e[i] - frame.sinLat * frame.sinLon * n[i] +
+                    frame.cosLat * frame.sinLon * u[i];
+        ecef.z[i] = frame.originEcef[2] + frame.cosLat * n[i] + frame.sinLat * u[i];
+    }
+    ecefToGeodetic(ecef, geodetic);
+}
+
+Vec3 geodeticToEnu(const GeoOrigin& origin, double latitude, double longitude, double altitude) {
+    CoordinateArrays point;
+    point.push_back(latitude, longitude, altitude);
+    geodeticToEnu(origin, point, point);
+    return point[0];
+}
+
+int utmZone(double latitude, double longitude) {
+    int zone = static_cast<int>(std::floor((longitude + 180.0) / 6.0)) % 60 + 1;
+    if (zone <= 0) zone += 60;
+    if (latitude >= 56.0 && latitude < 64.0 && longitude >= 3.0 && longitude < 12.0) {
+        zone = 32;
+    } else if (latitude >= 72.0 && latitude < 84.0 && longitude >= 0.0 && longitude < 42.0) {
+        zone = longitude < 9.0 ? 31 : longitude < 21.0 ? 33 : longitude < 33.0 ? 35 : 37;
+    }
+    return zone;
+}
+
+void geodeticToUtm(int zone, bool north, const CoordinateArrays& geodetic, CoordinateArrays& utm) {
+    const TransverseMercator& projection = wgs84TransverseMercator();
+    const double lambda0 = centralMeridian(zone);
+    const double falseNorthing = north ? 0.0 : kUtmFalseNorthing;
+    const size_t count = geodetic.size();
+    utm.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const double height = geodetic.z[i];
+        double x, y;
+        projection.forward(geodetic.x[i] * kDegree, std::remainder(geodetic.y[i] * kDegree - lambda0, 2.0 * kPi), x,
+                           y);
+        utm.x[i] = kUtmFalseEasting + kUtmScale * x;
+        utm.y[i] = falseNorthing + kUtmScale * y;
+        utm.z[i] = height;
+    }
+}
+
+void utmToGeodetic(int zone, bool north, const CoordinateArrays& utm, CoordinateArrays& geodetic) {
+    const TransverseMercator& projection = wgs84TransverseMercator();
+    const double lambda0 = centralMeridian(zone);
+    const double falseNorthing = north ? 0.0 : kUtmFalseNorthing;
+    const size_t count = utm.size();
+    geodetic.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const double height = utm.z[i];
+        double phi, lambda;
+        projection.reverse((utm.x[i] - kUtmFalseEasting) / kUtmScale, (utm.y[i] - falseNorthing) / kUtmScale, phi,
+                           lambda);
+        geodetic.x[i] = phi / kDegree;
+        geodetic.y[i] = std::remainder(lambda + lambda0, 2.0 * kPi) / kDegree;
+        geodetic.z[i] = height;
+    }
+}
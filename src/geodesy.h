@@ -0,0 +1,74 @@
+#ifndef GEODESY_H
+#define GEODESY_H
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// WGS84 ellipsoid
+namespace wgs84 {
+constexpr double kSemiMajorAxis = 6378137.0;
+constexpr double kFlattening = 1.0 / 298.257223563;
+constexpr double kSemiMinorAxis = kSemiMajorAxis * (1.0 - kFlattening);
+constexpr double kEccentricity2 = kFlattening * (2.0 - kFlattening);
+} // namespace wgs84
+
+using Vec3 = std::array<double, 3>;
+
+// Coordinates of many points as three parallel arrays (structure of arrays),
+// so the batch conversions below run over contiguous doubles without
+// branches. What x, y and z hold depends on the function: latitude,
+// longitude (degrees) and ellipsoidal height (m); ECEF metres; east, north,
+// up metres; or UTM easting, northing and height.
+struct CoordinateArrays {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+
+    size_t size() const { return x.size(); }
+    void resize(size_t n) {
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+    }
+    void reserve(size_t n) {
+        x.reserve(n);
+        y.reserve(n);
+        z.reserve(n);
+    }
+    void push_back(double a, double b, double c) {
+        x.push_back(a);
+        y.push_back(b);
+        z.push_back(c);
+    }
+    Vec3 operator[](size_t i) const { return {x[i], y[i], z[i]}; }
+};
+
+// Local east-north-up frame (metres) tangent to the WGS84 ellipsoid at origin
+struct GeoOrigin {
+    double latitude = 0.0;
+    double longitude = 0.0;
+    double altitude = 0.0;
+};
+
+// Batch conversions. `out` is resized to the size of `in` and may be the same
+// object. Geodetic <-> ECEF is exact in closed form (Heikkinen's inverse, no
+// iteration); ENU goes through ECEF, so it holds over any distance.
+void geodeticToEcef(const CoordinateArrays& geodetic, CoordinateArrays& ecef);
+void ecefToGeodetic(const CoordinateArrays& ecef, CoordinateArrays& geodetic);
+void geodeticToEnu(const GeoOrigin& origin, const CoordinateArrays& geodetic, CoordinateArrays& enu);
+void enuToGeodetic(const GeoOrigin& origin, const CoordinateArrays& enu, CoordinateArrays& geodetic);
+
+Vec3 geodeticToEnu(const GeoOrigin& origin, double latitude, double longitude, double altitude);
+
+// UTM zone (1-60) containing a longitude, with the Norway/Svalbard exceptions
+int utmZone(double latitude, double longitude);
+
+// Transverse Mercator by Krüger's series to sixth order in n (Karney 2011):
+// nanometre-level within the zone and still well under a millimetre 1000 km
+// outside it, so one zone can be used for a whole flight that crosses a zone
+// boundary. Southern hemisphere northings carry the 10 000 km false northing.
+void geodeticToUtm(int zone, bool north, const CoordinateArrays& geodetic, CoordinateArrays& utm);
+void utmToGeodetic(int zone, bool north, const CoordinateArrays& utm, CoordinateArrays& geodetic);
+
+#endif // GEODESY_H
@@ -0,0 +1,321 @@
+#include "gps_embed.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// SRT scanning helpers. Each one mirrors a pattern of the original regex parser
+// on a string_view, without copying or allocating.
+// ---------------------------------------------------------------------------
+
+// ECMAScript \s
+bool srtIsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+bool srtIsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+size_t srtSkipSpace(std::string_view text, size_t pos) {
+    while (pos < text.size() && srtIsSpace(text[pos])) pos++;
+    return pos;
+}
+
+// ASCII lowercase without the locale lookup of std::tolower
+char srtLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Case-insensitive search for a lowercase literal, starting at pos
+size_t srtFindNoCase(std::string_view text, std::string_view literal, size_t pos) {
+    for (; pos + literal.size() <= text.size(); pos++) {
+        if (srtLower(text[pos]) != literal[0]) continue;
+        size_t i = 1;
+        while (i < literal.size() && srtLower(text[pos + i]) == literal[i]) {
+            i++;
+        }
+        if (i == literal.size()) return pos;
+    }
+    return std::string_view::npos;
+}
+
+// Match [\-\d\.]+ at pos and convert it like std::stod (longest valid prefix).
+// Returns the position after the token, or npos if there is no convertible token.
+size_t srtScanNumber(std::string_view text, size_t pos, double& value) {
+    size_t end = pos;
+    while (end < text.size() && (srtIsDigit(text[end]) || text[end] == '-' || text[end] == '.')) end++;
+    if (end == pos) return std::string_view::npos;
+    auto result = std::from_chars(text.data() + pos, text.data() + end, value);
+    if (result.ec != std::errc()) return std::string_view::npos;
+    return end;
+}
+
+// (\d{2}):(\d{2}):(\d{2}),(\d{3}) - first match in the line
+bool srtParseTimestamp(std::string_view line, double& timestamp) {
+    auto num = [&line](size_t pos, size_t digits) {
+        int v = 0;
+        for (size_t i = 0; i < digits; i++) v = v * 10 + (line[pos + i] - '0');
+        return v;
+    };
+    for (size_t p = 0; p + 12 <= line.size(); p++) {
+        const char* c = line.data() + p;
+        if (srtIsDigit(c[0]) && srtIsDigit(c[1]) && c[2] == ':' &&
+            srtIsDigit(c[3]) && srtIsDigit(c[4]) && c[5] == ':' &&
+            srtIsDigit(c[6]) && srtIsDigit(c[7]) && c[8] == ',' &&
+            srtIsDigit(c[9]) && srtIsDigit(c[10]) && srtIsDigit(c[11])) {
+            timestamp = num(p, 2) * 3600 + num(p + 3, 2) * 60 + num(p + 6, 2) + num(p + 9, 3) / 1000.0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// GPS:\s*\(lon\s*,\s*lat\)
+bool srtFindGpsPair(std::string_view meta, double& longitude, double& latitude) {
+    for (size_t p = meta.find("GPS:"); p != std::string_view::npos; p = meta.find("GPS:", p + 1)) {
+        size_t q = srtSkipSpace(meta, p + 4);
+        if (q >= meta.size() || meta[q] != '(') continue;
+        double lon, lat;
+        q = srtScanNumber(meta, srtSkipSpace(meta, q + 1), lon);
+        if (q == std::string_view::npos) continue;
+        q = srtSkipSpace(meta, q);
+        if (q >= meta.size() || meta[q] != ',') continue;
+        q = srtScanNumber(meta, srtSkipSpace(meta, q + 1), lat);
+        if (q == std::string_view::npos || q >= meta.size() || meta[q] != ')') continue;
+        longitude = lon;
+        latitude = lat;
+        return true;
+    }
+    return false;
+}
+
+// <prefix>\s*number<terminator>, prefix matched case-insensitively when requested
+bool srtFindTaggedNumber(std::string_view meta, std::string_view prefix, char terminator,
+                         bool ignoreCase, double& value) {
+    auto find = [&](size_t from) {
+        return ignoreCase ? srtFindNoCase(meta, prefix, from) : meta.find(prefix, from);
+    };
+    for (size_t p = find(0); p != std::string_view::npos; p = find(p + 1)) {
+        double v;
+        size_t q = srtScanNumber(meta, srtSkipSpace(meta, p + prefix.size()), v);
+        if (q == std::string_view::npos || q >= meta.size() || meta[q] != terminator) continue;
+        value = v;
+        return true;
+    }
+    return false;
+}
+
+// Accumulates one subtitle block (index line, time line, metadata lines)
+struct SrtBlockScanner {
+    std::vector<GPSData>& frames;
+    size_t lineCount = 0;
+    bool hasTimestamp = false;
+    double timestamp = 0.0;
+    std::string metadata;  // reused across blocks, so no per-block allocation
+
+    explicit SrtBlockScanner(std::vector<GPSData>& out) : frames(out) {
+        metadata.reserve(512);
+    }
+
+    void addLine(std::string_view line) {
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            endBlock();
+            return;
+        }
+        if (lineCount == 1) {
+            hasTimestamp = srtParseTimestamp(line, timestamp);
+        } else if (lineCount >= 2) {
+            metadata.append(line.data(), line.size());
+            metadata.push_back(' ');
+        }
+        lineCount++;
+    }
+
+    void endBlock() {
+        if (lineCount >= 3 && hasTimestamp) {
+            GPSData data;
+            data.timestamp = timestamp;
+
+            // Try to parse GPS coordinates, then the alternative format
+            if (srtFindGpsPair(metadata, data.longitude, data.latitude)) {
+                data.valid = true;
+            } else {
+                bool hasLat = srtFindTaggedNumber(metadata, "[latitude:", ']', true, data.latitude);
+                bool hasLon = srtFindTaggedNumber(metadata, "[longtitude:", ']', true, data.longitude);
+                data.valid = hasLat && hasLon;
+            }
+
+            // Parse altitude
+            if (!srtFindTaggedNumber(metadata, "H:", 'm', false, data.altitude)) {
+                srtFindTaggedNumber(metadata, "[altitude:", ']', true, data.altitude);
+            }
+
+            if (data.valid) {
+                frames.push_back(data);
+            }
+        }
+        lineCount = 0;
+        hasTimestamp = false;
+        metadata.clear();
+    }
+};
+
+} // namespace
+
+// Parse DJI SRT file and extract GPS data.
+// Single pass over fixed-size chunks: blocks are separated by blank lines and
+// recognise "GPS:(lon,lat)", "[latitude:]/[longtitude:]" and "H:"/"[altitude:]".
+std::vector<GPSData> parseSRT(const std::string& srtPath) {
+    std::vector<GPSData> frames;
+    
+    std::ifstream file(srtPath, std::ios::binary);
+    if (!file.is_open()) {
+        return frames;
+    }
+    
+    SrtBlockScanner scanner(frames);
+    std::vector<char> buffer(1 << 20);
+    size_t carry = 0;
+    
+    for (;;) {
+        file.read(buffer.data() + carry, static_cast<std::streamsize>(buffer.size() - carry));
+        const size_t filled = carry + static_cast<size_t>(file.gcount());
+        const bool atEnd = !file;
+        
+        // Hand every complete line to the scanner
+        size_t lineStart = 0;
+        while (const void* nl = std::memchr(buffer.data() + lineStart, '\n', filled - lineStart)) {
+            size_t lineEnd = static_cast<const char*>(nl) - buffer.data();
+            scanner.addLine(std::string_view(buffer.data() + lineStart, lineEnd - lineStart));
+            lineStart = lineEnd + 1;
+        }
+        
+        carry = filled - lineStart;
+        if (atEnd) {
+            if (carry > 0) {
+                scanner.addLine(std::string_view(buffer.data() + lineStart, carry));
+            }
+            break;
+        }
+        
+        // Keep the partial last line; grow only for lines longer than the buffer
+        std::memmove(buffer.data(), buffer.data() + lineStart, carry);
+        if (carry == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+    scanner.endBlock();
+    
+    return frames;
+}
+
+// Find closest GPS data for a given timestamp
+GPSData getGPSForTimestamp(const std::vector<GPSData>& frames, double timestamp) {
+    if (frames.empty()) {
+        return GPSData();
+    }
+    
+    double minDiff = std::abs(frames[0].timestamp - timestamp);
+    size_t closestIdx = 0;
+    
+    for (size_t i = 1; i < frames.size(); i++) {
+        double diff = std::abs(frames[i].timestamp - timestamp);
+        if (diff < minDiff) {
+            minDiff = diff;
+            closestIdx = i;
+        }
+    }
+    
+    return frames[closestIdx];
+}
+
+// Rounded once to 1e-4 arc-seconds as a whole, so the carry into minutes and degrees is exact
+DmsValue splitDms(double decimal) {
+    const uint64_t total = static_cast<uint64_t>(std::llround(std::abs(decimal) * 3600.0 * 10000.0));
+    DmsValue dms;
+    dms.degrees = static_cast<uint32_t>(total / 36000000);
+    dms.minutes = static_cast<uint32_t>(total / 600000 % 60);
+    dms.secondsE4 = static_cast<uint32_t>(total % 600000);
+    return dms;
+}
+
+size_t formatDms(double decimal, char* buffer, size_t size) {
+    const DmsValue dms = splitDms(decimal);
+    char* out = buffer;
+    char* const end = buffer + size;
+    bool fits = true;
+    auto put = [&](uint32_t value) {
+        auto result = std::to_chars(out, end, value);
+        fits = fits && result.ec == std::errc();
+        out = fits ? result.ptr : end;
+    };
+    auto putChar = [&](char c) {
+        fits = fits && out < end;
+        if (fits) *out++ = c;
+    };
+    put(dms.degrees);
+    putChar(' ');
+    put(dms.minutes);
+    putChar(' ');
+    put(dms.secondsE4 / 10000);
+    putChar('.');
+    const uint32_t fraction = dms.secondsE4 % 10000;
+    putChar(static_cast<char>('0' + fraction / 1000));
+    putChar(static_cast<char>('0' + fraction / 100 % 10));
+    putChar(static_cast<char>('0' + fraction / 10 % 10));
+    putChar(static_cast<char>('0' + fraction % 10));
+    return fits ? static_cast<size_t>(out - buffer) : 0;
+}
+
+// Convert decimal degrees to DMS string for exiftool
+std::string decimalToDMS(double decimal) {
+    char buffer[kDmsBufferSize];
+    return std::string(buffer, formatDms(decimal, buffer, sizeof(buffer)));
+}
+
+// Generate exiftool command to embed GPS data into both EXIF and XMP for maximum compatibility
+std::string generateExiftoolCommand(const std::string& exiftoolPath, const std::string& imagePath, 
+                                   double latitude, double longitude, double altitude) {
+    std::ostringstream cmd;
+    cmd << "\"\"" << exiftoolPath << "\" ";
+    
+    const char latRef = latitude >= 0 ? 'N' : 'S';
+    const char lonRef = longitude >= 0 ? 'E' : 'W';
+    
+    // EXIF GPS (DMS format for lat/lon)
+    cmd << "-EXIF:GPSLatitude=\"" << decimalToDMS(latitude) << "\" ";
+    cmd << "-EXIF:GPSLatitudeRef=" << latRef << " ";
+    cmd << "-EXIF:GPSLongitude=\"" << decimalToDMS(longitude) << "\" ";
+    cmd << "-EXIF:GPSLongitudeRef=" << lonRef << " ";
+    
+    // GPS Version ID must be "2.3.0.0" or "2 3 0 0" array format
+    cmd << "-EXIF:GPSVersionID=\"2.3.0.0\" ";
+    cmd << "-EXIF:GPSMapDatum=\"WGS-84\" ";
+    
+    if (altitude != 0.0) {
+        cmd << "-EXIF:GPSAltitude=" << std::abs(altitude) << " ";
+        cmd << "-EXIF:GPSAltitudeRef=" << (altitude >= 0 ? "0" : "1") << " ";
+    }
+    
+    // XMP GPS (decimal degrees) for applications that prefer XMP
+    cmd << "-XMP:GPSLatitude=" << std::fixed << std::setprecision(8) << latitude << " ";
+    cmd << "-XMP:GPSLongitude=" << std::fixed << std::setprecision(8) << longitude << " ";
+    if (altitude != 0.0) {
+        cmd << "-XMP:GPSAltitude=" << std::abs(altitude) << " ";
+    }
+    
+    cmd << "-overwrite_original ";
+    cmd << "\"" << imagePath << "\"\"";
+    
+    return cmd.str();
+}
@@ -0,0 +1,184 @@
+#pragma once
+#include "gps_embed.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// How positions between two SRT samples are computed
+enum class GpsInterpolation {
+    Nearest,  // closest sample, same result as getGPSForTimestamp()
+    Linear,   // straight line between the two neighbouring samples
+    Hermite   // cubic Hermite with finite-difference tangents (smooth through turns)
+};
+
+// GPS track built once from parseSRT() output.
+// Samples are sorted by time and de-duplicated; lookups are O(log n), or O(1)
+// when the samples are evenly spaced (the usual one-entry-per-video-frame SRT).
+class GpsTrack {
+public:
+    GpsTrack() = default;
+
+    explicit GpsTrack(std::vector<GPSData> samples) : m_samples(std::move(samples)) {
+        auto byTime = [](const GPSData& a, const GPSData& b) { return a.timestamp < b.timestamp; };
+        m_wasMonotonic = std::is_sorted(m_samples.begin(), m_samples.end(), byTime);
+        if (!m_wasMonotonic) {
+            std::stable_sort(m_samples.begin(), m_samples.end(), byTime);
+        }
+
+        // Keep the first sample of any repeated timestamp
+        auto sameTime = [](const GPSData& a, const GPSData& b) { return a.timestamp == b.timestamp; };
+        m_samples.erase(std::unique(m_samples.begin(), m_samples.end(), sameTime), m_samples.end());
+
+        // Evenly spaced samples allow a direct index guess instead of a binary search.
+        // The guess only has to be within one sample; lookup() corrects it.
+        if (m_samples.size() >= 3) {
+            const double first = m_samples.front().timestamp;
+            m_step = (m_samples.back().timestamp - first) / (m_samples.size() - 1);
+            m_uniform = m_step > 0.0;
+            for (size_t i = 0; m_uniform && i < m_samples.size(); i++) {
+                m_uniform = std::abs(m_samples[i].timestamp - (first + i * m_step)) <= m_step * 0.5;
+            }
+        }
+    }
+
+    bool empty() const { return m_samples.empty(); }
+    size_t size() const { return m_samples.size(); }
+    const std::vector<GPSData>& samples() const { return m_samples; }
+
+    // False if parseSRT() returned samples out of time order (they were sorted)
+    bool wasMonotonic() const { return m_wasMonotonic; }
+
+    // True if the uniform-step fast path is used
+    bool isUniform() const { return m_uniform; }
+
+    // Position at a timestamp. Outside the track the first/last sample is returned.
+    GPSData at(double timestamp, GpsInterpolation mode = GpsInterpolation::Linear) const {
+        if (m_samples.empty()) {
+            return GPSData();
+        }
+        return interpolate(lookup(timestamp), timestamp, mode);
+    }
+
+    // Positions for a whole list of frame timestamps. Ascending input (the normal
+    // case: frame i at i / fps) is answered with a single forward walk.
+    std::vector<GPSData> at(const std::vector<double>& timestamps,
+                            GpsInterpolation mode = GpsInterpolation::Linear) const {
+        std::vector<GPSData> result;
+        result.reserve(timestamps.size());
+        if (m_samples.empty()) {
+            result.resize(timestamps.size());
+            return result;
+        }
+
+        size_t segment = 0;
+        double previous = -INFINITY;
+        for (double t : timestamps) {
+            if (t < previous) {
+                segment = lookup(t);
+            } else {
+                while (segment + 2 < m_samples.size() && t >= m_samples[segment + 1].timestamp) {
+                    segment++;
+                }
+            }
+            previous = t;
+            result.push_back(interpolate(segment, t, mode));
+        }
+        return result;
+    }
+
+private:
+    // Index i of the segment [i, i+1] containing t (clamped to the track)
+    size_t lookup(double t) const {
+        const size_t n = m_samples.size();
+        if (n < 2 || t <= m_samples.front().timestamp) {
+            return 0;
+        }
+        if (t >= m_samples.back().timestamp) {
+            return n - 2;
+        }
+
+        size_t i;
+        if (m_uniform) {
+            i = static_cast<size_t>((t - m_samples.front().timestamp) / m_step);
+            i = std::min(i, n - 2);
+            while (i > 0 && t < m_samples[i].timestamp) i--;
+            while (i + 2 < n && t >= m_samples[i + 1].timestamp) i++;
+        } else {
+            auto it = std::upper_bound(m_samples.begin(), m_samples.end(), t,
+                                       [](double value, const GPSData& s) { return value < s.timestamp; });
+            i = static_cast<size_t>(it - m_samples.begin()) - 1;
+        }
+        return i;
+    }
+
+    GPSData interpolate(size_t i, double t, GpsInterpolation mode) const {
+        const size_t n = m_samples.size();
+        if (n == 1 || t <= m_samples[i].timestamp) {
+            return sampleAt(i, t);
+        }
+        if (t >= m_samples[i + 1].timestamp) {
+            return sampleAt(i + 1, t);
+        }
+
+        const GPSData& a = m_samples[i];
+        const GPSData& b = m_samples[i + 1];
+        const double h = b.timestamp - a.timestamp;
+        const double u = (t - a.timestamp) / h;
+
+        GPSData result;
+        result.timestamp = t;
+        result.valid = true;
+
+        switch (mode) {
+            case GpsInterpolation::Nearest: {
+                // Ties go to the earlier sample, like getGPSForTimestamp()
+                const GPSData& closest = (t - a.timestamp) <= (b.timestamp - t) ? a : b;
+                result.latitude = closest.latitude;
+                result.longitude = closest.longitude;
+                result.altitude = closest.altitude;
+                break;
+            }
+            case GpsInterpolation::Linear:
+                result.latitude = a.latitude + (b.latitude - a.latitude) * u;
+                result.longitude = a.longitude + (b.longitude - a.longitude) * u;
+                result.altitude = a.altitude + (b.altitude - a.altitude) * u;
+                break;
+            case GpsInterpolation::Hermite: {
+                const double u2 = u * u;
+                const double u3 = u2 * u;
+                const double h00 = 2 * u3 - 3 * u2 + 1;
+                const double h10 = u3 - 2 * u2 + u;
+                const double h01 = -2 * u3 + 3 * u2;
+                const double h11 = u3 - u2;
+                auto hermite = [&](double GPSData::*field) {
+                    return h00 * (a.*field) + h10 * h * tangent(i, field) +
+                           h01 * (b.*field) + h11 * h * tangent(i + 1, field);
+                };
+                result.latitude = hermite(&GPSData::latitude);
+                result.longitude = hermite(&GPSData::longitude);
+                result.altitude = hermite(&GPSData::altitude);
+                break;
+            }
+        }
+        return result;
+    }
+
+    // Finite-difference slope at sample i (one-sided at the ends)
+    double tangent(size_t i, double GPSData::*field) const {
+        const size_t lo = i > 0 ? i - 1 : i;
+        const size_t hi = i + 1 < m_samples.size() ? i + 1 : i;
+        return (m_samples[hi].*field - m_samples[lo].*field) /
+               (m_samples[hi].timestamp - m_samples[lo].timestamp);
+    }
+
+    GPSData sampleAt(size_t i, double t) const {
+        GPSData result = m_samples[i];
+        result.timestamp = t;
+        return result;
+    }
+
+    std::vector<GPSData> m_samples;
+    double m_step = 0.0;
+    bool m_uniform = false;
+    bool m_wasMonotonic = true;
+};
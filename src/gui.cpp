@@ -1,12 +1,19 @@
 #include "gui.h"
 #include "pipeline.h"
+#include "log_queue.h"
+#include "progress.h"
 #include <windows.h>
+#include <commctrl.h>
 #include <commdlg.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <shlobj.h>
 #include <fstream>
 #include <map>
+#include <vector>
 
 // Control IDs
 #define ID_VIDEO_PATH 1001
@@ -24,6 +31,17 @@
 #define ID_START_BUTTON 1013
 #define ID_LOG_TEXT 1014
 #define ID_VIDEO_BROWSE_FOLDER 1015
+#define ID_LOG_TIMER 1016
+#define ID_PROGRESS_BAR 1017
+#define ID_PROGRESS_TEXT 1018
+
+// Log window refresh interval and size
+#define LOG_FLUSH_INTERVAL_MS 50
+#define LOG_MAX_CHARS (512 * 1024)
+
+// Progress bar resolution and how long without progress before the status says so
+#define PROGRESS_RANGE 1000
+#define PROGRESS_STALL_SECONDS 60
 
 // Global window handles
 HWND g_hwndVideoPath = NULL;
@@ -38,9 +56,26 @@ HWND g_hwndRadioMetashape = NULL;
 HWND g_hwndRadioRealityScan = NULL;
 HWND g_hwndMetashapeBrowse = NULL;
 HWND g_hwndRealityScanBrowse = NULL;
+HWND g_hwndProgressBar = NULL;
+HWND g_hwndProgressText = NULL;
 
 bool g_processing = false;
 
+// Set by the Cancel button (or closing the window) while the pipeline runs;
+// the window closes once the run has stopped if g_closeAfterRun is set
+std::atomic<bool> g_cancel{false};
+bool g_closeAfterRun = false;
+
+// Log lines from any thread; the UI thread moves them into the edit control on a timer
+LogQueue g_logQueue;
+Scrollback g_logScrollback(LOG_MAX_CHARS);
+
+// Latest progress from the pipeline thread; the UI thread shows it on the log timer
+std::mutex g_progressMutex;
+ProgressEvent g_progress;
+std::chrono::steady_clock::time_point g_progressTime;
+bool g_progressChanged = false;
+
 // Forward declaration
 void UpdateMethodControls();
 
@@ -165,13 +200,87 @@ void LoadSettings() {
     UpdateMethodControls();
 }
 
+// Called from the pipeline threads: only queues the line, never touches the window
 void AppendLog(const std::string& message) {
+    g_logQueue.push(message);
+}
+
+// UI thread: move everything queued since the last call into the log window in one edit
+void FlushLog() {
     if (g_hwndLogText == NULL) return;
     
+    std::vector<std::string> lines;
+    size_t dropped = g_logQueue.drain(lines);
+    if (lines.empty() && dropped == 0) return;
+    
+    Scrollback::Update update = g_logScrollback.append(lines, dropped);
+    
+    SendMessageA(g_hwndLogText, WM_SETREDRAW, FALSE, 0);
+    if (update.replaceAll) {
+        SetWindowTextA(g_hwndLogText, g_logScrollback.text().c_str());
+    } else {
+        int len = GetWindowTextLengthA(g_hwndLogText);
+        SendMessageA(g_hwndLogText, EM_SETSEL, len, len);
+        SendMessageA(g_hwndLogText, EM_REPLACESEL, FALSE, (LPARAM)update.append.c_str());
+    }
     int len = GetWindowTextLengthA(g_hwndLogText);
     SendMessageA(g_hwndLogText, EM_SETSEL, len, len);
-    SendMessageA(g_hwndLogText, EM_REPLACESEL, FALSE, (LPARAM)(message + "\r\n").c_str());
     SendMessageA(g_hwndLogText, EM_SCROLLCARET, 0, 0);
+    SendMessageA(g_hwndLogText, WM_SETREDRAW, TRUE, 0);
+    InvalidateRect(g_hwndLogText, NULL, TRUE);
+}
+
+// Called from the pipeline threads: only stores the event, never touches the window
+void OnProgress(const ProgressEvent& event) {
+    std::lock_guard<std::mutex> lock(g_progressMutex);
+    g_progress = event;
+    g_progressTime = std::chrono::steady_clock::now();
+    g_progressChanged = true;
+}
+
+// UI thread: show the latest progress, or that none has arrived for a while
+void FlushProgress() {
+    if (g_hwndProgressBar == NULL || !g_processing) return;
+
+    ProgressEvent event;
+    double silentSeconds = 0.0;
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(g_progressMutex);
+        event = g_progress;
+        silentSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - g_progressTime).count();
+        changed = g_progressChanged;
+        g_progressChanged = false;
+    }
+    bool stalled = silentSeconds > PROGRESS_STALL_SECONDS;
+    if (!changed && !stalled) return;
+
+    SendMessageA(g_hwndProgressBar, PBM_SETPOS, (WPARAM)(event.overallFraction * PROGRESS_RANGE), 0);
+    std::string text = event.stage.empty() ? "Starting..." : describeProgress(event);
+    if (stalled) {
+        text += " | no progress for " + formatDuration(silentSeconds);
+    }
+    SetWindowTextA(g_hwndProgressText, text.c_str());
+}
+
+// UI thread: new run, empty bar
+void ResetProgress() {
+    {
+        std::lock_guard<std::mutex> lock(g_progressMutex);
+        g_progress = ProgressEvent();
+        g_progressTime = std::chrono::steady_clock::now();
+        g_progressChanged = false;
+    }
+    SendMessageA(g_hwndProgressBar, PBM_SETPOS, 0, 0);
+    SetWindowTextA(g_hwndProgressText, "Starting...");
+}
+
+// UI thread: empty the log window and anything still queued for it
+void ClearLog() {
+    std::vector<std::string> discarded;
+    g_logQueue.drain(discarded);
+    g_logScrollback.clear();
+    SetWindowTextA(g_hwndLogText, "");
 }
 
 std::string BrowseForFile(HWND hwnd, const char* filter, const char* title) {
@@ -240,6 +349,8 @@ void RunPipelineAsync(HWND hwnd) {
     config.frameRate = atof(fpsText);
     config.metashapeExePath = metashapePath;
     config.realityscanExePath = realityscanPath;
+    // COLMAP matching can print thousands of lines/s, far more than anyone can read in the log window
+    config.maxLogLinesPerSecond = 200;
     
     // Determine method
     if (SendMessage(g_hwndRadioColmap, BM_GETCHECK, 0, 0) == BST_CHECKED) {
@@ -250,19 +361,20 @@ void RunPipelineAsync(HWND hwnd) {
         config.method = ReconMethod::REALITYSCAN;
     }
     
-    // Disable controls
-    EnableWindow(g_hwndStartButton, FALSE);
-    SetWindowTextA(g_hwndStartButton, "Processing...");
+    // The start button cancels the run while it is going
+    g_cancel = false;
+    SetWindowTextA(g_hwndStartButton, "Cancel");
     
     // Clear log
-    SetWindowTextA(g_hwndLogText, "");
+    ClearLog();
+    ResetProgress();
     
     // Run pipeline in background thread
     std::thread([hwnd, config]() {
-        bool success = runPipeline(config, AppendLog);
+        bool success = runPipeline(config, AppendLog, OnProgress, &g_cancel);
         
-        // Re-enable controls on UI thread
-        PostMessage(hwnd, WM_USER + 1, success ? 1 : 0, 0);
+        // Re-enable controls on UI thread (2 = cancelled)
+        PostMessage(hwnd, WM_USER + 1, success ? 1 : (g_cancel ? 2 : 0), 0);
     }).detach();
 }
 
@@ -352,13 +464,24 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 WS_CHILD | WS_VISIBLE,
                 300, 285, 180, 35, hwnd, (HMENU)ID_START_BUTTON, NULL, NULL);
             
+            // Overall progress and the current stage's status line
+            g_hwndProgressBar = CreateWindowExA(0, PROGRESS_CLASSA, "",
+                WS_CHILD | WS_VISIBLE,
+                10, 330, 760, 18, hwnd, (HMENU)ID_PROGRESS_BAR, NULL, NULL);
+            SendMessageA(g_hwndProgressBar, PBM_SETRANGE, 0, MAKELPARAM(0, PROGRESS_RANGE));
+            g_hwndProgressText = CreateWindowA("STATIC", "",
+                WS_CHILD | WS_VISIBLE | SS_LEFTNOWORDWRAP,
+                10, 352, 760, 20, hwnd, (HMENU)ID_PROGRESS_TEXT, NULL, NULL);
+            
             // Log section
             CreateWindowA("STATIC", "Progress Log:",
                 WS_CHILD | WS_VISIBLE,
-                10, 330, 100, 20, hwnd, NULL, NULL, NULL);
+                10, 376, 100, 20, hwnd, NULL, NULL, NULL);
             g_hwndLogText = CreateWindowExA(WS_EX_CLIENTEDGE, "EDIT", "",
                 WS_CHILD | WS_VISIBLE | WS_VSCROLL | ES_MULTILINE | ES_AUTOVSCROLL | ES_READONLY,
-                10, 355, 760, 235, hwnd, (HMENU)ID_LOG_TEXT, NULL, NULL);
+                10, 398, 760, 192, hwnd, (HMENU)ID_LOG_TEXT, NULL, NULL);
+            // Default limit is 32K characters; the scrollback cap keeps it below this
+            SendMessageA(g_hwndLogText, EM_SETLIMITTEXT, LOG_MAX_CHARS * 2, 0);
             
             // Set font for all controls
             HFONT hFont = CreateFontA(16, 0, 0, 0, FW_NORMAL, FALSE, FALSE, FALSE,
@@ -375,6 +498,9 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             
             AppendLog("Ready. Configure settings and click 'Start Processing'.");
             AppendLog("FFmpeg and COLMAP are bundled in the vendor/ directory.");
+            FlushLog();
+            
+            SetTimer(hwnd, ID_LOG_TIMER, LOG_FLUSH_INTERVAL_MS, NULL);
             
             return 0;
         }
@@ -443,26 +569,58 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                     if (!g_processing) {
                         g_processing = true;
                         RunPipelineAsync(hwnd);
+                    } else if (!g_cancel) {
+                        g_cancel = true;
+                        EnableWindow(g_hwndStartButton, FALSE);
+                        SetWindowTextA(g_hwndStartButton, "Cancelling...");
+                        AppendLog("Cancelling - stopping the running tools...");
                     }
                     return 0;
             }
             break;
         }
         
+        case WM_TIMER:
+            if (wParam == ID_LOG_TIMER) {
+                FlushLog();
+                FlushProgress();
+                return 0;
+            }
+            break;
+        
         case WM_USER + 1: {
             // Pipeline completed
+            FlushProgress();
             g_processing = false;
             EnableWindow(g_hwndStartButton, TRUE);
             SetWindowTextA(g_hwndStartButton, "Start Processing");
-            
             if (wParam == 1) {
+                SendMessageA(g_hwndProgressBar, PBM_SETPOS, PROGRESS_RANGE, 0);
+                SetWindowTextA(g_hwndProgressText, "Done");
+            } else {
+                SetWindowTextA(g_hwndProgressText, wParam == 2 ? "Cancelled" : "Failed");
+            }
+            
+            if (g_closeAfterRun) {
+                SaveSettings();
+                DestroyWindow(hwnd);
+                return 0;
+            }
+            if (wParam == 2) {
+                // Asked for, so no error box
+                AppendLog("==============================================");
+                AppendLog("Pipeline cancelled. Completed stages are kept - starting again resumes after them.");
+                FlushLog();
+            } else if (wParam == 1) {
                 AppendLog("==============================================");
                 AppendLog("SUCCESS! Pipeline completed.");
+                FlushLog();
                 MessageBoxA(hwnd, "Pipeline completed successfully!\nOutput is ready for Gaussian Splatting.",
                     "Success", MB_OK | MB_ICONINFORMATION);
             } else {
                 AppendLog("==============================================");
                 AppendLog("ERROR: Pipeline failed. Check the log above.");
+                FlushLog();
                 MessageBoxA(hwnd, "Pipeline failed. Please check the log for details.",
                     "Error", MB_OK | MB_ICONERROR);
             }
@@ -472,17 +630,23 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         case WM_CLOSE:
             if (g_processing) {
                 int result = MessageBoxA(hwnd,
-                    "Processing is in progress. Are you sure you want to exit?",
+                    "Processing is in progress. Cancel it and exit?",
                     "Confirm Exit", MB_YESNO | MB_ICONWARNING);
-                if (result == IDNO) {
-                    return 0;
+                if (result == IDYES) {
+                    // Close once the tools are stopped and their partial output removed
+                    g_cancel = true;
+                    g_closeAfterRun = true;
+                    EnableWindow(g_hwndStartButton, FALSE);
+                    SetWindowTextA(g_hwndStartButton, "Cancelling...");
                 }
+                return 0;
             }
             SaveSettings();
             DestroyWindow(hwnd);
             return 0;
         
         case WM_DESTROY:
+            KillTimer(hwnd, ID_LOG_TIMER);
             PostQuitMessage(0);
             return 0;
     }
@@ -493,6 +657,9 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 int runGUI(HINSTANCE hInstance) {
     const char* CLASS_NAME = "DroneReconWindowClass";
     
+    INITCOMMONCONTROLSEX controls = {sizeof(controls), ICC_PROGRESS_CLASS};
+    InitCommonControlsEx(&controls);
+    
     WNDCLASSA wc = {};
     wc.lpfnWndProc = WindowProc;
     wc.hInstance = hInstance;
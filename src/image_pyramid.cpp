@@ -0,0 +1,76 @@
+#include "image_pyramid.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+std::vector<int> pyramidFactors(int levels) {
+    levels = std::clamp(levels, 0, kMaxPyramidLevels);
+    std::vector<int> factors;
+    for (int level = 0; level <= levels; level++) {
+        factors.push_back(1 << level);
+    }
+    return factors;
+}
+
+fs::path pyramidLevelDir(const fs::path& fullSizeDir, int factor) {
+    if (factor <= 1) {
+        return fullSizeDir;
+    }
+    // "frames/combined/" has an empty filename; use the folder's own name
+    fs::path dir = fullSizeDir.has_filename() ? fullSizeDir : fullSizeDir.parent_path();
+    return dir.parent_path() / (dir.filename().string() + "_" + std::to_string(factor));
+}
+
+int pyramidQuality(const std::vector<int>& quality, size_t level) {
+    if (quality.empty()) {
+        return 2;
+    }
+    return quality[std::min(level, quality.size() - 1)];
+}
+
+std::string buildPyramidFilter(const std::string& input, int levels) {
+    const std::vector<int> factors = pyramidFactors(levels);
+    std::string graph = "[" + input + "]split=" + std::to_string(factors.size()) + "[p0]";
+    for (size_t level = 1; level < factors.size(); level++) {
+        graph += "[s" + std::to_string(level) + "]";
+    }
+    // Sizes are rounded down like the trainers' own resize scripts do
+    for (size_t level = 1; level < factors.size(); level++) {
+        const std::string factor = std::to_string(factors[level]);
+        graph += ";[s" + std::to_string(level) + "]scale=trunc(iw/" + factor + "):trunc(ih/" + factor +
+                 "):flags=area[p" + std::to_string(level) + "]";
+    }
+    return graph;
+}
+
+bool parsePyramidQuality(const std::string& text, std::vector<int>& quality) {
+    std::vector<int> parsed;
+    std::istringstream fields(text);
+    std::string field;
+    while (std::getline(fields, field, ',')) {
+        char* end = nullptr;
+        long value = std::strtol(field.c_str(), &end, 10);
+        if (field.empty() || *end != '\0' || value < 2 || value > 31) {
+            return false;
+        }
+        parsed.push_back(static_cast<int>(value));
+    }
+    if (parsed.empty() || parsed.size() > static_cast<size_t>(kMaxPyramidLevels) + 1) {
+        return false;
+    }
+    quality = std::move(parsed);
+    return true;
+}
+
+std::string formatPyramidQuality(const std::vector<int>& quality) {
+    std::string text;
+    for (size_t i = 0; i < quality.size(); i++) {
+        if (i > 0) {
+            text += ',';
+        }
+        text += std::to_string(quality[i]);
+    }
+    return text;
+}
@@ -0,0 +1,35 @@
+#ifndef IMAGE_PYRAMID_H
+#define IMAGE_PYRAMID_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Multi-resolution image folders as Gaussian splatting trainers expect them:
+// images/ at full size next to images_2/, images_4/, images_8/ ... with the
+// same file names, each level half the size of the previous one.
+
+// Most downscaled levels supported (1/16)
+const int kMaxPyramidLevels = 4;
+
+// Downscale factor of every level, full size first: 3 levels -> 1, 2, 4, 8
+std::vector<int> pyramidFactors(int levels);
+
+// Folder of a level next to the full-size folder: "images" -> "images_2"
+// (factor 1 is the full-size folder itself)
+std::filesystem::path pyramidLevelDir(const std::filesystem::path& fullSizeDir, int factor);
+
+// ffmpeg JPEG quantizer (-q:v, 2 = best .. 31) of a level; levels past the end
+// of quality use its last entry, an empty list means 2 everywhere
+int pyramidQuality(const std::vector<int>& quality, size_t level);
+
+// Filter graph that splits the stream labelled input into every level:
+// "[in]split=4[p0][s1][s2][s3];[s1]scale=...[p1];..." with outputs [p0]
+// (full size, untouched) to [p<levels>]. Downscaling uses area averaging.
+std::string buildPyramidFilter(const std::string& input, int levels);
+
+// "2,3,3,4" -> {2, 3, 3, 4}; false unless every entry is a quantizer 2..31
+bool parsePyramidQuality(const std::string& text, std::vector<int>& quality);
+std::string formatPyramidQuality(const std::vector<int>& quality);
+
+#endif // IMAGE_PYRAMID_H
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <vector>
+
+// Picks the sharpest of every `windowSize` consecutive candidate frames.
+// Candidates are added in index order with their sharpness score; when a
+// window is complete the decision for it is returned. A window whose best
+// frame is still far blurrier than the recent ones (score below blurRatio x
+// median of the last kept windows) is dropped entirely.
+class KeyframeSelector {
+public:
+    struct Decision {
+        size_t best = 0;             // candidate index of the sharpest frame
+        double score = 0.0;
+        bool keep = true;            // false: even the best frame is too blurry
+        std::vector<size_t> discard; // all other candidates of the window
+    };
+
+    KeyframeSelector(size_t windowSize, double blurRatio)
+        : m_windowSize(std::max<size_t>(1, windowSize)), m_blurRatio(blurRatio) {}
+
+    std::optional<Decision> add(size_t index, double score) {
+        std::optional<Decision> decision;
+        const size_t window = index / m_windowSize;
+        if (!m_candidates.empty() && window != m_window) {
+            decision = close();
+        }
+        m_window = window;
+        m_candidates.push_back({index, score});
+        return decision;
+    }
+
+    // Decision for the last, possibly partial, window
+    std::optional<Decision> finish() {
+        if (m_candidates.empty()) {
+            return std::nullopt;
+        }
+        return close();
+    }
+
+    size_t droppedWindows() const { return m_dropped; }
+
+private:
+    struct Candidate {
+        size_t index;
+        double score;
+    };
+
+    Decision close() {
+        auto best = std::max_element(m_candidates.begin(), m_candidates.end(),
+                                     [](const Candidate& a, const Candidate& b) { return a.score < b.score; });
+        Decision decision;
+        decision.best = best->index;
+        decision.score = best->score;
+        for (const auto& candidate : m_candidates) {
+            if (candidate.index != best->index) {
+                decision.discard.push_back(candidate.index);
+            }
+        }
+
+        if (m_blurRatio > 0.0 && m_recent.size() >= kMinHistory) {
+            std::vector<double> sorted(m_recent.begin(), m_recent.end());
+            std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+            decision.keep = decision.score >= m_blurRatio * sorted[sorted.size() / 2];
+        }
+
+        if (decision.keep) {
+            m_recent.push_back(decision.score);
+            if (m_recent.size() > kHistory) {
+                m_recent.pop_front();
+            }
+        } else {
+            m_dropped++;
+        }
+        m_candidates.clear();
+        return decision;
+    }
+
+    static constexpr size_t kHistory = 31;    // kept windows the median is taken over
+    static constexpr size_t kMinHistory = 5;  // never drop before this many were kept
+
+    size_t m_windowSize;
+    double m_blurRatio;
+    size_t m_window = 0;
+    std::vector<Candidate> m_candidates;
+    std::deque<double> m_recent;
+    size_t m_dropped = 0;
+};
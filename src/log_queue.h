@@ -0,0 +1,139 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Lock-free multi-producer / single-consumer queue of log lines.
+// push() never blocks (one CAS on the list head). The consumer takes every
+// pending line at once with drain(), which swaps the head out and restores
+// FIFO order, so there is no ABA problem and no per-line consumer work under
+// contention. If the consumer stalls, lines beyond maxPendingBytes are
+// counted and discarded instead of growing without bound.
+class LogQueue {
+public:
+    explicit LogQueue(size_t maxPendingBytes = 16 * 1024 * 1024) : m_maxPendingBytes(maxPendingBytes) {}
+
+    LogQueue(const LogQueue&) = delete;
+    LogQueue& operator=(const LogQueue&) = delete;
+
+    ~LogQueue() {
+        freeList(m_head.exchange(nullptr));
+    }
+
+    // Safe from any thread. Returns false if the line was dropped.
+    bool push(std::string line) {
+        const size_t size = line.size();
+        if (m_pendingBytes.fetch_add(size, std::memory_order_relaxed) + size > m_maxPendingBytes) {
+            m_pendingBytes.fetch_sub(size, std::memory_order_relaxed);
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Node* node = new Node{std::move(line), m_head.load(std::memory_order_relaxed)};
+        while (!m_head.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    // Consumer only: append every pending line to out in push order.
+    // Returns the number of lines dropped since the previous drain().
+    size_t drain(std::vector<std::string>& out) {
+        Node* list = m_head.exchange(nullptr, std::memory_order_acquire);
+
+        // The list is newest-first; reverse it
+        Node* ordered = nullptr;
+        while (list) {
+            Node* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        size_t bytes = 0;
+        while (ordered) {
+            bytes += ordered->line.size();
+            out.push_back(std::move(ordered->line));
+            Node* next = ordered->next;
+            delete ordered;
+            ordered = next;
+        }
+        m_pendingBytes.fetch_sub(bytes, std::memory_order_relaxed);
+        return m_dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    bool empty() const { return m_head.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node {
+        std::string line;
+        Node* next;
+    };
+
+    static void freeList(Node* node) {
+        while (node) {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    std::atomic<Node*> m_head{nullptr};
+    std::atomic<size_t> m_pendingBytes{0};
+    std::atomic<size_t> m_dropped{0};
+    const size_t m_maxPendingBytes;
+};
+
+// Text of a capped log view, kept in step with a text control.
+// append() says how to update the control: normally just append the new
+// text; once the cap is exceeded the oldest whole lines are removed, down to
+// 3/4 of the cap, and the control is reset to text(). A reset therefore
+// happens once every maxChars/4 characters of output, not on every line.
+class Scrollback {
+public:
+    struct Update {
+        bool replaceAll = false;  // set the control to text() instead of appending
+        std::string append;
+    };
+
+    explicit Scrollback(size_t maxChars = 512 * 1024, std::string newline = "\r\n")
+        : m_maxChars(maxChars), m_newline(std::move(newline)) {}
+
+    Update append(const std::vector<std::string>& lines, size_t droppedLines = 0) {
+        Update update;
+        if (droppedLines > 0) {
+            update.append += "... " + std::to_string(droppedLines) + " log lines dropped" + m_newline;
+        }
+        for (const auto& line : lines) {
+            update.append += line;
+            update.append += m_newline;
+        }
+
+        m_text += update.append;
+        if (m_text.size() > m_maxChars) {
+            m_text.erase(0, lineStartAfter(m_text, m_text.size() - m_maxChars * 3 / 4));
+            update.replaceAll = true;
+            update.append.clear();
+        }
+        return update;
+    }
+
+    void clear() { m_text.clear(); }
+    const std::string& text() const { return m_text; }
+    size_t size() const { return m_text.size(); }
+
+private:
+    // First line start at or after pos (or the end of text)
+    size_t lineStartAfter(const std::string& text, size_t pos) const {
+        if (pos == 0) {
+            return 0;
+        }
+        size_t found = text.find(m_newline, pos - 1);
+        return found == std::string::npos ? text.size() : found + m_newline.size();
+    }
+
+    std::string m_text;
+    size_t m_maxChars;
+    std::string m_newline;
+};
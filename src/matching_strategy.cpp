@@ -0,0 +1,226 @@
+#include "matching_strategy.h"
+#include "geodesy.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+std::string formatNumber(double value) {
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+}
+
+void sortUnique(std::vector<std::pair<size_t, size_t>>& pairs) {
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+}
+
+} // namespace
+
+const char* matchingModeName(MatchingMode mode) {
+    switch (mode) {
+        case MatchingMode::Auto: return "auto";
+        case MatchingMode::Exhaustive: return "exhaustive";
+        case MatchingMode::Sequential: return "sequential";
+        case MatchingMode::Spatial: return "spatial";
+        case MatchingMode::VocabTree: return "vocab_tree";
+        case MatchingMode::PairList: return "pairs";
+    }
+    return "unknown";
+}
+
+bool parseMatchingMode(const std::string& text, MatchingMode& mode) {
+    for (MatchingMode candidate : {MatchingMode::Auto, MatchingMode::Exhaustive, MatchingMode::Sequential,
+                                   MatchingMode::Spatial, MatchingMode::VocabTree, MatchingMode::PairList}) {
+        if (text == matchingModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<std::pair<size_t, size_t>> buildSequentialPairs(const std::vector<FrameRecord>& frames,
+                                                            size_t overlap) {
+    std::vector<std::pair<size_t, size_t>> pairs;
+    for (size_t i = 0; i < frames.size(); i++) {
+        for (size_t j = i + 1; j < frames.size() && j <= i + overlap; j++) {
+            if (frames[j].video != frames[i].video) {
+                break;
+            }
+            pairs.emplace_back(i, j);
+        }
+    }
+    return pairs;
+}
+
+std::vector<std::pair<size_t, size_t>> buildSpatialPairs(const std::vector<FrameRecord>& frames,
+                                                         double radius, size_t maxNeighbors) {
+    std::vector<std::pair<size_t, size_t>> pairs;
+    if (radius <= 0.0 || maxNeighbors == 0) {
+        return pairs;
+    }
+
+    // Local east-north-up metres around the mean position
+    std::vector<size_t> tagged;
+    CoordinateArrays points;
+    GeoOrigin origin;
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (frames[i].hasGps) {
+            tagged.push_back(i);
+            points.push_back(frames[i].latitude, frames[i].longitude, frames[i].altitude);
+            origin.latitude += frames[i].latitude;
+            origin.longitude += frames[i].longitude;
+            origin.altitude += frames[i].altitude;
+        }
+    }
+    if (tagged.size() < 2) {
+        return pairs;
+    }
+    origin.latitude /= tagged.size();
+    origin.longitude /= tagged.size();
+    origin.altitude /= tagged.size();
+    geodeticToEnu(origin, points, points);
+    const double* east = points.x.data();
+    const double* north = points.y.data();
+    const double* up = points.z.data();
+
+    // Uniform grid with radius-sized cells: all neighbours are in the 3x3 block
+    auto cellOf = [radius](double v) { return static_cast<int64_t>(std::floor(v / radius)); };
+    auto key = [](int64_t cx, int64_t cy) { return (static_cast<uint64_t>(cx) << 32) ^ static_cast<uint32_t>(cy); };
+    std::unordered_map<uint64_t, std::vector<size_t>> grid;
+    grid.reserve(points.size());
+    for (size_t k = 0; k < points.size(); k++) {
+        grid[key(cellOf(east[k]), cellOf(north[k]))].push_back(k);
+    }
+
+    const double radiusSquared = radius * radius;
+    std::vector<std::pair<double, size_t>> candidates;
+    for (size_t k = 0; k < points.size(); k++) {
+        candidates.clear();
+        const int64_t cx = cellOf(east[k]);
+        const int64_t cy = cellOf(north[k]);
+        for (int64_t dx = -1; dx <= 1; dx++) {
+            for (int64_t dy = -1; dy <= 1; dy++) {
+                auto cell = grid.find(key(cx + dx, cy + dy));
+                if (cell == grid.end()) {
+                    continue;
+                }
+                for (size_t other : cell->second) {
+                    if (other == k) continue;
+                    const double ex = east[other] - east[k];
+                    const double ey = north[other] - north[k];
+                    const double ez = up[other] - up[k];
+                    const double d2 = ex * ex + ey * ey + ez * ez;
+                    if (d2 <= radiusSquared) {
+                        candidates.emplace_back(d2, other);
+                    }
+                }
+            }
+        }
+
+        const size_t keep = std::min(maxNeighbors, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end());
+        for (size_t c = 0; c < keep; c++) {
+            size_t a = tagged[k];
+            size_t b = tagged[candidates[c].second];
+            pairs.emplace_back(std::min(a, b), std::max(a, b));
+        }
+    }
+
+    sortUnique(pairs);
+    return pairs;
+}
+
+MatchingPlan planMatching(const std::vector<FrameRecord>& frames, const MatchingOptions& options) {
+    MatchingPlan plan;
+    const size_t frameCount = frames.size();
+    const size_t gpsCount = std::count_if(frames.begin(), frames.end(),
+                                          [](const FrameRecord& frame) { return frame.hasGps; });
+    const double gpsShare = frameCount > 0 ? static_cast<double>(gpsCount) / frameCount : 0.0;
+    const bool haveVocabTree = !options.vocabTreePath.empty();
+    const std::string counts = std::to_string(frameCount) + " frames, " +
+                               std::to_string(static_cast<int>(gpsShare * 100.0 + 0.5)) + "% geotagged";
+
+    plan.mode = options.mode;
+    if (plan.mode == MatchingMode::Auto) {
+        if (frameCount <= options.exhaustiveMaxFrames) {
+            plan.mode = MatchingMode::Exhaustive;
+            plan.reason = counts + ", small enough for exhaustive matching";
+        } else if (gpsShare >= options.minGpsCoverage) {
+            plan.mode = MatchingMode::PairList;
+            plan.reason = counts + ", matching video neighbours and GPS neighbours";
+        } else {
+            plan.mode = MatchingMode::Sequential;
+            plan.reason = counts + (haveVocabTree ? ", video order with loop detection"
+                                                  : ", video order (no vocabulary tree for loop detection)");
+        }
+    } else {
+        plan.reason = counts + ", requested";
+    }
+
+    // Requested modes that cannot run on these inputs
+    if (plan.mode == MatchingMode::VocabTree && !haveVocabTree) {
+        plan.mode = MatchingMode::Sequential;
+        plan.reason = counts + ", no vocabulary tree available - using video order instead";
+    }
+    if (plan.mode == MatchingMode::Spatial && gpsCount == 0) {
+        plan.mode = MatchingMode::Sequential;
+        plan.reason = counts + ", no geotags for spatial matching - using video order instead";
+    }
+
+    switch (plan.mode) {
+        case MatchingMode::Auto:
+        case MatchingMode::Exhaustive:
+            plan.mode = MatchingMode::Exhaustive;
+            plan.matcher = "exhaustive_matcher";
+            break;
+        case MatchingMode::Sequential:
+            plan.matcher = "sequential_matcher";
+            plan.arguments = {"--SequentialMatching.overlap", std::to_string(options.sequentialOverlap)};
+            if (haveVocabTree) {
+                plan.arguments.insert(plan.arguments.end(),
+                                      {"--SequentialMatching.loop_detection", "1",
+                                       "--SequentialMatching.vocab_tree_path", options.vocabTreePath});
+            }
+            break;
+        case MatchingMode::Spatial:
+            plan.matcher = "spatial_matcher";
+            plan.arguments = {"--SpatialMatching.is_gps", "1",
+                              "--SpatialMatching.max_num_neighbors", std::to_string(options.spatialNeighbors),
+                              "--SpatialMatching.max_distance", formatNumber(options.spatialRadius)};
+            break;
+        case MatchingMode::VocabTree:
+            plan.matcher = "vocab_tree_matcher";
+            plan.arguments = {"--VocabTreeMatching.vocab_tree_path", options.vocabTreePath,
+                              "--VocabTreeMatching.num_images", std::to_string(options.vocabTreeImages)};
+            break;
+        case MatchingMode::PairList: {
+            plan.matcher = "matches_importer";
+            plan.arguments = {"--match_type", "pairs"};
+            plan.pairs = buildSequentialPairs(frames, options.sequentialOverlap);
+            auto spatial = buildSpatialPairs(frames, options.spatialRadius, options.spatialNeighbors);
+            plan.pairs.insert(plan.pairs.end(), spatial.begin(), spatial.end());
+            sortUnique(plan.pairs);
+            break;
+        }
+    }
+    return plan;
+}
+
+bool writePairList(const std::string& path, const std::vector<FrameRecord>& frames,
+                   const std::vector<std::pair<size_t, size_t>>& pairs) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    for (const auto& pair : pairs) {
+        file << frames[pair.first].name << ' ' << frames[pair.second].name << '\n';
+    }
+    return file.good();
+}
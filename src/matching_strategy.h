@@ -0,0 +1,57 @@
+#ifndef MATCHING_STRATEGY_H
+#define MATCHING_STRATEGY_H
+
+#include "pipeline.h"
+#include "frame_record.h"
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Tuning for choosing and building COLMAP match pairs
+struct MatchingOptions {
+    MatchingMode mode = MatchingMode::Auto;
+    std::string vocabTreePath;        // empty = no vocabulary tree available
+
+    size_t exhaustiveMaxFrames = 300; // Auto: exhaustive up to this many frames
+    double minGpsCoverage = 0.5;      // Auto: share of geotagged frames to use GPS pairs
+
+    size_t sequentialOverlap = 10;    // neighbours in video order matched per frame
+    double spatialRadius = 50.0;      // metres, GPS neighbours further apart are not matched
+    size_t spatialNeighbors = 20;     // nearest GPS neighbours matched per frame
+    size_t vocabTreeImages = 50;      // retrieved images per query (vocab_tree_matcher)
+};
+
+// What runColmap should run for feature matching
+struct MatchingPlan {
+    MatchingMode mode = MatchingMode::Exhaustive;
+    std::string reason;                             // why Auto picked this mode
+    std::string matcher;                            // COLMAP command, e.g. "sequential_matcher"
+    std::vector<std::string> arguments;             // extra "--Option value" arguments
+    std::vector<std::pair<size_t, size_t>> pairs;   // PairList: frame index pairs (i < j)
+};
+
+const char* matchingModeName(MatchingMode mode);
+
+// Parse "auto", "exhaustive", "sequential", "spatial", "vocab_tree" or "pairs"
+bool parseMatchingMode(const std::string& text, MatchingMode& mode);
+
+// Pick the matcher for these frames. frames must be in image-name order, which
+// for "<video>_frame_NNNN.jpg" names is video order.
+MatchingPlan planMatching(const std::vector<FrameRecord>& frames, const MatchingOptions& options);
+
+// Frames within `overlap` of each other in the same video
+std::vector<std::pair<size_t, size_t>> buildSequentialPairs(const std::vector<FrameRecord>& frames,
+                                                            size_t overlap);
+
+// For every geotagged frame, up to maxNeighbors nearest geotagged frames within
+// radius metres (3D distance), found through a uniform grid over local
+// east-north-up coordinates. Catches revisits and neighbouring flight lines.
+std::vector<std::pair<size_t, size_t>> buildSpatialPairs(const std::vector<FrameRecord>& frames,
+                                                         double radius, size_t maxNeighbors);
+
+// Write a matches_importer pair list ("name1 name2" per line)
+bool writePairList(const std::string& path, const std::vector<FrameRecord>& frames,
+                   const std::vector<std::pair<size_t, size_t>>& pairs);
+
+#endif // MATCHING_STRATEGY_H
@@ -0,0 +1,125 @@
+#include "output_capture.h"
+
+namespace {
+
+// Suppressed lines still shown when the process ends (usually the error)
+const size_t kSuppressedTailLines = 10;
+
+} // namespace
+
+OutputCapture::OutputCapture(LogCallback sink, const ProcessOutputOptions& options)
+    : m_sink(std::move(sink)), m_options(options), m_splitter(options.maxLineLength) {}
+
+void OutputCapture::write(const char* data, size_t size) {
+    m_splitter.feed(data, size, [this](std::string_view line) { pushLine(line); });
+}
+
+void OutputCapture::close() {
+    m_splitter.finish([this](std::string_view line) { pushLine(line); });
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    m_ready.notify_one();
+}
+
+void OutputCapture::pushLine(std::string_view line) {
+    if (m_options.lineObserver && m_options.lineObserver(line)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lines.emplace_back(line);
+    m_bufferedBytes += line.size();
+    while (m_bufferedBytes > m_options.maxBufferedBytes && m_lines.size() > 1) {
+        m_bufferedBytes -= m_lines.front().size();
+        m_lines.pop_front();
+        m_dropped++;
+    }
+    m_ready.notify_one();
+}
+
+size_t OutputCapture::droppedLines() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_dropped;
+}
+
+void OutputCapture::deliver() {
+    m_windowStart = std::chrono::steady_clock::now();
+    std::deque<std::string> batch;
+    for (;;) {
+        size_t dropped;
+        bool closed;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_ready.wait(lock, [this]() { return m_closed || !m_lines.empty(); });
+            batch.swap(m_lines);
+            m_bufferedBytes = 0;
+            dropped = m_dropped;
+            closed = m_closed;
+        }
+
+        // Lines were lost before this batch, so the notice goes first
+        if (dropped > m_droppedReported) {
+            reportSuppressed(false);
+            m_sink("... " + std::to_string(dropped - m_droppedReported) +
+                   " lines dropped (log could not keep up)");
+            m_droppedReported = dropped;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        for (auto& line : batch) {
+            deliverLine(line, now);
+        }
+        batch.clear();
+
+        if (closed) {
+            // close() happens after the last write, so nothing can follow this batch
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_lines.empty()) {
+                break;
+            }
+        }
+    }
+    reportSuppressed(true);
+}
+
+void OutputCapture::deliverLine(std::string& line, std::chrono::steady_clock::time_point now) {
+    if (m_options.maxLinesPerSecond == 0) {
+        m_sink(line);
+        return;
+    }
+
+    if (now - m_windowStart >= std::chrono::seconds(1)) {
+        reportSuppressed(false);
+        m_windowStart = now;
+        m_windowLines = 0;
+    }
+
+    if (m_windowLines < m_options.maxLinesPerSecond) {
+        m_windowLines++;
+        m_sink(line);
+        return;
+    }
+
+    m_suppressed++;
+    m_totalSuppressed++;
+    m_suppressedTail.push_back(std::move(line));
+    if (m_suppressedTail.size() > kSuppressedTailLines) {
+        m_suppressedTail.pop_front();
+    }
+}
+
+void OutputCapture::reportSuppressed(bool withTail) {
+    if (m_suppressed == 0) {
+        return;
+    }
+    if (withTail) {
+        m_sink("... " + std::to_string(m_suppressed - m_suppressedTail.size()) +
+               " lines suppressed, last " + std::to_string(m_suppressedTail.size()) + ":");
+        for (const auto& line : m_suppressedTail) {
+            m_sink(line);
+        }
+    } else {
+        m_sink("... " + std::to_string(m_suppressed) + " lines suppressed");
+    }
+    m_suppressed = 0;
+    m_suppressedTail.clear();
+}
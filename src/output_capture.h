@@ -0,0 +1,162 @@
+#ifndef OUTPUT_CAPTURE_H
+#define OUTPUT_CAPTURE_H
+
+#include "pipeline.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// Limits for capturing one child process's output
+struct ProcessOutputOptions {
+    // Lines waiting for the log consumer; beyond this the oldest are dropped
+    size_t maxBufferedBytes = 4 * 1024 * 1024;
+    // Lines delivered per second (0 = all). Excess lines are counted and
+    // summarised; the last few are still shown when the process ends.
+    size_t maxLinesPerSecond = 0;
+    // Longer lines are split (guards against endless '\r'-free progress output)
+    size_t maxLineLength = 64 * 1024;
+    // Sees every line on the pipe reader thread, before buffering and rate
+    // limiting, so none is missed. Returning true keeps the line out of the
+    // log (machine-readable progress output).
+    std::function<bool(std::string_view)> lineObserver;
+    
+    // Watchdog, enforced by runCommandHidden: the command and every process
+    // it started are killed once *cancel is set, after timeoutSeconds, or
+    // after stallSeconds without output (0 = no limit)
+    const std::atomic<bool>* cancel = nullptr;
+    double timeoutSeconds = 0.0;
+    double stallSeconds = 0.0;
+    // Limits by stage (PipelineConfig::toolTimeouts), which the pipeline
+    // turns into the two above for each tool it runs
+    const std::map<std::string, ToolTimeout>* stageTimeouts = nullptr;
+};
+
+// Splits a byte stream into lines in a single pass. Complete lines inside a
+// chunk are handed out as views without copying; only a line spanning two
+// chunks is assembled in the carry buffer. '\n', '\r' and "\r\n" all end a
+// line so carriage-return progress updates (ffmpeg stats) become lines too.
+// Empty lines are skipped.
+class LineSplitter {
+public:
+    explicit LineSplitter(size_t maxLineLength = 0) : m_maxLineLength(maxLineLength) {}
+
+    template <typename OnLine>
+    void feed(const char* data, size_t size, OnLine&& onLine) {
+        const char* end = data + size;
+        while (data < end) {
+            const char* eol = findLineEnd(data, end);
+            if (!eol) {
+                append(data, end, onLine);
+                return;
+            }
+            if (m_partial.empty()) {
+                emit(std::string_view(data, eol - data), onLine);
+            } else {
+                append(data, eol, onLine);
+                emit(m_partial, onLine);
+                m_partial.clear();
+            }
+            data = eol + 1;
+        }
+    }
+
+    // End of stream: hand out an unterminated last line
+    template <typename OnLine>
+    void finish(OnLine&& onLine) {
+        emit(m_partial, onLine);
+        m_partial.clear();
+    }
+
+private:
+    static const char* findLineEnd(const char* begin, const char* end) {
+        for (const char* p = begin; p < end; p++) {
+            if (*p == '\n' || *p == '\r') {
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    template <typename OnLine>
+    void append(const char* begin, const char* end, OnLine& onLine) {
+        while (m_maxLineLength > 0 && m_partial.size() + (end - begin) > m_maxLineLength) {
+            size_t take = m_maxLineLength - m_partial.size();
+            m_partial.append(begin, take);
+            begin += take;
+            emit(m_partial, onLine);
+            m_partial.clear();
+        }
+        m_partial.append(begin, end);
+    }
+
+    template <typename OnLine>
+    void emit(std::string_view line, OnLine& onLine) {
+        if (m_maxLineLength > 0) {
+            while (line.size() > m_maxLineLength) {
+                onLine(line.substr(0, m_maxLineLength));
+                line.remove_prefix(m_maxLineLength);
+            }
+        }
+        if (!line.empty()) {
+            onLine(line);
+        }
+    }
+
+    std::string m_partial;
+    size_t m_maxLineLength;
+};
+
+// Decouples a child process from its log consumer. The pipe reader calls
+// write()/close() and never blocks on the consumer; deliver() runs on another
+// thread and feeds the LogCallback in batches. If the consumer falls behind,
+// the oldest undelivered lines are dropped once maxBufferedBytes is reached,
+// so the child is never stalled on a full pipe.
+class OutputCapture {
+public:
+    OutputCapture(LogCallback sink, const ProcessOutputOptions& options);
+
+    // Reader side
+    void write(const char* data, size_t size);
+    void close();
+
+    // Consumer side: returns once close() was called and every line was handled
+    void deliver();
+
+    size_t droppedLines() const;
+    size_t suppressedLines() const { return m_totalSuppressed; }
+
+private:
+    void pushLine(std::string_view line);
+    void deliverLine(std::string& line, std::chrono::steady_clock::time_point now);
+    void reportSuppressed(bool withTail);
+
+    LogCallback m_sink;
+    ProcessOutputOptions m_options;
+    LineSplitter m_splitter;
+
+    // Shared between reader and consumer
+    mutable std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<std::string> m_lines;
+    size_t m_bufferedBytes = 0;
+    size_t m_dropped = 0;
+    bool m_closed = false;
+
+    // Consumer only
+    size_t m_droppedReported = 0;
+    std::chrono::steady_clock::time_point m_windowStart;
+    size_t m_windowLines = 0;
+    size_t m_suppressed = 0;
+    size_t m_totalSuppressed = 0;
+    std::deque<std::string> m_suppressedTail;
+};
+
+#endif // OUTPUT_CAPTURE_H
@@ -0,0 +1,521 @@
+#include "partition.h"
+#include "colmap_model.h"
+#include "geo_registration.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Overlap frames a tile gets at the least: enough shared cameras for the
+// merge to align it by, even where the frames lie further apart than the
+// overlap distance
+size_t minimumOverlap(size_t maxFrames) {
+    return std::max<size_t>(5, maxFrames / 20);
+}
+
+// Runs of maxFrames frames in frame order, each widened by the minimum
+// overlap on both sides
+std::vector<Tile> partitionInFrameOrder(size_t count, size_t maxFrames) {
+    std::vector<Tile> tiles;
+    const size_t margin = minimumOverlap(maxFrames);
+    for (size_t start = 0; start < count; start += maxFrames) {
+        const size_t end = std::min(count, start + maxFrames);
+        const size_t from = start >= margin ? start - margin : 0;
+        const size_t to = std::min(count, end + margin);
+        Tile tile;
+        tile.frames.resize(to - from);
+        std::iota(tile.frames.begin(), tile.frames.end(), from);
+        tile.core = end - start;
+        tiles.push_back(std::move(tile));
+    }
+    return tiles;
+}
+
+// Angle in degrees between the rotations of two unit quaternions
+double rotationAngle(const double a[4], const double b[4]) {
+    const double d = std::abs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+    return 2.0 * std::acos(std::min(1.0, d)) * 180.0 / kPi;
+}
+
+double distance(const Vec3& a, const Vec3& b) {
+    return std::sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+// Similarity taking the cameras `from` (the model being added) onto the same
+// images `to` in the merged model
+bool alignShared(const std::vector<const ColmapImage*>& from, const std::vector<const ColmapImage*>& to,
+                 const ModelMergeOptions& options, Similarity& transform, size_t& inliers, std::string& reason) {
+    const size_t n = from.size();
+
+    // Per image: R_to = R_from S^T, so S = R_to^T R_from
+    std::vector<std::array<double, 4>> relative(n);
+    for (size_t i = 0; i < n; i++) {
+        double rf[3][3], rt[3][3], s[3][3];
+        quaternionToMatrix(from[i]->qvec, rf);
+        quaternionToMatrix(to[i]->qvec, rt);
+        for (int a = 0; a < 3; a++) {
+            for (int b = 0; b < 3; b++) {
+                s[a][b] = rt[0][a] * rf[0][b] + rt[1][a] * rf[1][b] + rt[2][a] * rf[2][b];
+            }
+        }
+        matrixToQuaternion(s, relative[i].data());
+    }
+
+    // The relative rotation most others agree with, averaged over those
+    size_t best = 0, bestCount = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t count = 0;
+        for (size_t j = 0; j < n; j++) {
+            count += rotationAngle(relative[i].data(), relative[j].data()) <= options.maxAngle;
+        }
+        if (count > bestCount) {
+            best = i;
+            bestCount = count;
+        }
+    }
+    if (bestCount < options.minShared) {
+        reason = "the shared cameras disagree on the relative orientation";
+        return false;
+    }
+    std::vector<size_t> agreeing;
+    double q[4] = {0.0, 0.0, 0.0, 0.0};
+    for (size_t j = 0; j < n; j++) {
+        if (rotationAngle(relative[best].data(), relative[j].data()) <= options.maxAngle) {
+            agreeing.push_back(j);
+            const double* r = relative[j].data();
+            const double sign = r[0] * relative[best][0] + r[1] * relative[best][1] + r[2] * relative[best][2] +
+                                r[3] * relative[best][3] < 0.0 ? -1.0 : 1.0;
+            for (int k = 0; k < 4; k++) q[k] += sign * r[k];
+        }
+    }
+    quaternionToMatrix(q, transform.rotation);
+
+    // Rotated centers of `from` against the centers in the merged model
+    std::vector<Vec3> a(n), b(n);
+    for (size_t i = 0; i < n; i++) {
+        const Vec3 c = cameraCenter(*from[i]);
+        for (int k = 0; k < 3; k++) {
+            a[i][k] = transform.rotation[k][0] * c[0] + transform.rotation[k][1] * c[1] + transform.rotation[k][2] * c[2];
+        }
+        b[i] = cameraCenter(*to[i]);
+    }
+    // Cameras taken from the same spot do not count towards the spacing
+    std::vector<double> spacing;
+    for (size_t i : agreeing) {
+        double nearest = INFINITY;
+        for (size_t j : agreeing) {
+            const double d = distance(b[i], b[j]);
+            if (j != i && d > 0.0) nearest = std::min(nearest, d);
+        }
+        if (std::isfinite(nearest)) spacing.push_back(nearest);
+    }
+    std::nth_element(spacing.begin(), spacing.begin() + spacing.size() / 2, spacing.end());
+    const double threshold = spacing.empty() ? 0.0 : options.maxError * spacing[spacing.size() / 2];
+    if (!(threshold > 0.0)) {
+        reason = "the shared cameras all sit in one place";
+        return false;
+    }
+
+    auto countInliers = [&](double scale, const Vec3& translation, std::vector<size_t>* members) {
+        size_t count = 0;
+        for (size_t i : agreeing) {
+            const Vec3 mapped = {scale * a[i][0] + translation[0], scale * a[i][1] + translation[1],
+                                 scale * a[i][2] + translation[2]};
+            if (distance(mapped, b[i]) <= threshold) {
+                count++;
+                if (members) members->push_back(i);
+            }
+        }
+        return count;
+    };
+
+    // Scale and translation from pairs of cameras: every pair when there are
+    // few, else a fixed-seed sample
+    const size_t m = agreeing.size();
+    const size_t pairCount = m * (m - 1) / 2;
+    const size_t samples = std::min<size_t>(pairCount, 500);
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> pick(0, m - 1);
+    double bestScale = 0.0;
+    Vec3 bestTranslation = {0.0, 0.0, 0.0};
+    size_t bestInliers = 0;
+    size_t p = 0, q1 = 1;
+    for (size_t sample = 0; sample < samples; sample++) {
+        size_t i, j;
+        if (pairCount <= 500) {
+            i = agreeing[p];
+            j = agreeing[q1];
+            if (++q1 == m) q1 = ++p + 1;
+        } else {
+            i = agreeing[pick(rng)];
+            j = agreeing[pick(rng)];
+        }
+        const double span = distance(a[i], a[j]);
+        if (i == j || span < 1e-12) continue;
+        const double scale = distance(b[i], b[j]) / span;
+        const Vec3 translation = {b[i][0] - scale * a[i][0], b[i][1] - scale * a[i][1], b[i][2] - scale * a[i][2]};
+        const size_t count = countInliers(scale, translation, nullptr);
+        if (count > bestInliers) {
+            bestInliers = count;
+            bestScale = scale;
+            bestTranslation = translation;
+        }
+    }
+    if (bestInliers < options.minShared) {
+        reason = "too few shared cameras agree on scale and position";
+        return false;
+    }
+
+    // Least-squares refit on the inliers
+    std::vector<size_t> members;
+    countInliers(bestScale, bestTranslation, &members);
+    Vec3 meanA = {0.0, 0.0, 0.0}, meanB = {0.0, 0.0, 0.0};
+    for (size_t i : members) {
+        for (int k = 0; k < 3; k++) {
+            meanA[k] += a[i][k] / members.size();
+            meanB[k] += b[i][k] / members.size();
+        }
+    }
+    double numerator = 0.0, denominator = 0.0;
+    for (size_t i : members) {
+        for (int k = 0; k < 3; k++) {
+            numerator += (a[i][k] - meanA[k]) * (b[i][k] - meanB[k]);
+            denominator += (a[i][k] - meanA[k]) * (a[i][k] - meanA[k]);
+        }
+    }
+    if (denominator > 0.0 && numerator > 0.0) {
+        transform.scale = numerator / denominator;
+        for (int k = 0; k < 3; k++) {
+            transform.translation[k] = meanB[k] - transform.scale * meanA[k];
+        }
+    } else {
+        transform.scale = bestScale;
+        transform.translation = bestTranslation;
+    }
+    inliers = countInliers(transform.scale, transform.translation, nullptr);
+    if (inliers < options.minShared || inliers * 10 < n * 3) {
+        char text[120];
+        snprintf(text, sizeof(text), "only %zu of %zu shared cameras agree on one alignment", inliers, n);
+        reason = text;
+        return false;
+    }
+    return true;
+}
+
+// Add model to merged through transform. Images already in merged keep their
+// pose; the observations model made in them are appended to their keypoints.
+void appendModel(ColmapModel& merged, const ColmapModel& model, const Similarity& transform,
+                 std::unordered_map<std::string, size_t>& byName, uint32_t& nextCamera, uint32_t& nextImage,
+                 uint64_t& nextPoint) {
+    std::unordered_map<uint32_t, uint32_t> cameraIds;
+    for (const ColmapCamera& camera : model.cameras) {
+        cameraIds[camera.id] = 0;
+    }
+    std::unordered_map<uint32_t, size_t> imageIndex;  // image id in model -> index in merged
+    std::unordered_map<uint32_t, const ColmapImage*> source;
+    std::unordered_map<uint32_t, bool> shared;
+    for (const ColmapImage& image : model.images) {
+        source[image.id] = &image;
+        auto existing = byName.find(image.name);
+        if (existing != byName.end()) {
+            imageIndex[image.id] = existing->second;
+            shared[image.id] = true;
+            continue;
+        }
+        uint32_t& camera = cameraIds[image.camera];
+        if (camera == 0) {
+            auto original = std::find_if(model.cameras.begin(), model.cameras.end(),
+                                         [&](const ColmapCamera& c) { return c.id == image.camera; });
+            if (original != model.cameras.end()) {
+                camera = nextCamera++;
+                merged.cameras.push_back(*original);
+                merged.cameras.back().id = camera;
+            }
+        }
+        ColmapImage added = image;
+        transformPose(added, transform);
+        added.id = nextImage++;
+        added.camera = camera;
+        for (ColmapPoint2D& point : added.points) {
+            point.point3D = kColmapNoPoint3D;
+        }
+        byName[added.name] = merged.images.size();
+        imageIndex[image.id] = merged.images.size();
+        shared[image.id] = false;
+        merged.images.push_back(std::move(added));
+    }
+
+    for (const ColmapPoint3D& point : model.points) {
+        // Seen only in shared images: the merged model has this point already
+        bool seesNewImage = false;
+        for (const ColmapTrackElement& element : point.track) {
+            auto it = shared.find(element.image);
+            seesNewImage = seesNewImage || (it != shared.end() && !it->second);
+        }
+        if (!seesNewImage) {
+            continue;
+        }
+        ColmapPoint3D moved;
+        moved.id = nextPoint++;
+        const Vec3 xyz = transform.apply({point.xyz[0], point.xyz[1], point.xyz[2]});
+        std::copy(xyz.begin(), xyz.end(), moved.xyz);
+        std::copy(point.rgb, point.rgb + 3, moved.rgb);
+        moved.error = point.error;
+        for (const ColmapTrackElement& element : point.track) {
+            auto index = imageIndex.find(element.image);
+            if (index == imageIndex.end()) continue;
+            const ColmapImage& from = *source[element.image];
+            if (element.point2D >= from.points.size()) continue;
+            ColmapImage& target = merged.images[index->second];
+            uint32_t point2D = element.point2D;
+            if (shared[element.image]) {
+                const ColmapPoint2D& keypoint = from.points[element.point2D];
+                point2D = static_cast<uint32_t>(target.points.size());
+                target.points.push_back({keypoint.x, keypoint.y, moved.id});
+            } else {
+                target.points[point2D].point3D = moved.id;
+            }
+            moved.track.push_back({target.id, point2D});
+        }
+        merged.points.push_back(std::move(moved));
+    }
+}
+
+} // namespace
+
+std::vector<Tile> partitionFrames(const std::vector<FrameRecord>& frames, const PartitionOptions& options) {
+    std::vector<Tile> tiles;
+    const size_t maxFrames = std::max<size_t>(options.maxFrames, 1);
+    if (frames.empty()) {
+        return tiles;
+    }
+    if (frames.size() <= maxFrames) {
+        Tile tile;
+        tile.frames.resize(frames.size());
+        std::iota(tile.frames.begin(), tile.frames.end(), 0);
+        tile.core = frames.size();
+        tiles.push_back(std::move(tile));
+        return tiles;
+    }
+
+    std::vector<size_t> tagged;
+    CoordinateArrays points;
+    GeoOrigin origin;
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (frames[i].hasGps) {
+            tagged.push_back(i);
+            points.push_back(frames[i].latitude, frames[i].longitude, frames[i].altitude);
+            origin.latitude += frames[i].latitude;
+            origin.longitude += frames[i].longitude;
+            origin.altitude += frames[i].altitude;
+        }
+    }
+    if (tagged.size() < 2) {
+        return partitionInFrameOrder(frames.size(), maxFrames);
+    }
+    origin.latitude /= tagged.size();
+    origin.longitude /= tagged.size();
+    origin.altitude /= tagged.size();
+    geodeticToEnu(origin, points, points);
+
+    // Every frame hangs off a geotagged one: itself, else the last one before
+    // it (the first one for frames before any GPS)
+    std::vector<size_t> anchor(frames.size());
+    std::vector<size_t> weight(tagged.size(), 0);
+    for (size_t i = 0, k = 0; i < frames.size(); i++) {
+        while (k + 1 < tagged.size() && tagged[k + 1] <= i) k++;
+        anchor[i] = k;
+        weight[k]++;
+    }
+
+    // Halve across the longer horizontal extent until a cell fits into a tile
+    std::vector<std::vector<size_t>> cells;
+    std::vector<std::vector<size_t>> work(1);
+    work[0].resize(tagged.size());
+    std::iota(work[0].begin(), work[0].end(), 0);
+    while (!work.empty()) {
+        std::vector<size_t> cell = std::move(work.back());
+        work.pop_back();
+        size_t count = 0;
+        double minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+        for (size_t k : cell) {
+            count += weight[k];
+            minX = std::min(minX, points.x[k]);
+            maxX = std::max(maxX, points.x[k]);
+            minY = std::min(minY, points.y[k]);
+            maxY = std::max(maxY, points.y[k]);
+        }
+        // A cell no wider than the overlap is not split: each half would
+        // take in the other one again (a hovering drone, say)
+        if (count <= maxFrames || cell.size() < 2 || std::max(maxX - minX, maxY - minY) <= options.overlap) {
+            cells.push_back(std::move(cell));
+            continue;
+        }
+        const std::vector<double>& axis = maxX - minX >= maxY - minY ? points.x : points.y;
+        std::sort(cell.begin(), cell.end(), [&](size_t a, size_t b) { return axis[a] < axis[b]; });
+        size_t split = 0;
+        for (size_t half = 0; split + 1 < cell.size() && half + weight[cell[split]] <= count / 2; split++) {
+            half += weight[cell[split]];
+        }
+        split = std::max<size_t>(split, 1);
+        work.emplace_back(cell.begin(), cell.begin() + split);
+        work.emplace_back(cell.begin() + split, cell.end());
+    }
+
+    // Grow each cell by the geotagged frames within the overlap of its box,
+    // and by the ones nearest to the box if that adds too few
+    const size_t margin = minimumOverlap(maxFrames);
+    std::vector<size_t> cellOf(tagged.size());
+    for (size_t c = 0; c < cells.size(); c++) {
+        for (size_t k : cells[c]) cellOf[k] = c;
+    }
+    std::vector<char> member(tagged.size());
+    for (size_t c = 0; c < cells.size(); c++) {
+        double minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+        for (size_t k : cells[c]) {
+            minX = std::min(minX, points.x[k]);
+            maxX = std::max(maxX, points.x[k]);
+            minY = std::min(minY, points.y[k]);
+            maxY = std::max(maxY, points.y[k]);
+        }
+        std::vector<std::pair<double, size_t>> outside;
+        size_t added = 0;
+        for (size_t k = 0; k < tagged.size(); k++) {
+            const double dx = std::max({minX - points.x[k], points.x[k] - maxX, 0.0});
+            const double dy = std::max({minY - points.y[k], points.y[k] - maxY, 0.0});
+            member[k] = cellOf[k] == c || (dx <= options.overlap && dy <= options.overlap);
+            if (cellOf[k] != c) {
+                if (member[k]) {
+                    added++;
+                } else {
+                    outside.emplace_back(std::hypot(dx, dy), k);
+                }
+            }
+        }
+        const size_t missing = std::min(outside.size(), margin > added ? margin - added : 0);
+        std::partial_sort(outside.begin(), outside.begin() + missing, outside.end());
+        for (size_t j = 0; j < missing; j++) {
+            member[outside[j].second] = 1;
+        }
+        Tile tile;
+        for (size_t i = 0; i < frames.size(); i++) {
+            if (member[anchor[i]]) {
+                tile.frames.push_back(i);
+                tile.core += cellOf[anchor[i]] == c;
+            }
+        }
+        tiles.push_back(std::move(tile));
+    }
+    std::sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return a.frames[0] < b.frames[0]; });
+    return tiles;
+}
+
+bool mergeColmapModels(const std::vector<fs::path>& modelDirs, const fs::path& outputDir,
+                       const ModelMergeOptions& options, ModelMergeResult& result, std::string* error) {
+    result = ModelMergeResult();
+    std::vector<ColmapModel> models(modelDirs.size());
+    for (size_t i = 0; i < modelDirs.size(); i++) {
+        if (!readColmapModel(modelDirs[i], models[i], error)) {
+            return false;
+        }
+    }
+    result.models = models.size();
+    if (models.empty()) {
+        if (error) *error = "no models to merge";
+        return false;
+    }
+
+    // The model with the most images is the reference frame
+    size_t base = 0;
+    for (size_t i = 1; i < models.size(); i++) {
+        if (models[i].images.size() > models[base].images.size()) base = i;
+    }
+    ColmapModel merged = std::move(models[base]);
+    std::unordered_map<std::string, size_t> byName;
+    uint32_t nextCamera = 1, nextImage = 1;
+    uint64_t nextPoint = 1;
+    for (size_t i = 0; i < merged.images.size(); i++) {
+        byName[merged.images[i].name] = i;
+        nextImage = std::max(nextImage, merged.images[i].id + 1);
+    }
+    for (const ColmapCamera& camera : merged.cameras) {
+        nextCamera = std::max(nextCamera, camera.id + 1);
+    }
+    for (const ColmapPoint3D& point : merged.points) {
+        nextPoint = std::max(nextPoint, point.id + 1);
+    }
+    std::vector<bool> done(models.size(), false);
+    done[base] = true;
+    result.merged = 1;
+    result.notes.push_back(modelDirs[base].string() + ": reference, " + std::to_string(merged.images.size()) +
+                           " images");
+
+    auto sharedWith = [&](const ColmapModel& model) {
+        size_t count = 0;
+        for (const ColmapImage& image : model.images) {
+            count += byName.count(image.name);
+        }
+        return count;
+    };
+
+    // Grow the merged model by the pending model that overlaps it most
+    for (;;) {
+        size_t next = models.size(), nextShared = 0;
+        for (size_t i = 0; i < models.size(); i++) {
+            if (done[i]) continue;
+            const size_t shared = sharedWith(models[i]);
+            if (shared > nextShared) {
+                next = i;
+                nextShared = shared;
+            }
+        }
+        if (next == models.size() || nextShared < options.minShared) {
+            break;
+        }
+        done[next] = true;
+        const ColmapModel& model = models[next];
+        std::vector<const ColmapImage*> from, to;
+        for (const ColmapImage& image : model.images) {
+            auto existing = byName.find(image.name);
+            if (existing != byName.end()) {
+                from.push_back(&image);
+                to.push_back(&merged.images[existing->second]);
+            }
+        }
+        Similarity transform;
+        size_t inliers = 0;
+        std::string reason;
+        if (!alignShared(from, to, options, transform, inliers, reason)) {
+            result.notes.push_back(modelDirs[next].string() + ": left out, " + reason);
+            continue;
+        }
+        const size_t before = merged.images.size();
+        appendModel(merged, model, transform, byName, nextCamera, nextImage, nextPoint);
+        char text[160];
+        snprintf(text, sizeof(text), ": %zu new images, aligned on %zu of %zu shared cameras (scale %.4g)",
+                 merged.images.size() - before, inliers, from.size(), transform.scale);
+        result.notes.push_back(modelDirs[next].string() + text);
+        result.merged++;
+    }
+    for (size_t i = 0; i < models.size(); i++) {
+        if (!done[i]) {
+            result.notes.push_back(modelDirs[i].string() + ": left out, shares only " +
+                                   std::to_string(sharedWith(models[i])) + " registered images with the others");
+        }
+    }
+
+    result.images = merged.images.size();
+    result.points = merged.points.size();
+    std::error_code ec;
+    fs::create_directories(outputDir, ec);
+    removeColmapModel(outputDir);
+    return writeColmapModel(merged, outputDir, ColmapFormat::Binary, error);
+}
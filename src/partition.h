@@ -0,0 +1,61 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "frame_record.h"
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Partitioned reconstruction: a large flight is split into overlapping
+// spatial tiles that are reconstructed independently, and the tile models
+// are merged through the frames they share.
+
+struct PartitionOptions {
+    size_t maxFrames = 1000;  // frames per tile, not counting the overlap
+    double overlap = 30.0;    // metres: frames this close to a tile are added to it
+};
+
+struct Tile {
+    std::vector<size_t> frames;  // indices into the frame list, in frame order
+    size_t core = 0;             // how many of them belong to this tile alone (the rest is overlap)
+};
+
+// Split frames into tiles by halving their GPS positions (local ENU) across
+// the longer horizontal extent until each half holds at most maxFrames, then
+// grow every tile by the frames within overlap metres of its bounding box,
+// and by the nearest others if that gives it fewer than 5 (or a twentieth of
+// a tile) to share. Cells no wider than the overlap are not split, so frames
+// taken from one spot stay together. Frames without GPS go with the
+// geotagged frame before them; without any GPS the frames are cut into runs
+// in frame order overlapping by that minimum. A single tile when all frames
+// fit into one.
+std::vector<Tile> partitionFrames(const std::vector<FrameRecord>& frames, const PartitionOptions& options);
+
+struct ModelMergeOptions {
+    double maxAngle = 2.0;   // degrees: shared cameras whose relative orientation disagrees more are outliers
+    double maxError = 0.5;   // camera center outliers, in units of the median spacing of the shared cameras
+    size_t minShared = 3;    // models sharing fewer registered images are not merged
+};
+
+struct ModelMergeResult {
+    size_t models = 0;               // models read
+    size_t merged = 0;               // of those, in the output
+    size_t images = 0;
+    size_t points = 0;
+    std::vector<std::string> notes;  // one line per model: how it was aligned, or why it was left out
+};
+
+// Merge COLMAP models that share images (by name) into one binary model in
+// outputDir, in the frame of the model with the most images. The others are
+// added in order of overlap, each aligned by a similarity: the rotation from
+// the relative orientations of the shared cameras, scale and translation
+// from their centers (RANSAC over pairs), so tiles that share a single line
+// of cameras still align. A shared image keeps the pose it had first; points
+// a model saw only in shared images are dropped as duplicates. Models that
+// cannot be aligned are left out and noted. False with error set if a model
+// cannot be read or the output cannot be written.
+bool mergeColmapModels(const std::vector<std::filesystem::path>& modelDirs, const std::filesystem::path& outputDir,
+                       const ModelMergeOptions& options, ModelMergeResult& result, std::string* error = nullptr);
+
+#endif // PARTITION_H
@@ -0,0 +1,180 @@
+#include "perf_report.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+double megabytes(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+} // namespace
+
+StageMetrics& RunReport::stageLocked(const std::string& stage) {
+    for (auto& metrics : m_stages) {
+        if (metrics.name == stage) {
+            return metrics;
+        }
+    }
+    m_stages.emplace_back();
+    m_stages.back().name = stage;
+    return m_stages.back();
+}
+
+void RunReport::addProcess(const std::string& stage, const ProcessStats& stats) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    StageMetrics& metrics = stageLocked(stage);
+    metrics.cpuSeconds += stats.cpuSeconds;
+    metrics.peakMemoryBytes = std::max(metrics.peakMemoryBytes, stats.peakMemoryBytes);
+    metrics.bytesRead += stats.bytesRead;
+    metrics.bytesWritten += stats.bytesWritten;
+    metrics.processes++;
+}
+
+void RunReport::addStage(const std::string& stage, double wallSeconds, size_t items, const std::string& itemName) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    StageMetrics& metrics = stageLocked(stage);
+    metrics.wallSeconds += wallSeconds;
+    metrics.items += items;
+    if (!itemName.empty()) {
+        metrics.itemName = itemName;
+    }
+}
+
+void RunReport::addBusyTime(const std::string& stage, double seconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stageLocked(stage).cpuSeconds += seconds;
+}
+
+void RunReport::setInfo(const std::string& key, const std::string& value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : m_info) {
+        if (entry.first == key) {
+            entry.second = value;
+            return;
+        }
+    }
+    m_info.emplace_back(key, value);
+}
+
+std::vector<StageMetrics> RunReport::stages() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stages;
+}
+
+double RunReport::elapsedSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+}
+
+std::vector<std::string> RunReport::summaryTable() const {
+    std::vector<StageMetrics> stages = this->stages();
+    size_t nameWidth = 5;
+    for (const auto& stage : stages) {
+        nameWidth = std::max(nameWidth, stage.name.size());
+    }
+
+    std::vector<std::string> lines;
+    char line[512];
+    std::snprintf(line, sizeof(line), "%-*s %9s %9s %8s %9s %9s  %s", static_cast<int>(nameWidth), "Stage",
+                  "Wall s", "CPU s", "Peak MB", "Read MB", "Write MB", "Throughput");
+    lines.push_back(line);
+
+    double cpu = 0.0;
+    uint64_t read = 0, written = 0, peak = 0;
+    for (const auto& stage : stages) {
+        std::string rate;
+        if (stage.items > 0 && stage.wallSeconds > 0.0) {
+            char text[96];
+            std::snprintf(text, sizeof(text), "%zu %s, %.1f/s", stage.items, stage.itemName.c_str(),
+                          stage.itemsPerSecond());
+            rate = text;
+        }
+        std::snprintf(line, sizeof(line), "%-*s %9.2f %9.2f %8.0f %9.1f %9.1f  %s", static_cast<int>(nameWidth),
+                      stage.name.c_str(), stage.wallSeconds, stage.cpuSeconds, megabytes(stage.peakMemoryBytes),
+                      megabytes(stage.bytesRead), megabytes(stage.bytesWritten), rate.c_str());
+        lines.push_back(line);
+        cpu += stage.cpuSeconds;
+        read += stage.bytesRead;
+        written += stage.bytesWritten;
+        peak = std::max(peak, stage.peakMemoryBytes);
+    }
+
+    // Stages can overlap (parallel videos), so the total is the run's wall time
+    std::snprintf(line, sizeof(line), "%-*s %9.2f %9.2f %8.0f %9.1f %9.1f  pipeline itself: %.0f MB peak",
+                  static_cast<int>(nameWidth), "total", elapsedSeconds(), cpu, megabytes(peak), megabytes(read),
+                  megabytes(written), megabytes(currentProcessPeakMemory()));
+    lines.push_back(line);
+    return lines;
+}
+
+bool RunReport::writeJson(const std::string& path, bool success) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::vector<StageMetrics> stages = this->stages();
+    std::vector<std::pair<std::string, std::string>> info;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        info = m_info;
+    }
+
+    char number[64];
+    auto fixed = [&](double value) {
+        std::snprintf(number, sizeof(number), "%.3f", value);
+        return std::string(number);
+    };
+
+    file << "{\n";
+    file << "  \"success\": " << (success ? "true" : "false") << ",\n";
+    file << "  \"wall_seconds\": " << fixed(elapsedSeconds()) << ",\n";
+    file << "  \"pipeline_peak_memory_bytes\": " << currentProcessPeakMemory() << ",\n";
+    file << "  \"info\": {";
+    for (size_t i = 0; i < info.size(); i++) {
+        file << (i ? ", " : "") << "\"" << jsonEscape(info[i].first) << "\": \"" << jsonEscape(info[i].second) << "\"";
+    }
+    file << "},\n";
+    file << "  \"stages\": [\n";
+    for (size_t i = 0; i < stages.size(); i++) {
+        const StageMetrics& stage = stages[i];
+        file << "    {\"name\": \"" << jsonEscape(stage.name) << "\""
+             << ", \"wall_seconds\": " << fixed(stage.wallSeconds)
+             << ", \"cpu_seconds\": " << fixed(stage.cpuSeconds)
+             << ", \"peak_memory_bytes\": " << stage.peakMemoryBytes
+             << ", \"bytes_read\": " << stage.bytesRead
+             << ", \"bytes_written\": " << stage.bytesWritten
+             << ", \"processes\": " << stage.processes
+             << ", \"items\": " << stage.items
+             << ", \"item_name\": \"" << jsonEscape(stage.itemName) << "\""
+             << ", \"items_per_second\": " << fixed(stage.itemsPerSecond()) << "}"
+             << (i + 1 < stages.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n";
+    file << "}\n";
+    return file.good();
+}
+
+std::string jsonEscape(const std::string& text) {
+    std::string result;
+    result.reserve(text.size() + 2);
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\r': result += "\\r"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    result += escaped;
+                } else {
+                    result += static_cast<char>(c);
+                }
+        }
+    }
+    return result;
+}
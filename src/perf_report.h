@@ -0,0 +1,85 @@
+#ifndef PERF_REPORT_H
+#define PERF_REPORT_H
+
+#include "process.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Measurements of one pipeline stage. Process figures are summed over the
+// stage's child processes (peak memory: the largest one).
+struct StageMetrics {
+    std::string name;
+    double wallSeconds = 0.0;
+    double cpuSeconds = 0.0;       // child processes, or busy time of in-process workers
+    uint64_t peakMemoryBytes = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    size_t processes = 0;
+    size_t items = 0;              // frames or images the stage handled
+    std::string itemName;          // "frames", "images"
+
+    double itemsPerSecond() const { return wallSeconds > 0.0 ? items / wallSeconds : 0.0; }
+};
+
+// Per-run collection of stage metrics, written as a JSON report and a log
+// table at the end of the run. Thread safe; stages keep the order in which
+// they were first reported.
+class RunReport {
+public:
+    RunReport() : m_started(std::chrono::steady_clock::now()) {}
+
+    void addProcess(const std::string& stage, const ProcessStats& stats);
+    void addStage(const std::string& stage, double wallSeconds, size_t items = 0, const std::string& itemName = "");
+    void addBusyTime(const std::string& stage, double seconds);
+
+    // Free-form "key": value pairs for the report header (settings, counts)
+    void setInfo(const std::string& key, const std::string& value);
+
+    std::vector<StageMetrics> stages() const;
+    double elapsedSeconds() const;
+
+    // Fixed-width table, one line per stage plus a total
+    std::vector<std::string> summaryTable() const;
+    bool writeJson(const std::string& path, bool success) const;
+
+private:
+    StageMetrics& stageLocked(const std::string& stage);
+
+    mutable std::mutex m_mutex;
+    std::chrono::steady_clock::time_point m_started;
+    std::vector<StageMetrics> m_stages;
+    std::vector<std::pair<std::string, std::string>> m_info;
+};
+
+// Wall time of a stage from construction to finish()
+class StageTimer {
+public:
+    StageTimer(RunReport& report, std::string stage)
+        : m_report(report), m_stage(std::move(stage)), m_started(std::chrono::steady_clock::now()) {}
+
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_started).count();
+    }
+
+    void finish(size_t items = 0, const std::string& itemName = "") {
+        m_report.addStage(m_stage, seconds(), items, itemName);
+    }
+
+    const std::string& stage() const { return m_stage; }
+
+private:
+    RunReport& m_report;
+    std::string m_stage;
+    std::chrono::steady_clock::time_point m_started;
+};
+
+// JSON string contents for text (quotes, backslashes, control characters)
+std::string jsonEscape(const std::string& text);
+
+#endif // PERF_REPORT_H
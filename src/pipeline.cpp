@@ -1,272 +1,1064 @@
 #include "pipeline.h"
+#include "process.h"
 #include "gps_embed.h"
+#include "gps_track.h"
+#include "exif_writer.h"
+#include "thread_pool.h"
+#include "buffered_log.h"
+#include "frame_record.h"
+#include "frame_paths.h"
+#include "matching_strategy.h"
+#include "sharpness.h"
+#include "keyframe_selector.h"
+#include "adaptive_sampling.h"
+#include "stage_manifest.h"
+#include "perf_report.h"
+#include "progress.h"
+#include "image_pyramid.h"
+#include "frame_store.h"
+#include "frame_stage.h"
+#include "colmap_model.h"
+#include "geo_registration.h"
+#include "partition.h"
+#include "disk_budget.h"
 #include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 
 namespace fs = std::filesystem;
 
-std::string getExecutableDir() {
-    char buffer[MAX_PATH];
-    GetModuleFileNameA(NULL, buffer, MAX_PATH);
-    fs::path exePath(buffer);
-    return exePath.parent_path().string();
+#ifdef _WIN32
+const char* const kFfmpegVendorPath = "ffmpeg/bin/ffmpeg.exe";
+const char* const kColmapVendorPath = "colmap/bin/colmap.bat";
+#else
+const char* const kFfmpegVendorPath = "ffmpeg/bin/ffmpeg";
+const char* const kColmapVendorPath = "colmap/bin/colmap";
+#endif
+
+// External tools used by the pipeline, resolved once per run
+struct ToolPaths {
+    std::string ffmpeg;
+    std::string colmap;
+};
+
+bool checkVendorFiles(const PipelineConfig& config, ToolPaths& tools, LogCallback logCallback) {
+    tools.ffmpeg = resolveTool(config.ffmpegPath, kFfmpegVendorPath, "ffmpeg");
+    if (tools.ffmpeg.empty()) {
+        logCallback("ERROR: FFmpeg not found at: " + (config.ffmpegPath.empty()
+            ? (fs::path(getExecutableDir()) / "vendor" / kFfmpegVendorPath).string() : config.ffmpegPath));
+        return false;
+    }
+    
+    // COLMAP is only needed when it does the reconstruction
+    if (config.method == ReconMethod::COLMAP) {
+        tools.colmap = resolveTool(config.colmapPath, kColmapVendorPath, "colmap");
+        if (tools.colmap.empty()) {
+            logCallback("ERROR: COLMAP not found at: " + (config.colmapPath.empty()
+                ? (fs::path(getExecutableDir()) / "vendor" / kColmapVendorPath).string() : config.colmapPath));
+            return false;
+        }
+        logCallback("Vendor files OK: FFmpeg and COLMAP found");
+    } else {
+        logCallback("Vendor files OK: FFmpeg found");
+    }
+    return true;
 }
 
-// Convert path to Windows short path name (8.3 format) to avoid space issues
-std::string getShortPathName(const std::string& longPath) {
-    char shortPath[MAX_PATH];
-    DWORD length = GetShortPathNameA(longPath.c_str(), shortPath, MAX_PATH);
-    if (length > 0 && length < MAX_PATH) {
-        return std::string(shortPath);
+// Kind of a stage for PipelineConfig::toolTimeouts: "extract" for
+// "extract DJI_0001", "mapper" for "colmap mapper" and "colmap tile 3 mapper"
+std::string stageKind(const std::string& stage) {
+    if (stage.rfind("colmap ", 0) == 0) {
+        return stage.substr(stage.rfind(' ') + 1);
     }
-    // If conversion fails, return original path
-    return longPath;
+    return stage.substr(0, stage.find(' '));
 }
 
-bool checkVendorFiles(LogCallback logCallback) {
-    std::string exeDir = getExecutableDir();
-    fs::path ffmpegPath = fs::path(exeDir) / "vendor" / "ffmpeg" / "bin" / "ffmpeg.exe";
-    fs::path colmapPath = fs::path(exeDir) / "vendor" / "colmap" / "bin" / "colmap.bat";
-    
+// Limits of a stage: its own, else those under "all"
+ToolTimeout stageTimeout(const std::map<std::string, ToolTimeout>& timeouts, const std::string& stage) {
+    ToolTimeout timeout;
+    auto own = timeouts.find(stageKind(stage));
+    auto all = timeouts.find("all");
+    if (own != timeouts.end()) {
+        timeout = own->second;
+    }
+    if (all != timeouts.end()) {
+        timeout.seconds = timeout.seconds > 0.0 ? timeout.seconds : all->second.seconds;
+        timeout.stallSeconds = timeout.stallSeconds > 0.0 ? timeout.stallSeconds : all->second.stallSeconds;
+    }
+    return timeout;
+}
+
+bool isCancelled(const ProcessOutputOptions& output) {
+    return output.cancel && output.cancel->load();
+}
+
+// Run a tool under the time limits of its stage and add its resource usage
+// to the report under stage. If the tool is killed (cancelled or timed out),
+// partialOutputs are removed so nothing half-written is left behind.
+int runCommand(const std::string& command, const ProcessOutputOptions& output, LogCallback logCallback,
+               RunReport& report, const std::string& stage, const std::vector<fs::path>& partialOutputs = {}) {
+    ProcessOutputOptions limited = output;
+    if (output.stageTimeouts) {
+        const ToolTimeout timeout = stageTimeout(*output.stageTimeouts, stage);
+        limited.timeoutSeconds = timeout.seconds;
+        limited.stallSeconds = timeout.stallSeconds;
+    }
+    ProcessStats stats;
+    int result = runCommandHidden(command, logCallback, limited, &stats);
+    report.addProcess(stage, stats);
+    if ((result == kProcessCancelled || result == kProcessTimedOut) && !partialOutputs.empty()) {
+        std::error_code ec;
+        for (const auto& path : partialOutputs) {
+            fs::remove_all(path, ec);
+        }
+        logCallback("Removed the partial output of " + stage);
+    }
+    return result;
+}
+
+// Remove one video's frames from outputDir and from every pyramid level
+// folder next to it. False if one could not be removed.
+bool removeVideoFrames(const fs::path& outputDir, const std::string& framePrefix) {
+    bool removed = true;
+    for (int factor : pyramidFactors(kMaxPyramidLevels)) {
+        std::error_code ec;
+        for (fs::directory_iterator it(pyramidLevelDir(outputDir, factor), ec), end; !ec && it != end; it.increment(ec)) {
+            const std::string name = it->path().filename().string();
+            if (it->path().extension() == ".jpg" && name.rfind(framePrefix + "_frame_", 0) == 0) {
+                std::error_code removeError;
+                removed = fs::remove(it->path(), removeError) && removed;
+            }
+        }
+    }
+    return removed;
+}
+
+// Width of the grey plane keyframe candidates are scored on
+const int kSharpnessWidth = 480;
+
+// Extract frames of one video straight into outputDir as "<framePrefix>_frame_%04d.jpg".
+// Several videos may share outputDir as long as their prefixes differ.
+// With config.keyframeSelection, keyframeOversample candidates are decoded per
+// 1/frameRate window and only the sharpest is kept (frames stay numbered 1..n).
+// With config.pyramidLevels, the same decode also writes every frame into the
+// downscaled level folders next to outputDir (see pyramidLevelDir).
+bool extractFrames(const std::string& ffmpegPath, const std::string& videoPath, const std::string& outputDir,
+                  const std::string& framePrefix, const PipelineConfig& config, int ffmpegThreads,
+                  const ProcessOutputOptions& output, RunReport& report, ProgressModel& progress,
+                  LogCallback logCallback, std::vector<FrameRecord>* frames = nullptr) {
     if (!fs::exists(ffmpegPath)) {
-        logCallback("ERROR: FFmpeg not found at: " + ffmpegPath.string());
+        logCallback("ERROR: FFmpeg not found");
         return false;
     }
     
-    if (!fs::exists(colmapPath)) {
-        logCallback("ERROR: COLMAP not found at: " + colmapPath.string());
-        return false;
-    }
+    logCallback("Using FFmpeg: " + ffmpegPath);
     
-    logCallback("Vendor files OK: FFmpeg and COLMAP found");
-    return true;
-}
-
-// Run command with hidden console window and capture output to GUI log
-int runCommandHidden(const std::string& command, LogCallback logCallback) {
-    SECURITY_ATTRIBUTES sa;
-    sa.nLength = sizeof(SECURITY_ATTRIBUTES);
-    sa.bInheritHandle = TRUE;
-    sa.lpSecurityDescriptor = NULL;
+    fs::path videoFilePath(videoPath);
+    fs::path videoOutputDir(outputDir);
     
-    // Create pipes for stdout/stderr
-    HANDLE hReadPipe, hWritePipe;
-    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
-        logCallback("ERROR: Failed to create pipe");
-        return -1;
+    // Output folder of every pyramid level, full size first
+    const std::vector<int> factors = pyramidFactors(config.pyramidLevels);
+    std::vector<fs::path> levelDirs;
+    for (int factor : factors) {
+        levelDirs.push_back(pyramidLevelDir(videoOutputDir, factor));
     }
     
-    SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
+    try {
+        for (const fs::path& dir : levelDirs) {
+            fs::create_directories(dir);
+        }
+    }
+    catch (const std::exception& e) {
+        logCallback("ERROR creating output directory: " + std::string(e.what()));
+        return false;
+    }
     
-    STARTUPINFOA si = {};
-    si.cb = sizeof(STARTUPINFOA);
-    si.hStdOutput = hWritePipe;
-    si.hStdError = hWritePipe;
-    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;  // Hide the console window!
+    // Frames left over from an earlier run would be picked up before ffmpeg
+    // rewrites them; levels no longer configured would be out of date
+    if (!removeVideoFrames(videoOutputDir, framePrefix)) {
+        logCallback("ERROR: Could not remove the frames of an earlier run from " + videoOutputDir.string());
+        return false;
+    }
     
-    PROCESS_INFORMATION pi = {};
+    // Load the GPS track up front so frames can be tagged while ffmpeg is still decoding
+    GpsTrack track;
+    try {
+        fs::path srtPath = findSrtFile(videoFilePath);
+        if (!srtPath.empty()) {
+            logCallback("Found SRT file: " + srtPath.filename().string());
+            logCallback("Parsing GPS data...");
+            
+            // Parse SRT file into a time-indexed track
+            track = GpsTrack(parseSRT(srtPath.string()));
+            
+            if (!track.empty()) {
+                logCallback("Parsed " + std::to_string(track.size()) + " GPS entries from SRT");
+                if (!track.wasMonotonic()) {
+                    logCallback("⚠ SRT timestamps were out of order - entries sorted by time");
+                }
+                logCallback("GPS EXIF/XMP data will be embedded as frames are extracted");
+            } else {
+                logCallback("⚠ WARNING: No GPS data found in SRT file");
+            }
+        } else {
+            logCallback("ℹ No SRT file found for this video - skipping GPS embedding");
+        }
+    } catch (const std::exception& e) {
+        logCallback("⚠ WARNING: GPS embedding failed: " + std::string(e.what()));
+        track = GpsTrack();
+    }
     
-    // Wrap command in cmd.exe
-    std::string fullCommand = "cmd.exe /c " + command;
-    char* cmdLine = _strdup(fullCommand.c_str());
+    const double fps = config.frameRate;
     
-    BOOL success = CreateProcessA(
-        NULL, cmdLine, NULL, NULL, TRUE,
-        CREATE_NO_WINDOW, NULL, NULL, &si, &pi
-    );
+    // Adaptive sampling: frame times planned from the flight track
+    std::vector<double> plannedTimes;
+    if (config.adaptiveSampling) {
+        if (track.size() < 2) {
+            logCallback("⚠ Adaptive sampling needs an SRT track - extracting at a fixed " +
+                       std::to_string(fps) + " fps instead");
+        } else {
+            std::vector<TrackPoint> points;
+            points.reserve(track.size());
+            for (const GPSData& sample : track.samples()) {
+                points.push_back({sample.timestamp, sample.latitude, sample.longitude, sample.altitude});
+            }
+            SamplingOptions sampling;
+            sampling.overlap = config.samplingOverlap;
+            sampling.groundDistance = config.samplingGroundDistance;
+            sampling.fovDegrees = config.cameraFovDegrees;
+            sampling.height = config.samplingHeight;
+            sampling.maxInterval = config.samplingMaxInterval;
+            SamplingPlan plan = planSampling(points, sampling);
+            plannedTimes = std::move(plan.timestamps);
+            
+            const double duration = points.back().timestamp - points.front().timestamp;
+            char summary[160];
+            snprintf(summary, sizeof(summary), "%zu frames over %.0f m of flight, %.1f-%.1f m apart (fixed %.2f fps: ~%zu)",
+                     plannedTimes.size(), plan.trackLength, plan.minSpacing, plan.maxSpacing, fps,
+                     static_cast<size_t>(duration * fps) + 1);
+            logCallback("Adaptive sampling: " + std::string(summary));
+        }
+    }
+    const bool adaptive = !plannedTimes.empty();
+    if (adaptive && config.keyframeSelection) {
+        logCallback("ℹ Keyframe selection is not used together with adaptive sampling");
+    }
     
-    free(cmdLine);
-    CloseHandle(hWritePipe);
+    const bool keyframes = !adaptive && config.keyframeSelection && config.keyframeOversample > 1;
+    const int oversample = keyframes ? config.keyframeOversample : 1;
+    const double sampleRate = fps * oversample;
+    
+    // Keyframe candidates go next to the frames folder, never inside it
+    // (COLMAP scans its image folder recursively)
+    fs::path candidateDir = videoOutputDir.parent_path() / ".candidates" / framePrefix;
+    auto candidatePath = [&](size_t n, const char* extension, size_t level = 0) {
+        char name[48];
+        if (level == 0) {
+            snprintf(name, sizeof(name), "cand_%06zu.%s", n, extension);
+        } else {
+            snprintf(name, sizeof(name), "cand_%06zu_%d.%s", n, factors[level], extension);
+        }
+        return candidateDir / name;
+    };
+    if (keyframes) {
+        try {
+            fs::remove_all(candidateDir);
+            fs::create_directories(candidateDir);
+        } catch (const std::exception& e) {
+            logCallback("ERROR creating keyframe candidate directory: " + std::string(e.what()));
+            return false;
+        }
+    }
     
-    if (!success) {
-        CloseHandle(hReadPipe);
-        DWORD error = GetLastError();
-        logCallback("ERROR: Failed to start process (error code: " + std::to_string(error) + ")");
-        return -1;
+    // One output per pyramid level: ffmpeg options "-map [pN] ... <pattern>".
+    // Without a pyramid the single output takes the stream from -vf / -filter_script
+    const bool pyramid = factors.size() > 1;
+    std::string threadsOption = ffmpegThreads > 0 ? " -threads " + std::to_string(ffmpegThreads) : "";
+    auto levelOutputs = [&](const std::string& options, const std::function<fs::path(size_t)>& pattern) {
+        std::string outputs;
+        for (size_t level = 0; level < factors.size(); level++) {
+            if (pyramid) {
+                outputs += " -map \"[p" + std::to_string(level) + "]\"";
+            }
+            outputs += options + " -q:v " + std::to_string(pyramidQuality(config.pyramidQuality, level)) +
+                       threadsOption + " -atomic_writing 1 \"" + pattern(level).string() + "\"";
+        }
+        return outputs;
+    };
+    auto framePattern = [&](size_t level) { return levelDirs[level] / (framePrefix + "_frame_%04d.jpg"); };
+    auto candidatePattern = [&](size_t level) {
+        return level == 0 ? candidateDir / "cand_%06d.jpg"
+                          : candidateDir / ("cand_%06d_" + std::to_string(factors[level]) + ".jpg");
+    };
+    
+    // Build FFmpeg command; every path is quoted for spaces
+    // -nostdin keeps ffmpeg from waiting on a terminal in background/headless runs
+    // -progress replaces the status line with key=value blocks for the progress model
+    // -atomic_writing makes each frame appear under its final name only once complete
+    std::ostringstream cmdStream;
+    cmdStream << "\"" << ffmpegPath << "\" -nostdin" << ffmpegProgressArguments() << " -i \"" << videoPath << "\"";
+    fs::path selectScript = videoOutputDir.parent_path() / (framePrefix + "_select.txt");
+    if (adaptive) {
+        // Only the planned frames are encoded; the select expression is far too
+        // long for a command line, so ffmpeg reads it from a file
+        std::ofstream script(selectScript, std::ios::binary);
+        if (pyramid) {
+            script << "[0:v]" << buildSelectFilter(plannedTimes) << "[sel];" << buildPyramidFilter("sel", config.pyramidLevels);
+        } else {
+            script << buildSelectFilter(plannedTimes);
+        }
+        if (!script.good()) {
+            logCallback("ERROR: Could not write " + selectScript.string());
+            return false;
+        }
+        cmdStream << (pyramid ? " -filter_complex_script \"" : " -filter_script:v \"") << selectScript.string() << "\""
+                  << levelOutputs(" -fps_mode vfr", framePattern);
+    } else if (!keyframes) {
+        if (pyramid) {
+            cmdStream << " -filter_complex \"[0:v]fps=" << fps << "[sel];" << buildPyramidFilter("sel", config.pyramidLevels)
+                      << "\"";
+        } else {
+            cmdStream << " -vf fps=" << fps;
+        }
+        cmdStream << levelOutputs("", framePattern);
+    } else {
+        // One decode, two outputs: full-size JPEG candidates (and their
+        // pyramid levels) and a small grey plane of each for the sharpness score
+        cmdStream << " -filter_complex \"[0:v]fps=" << sampleRate << ",split=2[full][small];[small]scale="
+                  << kSharpnessWidth << ":-2:flags=area,format=gray[luma]"
+                  << (pyramid ? ";" + buildPyramidFilter("full", config.pyramidLevels) : std::string()) << "\"";
+        if (!pyramid) {
+            cmdStream << " -map \"[full]\"";
+        }
+        cmdStream << levelOutputs("", candidatePattern)
+                  << " -map \"[luma]\" -atomic_writing 1 \"" << (candidateDir / "cand_%06d.pgm").string() << "\"";
     }
     
-    // Read output in chunks and log it
-    char buffer[4096];
-    DWORD bytesRead;
-    std::string output;
+    if (adaptive) {
+        logCallback("Extracting " + std::to_string(plannedTimes.size()) + " planned frames...");
+    } else if (keyframes) {
+        logCallback("Extracting keyframes at " + std::to_string(fps) + " fps (sharpest of " +
+                   std::to_string(oversample) + " candidates per frame)...");
+    } else {
+        logCallback("Extracting frames at " + std::to_string(fps) + " fps...");
+    }
+    if (pyramid) {
+        std::string sizes;
+        for (size_t level = 1; level < factors.size(); level++) {
+            sizes += (level > 1 ? ", " : "") + levelDirs[level].filename().string();
+        }
+        logCallback("Writing image pyramid levels from the same decode: " + sizes);
+    }
     
-    while (ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, NULL) && bytesRead > 0) {
-        buffer[bytesRead] = '\0';
-        output += buffer;
-        
-        // Log output line by line
-        size_t pos = 0;
-        while ((pos = output.find('\n')) != std::string::npos) {
-            std::string line = output.substr(0, pos);
-            if (!line.empty() && line != "\r") {
-                logCallback(line);
+    // Per-frame post-processing, fed while ffmpeg runs: a check that every
+    // level is a complete JPEG (a full disk can cut one short), the GPS tags,
+    // then the content hash the frame manifest records (taken from the GPS
+    // write when there is one, so a tagged frame is read once)
+    FrameHashes hashes;
+    FrameStage frameStage("frames " + framePrefix);
+    frameStage.then("validate", validateJpegOperation());
+    frameStage.then("exif", writeGpsOperation());
+    frameStage.then("hash", contentHashOperation(hashes));
+    frameStage.cancelWhen(output.cancel);
+    
+    // Timestamps of the frames in the output folder, in frame-number order
+    std::vector<double> frameTimes;
+    auto levelPaths = [&](size_t n) {
+        std::vector<fs::path> paths;
+        for (const fs::path& dir : levelDirs) {
+            paths.push_back(dir / frameFileName(framePrefix, n));
+        }
+        return paths;
+    };
+    auto keepFrame = [&](double timestamp) {
+        const size_t n = frameTimes.size() + 1;
+        frameStage.submit({frameFileName(framePrefix, n), levelPaths(n),
+                           track.empty() ? GPSData() : track.at(timestamp, GpsInterpolation::Linear)});
+        frameTimes.push_back(timestamp);
+    };
+    
+    // Apply a keyframe decision: the winner becomes the next numbered frame
+    KeyframeSelector selector(oversample, config.keyframeBlurRatio);
+    auto applyDecision = [&](const KeyframeSelector::Decision& decision) {
+        std::error_code ec;
+        for (size_t level = 0; level < factors.size(); level++) {
+            for (size_t index : decision.discard) {
+                fs::remove(candidatePath(index + 1, "jpg", level), ec);
+            }
+            if (!decision.keep) {
+                fs::remove(candidatePath(decision.best + 1, "jpg", level), ec);
+            }
+        }
+        if (!decision.keep) {
+            return;
+        }
+        std::vector<fs::path> targets = levelPaths(frameTimes.size() + 1);
+        for (size_t level = 0; level < targets.size(); level++) {
+            fs::path best = candidatePath(decision.best + 1, "jpg", level);
+            fs::rename(best, targets[level], ec);
+            if (ec) {
+                logCallback("⚠ WARNING: Could not move keyframe " + best.string() + ": " + ec.message());
+                for (size_t moved = 0; moved < level; moved++) {
+                    fs::remove(targets[moved], ec);
+                }
+                return;
+            }
+        }
+        keepFrame(decision.best / sampleRate);
+    };
+    
+    // Run ffmpeg in the background and hand each frame on as soon as it exists
+    const std::string extractStage = "extract " + framePrefix;
+    StageTimer extractTimer(report, extractStage);
+    progress.start(extractStage, 0.0, "seconds");
+    const ProcessOutputOptions ffmpegOutput = progress.observe(output, extractStage, ProgressSource::Ffmpeg);
+    std::atomic<bool> ffmpegDone{false};
+    int result = 0;
+    std::thread ffmpegThread([&]() {
+        result = runCommand(cmdStream.str(), ffmpegOutput, logCallback, report, extractStage);
+        ffmpegDone = true;
+    });
+    
+    size_t candidateCount = 0;
+    double scoringSeconds = 0.0;
+    GrayImage luma;
+    for (;;) {
+        const bool done = ffmpegDone;
+        bool ready;
+        if (keyframes) {
+            fs::path pgm = candidatePath(candidateCount + 1, "pgm");
+            ready = fs::exists(pgm);
+            for (size_t level = 0; ready && level < factors.size(); level++) {
+                ready = fs::exists(candidatePath(candidateCount + 1, "jpg", level));
+            }
+            if (ready) {
+                const auto started = std::chrono::steady_clock::now();
+                double score = readPgm(pgm.string(), luma) ? laplacianVariance(luma) : 0.0;
+                scoringSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+                std::error_code ec;
+                fs::remove(pgm, ec);
+                if (auto decision = selector.add(candidateCount, score)) {
+                    applyDecision(*decision);
+                }
+                candidateCount++;
+            }
+        } else {
+            // A frame is handed on once every level of it has been written
+            ready = true;
+            for (const fs::path& path : levelPaths(frameTimes.size() + 1)) {
+                ready = ready && fs::exists(path);
+            }
+            if (ready) {
+                const size_t i = frameTimes.size();
+                keepFrame(adaptive ? plannedTimes[std::min(i, plannedTimes.size() - 1)] : i / fps);
             }
-            output.erase(0, pos + 1);
+        }
+        
+        if (!ready && done) {
+            break;  // ffmpeg exited before this check, so no more frames will appear
+        } else if (!ready) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
         }
     }
     
-    // Log any remaining output
-    if (!output.empty()) {
-        logCallback(output);
+    if (keyframes) {
+        if (auto decision = selector.finish()) {
+            applyDecision(*decision);
+        }
+        std::error_code ec;
+        fs::remove_all(candidateDir, ec);
+        fs::remove(candidateDir.parent_path(), ec);  // only succeeds once empty
     }
     
-    WaitForSingleObject(pi.hProcess, INFINITE);
+    ffmpegThread.join();
+    if (adaptive) {
+        std::error_code ec;
+        fs::remove(selectScript, ec);
+    }
+    const FrameStageResult perFrame = frameStage.wait();
+    const FrameOperationStats& gpsStats = perFrame.operations[1];
+    const FrameOperationStats& hashStats = perFrame.operations[2];
+    const size_t embedded = gpsStats.done;
+    
+    const size_t frameCount = frameTimes.size();
+    extractTimer.finish(frameCount, "frames");
+    
+    // In-process work overlaps ffmpeg, so its time is reported as the summed
+    // time spent on it (the rate is per worker thread)
+    if (!track.empty()) {
+        const double seconds = gpsStats.busySeconds;
+        report.addStage("gps " + framePrefix, seconds, embedded, "frames");
+        report.addBusyTime("gps " + framePrefix, seconds);
+    }
+    const double checkSeconds = perFrame.operations[0].busySeconds + hashStats.busySeconds;
+    report.addStage("check " + framePrefix, checkSeconds, hashStats.done, "frames");
+    report.addBusyTime("check " + framePrefix, checkSeconds);
+    if (keyframes) {
+        report.addStage("sharpness " + framePrefix, scoringSeconds, candidateCount, "candidates");
+        report.addBusyTime("sharpness " + framePrefix, scoringSeconds);
+    }
     
-    DWORD exitCode;
-    GetExitCodeProcess(pi.hProcess, &exitCode);
+    if (result == kProcessCancelled || result == kProcessTimedOut || perFrame.wasCancelled) {
+        // Only this video's frames: the folder may hold those of other videos
+        if (removeVideoFrames(videoOutputDir, framePrefix)) {
+            logCallback("Removed the partial output of " + extractStage);
+        }
+        return false;
+    }
+    if (result != 0) {
+        logCallback("ERROR: FFmpeg failed with exit code " + std::to_string(result));
+        return false;
+    }
+    progress.finish(extractStage);
     
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-    CloseHandle(hReadPipe);
+    logCallback("Extracted " + std::to_string(frameCount) + " frames to: " + videoOutputDir.string());
+    if (keyframes) {
+        logCallback("Kept the sharpest of " + std::to_string(candidateCount) + " candidates" +
+                   (selector.droppedWindows() > 0
+                        ? " (" + std::to_string(selector.droppedWindows()) + " motion-blurred intervals skipped)"
+                        : std::string()));
+    }
     
-    return exitCode;
+    // A broken frame, or one that could not be hashed, must not be recorded
+    // in the manifest; the next run extracts the video again
+    for (const FrameError& error : perFrame.errors) {
+        if (error.operation != "exif") {
+            logCallback("ERROR: " + error.message);
+            return false;
+        }
+    }
+    if (!track.empty()) {
+        size_t warned = 0;
+        for (size_t i = 0; i < perFrame.errors.size() && warned < 5; i++) {
+            if (perFrame.errors[i].operation == "exif") {
+                logCallback("⚠ WARNING: GPS embedding failed for " + perFrame.errors[i].message);
+                warned++;
+            }
+        }
+        logCallback("✅ Embedded GPS data into " + std::to_string(embedded) + "/" + 
+                   std::to_string(frameCount) + " frames");
+    }
+    
+    if (frames) {
+        // Same positions the workers embedded; failed embeds were logged above
+        std::vector<GPSData> positions = track.at(frameTimes, GpsInterpolation::Linear);
+        frames->clear();
+        frames->reserve(frameCount);
+        for (size_t i = 0; i < frameCount; i++) {
+            FrameRecord frame;
+            frame.name = frameFileName(framePrefix, i + 1);
+            frame.index = i;
+            frame.timestamp = frameTimes[i];
+            frame.hasGps = positions[i].valid;
+            frame.latitude = positions[i].latitude;
+            frame.longitude = positions[i].longitude;
+            frame.altitude = positions[i].altitude;
+            frame.contentHash = hashes.get(frame.name);
+            frames->push_back(std::move(frame));
+        }
+    }
+    return frameCount > 0;
 }
 
-int runCommand(const std::string& command, LogCallback logCallback) {
-    return runCommandHidden(command, logCallback);
+// Expected cost of the reconstruction stages in rough seconds on a desktop
+// GPU machine. Only the relative sizes matter: they weight the overall
+// progress, and the overall ETA is rescaled by the measured speed.
+void planSparseProgress(ProgressModel& progress, const std::string& prefix, double frames, MatchingMode matching) {
+    const bool exhaustive = matching == MatchingMode::Exhaustive;
+    progress.plan(prefix + " features", 0.3 * frames);
+    progress.plan(prefix + " matching", exhaustive ? 0.002 * frames * frames : 0.4 * frames);
+    progress.plan(prefix + " mapper", 0.5 * frames + 2e-4 * frames * frames);
 }
 
-bool extractFrames(const std::string& videoPath, const std::string& outputDir, 
-                  double fps, LogCallback logCallback) {
-    std::string exeDir = getExecutableDir();
-    fs::path ffmpegPath = fs::path(exeDir) / "vendor" / "ffmpeg" / "bin" / "ffmpeg.exe";
+void planReconstructionProgress(ProgressModel& progress, ReconMethod method, double frames, MatchingMode matching) {
+    switch (method) {
+        case ReconMethod::COLMAP:
+            planSparseProgress(progress, "colmap", frames, matching);
+            progress.plan("colmap undistort", 0.1 * frames);
+            break;
+        case ReconMethod::METASHAPE:
+            progress.plan("metashape", 3.0 * frames);
+            break;
+        case ReconMethod::REALITYSCAN:
+            progress.plan("realityscan", 3.0 * frames);
+            break;
+    }
+}
+
+// Vocabulary tree for loop detection / retrieval: the configured file, else the
+// first vendor/colmap/vocab_tree*.bin, else none
+std::string findVocabTree(const std::string& configuredPath, LogCallback logCallback) {
+    if (!configuredPath.empty()) {
+        if (fs::exists(configuredPath)) {
+            return configuredPath;
+        }
+        logCallback("⚠ WARNING: Vocabulary tree not found: " + configuredPath);
+        return "";
+    }
     
-    if (!fs::exists(ffmpegPath)) {
-        logCallback("ERROR: FFmpeg not found");
+    fs::path colmapVendorDir = fs::path(getExecutableDir()) / "vendor" / "colmap";
+    std::error_code ec;
+    std::vector<fs::path> trees;
+    for (fs::directory_iterator it(colmapVendorDir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name.rfind("vocab_tree", 0) == 0 && it->path().extension() == ".bin") {
+            trees.push_back(it->path());
+        }
+    }
+    std::sort(trees.begin(), trees.end());
+    return trees.empty() ? "" : trees.front().string();
+}
+
+// Read the COLMAP model in modelDir, log what it holds and every
+// inconsistency found, and write it to binaryDir as a binary model (nothing
+// written if binaryDir is empty). False if the model cannot be read or written.
+bool checkColmapModel(const fs::path& modelDir, const fs::path& binaryDir, const std::set<std::string>& imageNames,
+                      LogCallback logCallback) {
+    ColmapModelCheck check;
+    std::string error;
+    if (!convertColmapModel(modelDir, binaryDir, ColmapFormat::Binary, imageNames.empty() ? nullptr : &imageNames,
+                            check, &error)) {
+        logCallback("ERROR: COLMAP model: " + error);
         return false;
     }
-    
-    logCallback("Using FFmpeg: " + ffmpegPath.string());
-    
-    fs::path videoFilePath(videoPath);
-    std::string videoStem = videoFilePath.stem().string();
-    fs::path videoOutputDir = fs::path(outputDir) / videoStem;
+    char summary[160];
+    snprintf(summary, sizeof(summary), "%zu cameras, %zu images, %zu points (mean track length %.1f, mean error %.2f px)",
+             check.cameras, check.images, check.points, check.meanTrackLength, check.meanError);
+    logCallback("✅ COLMAP model " + modelDir.string() + ": " + summary);
+    if (!binaryDir.empty()) {
+        logCallback("✓ Binary model written to " + binaryDir.string());
+    }
+    if (!check.ok()) {
+        logCallback("⚠ WARNING: COLMAP model has " + std::to_string(check.problemCount) + " inconsistencies:");
+        for (const auto& problem : check.problems) {
+            logCallback("  " + problem);
+        }
+    }
+    return true;
+}
+
+// Whether a stage can be skipped: recorded in the manifest as complete with
+// the same inputs, and its result is still there. Otherwise the stage is
+// begun, with the reason logged on a resumed run. Each step's inputs include
+// the previous step's digest, so any change reruns that step and everything
+// after it.
+bool stageUpToDate(StageManifest& manifest, ProgressModel& progress, LogCallback logCallback,
+                   const std::string& stage, const StageInputs& inputs, const fs::path& result,
+                   const char* forceReason = nullptr) {
+    std::string reason = forceReason ? forceReason : "";
+    std::error_code ec;
+    if (!forceReason && manifest.isCurrent(stage, inputs, &reason) && fs::exists(result, ec)) {
+        logCallback("✓ Up to date - skipping");
+        progress.skip(stage);
+        return true;
+    }
+    if (manifest.wasLoaded()) {
+        logCallback("Running (" + (reason.empty() ? std::string("previous result is missing") : reason) + ")");
+    }
+    manifest.begin(stage);
+    return false;
+}
+
+// Run one COLMAP step, timed as a stage of the run report and followed
+// through its progress counters
+int runColmapStep(const std::string& stage, const std::string& command, ProgressSource source,
+                  const std::string& unit, size_t images, const ProcessOutputOptions& output, RunReport& report,
+                  ProgressModel& progress, LogCallback logCallback, const std::vector<fs::path>& partialOutputs = {}) {
+    StageTimer timer(report, stage);
+    progress.start(stage, static_cast<double>(images), unit);
+    int result = runCommand(command, progress.observe(output, stage, source, images), logCallback, report, stage,
+                            partialOutputs);
+    timer.finish(images, "images");
+    if (result == 0) {
+        progress.finish(stage);
+    }
+    return result;
+}
+
+// Feature extraction, matching and the mapper for one set of frames, with
+// its own database and sparse folder: all frames, or one tile of them
+struct SparseJob {
+    std::string stagePrefix;  // stages "<prefix> features", "<prefix> matching", "<prefix> mapper"
+    fs::path databasePath;
+    fs::path sparseDir;       // the mapper writes sparseDir/0, 1, ...
+    fs::path imageListPath;   // written and given to feature extraction and the mapper; empty = every image
+    fs::path staleDir;        // removed along with sparseDir when the mapper reruns
+    bool removeDatabase = false;  // once the model is built (PipelineConfig::cleanupIntermediates)
+    std::vector<FrameRecord> frames;
+    MatchingPlan plan;
+};
+
+// Remove a SparseJob's database and pair list; the model no longer needs them
+void removeSparseDatabase(const SparseJob& job, LogCallback logCallback) {
+    std::error_code ec;
+    const uintmax_t bytes = fs::file_size(job.databasePath, ec);
+    if (ec || !fs::remove(job.databasePath, ec)) {
+        return;
+    }
+    fs::remove(job.databasePath.parent_path() / "match_pairs.txt", ec);
+    fs::remove(job.databasePath.parent_path(), ec);  // only succeeds once empty
+    logCallback("Removed the database (" + formatBytes(bytes) + ") - the model is built");
+}
+
+// modelDigest: the mapper's stage inputs, for the steps that use its model
+bool runSparseReconstruction(const std::string& colmapPath, const std::string& framesDir, const SparseJob& job,
+                             const std::string& mapperOptions, StageManifest& manifest,
+                             const ProcessOutputOptions& output, RunReport& report, ProgressModel& progress,
+                             LogCallback logCallback, std::string& modelDigest) {
+    auto fixed = [](const fs::path& path) {
+        std::string text = path.string();
+        std::replace(text.begin(), text.end(), '\\', '/');
+        return text;
+    };
+    const std::string fixedFramesDir = fixed(framesDir);
+    const std::string fixedDbPath = fixed(job.databasePath);
+    const std::vector<FrameRecord>& frames = job.frames;
+    const MatchingPlan& plan = job.plan;
     
     try {
-        fs::create_directories(videoOutputDir);
+        fs::create_directories(job.databasePath.parent_path());
+        fs::create_directories(job.sparseDir);
     }
     catch (const std::exception& e) {
-        logCallback("ERROR creating output directory: " + std::string(e.what()));
+        logCallback("ERROR creating COLMAP directories: " + std::string(e.what()));
         return false;
     }
     
-    std::string outputPattern = (videoOutputDir / (videoStem + "_frame_%04d.jpg")).string();
-    
-    // Build FFmpeg command with proper quoting for cmd.exe /c
-    // Need to wrap the entire command in outer quotes for paths with spaces
-    std::ostringstream cmdStream;
-    cmdStream << "\"\"" << ffmpegPath.string() << "\" -i \"" << videoPath 
-              << "\" -vf fps=" << fps << " -q:v 2 \"" << outputPattern << "\"\"";
-    
-    logCallback("Extracting frames at " + std::to_string(fps) + " fps...");
+    auto upToDate = [&](const std::string& stage, const StageInputs& inputs, const fs::path& result,
+                        const char* forceReason = nullptr) {
+        return stageUpToDate(manifest, progress, logCallback, stage, inputs, result, forceReason);
+    };
+    auto runTimed = [&](const std::string& stage, const std::string& command, ProgressSource source,
+                        const std::string& unit, const std::vector<fs::path>& partialOutputs = {}) {
+        return runColmapStep(stage, command, source, unit, frames.size(), output, report, progress, logCallback,
+                             partialOutputs);
+    };
+    
+    const std::string featureArguments = "--ImageReader.single_camera 1";
+    StageInputs featureInputs;
+    featureInputs.addFile("colmap", colmapPath);
+    featureInputs.add("frames", frameListDigest(framesDir, frames));
+    featureInputs.add("arguments", featureArguments);
+    
+    StageInputs matchingInputs;
+    matchingInputs.add("features", featureInputs.digest());
+    matchingInputs.add("matcher", plan.matcher);
+    std::string matcherArguments;
+    for (const auto& argument : plan.arguments) {
+        matcherArguments += argument.rfind("--", 0) == 0 ? " " + argument : " \"" + argument + "\"";
+    }
+    matchingInputs.add("arguments", matcherArguments);
+    if (plan.mode == MatchingMode::PairList) {
+        std::vector<std::string> pairs;
+        pairs.reserve(plan.pairs.size());
+        for (const auto& pair : plan.pairs) {
+            pairs.push_back(std::to_string(pair.first) + " " + std::to_string(pair.second));
+        }
+        matchingInputs.add("pairs", StageInputs::digestOf(pairs));
+    }
     
-    int result = runCommand(cmdStream.str(), logCallback);
+    StageInputs mapperInputs;
+    mapperInputs.add("matches", matchingInputs.digest());
+    mapperInputs.add("arguments", mapperOptions);
+    modelDigest = mapperInputs.digest();
+    
+    // COLMAP keeps existing matches in the database, so different matching
+    // settings need a fresh database, i.e. feature extraction again
+    const std::string featureStage = job.stagePrefix + " features";
+    const std::string matchingStage = job.stagePrefix + " matching";
+    const std::string mapperStage = job.stagePrefix + " mapper";
+    
+    // The database was removed after the model was built: while the model is
+    // current nothing needs it
+    std::error_code ec;
+    if (!fs::exists(job.databasePath, ec) && manifest.isCurrent(mapperStage, mapperInputs) &&
+        fs::exists(job.sparseDir / "0", ec)) {
+        logCallback("✓ Model is up to date (database removed after it was built) - skipping features, matching and mapper");
+        for (const auto& stage : {featureStage, matchingStage, mapperStage}) {
+            progress.skip(stage);
+        }
+        return true;
+    }
+    const bool freshDatabase = manifest.isCurrent(featureStage, featureInputs) &&
+                               !manifest.isCurrent(matchingStage, matchingInputs);
     
-    if (result != 0) {
-        logCallback("ERROR: FFmpeg failed with exit code " + std::to_string(result));
-        return false;
+    // Step 1: Feature extraction
+    logCallback("Step 1/4: Feature Extraction...");
+    std::string cmd;
+    bool featuresExtracted = false;
+    if (!upToDate(featureStage, featureInputs, job.databasePath,
+                  freshDatabase ? "matching changed, which needs a fresh database" : nullptr)) {
+        manifest.begin(matchingStage);
+        featuresExtracted = true;
+        fs::remove(job.databasePath, ec);
+        cmd = "\"" + colmapPath + "\" feature_extractor --database_path \"" + 
+              fixedDbPath + "\" --image_path \"" + fixedFramesDir + "\" " + featureArguments;
+        if (!job.imageListPath.empty()) {
+            std::ofstream list(job.imageListPath);
+            for (const auto& frame : frames) {
+                list << frame.name << "\n";
+            }
+            if (!list.flush()) {
+                logCallback("ERROR: Could not write image list: " + job.imageListPath.string());
+                return false;
+            }
+            cmd += " --image_list_path \"" + fixed(job.imageListPath) + "\"";
+        }
+        logCallback("DEBUG: Full command: " + cmd);
+        if (runTimed(featureStage, cmd, ProgressSource::ColmapFeatures, "images", {job.databasePath}) != 0) {
+            logCallback("ERROR: Feature extraction failed");
+            return false;
+        }
+        manifest.complete(featureStage, featureInputs);
     }
     
-    // Count extracted frames
-    int frameCount = 0;
-    for (const auto& entry : fs::directory_iterator(videoOutputDir)) {
-        if (entry.path().extension() == ".jpg") {
-            frameCount++;
+    // Step 2: Feature matching
+    logCallback("Step 2/4: Feature Matching...");
+    logCallback(std::string("Matching strategy: ") + matchingModeName(plan.mode) + " (" + plan.reason + ")");
+    if (!upToDate(matchingStage, matchingInputs, job.databasePath, featuresExtracted ? "new database" : nullptr)) {
+        cmd = "\"" + colmapPath + "\" " + plan.matcher + " --database_path \"" + fixedDbPath + "\"";
+        if (plan.mode == MatchingMode::PairList) {
+            std::string pairsPath = fixed(job.databasePath.parent_path() / "match_pairs.txt");
+            if (!writePairList(pairsPath, frames, plan.pairs)) {
+                logCallback("ERROR: Could not write pair list: " + pairsPath);
+                return false;
+            }
+            const size_t exhaustivePairs = frames.size() * (frames.size() - 1) / 2;
+            logCallback("Matching " + std::to_string(plan.pairs.size()) + " image pairs (exhaustive: " +
+                       std::to_string(exhaustivePairs) + ")");
+            cmd += " --match_list_path \"" + pairsPath + "\"";
         }
+        cmd += matcherArguments;
+        // exhaustive_matcher and matches_importer count blocks of pairs, the others images
+        const bool blocks = plan.mode == MatchingMode::Exhaustive || plan.mode == MatchingMode::PairList;
+        if (runTimed(matchingStage, cmd, ProgressSource::ColmapMatching, blocks ? "blocks" : "images") != 0) {
+            logCallback("ERROR: Feature matching failed");
+            return false;
+        }
+        manifest.complete(matchingStage, matchingInputs);
     }
     
-    logCallback("Extracted " + std::to_string(frameCount) + " frames to: " + videoOutputDir.string());
+    // Step 3: Sparse reconstruction
+    logCallback("Step 3/4: Sparse Reconstruction...");
+    if (!upToDate(mapperStage, mapperInputs, job.sparseDir / "0")) {
+        // Models of an earlier run would be mixed up with the new ones
+        try {
+            if (!job.staleDir.empty()) {
+                fs::remove_all(job.staleDir);
+            }
+            fs::remove_all(job.sparseDir);
+            fs::create_directories(job.sparseDir);
+        } catch (const std::exception& e) {
+            logCallback("ERROR clearing " + job.sparseDir.string() + ": " + e.what());
+            return false;
+        }
+        cmd = "\"" + colmapPath + "\" mapper --database_path \"" + fixedDbPath + 
+              "\" --image_path \"" + fixedFramesDir + "\" --output_path \"" + fixed(job.sparseDir) + "\"";
+        if (!job.imageListPath.empty()) {
+            cmd += " --image_list_path \"" + fixed(job.imageListPath) + "\"";
+        }
+        if (!mapperOptions.empty()) {
+            cmd += " " + mapperOptions;
+        }
+        if (runTimed(mapperStage, cmd, ProgressSource::ColmapMapper, "images", {job.sparseDir}) != 0) {
+            logCallback("ERROR: Sparse reconstruction failed");
+            return false;
+        }
+        std::set<std::string> frameNames;
+        for (const auto& frame : frames) {
+            frameNames.insert(frame.name);
+        }
+        if (!checkColmapModel(job.sparseDir / "0", fs::path(), frameNames, logCallback)) {
+            logCallback("ERROR: Sparse reconstruction produced no usable model");
+            return false;
+        }
+        manifest.complete(mapperStage, mapperInputs);
+    }
+    if (job.removeDatabase) {
+        removeSparseDatabase(job, logCallback);
+    }
+    return true;
+}
+
+// Partitioned reconstruction: every tile is a SparseJob of its own in
+// tiles/tile_NN/ (database, image list, sparse/), tileJobs of them at a
+// time, and the tile models are merged into sparse/0.
+bool runColmapTiles(const std::string& colmapPath, const std::string& framesDir, const fs::path& projectDir,
+                    const std::vector<FrameRecord>& frames, const std::vector<Tile>& tiles,
+                    const MatchingOptions& matching, const std::string& mapperOptions, int tileJobs,
+                    bool removeDatabases, StageManifest& manifest, const ProcessOutputOptions& output, RunReport& report,
+                    ProgressModel& progress, LogCallback logCallback, std::string& modelDigest) {
+    const fs::path tilesDir = projectDir / "tiles";
+    const fs::path sparseDir = projectDir / "sparse";
+    auto tileName = [](size_t t) {
+        const std::string number = std::to_string(t + 1);
+        return "tile_" + std::string(number.size() < 2 ? 2 - number.size() : 0, '0') + number;
+    };
+    
+    // sparse/0 is the merged model from now on, and the database of a single
+    // model and tiles of an earlier, larger layout are gone
+    for (const char* stage : {"colmap features", "colmap matching", "colmap mapper"}) {
+        manifest.remove(stage);
+        progress.unplan(stage);
+    }
+    std::error_code ec;
+    if (fs::exists(projectDir / "database", ec)) {
+        fs::remove_all(projectDir / "database", ec);
+        logCallback("Removed the database of an earlier single-model reconstruction");
+    }
+    for (const auto& stage : manifest.stages("colmap tile ")) {
+        const size_t number = std::strtoul(stage.c_str() + std::strlen("colmap tile "), nullptr, 10);
+        if (number == 0 || number > tiles.size()) {
+            manifest.remove(stage);
+        }
+    }
+    std::vector<fs::path> staleTiles;
+    for (fs::directory_iterator it(tilesDir, ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        if (name.rfind("tile_", 0) == 0 && std::strtoul(name.c_str() + 5, nullptr, 10) > tiles.size()) {
+            staleTiles.push_back(it->path());
+        }
+    }
+    for (const auto& dir : staleTiles) {
+        fs::remove_all(dir, ec);
+    }
     
-    // Try to embed GPS data from SRT into extracted frames using bundled exiftool
-    try {
-        fs::path srtPathUpper = videoFilePath;
-        srtPathUpper.replace_extension(".SRT");
-        fs::path srtPathLower = videoFilePath;
-        srtPathLower.replace_extension(".srt");
-        
-        fs::path srtPath;
-        if (fs::exists(srtPathUpper)) {
-            srtPath = srtPathUpper;
-        } else if (fs::exists(srtPathLower)) {
-            srtPath = srtPathLower;
+    std::vector<SparseJob> jobs(tiles.size());
+    for (size_t t = 0; t < tiles.size(); t++) {
+        SparseJob& job = jobs[t];
+        const fs::path dir = tilesDir / tileName(t);
+        job.stagePrefix = "colmap tile " + std::to_string(t + 1);
+        job.databasePath = dir / "database.db";
+        job.sparseDir = dir / "sparse";
+        job.imageListPath = dir / "image_list.txt";
+        job.removeDatabase = removeDatabases;
+        for (size_t index : tiles[t].frames) {
+            job.frames.push_back(frames[index]);
         }
-        
-        if (!srtPath.empty()) {
-            // SRT file exists - check for bundled exiftool
-            std::string exeDir = getExecutableDir();
-            fs::path exiftoolPath = fs::path(exeDir) / "vendor" / "exiftool" / "exiftool.exe";
-            
-            if (fs::exists(exiftoolPath)) {
-                logCallback("Found SRT file: " + srtPath.filename().string());
-                logCallback("Parsing GPS data...");
-                
-                // Parse SRT file
-                std::vector<GPSData> gpsFrames = parseSRT(srtPath.string());
-                
-                if (!gpsFrames.empty()) {
-                    logCallback("Parsed " + std::to_string(gpsFrames.size()) + " GPS entries from SRT");
-                    logCallback("Embedding GPS EXIF data into frames using exiftool...");
-                    
-                    // Get list of extracted frames
-                    std::vector<fs::path> frameFiles;
-                    for (const auto& entry : fs::directory_iterator(videoOutputDir)) {
-                        if (entry.path().extension() == ".jpg") {
-                            frameFiles.push_back(entry.path());
-                        }
-                    }
-                    
-                    std::sort(frameFiles.begin(), frameFiles.end());
-                    
-                    int embedded = 0;
-                    for (size_t i = 0; i < frameFiles.size(); i++) {
-                        double timestamp = i / fps;
-                        GPSData gps = getGPSForTimestamp(gpsFrames, timestamp);
-                        
-                        if (gps.valid) {
-                            std::string cmd = generateExiftoolCommand(
-                                exiftoolPath.string(),
-                                frameFiles[i].string(),
-                                gps.latitude,
-                                gps.longitude,
-                                gps.altitude
-                            );
-                            
-                            if (runCommandHidden(cmd, [](const std::string&){}) == 0) {
-                                embedded++;
-                            }
-                        }
-                    }
-                    
-                    logCallback("✅ Embedded GPS data into " + std::to_string(embedded) + "/" + 
-                               std::to_string(frameFiles.size()) + " frames");
-                } else {
-                    logCallback("⚠ WARNING: No GPS data found in SRT file");
+        job.plan = planMatching(job.frames, matching);
+        planSparseProgress(progress, job.stagePrefix, job.frames.size(), job.plan.mode);
+    }
+    const std::string mergeStage = "colmap merge";
+    progress.plan(mergeStage, 0.01 * frames.size());
+    
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t parallel = tileJobs > 0 ? static_cast<size_t>(tileJobs) : std::max<size_t>(1, cores / 4);
+    parallel = std::min(parallel, tiles.size());
+    logCallback("Reconstructing " + std::to_string(tiles.size()) + " tiles, " + std::to_string(parallel) +
+               " at a time:");
+    for (size_t t = 0; t < tiles.size(); t++) {
+        logCallback("  " + tileName(t) + ": " + std::to_string(tiles[t].frames.size()) + " frames (" +
+                   std::to_string(tiles[t].core) + " + " + std::to_string(tiles[t].frames.size() - tiles[t].core) +
+                   " overlap)");
+    }
+    
+    std::vector<std::string> digests(tiles.size());
+    std::vector<char> succeeded(tiles.size(), 0);
+    std::mutex logMutex;
+    {
+        ThreadPool pool(parallel);
+        std::vector<std::future<void>> futures;
+        for (size_t t = 0; t < tiles.size(); t++) {
+            futures.push_back(pool.submit([&, t]() {
+                if (isCancelled(output)) {
+                    return;
                 }
-            } else {
-                logCallback("⚠ No exiftool found - skipping GPS embedding");
-                logCallback("  To enable GPS embedding, exiftool should be at:");
-                logCallback("  " + exiftoolPath.string());
-            }
+                const std::string label = tileName(t) + " (" + std::to_string(jobs[t].frames.size()) + " frames)";
+                {
+                    std::lock_guard<std::mutex> lock(logMutex);
+                    logCallback("Started " + label);
+                }
+                BufferedLog jobLog(logCallback, logMutex, "    ");
+                succeeded[t] = runSparseReconstruction(colmapPath, framesDir, jobs[t], mapperOptions, manifest, output,
+                                                       report, progress, jobLog.callback(), digests[t]);
+                jobLog.flush((succeeded[t] ? "Finished " : "FAILED ") + label);
+            }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+    }
+    if (isCancelled(output)) {
+        return false;
+    }
+    
+    std::vector<fs::path> models;
+    StageInputs mergeInputs;
+    for (size_t t = 0; t < tiles.size(); t++) {
+        if (succeeded[t]) {
+            models.push_back(jobs[t].sparseDir / "0");
+            mergeInputs.add(tileName(t), digests[t]);
         } else {
-            logCallback("ℹ No SRT file found for this video - skipping GPS embedding");
+            for (const char* step : {" features", " matching", " mapper"}) {
+                progress.unplan(jobs[t].stagePrefix + step);
+            }
+            logCallback("⚠ WARNING: " + tileName(t) + " failed - its frames are only in the model where other tiles overlap it");
         }
-    } catch (const std::exception& e) {
-        logCallback("⚠ WARNING: GPS embedding failed: " + std::string(e.what()));
+    }
+    if (models.empty()) {
+        logCallback("ERROR: No tile produced a model");
+        return false;
     }
     
-    return frameCount > 0;
+    logCallback("Merging the tile models...");
+    modelDigest = mergeInputs.digest();
+    if (stageUpToDate(manifest, progress, logCallback, mergeStage, mergeInputs, sparseDir / "0")) {
+        return true;
+    }
+    fs::remove_all(projectDir / "sparse_unaligned", ec);
+    fs::remove_all(sparseDir, ec);
+    StageTimer timer(report, mergeStage);
+    progress.start(mergeStage, 0.0, "");
+    ModelMergeResult result;
+    std::string error;
+    if (!mergeColmapModels(models, sparseDir / "0", ModelMergeOptions(), result, &error)) {
+        logCallback("ERROR: Merging the tile models failed: " + error);
+        return false;
+    }
+    timer.finish(result.images, "images");
+    progress.finish(mergeStage);
+    for (const auto& note : result.notes) {
+        logCallback("  " + note);
+    }
+    if (result.merged < result.models) {
+        logCallback("⚠ WARNING: " + std::to_string(result.models - result.merged) + " of " +
+                   std::to_string(result.models) + " tile models could not be merged - their frames are missing "
+                   "from sparse/0 unless an overlapping tile has them");
+    }
+    std::set<std::string> frameNames;
+    for (const auto& frame : frames) {
+        frameNames.insert(frame.name);
+    }
+    if (!checkColmapModel(sparseDir / "0", fs::path(), frameNames, logCallback)) {
+        return false;
+    }
+    manifest.complete(mergeStage, mergeInputs);
+    return true;
 }
 
-bool runColmap(const std::string& framesDir, const std::string& outputDir, 
-              LogCallback logCallback) {
-    std::string exeDir = getExecutableDir();
-    fs::path colmapPath = fs::path(exeDir) / "vendor" / "colmap" / "bin" / "colmap.bat";
-    
+// frames: the extracted frames grouped by video in frame order (may be empty,
+// then the images in framesDir are used without GPS). Steps recorded as
+// complete in the manifest with the same inputs are skipped.
+bool runColmap(const std::string& colmapPath, const std::string& framesDir, const std::string& outputDir, 
+              std::vector<FrameRecord> frames, const MatchingOptions& matching, const std::string& mapperOptions,
+              bool geoRegistration, const GeoRegistrationOptions& geo, const PartitionOptions& partition, int tileJobs,
+              bool removeDatabases, StageManifest& manifest, const ProcessOutputOptions& output, RunReport& report,
+              ProgressModel& progress, LogCallback logCallback) {
     if (!fs::exists(colmapPath)) {
         logCallback("ERROR: COLMAP not found");
         return false;
@@ -285,7 +1077,7 @@ bool runColmap(const std::string& framesDir, const std::string& outputDir,
         logCallback("");
     }
     
-    logCallback("Using COLMAP: " + colmapPath.string());
+    logCallback("Using COLMAP: " + colmapPath);
     logCallback("Input frames: " + framesDir);
     logCallback("Output: " + outputDir);
     
@@ -299,9 +1091,10 @@ bool runColmap(const std::string& framesDir, const std::string& outputDir,
     fs::path dbPath = projectDir / "database" / "database.db";
     fs::path sparseDir = projectDir / "sparse";
     fs::path imagesDir = projectDir / "images";
+    // The mapper's model as it was before geo-registration replaced sparse/0
+    fs::path unalignedDir = projectDir / "sparse_unaligned" / "0";
     
     try {
-        fs::create_directories(dbPath.parent_path());
         fs::create_directories(sparseDir);
         fs::create_directories(imagesDir);
     }
@@ -310,50 +1103,179 @@ bool runColmap(const std::string& framesDir, const std::string& outputDir,
         return false;
     }
     
-    // Convert database and sparse paths to forward slashes
-    std::string fixedDbPath = dbPath.string();
-    std::string fixedSparseDir = sparseDir.string();
-    std::replace(fixedDbPath.begin(), fixedDbPath.end(), '\\', '/');
-    std::replace(fixedSparseDir.begin(), fixedSparseDir.end(), '\\', '/');
-    
-    // Step 1: Feature extraction
-    logCallback("Step 1/4: Feature Extraction...");
-    std::string cmd = "\"\"" + colmapPath.string() + "\" feature_extractor --database_path \"" + 
-                     fixedDbPath + "\" --image_path \"" + fixedFramesDir + 
-                     "\" --ImageReader.single_camera 1\"";
-    logCallback("DEBUG: Full command: " + cmd);
-    if (runCommand(cmd, logCallback) != 0) {
-        logCallback("ERROR: Feature extraction failed");
-        return false;
-    }
-    
-    // Step 2: Feature matching
-    logCallback("Step 2/4: Feature Matching...");
-    cmd = "\"\"" + colmapPath.string() + "\" exhaustive_matcher --database_path \"" + 
-          fixedDbPath + "\"\"";
-    if (runCommand(cmd, logCallback) != 0) {
-        logCallback("ERROR: Feature matching failed");
-        return false;
+    if (frames.empty()) {
+        for (const auto& entry : fs::directory_iterator(framesDir)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".jpg") {
+                FrameRecord frame;
+                frame.name = entry.path().filename().string();
+                frames.push_back(std::move(frame));
+            }
+        }
+        std::sort(frames.begin(), frames.end(),
+                  [](const FrameRecord& a, const FrameRecord& b) { return a.name < b.name; });
     }
     
-    // Step 3: Sparse reconstruction
-    logCallback("Step 3/4: Sparse Reconstruction...");
-    cmd = "\"\"" + colmapPath.string() + "\" mapper --database_path \"" + fixedDbPath + 
-          "\" --image_path \"" + fixedFramesDir + "\" --output_path \"" + fixedSparseDir + "\"\"";
-    if (runCommand(cmd, logCallback) != 0) {
-        logCallback("ERROR: Sparse reconstruction failed");
-        return false;
+    auto upToDate = [&](const std::string& stage, const StageInputs& inputs, const fs::path& result,
+                        const char* forceReason = nullptr) {
+        return stageUpToDate(manifest, progress, logCallback, stage, inputs, result, forceReason);
+    };
+    auto runTimed = [&](const std::string& stage, const std::string& command, ProgressSource source,
+                        const std::string& unit, const std::vector<fs::path>& partialOutputs = {}) {
+        return runColmapStep(stage, command, source, unit, frames.size(), output, report, progress, logCallback,
+                             partialOutputs);
+    };
+    
+    // Steps 1-3: features, matching and mapper, for all frames at once or
+    // per tile followed by a merge
+    std::string modelDigest;
+    const std::vector<Tile> tiles = partition.maxFrames > 0 ? partitionFrames(frames, partition) : std::vector<Tile>();
+    if (geoRegistration) {
+        progress.plan("colmap geo registration", 0.01 * frames.size());
+    }
+    if (tiles.size() > 1) {
+        char summary[160];
+        snprintf(summary, sizeof(summary), "%zu frames in %zu tiles of up to %zu frames, %.0f m overlap",
+                 frames.size(), tiles.size(), partition.maxFrames, partition.overlap);
+        logCallback(std::string("Partitioned reconstruction: ") + summary);
+        progress.plan("colmap undistort", 0.1 * frames.size());
+        if (!runColmapTiles(colmapPath, framesDir, projectDir, frames, tiles, matching, mapperOptions, tileJobs,
+                            removeDatabases, manifest, output, report, progress, logCallback, modelDigest)) {
+            return false;
+        }
+    } else {
+        if (tiles.size() == 1 && frames.size() > partition.maxFrames) {
+            logCallback("ℹ The frames were taken within " + std::to_string(static_cast<int>(partition.overlap)) +
+                        " m of each other, too close to split into tiles - reconstructing them as one model");
+        }
+        // One model replaces the tiles and merged model of a partitioned run
+        std::error_code ec;
+        const auto tileStages = manifest.stages("colmap tile ");
+        if (!tileStages.empty() || fs::exists(projectDir / "tiles", ec)) {
+            for (const auto& stage : tileStages) {
+                manifest.remove(stage);
+            }
+            manifest.remove("colmap merge");
+            fs::remove_all(projectDir / "tiles", ec);
+            logCallback("Removed the tiles of an earlier partitioned reconstruction");
+        }
+        SparseJob job;
+        job.stagePrefix = "colmap";
+        job.databasePath = dbPath;
+        job.sparseDir = sparseDir;
+        job.staleDir = unalignedDir.parent_path();
+        job.removeDatabase = removeDatabases;
+        job.frames = frames;
+        job.plan = planMatching(frames, matching);
+        planReconstructionProgress(progress, ReconMethod::COLMAP, frames.size(), job.plan.mode);
+        if (!runSparseReconstruction(colmapPath, framesDir, job, mapperOptions, manifest, output, report, progress,
+                                     logCallback, modelDigest)) {
+            return false;
+        }
+    }
+    
+    // Geo-registration: sparse/0 in metres, east-north-up around the flight,
+    // fitted to the frames' GPS positions
+    std::string cmd;
+    const std::string geoStage = "colmap geo registration";
+    std::error_code ec;
+    if (geoRegistration) {
+        logCallback("Geo-registration to GPS...");
+        std::map<std::string, GPSData> positions;
+        std::vector<std::string> positionLines;
+        for (const auto& frame : frames) {
+            if (frame.hasGps) {
+                GPSData& gps = positions[frame.name];
+                gps.latitude = frame.latitude;
+                gps.longitude = frame.longitude;
+                gps.altitude = frame.altitude;
+                gps.valid = true;
+                char line[160];
+                snprintf(line, sizeof(line), "%s %.8f %.8f %.3f", frame.name.c_str(), frame.latitude,
+                         frame.longitude, frame.altitude);
+                positionLines.push_back(line);
+            }
+        }
+        StageInputs geoInputs;
+        geoInputs.add("model", modelDigest);
+        geoInputs.add("positions", StageInputs::digestOf(positionLines));
+        geoInputs.add("max error", geo.maxError);
+        
+        if (positions.empty()) {
+            logCallback("ℹ No GPS positions for the frames - model left in COLMAP's arbitrary frame");
+            progress.unplan(geoStage);
+        } else if (upToDate(geoStage, geoInputs, sparseDir / "0" / "geo_registration.txt")) {
+            modelDigest = geoInputs.digest();
+        } else {
+            // Always fit the mapper's own model, never an already aligned one
+            if (!fs::exists(unalignedDir, ec)) {
+                fs::create_directories(unalignedDir.parent_path(), ec);
+                fs::rename(sparseDir / "0", unalignedDir, ec);
+                if (ec) {
+                    logCallback("ERROR: Could not keep the unaligned model: " + ec.message());
+                    return false;
+                }
+            }
+            StageTimer timer(report, geoStage);
+            progress.start(geoStage, 0.0, "");
+            GeoRegistrationResult result;
+            std::string error;
+            fs::remove_all(sparseDir / "0", ec);
+            if (geoRegisterColmapModel(unalignedDir, sparseDir / "0", positions, geo, result, &error) &&
+                writeGeoRegistration(sparseDir / "0" / "geo_registration.txt", result)) {
+                timer.finish(result.registered, "images");
+                progress.finish(geoStage);
+                char summary[200];
+                snprintf(summary, sizeof(summary),
+                         "%zu of %zu cameras within %.1f m of their GPS position (RMS %.2f m), scale %.4g m/unit",
+                         result.inliers, result.matched, geo.maxError, result.rmsError, result.transform.scale);
+                logCallback(std::string("✅ Model geo-registered: ") + summary);
+                logCallback("  Transform and origin: " + (sparseDir / "0" / "geo_registration.txt").string());
+                manifest.complete(geoStage, geoInputs);
+                modelDigest = geoInputs.digest();
+            } else {
+                // Put the mapper's model back; the run goes on with it
+                fs::remove_all(sparseDir / "0", ec);
+                fs::rename(unalignedDir, sparseDir / "0", ec);
+                fs::remove_all(unalignedDir.parent_path(), ec);
+                if (!error.empty()) {
+                    logCallback("ERROR: Geo-registration failed: " + error);
+                    return false;
+                }
+                logCallback("⚠ WARNING: Model not geo-registered: " + result.reason);
+                progress.skip(geoStage);
+            }
+        }
+    } else if (fs::exists(unalignedDir, ec)) {
+        // Turned off since the last run: back to the mapper's frame
+        fs::remove_all(sparseDir / "0", ec);
+        fs::rename(unalignedDir, sparseDir / "0", ec);
+        fs::remove_all(unalignedDir.parent_path(), ec);
+        manifest.remove(geoStage);
+        logCallback("Geo-registration is off - restored the unaligned model");
     }
     
     // Step 4: Image undistortion (outputs to images/ directory)
     logCallback("Step 4/4: Image Undistortion...");
-    std::string fixedSparse0 = (sparseDir / "0").string();
-    std::replace(fixedSparse0.begin(), fixedSparse0.end(), '\\', '/');
-    cmd = "\"\"" + colmapPath.string() + "\" image_undistorter --image_path \"" + fixedFramesDir + 
-          "\" --input_path \"" + fixedSparse0 + 
-          "\" --output_path \"" + fixedOutputDir + "\" --output_type COLMAP\"";
-    if (runCommand(cmd, logCallback) != 0) {
-        logCallback("WARNING: Image undistortion failed, but sparse reconstruction succeeded");
+    StageInputs undistortInputs;
+    undistortInputs.add("model", modelDigest);
+    if (!upToDate("colmap undistort", undistortInputs, projectDir / "sparse" / "cameras.bin")) {
+        std::string fixedSparse0 = (sparseDir / "0").string();
+        std::replace(fixedSparse0.begin(), fixedSparse0.end(), '\\', '/');
+        cmd = "\"" + colmapPath + "\" image_undistorter --image_path \"" + fixedFramesDir + 
+              "\" --input_path \"" + fixedSparse0 + 
+              "\" --output_path \"" + fixedOutputDir + "\" --output_type COLMAP";
+        // The undistorter writes its model next to sparse/0, which has to stay
+        const std::vector<fs::path> partial = {projectDir / "images", projectDir / "stereo",
+                                               sparseDir / "cameras.bin", sparseDir / "images.bin",
+                                               sparseDir / "points3D.bin"};
+        if (runTimed("colmap undistort", cmd, ProgressSource::ColmapUndistort, "images", partial) != 0) {
+            if (isCancelled(output)) {
+                return false;
+            }
+            logCallback("WARNING: Image undistortion failed, but sparse reconstruction succeeded");
+        } else {
+            manifest.complete("colmap undistort", undistortInputs);
+        }
     }
     
     logCallback("COLMAP reconstruction complete!");
@@ -364,8 +1286,41 @@ bool runColmap(const std::string& framesDir, const std::string& outputDir,
     return true;
 }
 
-bool runMetashape(const std::string& framesDir, const std::string& outputDir, 
-                 const std::string& metashapeExe, LogCallback logCallback) {
+// Logs how a set of images was placed through the frame store
+void logPlacement(const std::string& what, size_t linked, size_t reflinked, size_t copied, size_t failed,
+                  LogCallback logCallback) {
+    std::string summary = std::to_string(linked) + " linked";
+    if (reflinked > 0) summary += ", " + std::to_string(reflinked) + " reflinked";
+    if (copied > 0) summary += ", " + std::to_string(copied) + " copied (no links on this file system)";
+    logCallback((failed > 0 ? "⚠ " : "✅ ") + what + ": " + summary +
+               (failed > 0 ? ", " + std::to_string(failed) + " failed" : std::string()));
+}
+
+// Put every frame into targetDir under its own name through the store
+bool placeFrames(FrameStore& store, const fs::path& framesDir, const std::vector<std::string>& names,
+                 const fs::path& targetDir, const std::string& what, LogCallback logCallback) {
+    std::vector<FrameWork> work;
+    work.reserve(names.size());
+    for (const auto& name : names) {
+        work.push_back({name, {framesDir / name}, GPSData()});
+    }
+    const FrameStore::Stats before = store.stats();
+    FrameStage stage("place");
+    stage.then("link", placeOperation(store, targetDir));
+    const FrameStageResult result = stage.run(std::move(work));
+    const FrameStore::Stats after = store.stats();
+    
+    logPlacement(what, after.linked - before.linked, after.reflinked - before.reflinked, after.copied - before.copied,
+                 result.failed, logCallback);
+    if (!result.errors.empty()) {
+        logCallback("⚠ WARNING: " + result.errors.front().message);
+    }
+    return result.ok();
+}
+
+bool runMetashape(const std::string& framesDir, const std::string& outputDir, size_t frameCount,
+                 const std::string& metashapeExe, const ProcessOutputOptions& output, RunReport& report,
+                 ProgressModel& progress, FrameStore& store, LogCallback logCallback) {
     if (metashapeExe.empty() || !fs::exists(metashapeExe)) {
         logCallback("ERROR: Metashape executable not found: " + metashapeExe);
         return false;
@@ -387,6 +1342,8 @@ bool runMetashape(const std::string& framesDir, const std::string& outputDir,
         logCallback("ERROR creating output directories: " + std::string(e.what()));
         return false;
     }
+    // A model left by an earlier run must not pass for this run's export
+    removeColmapModel(sparseDir);
     
     // Create Metashape Python script that exports to COLMAP format
     fs::path scriptPath = outputPath / "metashape_process.py";
@@ -427,12 +1384,7 @@ bool runMetashape(const std::string& framesDir, const std::string& outputDir,
     script << "    except Exception as e:\n";
     script << "        print(f\"  ERROR: COLMAP export failed: {e}\")\n";
     script << "        raise\n\n";
-    script << "    # Copy images to output\n";
-    script << "    import shutil\n";
-    script << "    images_out = Path(r\"" << imagesDir.string() << "\")\n";
-    script << "    for img in image_files:\n";
-    script << "        shutil.copy2(img, images_out / Path(img).name)\n";
-    script << "    print(f\"Copied {len(image_files)} images to output\")\n\n";
+    // images/ is filled from the frame store afterwards (links, no copies)
     script << "    project_path = Path(r\"" << outputDir << "\") / \"metashape_project.psx\"\n";
     script << "    doc.save(str(project_path))\n";
     script << "    print(\"Metashape processing complete!\")\n";
@@ -450,10 +1402,19 @@ bool runMetashape(const std::string& framesDir, const std::string& outputDir,
     fs::path logPath = outputPath / "metashape_log.txt";
     
     // Redirect output to log file
-    std::string cmd = "\"\"" + metashapeExe + "\" -r \"" + scriptPath.string() + "\" > \"" + 
-                     logPath.string() + "\" 2>&1\"";
-    
-    if (runCommand(cmd, logCallback) != 0) {
+    std::string cmd = "\"" + metashapeExe + "\" -r \"" + scriptPath.string() + "\" > \"" + 
+                     logPath.string() + "\" 2>&1";
+    
+    StageTimer timer(report, "metashape");
+    progress.start("metashape", 0.0, "");
+    const std::vector<fs::path> partial = {sparseDir, outputPath / "metashape_project.psx",
+                                           outputPath / "metashape_project.files"};
+    int result = runCommand(cmd, output, logCallback, report, "metashape", partial);
+    timer.finish(frameCount, "images");
+    if (result == 0) {
+        progress.finish("metashape");
+    }
+    if (result != 0) {
         logCallback("ERROR: Metashape processing failed");
         logCallback("Check log file for details: " + logPath.string());
         
@@ -477,6 +1438,26 @@ bool runMetashape(const std::string& framesDir, const std::string& outputDir,
         return false;
     }
     
+    // Metashape does not rewrite the pixels: images/ links the frames
+    std::vector<std::string> names;
+    for (const auto& entry : fs::directory_iterator(framesDir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".jpg") {
+            names.push_back(entry.path().filename().string());
+        }
+    }
+    StageTimer placeTimer(report, "images");
+    if (!placeFrames(store, framesDir, names, imagesDir, "Images for " + imagesDir.string(), logCallback)) {
+        logCallback("ERROR: Could not fill " + imagesDir.string());
+        return false;
+    }
+    placeTimer.finish(names.size(), "images");
+
+    // Metashape exports text; trainers load the binary model much faster
+    if (!checkColmapModel(sparseDir, sparseDir, std::set<std::string>(names.begin(), names.end()), logCallback)) {
+        logCallback("ERROR: Metashape's COLMAP export is unusable: " + sparseDir.string());
+        return false;
+    }
+    
     logCallback("Metashape reconstruction complete!");
     logCallback("Output structure:");
     logCallback("  " + imagesDir.string() + " - Images");
@@ -485,8 +1466,9 @@ bool runMetashape(const std::string& framesDir, const std::string& outputDir,
     return true;
 }
 
-bool runRealityScan(const std::string& framesDir, const std::string& outputDir, 
-                   const std::string& realityscanExe, LogCallback logCallback) {
+bool runRealityScan(const std::string& framesDir, const std::string& outputDir, size_t frameCount,
+                   const std::string& realityscanExe, const ProcessOutputOptions& output, RunReport& report,
+                   ProgressModel& progress, LogCallback logCallback) {
     if (realityscanExe.empty() || !fs::exists(realityscanExe)) {
         logCallback("ERROR: RealityScan executable not found: " + realityscanExe);
         return false;
@@ -513,10 +1495,13 @@ bool runRealityScan(const std::string& framesDir, const std::string& outputDir,
         return false;
     }
     
+    // A model left by an earlier run must not pass for this run's export
+    removeColmapModel(sparseDir);
+    
     logCallback("Running RealityScan (this may take a while)...");
     
     // Build RealityScan CLI command - use working commands
-    std::string cmd = "\"\"" + realityscanExe + "\"" +
+    std::string cmd = "\"" + realityscanExe + "\"" +
                      " -headless" +
                      " -newScene" +
                      " -addFolder \"" + framesDir + "\"" +
@@ -526,11 +1511,19 @@ bool runRealityScan(const std::string& framesDir, const std::string& outputDir,
                      " -exportRegistration \"" + registrationFile.string() + "\"" +
                      " -exportUndistortedImages \"" + imagesDir.string() + "\"" +
                      " -save \"" + projectFile.string() + "\"" +
-                     " -quit\"";
+                     " -quit";
     
     logCallback("Command: " + cmd);
     
-    if (runCommand(cmd, logCallback) != 0) {
+    StageTimer timer(report, "realityscan");
+    progress.start("realityscan", 0.0, "");
+    int result = runCommand(cmd, output, logCallback, report, "realityscan",
+                            {sparse0Dir, registrationFile, imagesDir, projectFile});
+    timer.finish(frameCount, "images");
+    if (result == 0) {
+        progress.finish("realityscan");
+    }
+    if (result != 0) {
         logCallback("ERROR: RealityScan processing failed");
         return false;
     }
@@ -540,11 +1533,6 @@ bool runRealityScan(const std::string& framesDir, const std::string& outputDir,
     logCallback("");
     logCallback("Checking exports...");
     
-    // Check for all COLMAP files created by exportRegistration
-    fs::path camerasFile = sparseDir / "cameras.txt";
-    fs::path imagesFile = sparseDir / "Images.txt";
-    fs::path pointsFile = sparseDir / "points3D.txt";
-    
     // Verify expected outputs were created
     bool success = true;
     if (fs::exists(registrationFile)) {
@@ -554,71 +1542,37 @@ bool runRealityScan(const std::string& framesDir, const std::string& outputDir,
         success = false;
     }
     
-    if (fs::exists(camerasFile)) {
-        logCallback("✅ cameras.txt exported successfully");
-    } else {
-        logCallback("⚠ Warning: cameras.txt was not created");
-    }
-    
-    if (fs::exists(imagesFile)) {
-        logCallback("✅ Images.txt exported successfully");
-    } else {
-        logCallback("⚠ Warning: Images.txt was not created");
-    }
-    
-    if (fs::exists(pointsFile)) {
-        logCallback("✅ points3D.txt exported successfully");
-    } else {
-        logCallback("⚠ Warning: points3D.txt was not created");
+    std::set<std::string> imageNames;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(imagesDir, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() != ".txt") {
+            imageNames.insert(entry.path().filename().string());
+        }
     }
-    
-    if (fs::exists(imagesDir) && !fs::is_empty(imagesDir)) {
-        size_t imageCount = std::distance(fs::directory_iterator(imagesDir), fs::directory_iterator{});
-        logCallback("✅ Exported " + std::to_string(imageCount) + " undistorted images");
+    if (!imageNames.empty()) {
+        logCallback("✅ Exported " + std::to_string(imageNames.size()) + " undistorted images");
     } else {
         logCallback("❌ Warning: No undistorted images were exported");
         success = false;
     }
     
-    // Copy all COLMAP files to images/ and sparse/0/ folders
+    // exportRegistration writes a text model (cameras.txt, Images.txt,
+    // points3D.txt) into sparse/; sparse/0/ gets it as a checked binary model
     if (success) {
         logCallback("");
-        logCallback("Organizing COLMAP files for Gaussian Splatting...");
-        
-        try {
-            // Copy all .txt files from sparse/ to both images/ and sparse/0/
-            for (const auto& entry : fs::directory_iterator(sparseDir)) {
-                if (entry.is_regular_file() && entry.path().extension() == ".txt") {
-                    fs::path filename = entry.path().filename();
-                    
-                    // Convert to lowercase for consistency
-                    std::string lowercaseName = filename.string();
-                    std::transform(lowercaseName.begin(), lowercaseName.end(), 
-                                 lowercaseName.begin(), ::tolower);
-                    
-                    // Copy to images/ with lowercase name
-                    fs::path destImages = imagesDir / lowercaseName;
-                    fs::copy_file(entry.path(), destImages, fs::copy_options::overwrite_existing);
-                    
-                    // Copy to sparse/0/ with lowercase name
-                    fs::path destSparse = sparse0Dir / lowercaseName;
-                    fs::copy_file(entry.path(), destSparse, fs::copy_options::overwrite_existing);
-                    
-                    logCallback("  Copied " + filename.string() + " -> images/" + lowercaseName + " and sparse/0/" + lowercaseName);
-                }
-            }
-            
-            logCallback("✅ COLMAP files organized for Gaussian Splatting");
-        }
-        catch (const std::exception& e) {
-            logCallback("⚠ Warning: Failed to copy some files: " + std::string(e.what()));
+        logCallback("Converting the COLMAP model for Gaussian Splatting...");
+        // Earlier versions copied the text files into sparse/0/ and images/
+        removeColmapModel(sparse0Dir);
+        for (const char* name : {"cameras.txt", "images.txt", "points3D.txt"}) {
+            fs::remove(imagesDir / name, ec);
         }
+        success = checkColmapModel(sparseDir, sparse0Dir, imageNames, logCallback);
     }
     
     logCallback("");
     logCallback("Output directory: " + undistortedDir.string());
-    logCallback("  Images + registration: " + imagesDir.string());
-    logCallback("  Sparse (copy): " + sparse0Dir.string());
+    logCallback("  Images: " + imagesDir.string());
+    logCallback("  Sparse (binary): " + sparse0Dir.string());
     
     if (!success) {
         logCallback("");
@@ -630,16 +1584,525 @@ bool runRealityScan(const std::string& framesDir, const std::string& outputDir,
     return success;
 }
 
-bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
+// Everything a video's frames depend on. ffmpeg is identified by its file
+// (a new build has a new size or date); the video by size and date, since
+// hashing gigabytes of footage would cost as much as extracting it.
+StageInputs extractionInputs(const std::string& ffmpegPath, const std::string& videoPath,
+                             const std::string& framePrefix, const PipelineConfig& config) {
+    StageInputs inputs;
+    inputs.addFile("ffmpeg", ffmpegPath);
+    inputs.addFile("video", videoPath);
+    fs::path srtPath = findSrtFile(fs::path(videoPath));
+    if (srtPath.empty()) {
+        inputs.add("srt", "none");
+    } else {
+        inputs.addFileContents("srt", srtPath.string());
+    }
+    inputs.add("prefix", framePrefix);
+    inputs.add("fps", config.frameRate);
+    inputs.add("keyframes", config.keyframeSelection
+                                ? std::to_string(config.keyframeOversample) + " " + std::to_string(config.keyframeBlurRatio)
+                                : std::string("off"));
+    if (config.adaptiveSampling) {
+        std::ostringstream sampling;
+        sampling << config.samplingOverlap << ' ' << config.samplingGroundDistance << ' ' << config.cameraFovDegrees
+                 << ' ' << config.samplingHeight << ' ' << config.samplingMaxInterval;
+        inputs.add("adaptive_sampling", sampling.str());
+    } else {
+        inputs.add("adaptive_sampling", "off");
+    }
+    // Only recorded when it changes the output, so manifests written before
+    // pyramids existed stay valid
+    if (config.pyramidLevels > 0 || pyramidQuality(config.pyramidQuality, 0) != 2) {
+        inputs.add("pyramid", std::to_string(config.pyramidLevels) + " " + formatPyramidQuality(config.pyramidQuality));
+    }
+    return inputs;
+}
+
+// extractFrames, skipped if the manifest says this video's frames are already
+// in outputDir with the same inputs
+bool extractFramesIfChanged(const std::string& ffmpegPath, const std::string& videoPath, const fs::path& outputDir,
+                            const std::string& framePrefix, const PipelineConfig& config, int ffmpegThreads,
+                            const ProcessOutputOptions& output, RunReport& report, ProgressModel& progress,
+                            LogCallback logCallback, StageManifest& manifest, std::vector<FrameRecord>& frames) {
+    const std::string stage = "extract " + framePrefix;
+    StageInputs inputs = extractionInputs(ffmpegPath, videoPath, framePrefix, config);
+    std::string reason;
+    if (manifest.isCurrent(stage, inputs, &reason)) {
+        // The manifest checks the full-size frames; the pyramid levels only need to exist
+        auto levelsPresent = [&]() {
+            for (int factor : pyramidFactors(config.pyramidLevels)) {
+                fs::path dir = pyramidLevelDir(outputDir, factor);
+                for (const FrameRecord& frame : frames) {
+                    if (!fs::exists(dir / frame.name)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+        if (restoreFrames(outputDir.string(), manifest.outputs(stage), frames) && levelsPresent()) {
+            logCallback("✓ " + std::to_string(frames.size()) + " frames of " + fs::path(videoPath).filename().string() +
+                       " are up to date - skipping extraction");
+            progress.skip(stage);
+            return true;
+        }
+        reason = "frames were modified or deleted";
+    }
+    if (manifest.wasLoaded()) {
+        logCallback("Extracting " + fs::path(videoPath).filename().string() + " (" + reason + ")");
+    }
+    
+    manifest.begin(stage);
+    if (!extractFrames(ffmpegPath, videoPath, outputDir.string(), framePrefix, config, ffmpegThreads, output,
+                       report, progress, logCallback, &frames)) {
+        return false;
+    }
+    manifest.complete(stage, inputs, frameManifestEntries(outputDir.string(), frames));
+    return true;
+}
+
+// Extract frames from every video into outputDir, running up to
+// config.maxParallelVideos ffmpeg jobs at once. Each job's log is buffered and
+// written as one block when the job finishes, so lines from parallel jobs never
+// interleave. Returns per-video frame counts in the order of videoFiles (-1 = failed)
+// and each video's frame records in videoFrames.
+std::vector<int> extractVideos(const std::string& ffmpegPath, const std::vector<std::string>& videoFiles,
+                               const std::vector<std::string>& framePrefixes, const fs::path& outputDir,
+                               const PipelineConfig& config, const ProcessOutputOptions& output,
+                               RunReport& report, ProgressModel& progress, LogCallback logCallback,
+                               StageManifest& manifest, std::vector<std::vector<FrameRecord>>& videoFrames) {
+    std::vector<int> frameCounts(videoFiles.size(), -1);
+    videoFrames.assign(videoFiles.size(), {});
+    
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t parallel = config.maxParallelVideos > 0
+        ? static_cast<size_t>(config.maxParallelVideos)
+        : std::max<size_t>(1, cores / 4);  // one MJPEG encode keeps ~4 cores busy
+    parallel = std::min(parallel, videoFiles.size());
+    
+    const int ffmpegThreads = config.ffmpegThreads > 0
+        ? config.ffmpegThreads
+        : (parallel > 1 ? static_cast<int>(std::max<size_t>(1, cores / parallel)) : 0);
+    
+    if (parallel <= 1) {
+        for (size_t i = 0; i < videoFiles.size() && !isCancelled(output); i++) {
+            if (videoFiles.size() > 1) {
+                logCallback("Processing video " + std::to_string(i + 1) + "/" + std::to_string(videoFiles.size()) + ": " + 
+                           fs::path(videoFiles[i]).filename().string());
+            }
+            if (extractFramesIfChanged(ffmpegPath, videoFiles[i], outputDir, framePrefixes[i], config,
+                                       ffmpegThreads, output, report, progress, logCallback, manifest,
+                                       videoFrames[i])) {
+                frameCounts[i] = static_cast<int>(videoFrames[i].size());
+            }
+        }
+        return frameCounts;
+    }
+    
+    logCallback("Extracting " + std::to_string(parallel) + " videos at a time (" +
+               std::to_string(ffmpegThreads) + " ffmpeg threads each)");
+    
+    std::mutex logMutex;
+    {
+        ThreadPool pool(parallel);
+        std::vector<std::future<void>> jobs;
+        for (size_t i = 0; i < videoFiles.size(); i++) {
+            jobs.push_back(pool.submit([&, i]() {
+                if (isCancelled(output)) {
+                    return;
+                }
+                const std::string label = "video " + std::to_string(i + 1) + "/" + std::to_string(videoFiles.size()) + 
+                                          ": " + fs::path(videoFiles[i]).filename().string();
+                {
+                    std::lock_guard<std::mutex> lock(logMutex);
+                    logCallback("Started " + label);
+                }
+                
+                BufferedLog jobLog(logCallback, logMutex, "    ");
+                bool ok = extractFramesIfChanged(ffmpegPath, videoFiles[i], outputDir, framePrefixes[i], config,
+                                                 ffmpegThreads, output, report, progress, jobLog.callback(), manifest,
+                                                 videoFrames[i]);
+                frameCounts[i] = ok ? static_cast<int>(videoFrames[i].size()) : -1;
+                jobLog.flush((ok ? "Finished " : "FAILED ") + label);
+            }));
+        }
+        for (auto& job : jobs) {
+            job.get();
+        }
+    }
+    
+    return frameCounts;
+}
+
+// Name, size and date of every image, for stage inputs
+std::string imageListDigest(const fs::path& dir, const std::vector<std::string>& names) {
+    std::vector<std::string> lines;
+    lines.reserve(names.size());
+    for (const auto& name : names) {
+        std::error_code ec;
+        const auto size = fs::file_size(dir / name, ec);
+        const auto time = fs::last_write_time(dir / name, ec).time_since_epoch().count();
+        lines.push_back(name + "\t" + std::to_string(size) + "\t" + std::to_string(time));
+    }
+    return StageInputs::digestOf(lines);
+}
+
+// Downscaled copies of the reconstruction's images (images_2/, ...) with the
+// same file names, all levels from one decode of each image through an ffmpeg
+// concat list. Every level, the full-size one included, gets the frame's
+// geotag: undistortion rewrites the pixels and drops the EXIF block.
+bool writeImagesPyramid(const std::string& ffmpegPath, const fs::path& imagesDir, const fs::path& framesDir,
+                        const std::vector<FrameRecord>& frames, const PipelineConfig& config, StageManifest& manifest,
+                        const ProcessOutputOptions& output, RunReport& report, ProgressModel& progress,
+                        FrameStore& store, LogCallback logCallback) {
+    const std::string stage = "pyramid images";
+    const std::vector<int> factors = pyramidFactors(config.pyramidLevels);
+    
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(imagesDir, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".jpg") {
+            names.push_back(entry.path().filename().string());
+        }
+    }
+    std::sort(names.begin(), names.end());
+    if (names.empty()) {
+        logCallback("⚠ WARNING: No images in " + imagesDir.string() + " - image pyramid not written");
+        progress.unplan(stage);
+        return false;
+    }
+    
+    StageInputs inputs;
+    inputs.addFile("ffmpeg", ffmpegPath);
+    inputs.add("pyramid", std::to_string(config.pyramidLevels) + " " + formatPyramidQuality(config.pyramidQuality));
+    inputs.add("images", imageListDigest(imagesDir, names));
+    std::string reason;
+    if (manifest.isCurrent(stage, inputs, &reason)) {
+        bool complete = true;
+        for (size_t level = 1; complete && level < factors.size(); level++) {
+            fs::path dir = pyramidLevelDir(imagesDir, factors[level]);
+            complete = std::all_of(names.begin(), names.end(),
+                                   [&](const std::string& name) { return fs::exists(dir / name); });
+        }
+        if (complete) {
+            logCallback("✓ Image pyramid is up to date - skipping");
+            progress.skip(stage);
+            return true;
+        }
+    }
+    manifest.begin(stage);
+    
+    logCallback("Writing image pyramid (" + std::to_string(names.size()) + " images, " +
+               std::to_string(factors.size() - 1) + " levels)...");
+    StageTimer timer(report, stage);
+    progress.start(stage, static_cast<double>(names.size()), "images");
+    
+    // Fresh level folders; levels that are no longer configured are removed
+    try {
+        for (int factor : pyramidFactors(kMaxPyramidLevels)) {
+            if (factor > 1) {
+                fs::remove_all(pyramidLevelDir(imagesDir, factor));
+            }
+        }
+        for (size_t level = 1; level < factors.size(); level++) {
+            fs::create_directories(pyramidLevelDir(imagesDir, factors[level]));
+        }
+    } catch (const std::exception& e) {
+        logCallback("ERROR preparing image pyramid folders: " + std::string(e.what()));
+        return false;
+    }
+    
+    // Images that are the extracted frames themselves (same store object)
+    // reuse the frame pyramid written during extraction
+    const bool framesReused = std::all_of(names.begin(), names.end(), [&](const std::string& name) {
+        std::error_code ec;
+        if (!fs::equivalent(imagesDir / name, framesDir / name, ec)) {
+            return false;
+        }
+        for (size_t level = 1; level < factors.size(); level++) {
+            if (!fs::exists(pyramidLevelDir(framesDir, factors[level]) / name, ec)) {
+                return false;
+            }
+        }
+        return true;
+    });
+    if (framesReused) {
+        logCallback("Images are the extracted frames - linking the frame pyramid");
+        for (size_t level = 1; level < factors.size(); level++) {
+            fs::path levelDir = pyramidLevelDir(imagesDir, factors[level]);
+            if (!placeFrames(store, pyramidLevelDir(framesDir, factors[level]), names, levelDir,
+                             levelDir.filename().string(), logCallback)) {
+                return false;
+            }
+        }
+        timer.finish(names.size() * (factors.size() - 1), "images");
+        progress.finish(stage);
+        manifest.complete(stage, inputs);
+        return true;
+    }
+    
+    // The concat demuxer decodes the images as one stream, in list order
+    fs::path listPath = imagesDir.parent_path() / "pyramid_images.txt";
+    {
+        std::ofstream list(listPath, std::ios::binary);
+        list << "ffconcat version 1.0\n";
+        for (const auto& name : names) {
+            std::string path = (imagesDir / name).string();
+            std::replace(path.begin(), path.end(), '\\', '/');
+            list << "file '" << path << "'\n";
+        }
+        if (!list.good()) {
+            logCallback("ERROR: Could not write " + listPath.string());
+            return false;
+        }
+    }
+    
+    // The full-size output of the split graph is discarded; the others are
+    // numbered in list order and renamed afterwards
+    std::ostringstream cmd;
+    cmd << "\"" << ffmpegPath << "\" -nostdin" << ffmpegProgressArguments() << " -f concat -safe 0 -i \""
+        << listPath.string() << "\" -filter_complex \"" << buildPyramidFilter("0:v", config.pyramidLevels) << "\""
+        << " -map \"[p0]\" -f null -";
+    for (size_t level = 1; level < factors.size(); level++) {
+        cmd << " -map \"[p" << level << "]\" -fps_mode passthrough -q:v " << pyramidQuality(config.pyramidQuality, level)
+            << " \"" << (pyramidLevelDir(imagesDir, factors[level]) / "pyramid_%06d.jpg").string() << "\"";
+    }
+    std::vector<fs::path> partial;
+    for (size_t level = 1; level < factors.size(); level++) {
+        partial.push_back(pyramidLevelDir(imagesDir, factors[level]));
+    }
+    const ProcessOutputOptions ffmpegOutput =
+        progress.observe(output, stage, ProgressSource::FfmpegFrames, static_cast<double>(names.size()));
+    int result = runCommand(cmd.str(), ffmpegOutput, logCallback, report, stage, partial);
+    fs::remove(listPath, ec);
+    if (result != 0) {
+        logCallback("ERROR: FFmpeg failed with exit code " + std::to_string(result));
+        return false;
+    }
+    
+    for (size_t level = 1; level < factors.size(); level++) {
+        fs::path dir = pyramidLevelDir(imagesDir, factors[level]);
+        for (size_t i = 0; i < names.size(); i++) {
+            char numbered[32];
+            snprintf(numbered, sizeof(numbered), "pyramid_%06zu.jpg", i + 1);
+            fs::rename(dir / numbered, dir / names[i], ec);
+            if (ec) {
+                logCallback("ERROR: FFmpeg did not write " + (dir / numbered).string() + ": " + ec.message());
+                return false;
+            }
+        }
+    }
+    
+    // Geotags for every level, from the frame records of the extraction
+    std::map<std::string, const FrameRecord*> byName;
+    for (const FrameRecord& frame : frames) {
+        if (frame.hasGps) {
+            byName[frame.name] = &frame;
+        }
+    }
+    std::vector<FrameWork> work;
+    for (const auto& name : names) {
+        auto frame = byName.find(name);
+        if (frame == byName.end()) {
+            continue;
+        }
+        FrameWork item{name, {}, GPSData()};
+        for (int factor : factors) {
+            item.files.push_back(pyramidLevelDir(imagesDir, factor) / name);
+        }
+        item.gps.latitude = frame->second->latitude;
+        item.gps.longitude = frame->second->longitude;
+        item.gps.altitude = frame->second->altitude;
+        item.gps.valid = true;
+        work.push_back(std::move(item));
+    }
+    FrameStage gpsStage("pyramid gps");
+    gpsStage.then("exif", writeGpsOperation());
+    gpsStage.cancelWhen(output.cancel);
+    const size_t tagged = gpsStage.run(std::move(work)).operations[0].done;
+    if (isCancelled(output)) {
+        return false;  // the stage stays begun, so the next run writes it again
+    }
+    timer.finish(names.size() * (factors.size() - 1), "images");
+    progress.finish(stage);
+    
+    std::string folders;
+    for (size_t level = 1; level < factors.size(); level++) {
+        folders += (level > 1 ? ", " : "") + pyramidLevelDir(imagesDir, factors[level]).filename().string();
+    }
+    logCallback("✅ Image pyramid written: " + folders + (byName.empty() ? std::string() :
+               " (GPS embedded in " + std::to_string(tagged) + "/" + std::to_string(names.size()) + " images)"));
+    
+    // Inputs after embedding, which rewrote the full-size images
+    inputs = StageInputs();
+    inputs.addFile("ffmpeg", ffmpegPath);
+    inputs.add("pyramid", std::to_string(config.pyramidLevels) + " " + formatPyramidQuality(config.pyramidQuality));
+    inputs.add("images", imageListDigest(imagesDir, names));
+    manifest.complete(stage, inputs);
+    return true;
+}
+
+// How far the disk budget may go: JPEG quantizer of the full-size frames,
+// and share of the requested frame rate
+const int kMaxAdaptedQuality = 5;
+const double kMinAdaptedFrameRate = 0.5;
+
+// Length and frame size of a video from ffmpeg's banner. Without an output
+// file ffmpeg exits with an error after printing it, which is expected here.
+VideoInfo probeVideo(const std::string& ffmpegPath, const std::string& videoPath, const ProcessOutputOptions& output) {
+    VideoInfo info;
+    std::error_code ec;
+    info.bytes = fs::file_size(videoPath, ec);
+    ProcessOutputOptions probe = output;
+    probe.lineObserver = [&info](std::string_view line) {
+        parseVideoInfoLine(line, info);
+        return true;
+    };
+    runCommandHidden("\"" + ffmpegPath + "\" -hide_banner -nostdin -i \"" + videoPath + "\"",
+                     [](const std::string&) {}, probe);
+    return info;
+}
+
+// Estimate the run's peak disk use and check it against the budget and the
+// free space. Adapt changes config (cleanup first, then JPEG quality, then
+// frame rate) until the estimate fits. False if the run should not start.
+bool checkDiskBudget(const std::string& ffmpegPath, const std::vector<std::string>& videoFiles,
+                     const fs::path& outputBase, PipelineConfig& config, const ProcessOutputOptions& output,
+                     LogCallback logCallback) {
+    std::vector<VideoInfo> videos;
+    for (const auto& video : videoFiles) {
+        videos.push_back(probeVideo(ffmpegPath, video, output));
+    }
+    
+    // Files of an earlier run into this directory are replaced or reused, so
+    // they count as room
+    std::error_code ec;
+    const fs::space_info space = fs::space(outputBase, ec);
+    const uint64_t existing = directoryBytes(outputBase);
+    uint64_t limit = ec ? UINT64_MAX : space.available + existing;
+    std::string room = ec ? std::string("free space unknown") : formatBytes(space.available) + " free";
+    if (existing > 0) {
+        room += " + " + formatBytes(existing) + " of an earlier run";
+    }
+    if (config.diskBudgetBytes > 0 && config.diskBudgetBytes < limit) {
+        limit = config.diskBudgetBytes;
+        room = "budget " + formatBytes(limit) + ", " + room;
+    }
+    
+    DiskEstimate estimate = estimateDiskUsage(videos, config);
+    auto describe = [&]() {
+        return "about " + std::to_string(static_cast<long>(estimate.frames)) + " frames, peak " +
+               formatBytes(estimate.peakBytes) + " (frames " + formatBytes(estimate.frameBytes) + ", database " +
+               formatBytes(estimate.databaseBytes) + ", images " + formatBytes(estimate.imageBytes) + "), " +
+               formatBytes(estimate.finalBytes) + " at the end";
+    };
+    logCallback("Disk use estimate: " + describe());
+    logCallback("  Room: " + room);
+    if (estimate.sizeAssumed) {
+        logCallback("ℹ Frame size of a video unknown - assumed 3840x2160");
+    }
+    if (estimate.peakBytes <= limit) {
+        return true;
+    }
+    
+    const std::string shortfall = "The run may need " + formatBytes(estimate.peakBytes) + " at its peak, " +
+                                  formatBytes(estimate.peakBytes - limit) + " more than there is room for";
+    if (config.diskBudgetAction == DiskBudgetAction::Warn) {
+        logCallback("⚠ WARNING: " + shortfall + ". Cleanup of intermediates, a lower frame rate or the "
+                    "adapt action of the disk budget would reduce it.");
+        return true;
+    }
+    if (config.diskBudgetAction == DiskBudgetAction::Refuse) {
+        logCallback("ERROR: " + shortfall + " - not starting");
+        return false;
+    }
+    
+    auto fits = [&]() {
+        estimate = estimateDiskUsage(videos, config);
+        return estimate.peakBytes <= limit;
+    };
+    std::vector<std::string> changes;
+    if (config.method == ReconMethod::COLMAP && !config.cleanupIntermediates) {
+        config.cleanupIntermediates = true;
+        changes.push_back("COLMAP databases are removed once their model is built");
+    }
+    if (!fits() && config.method != ReconMethod::METASHAPE && !config.removeDistortedFrames) {
+        config.removeDistortedFrames = true;
+        changes.push_back("the extracted frames are removed after undistortion");
+    }
+    const int quality = pyramidQuality(config.pyramidQuality, 0);
+    while (!fits() && pyramidQuality(config.pyramidQuality, 0) < kMaxAdaptedQuality) {
+        if (config.pyramidQuality.empty()) {
+            config.pyramidQuality.push_back(quality);
+        }
+        config.pyramidQuality[0]++;
+    }
+    if (pyramidQuality(config.pyramidQuality, 0) != quality) {
+        changes.push_back("frames are written at -q:v " + std::to_string(config.pyramidQuality[0]) + " instead of " +
+                          std::to_string(quality));
+    }
+    // Adaptive sampling picks its frames from the flight, not the frame rate
+    const double fps = config.frameRate;
+    while (!config.adaptiveSampling && !fits() && config.frameRate > fps * kMinAdaptedFrameRate + 1e-9) {
+        config.frameRate = std::max(fps * kMinAdaptedFrameRate, config.frameRate * 0.8);
+    }
+    if (config.frameRate != fps) {
+        char text[96];
+        snprintf(text, sizeof(text), "frames are extracted at %.3g fps instead of %.3g", config.frameRate, fps);
+        changes.push_back(text);
+    }
+    for (const auto& change : changes) {
+        logCallback("ℹ Disk budget: " + change);
+    }
+    if (!fits()) {
+        logCallback("ERROR: " + shortfall + ", and still " + formatBytes(estimate.peakBytes - limit) +
+                    " after adapting the settings - not starting");
+        return false;
+    }
+    logCallback("✓ Adapted to the disk budget: " + describe());
+    return true;
+}
+
+// Remove the extracted frames at every level and the per-video link folders
+// once the method has written its own images
+void removeExtractedFrames(const fs::path& framesDir, const fs::path& combinedFramesDir,
+                           const std::vector<std::string>& framePrefixes, LogCallback logCallback) {
+    uint64_t bytes = 0;
+    std::error_code ec;
+    for (const auto& prefix : framePrefixes) {
+        fs::remove_all(framesDir / prefix, ec);  // hard links: they would keep the bytes alive
+    }
+    for (int factor : pyramidFactors(kMaxPyramidLevels)) {
+        const fs::path dir = pyramidLevelDir(combinedFramesDir, factor);
+        bytes += directoryBytes(dir);
+        fs::remove_all(dir, ec);
+    }
+    logCallback("Removed the extracted frames (" + formatBytes(bytes) + ") - the images are undistorted");
+}
+
+// The pipeline proper; runPipeline adds the performance report around it
+bool runPipelineStages(const PipelineConfig& requested, LogCallback logCallback, RunReport& report,
+                       ProgressModel& progress, const std::atomic<bool>* cancel) {
+    // The disk budget may adapt the settings
+    PipelineConfig config = requested;
+    
     logCallback("=======================================================");
     logCallback("   Drone Reconstruction Pipeline - GUI Edition");
     logCallback("=======================================================");
     
     // Check vendor files
-    if (!checkVendorFiles(logCallback)) {
+    ToolPaths tools;
+    if (!checkVendorFiles(config, tools, logCallback)) {
         return false;
     }
     
+    // Child process output is drained independently of logCallback
+    ProcessOutputOptions output;
+    output.maxLinesPerSecond = static_cast<size_t>(std::max(0, config.maxLogLinesPerSecond));
+    output.cancel = cancel;
+    output.stageTimeouts = &config.toolTimeouts;
+    
     // Validate inputs
     if (config.videoPath.empty()) {
         logCallback("ERROR: Video path is required");
@@ -669,6 +2132,16 @@ bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
         return false;
     }
     
+    // Image bytes shared by frames/ and every backend's images/ folders
+    FrameStore store(outputBase / "frame_store");
+    
+    // Stages completed by earlier runs into this output directory
+    StageManifest manifest((outputBase / "pipeline_manifest.txt").string());
+    if (config.resume && manifest.load() && manifest.size() > 0) {
+        logCallback("Resuming: " + std::to_string(manifest.size()) + " completed stages recorded in " +
+                   manifest.path());
+    }
+    
     // Check if input is a file or folder
     fs::path inputPath(config.videoPath);
     bool isFolder = fs::is_directory(inputPath);
@@ -691,6 +2164,12 @@ bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
     logCallback("  Method:      " + methodName);
     logCallback("");
     
+    report.setInfo("video", config.videoPath);
+    report.setInfo("output", config.outputBaseDir);
+    report.setInfo("method", methodName);
+    report.setInfo("fps", std::to_string(config.frameRate));
+    report.setInfo("cores", std::to_string(std::max(1u, std::thread::hardware_concurrency())));
+    
     // Step 1: Frame Extraction
     logCallback("=======================================================");
     logCallback("STEP 1: Frame Extraction");
@@ -721,6 +2200,9 @@ bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
             return false;
         }
         
+        // Directory order is unspecified; sort so the combined output is reproducible
+        std::sort(videoFiles.begin(), videoFiles.end());
+        
         logCallback("Found " + std::to_string(videoFiles.size()) + " video file(s)");
         for (const auto& vf : videoFiles) {
             logCallback("  - " + fs::path(vf).filename().string());
@@ -735,7 +2217,7 @@ bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
     
     logCallback("");
     
-    // Extract frames from all videos
+    // Extract frames from all videos straight into their final folder
     fs::path combinedFramesDir = framesDir / outputFolderName;
     try {
         fs::create_directories(combinedFramesDir);
@@ -744,56 +2226,105 @@ bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
         return false;
     }
     
-    int totalFrames = 0;
+    std::vector<std::string> framePrefixes = uniqueFramePrefixes(videoFiles);
+    
+    // Frames of videos that were removed from the folder since the last run
+    for (const auto& stage : manifest.stages("extract ")) {
+        const std::string prefix = stage.substr(8);
+        if (std::find(framePrefixes.begin(), framePrefixes.end(), prefix) != framePrefixes.end()) {
+            continue;
+        }
+        std::vector<std::string> stale = manifest.outputs(stage);
+        for (const auto& entry : stale) {
+            for (int factor : pyramidFactors(kMaxPyramidLevels)) {
+                std::error_code ec;
+                fs::remove(pyramidLevelDir(combinedFramesDir, factor) / entry.substr(0, entry.find('\t')), ec);
+            }
+        }
+        manifest.remove(stage);
+        logCallback("Removed " + std::to_string(stale.size()) + " frames of " + prefix + " (video no longer in input)");
+    }
+    
+    if (!checkDiskBudget(tools.ffmpeg, videoFiles, outputBase, config, output, logCallback)) {
+        return false;
+    }
+    report.setInfo("fps", std::to_string(config.frameRate));
+    logCallback("");
+    
+    // Weights for the overall progress: extraction by video size (~25 MB/s
+    // decoded), reconstruction by frames estimated at 100 Mbit/s footage
+    double estimatedFrames = 0.0;
     for (size_t i = 0; i < videoFiles.size(); i++) {
-        if (videoFiles.size() > 1) {
-            logCallback("Processing video " + std::to_string(i + 1) + "/" + std::to_string(videoFiles.size()) + ": " + 
-                       fs::path(videoFiles[i]).filename().string());
+        std::error_code ec;
+        const double bytes = static_cast<double>(fs::file_size(videoFiles[i], ec));
+        if (!ec) {
+            progress.plan("extract " + framePrefixes[i], bytes / 25e6);
+            estimatedFrames += bytes / 12.5e6 * config.frameRate;
         }
-        
-        if (!extractFrames(videoFiles[i], framesDir.string(), config.frameRate, logCallback)) {
+    }
+    planReconstructionProgress(progress, config.method, estimatedFrames, config.matchingMode);
+    if (config.pyramidLevels > 0) {
+        progress.plan("pyramid images", 0.02 * estimatedFrames);
+    }
+    
+    std::vector<std::vector<FrameRecord>> videoFrames;
+    std::vector<int> frameCounts = extractVideos(tools.ffmpeg, videoFiles, framePrefixes, combinedFramesDir, config, output,
+                                                 report, progress, logCallback, manifest, videoFrames);
+    if (isCancelled(output)) {
+        return false;
+    }
+    
+    // All frames grouped by video in frame order, for the matching strategy
+    std::vector<FrameRecord> frames;
+    int totalFrames = 0;
+    for (size_t i = 0; i < videoFiles.size(); i++) {
+        if (frameCounts[i] < 0) {
             logCallback("WARNING: Frame extraction failed for " + videoFiles[i]);
             continue;
         }
+        totalFrames += frameCounts[i];
+        for (auto& frame : videoFrames[i]) {
+            frame.video = i;
+            frames.push_back(std::move(frame));
+        }
         
-        // Move frames to combined folder (if processing multiple videos)
-        if (videoFiles.size() > 1) {
-            fs::path videoStem = fs::path(videoFiles[i]).stem();
-            fs::path videoFramesDir = framesDir / videoStem;
-            
-            if (fs::exists(videoFramesDir)) {
-                // Copy all frames to combined folder
-                for (const auto& frameEntry : fs::directory_iterator(videoFramesDir)) {
-                    if (frameEntry.path().extension() == ".jpg") {
-                        fs::path destPath = combinedFramesDir / frameEntry.path().filename();
-                        try {
-                            fs::copy_file(frameEntry.path(), destPath, fs::copy_options::overwrite_existing);
-                            totalFrames++;
-                        } catch (const std::exception& e) {
-                            logCallback("WARNING: Failed to copy frame: " + std::string(e.what()));
-                        }
-                    }
-                }
-                
-                // Remove individual video frames directory
-                try {
-                    fs::remove_all(videoFramesDir);
-                } catch (...) {}
+        // Optional per-video view of the combined folder, made of hard links (no frame bytes copied)
+        if (videoFiles.size() > 1 && config.perVideoFrameLinks) {
+            fs::path videoFramesDir = framesDir / framePrefixes[i];
+            std::error_code ec;
+            fs::create_directories(videoFramesDir, ec);
+            std::vector<FrameWork> work;
+            for (int n = 1; n <= frameCounts[i]; n++) {
+                std::string name = frameFileName(framePrefixes[i], n);
+                work.push_back({name, {combinedFramesDir / name}, GPSData()});
             }
-        } else {
-            // Count frames for single video
-            fs::path videoStem = fs::path(videoFiles[0]).stem();
-            fs::path videoFramesDir = framesDir / videoStem;
-            for (const auto& entry : fs::directory_iterator(videoFramesDir)) {
-                if (entry.path().extension() == ".jpg") {
-                    totalFrames++;
-                }
+            FrameStage linkStage("per-video links");
+            linkStage.then("link", [&](FrameWork& frame, std::string& error) {
+                std::error_code linkError;
+                fs::remove(videoFramesDir / frame.name, linkError);
+                fs::create_hard_link(frame.files.front(), videoFramesDir / frame.name, linkError);
+                error = linkError.message();
+                return linkError ? FrameOpResult::Failed : FrameOpResult::Done;
+            });
+            const size_t linked = linkStage.run(std::move(work)).completed;
+            if (linked < static_cast<size_t>(frameCounts[i])) {
+                logCallback("WARNING: Hard links not supported for " + videoFramesDir.string() +
+                           " - per-video view incomplete (" + std::to_string(linked) + " frames)");
             }
         }
     }
     
+    if (frames.empty()) {
+        logCallback("ERROR: No frames were extracted");
+        return false;
+    }
     logCallback("Frame extraction completed successfully");
     logCallback("Total frames extracted: " + std::to_string(totalFrames));
+    report.setInfo("frames", std::to_string(totalFrames));
+    planReconstructionProgress(progress, config.method, totalFrames, config.matchingMode);
+    if (config.pyramidLevels > 0) {
+        progress.plan("pyramid images", 0.02 * totalFrames);
+    }
     logCallback("");
     
     // Get the actual frames directory
@@ -822,33 +2353,60 @@ bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
             logCallback("Processing will likely FAIL.");
             logCallback("");
             
-            // Show popup warning
-            std::string message = "WARNING: Your paths contain SPACES!\n\n"
-                                "COLMAP does not work with spaces in file paths.\n\n"
-                                "Video: " + config.videoPath + "\n"
-                                "Output: " + config.outputBaseDir + "\n\n"
-                                "Please use paths WITHOUT spaces.\n\n"
-                                "Processing will likely FAIL!\n\n"
-                                "Click OK to continue anyway (not recommended).";
-            MessageBoxA(NULL, message.c_str(), "COLMAP Path Warning", MB_OK | MB_ICONWARNING | MB_TOPMOST);
+#ifdef _WIN32
+            // Show popup warning (GUI runs only; batch runs have nobody to click OK)
+            if (config.interactive) {
+                std::string message = "WARNING: Your paths contain SPACES!\n\n"
+                                    "COLMAP does not work with spaces in file paths.\n\n"
+                                    "Video: " + config.videoPath + "\n"
+                                    "Output: " + config.outputBaseDir + "\n\n"
+                                    "Please use paths WITHOUT spaces.\n\n"
+                                    "Processing will likely FAIL!\n\n"
+                                    "Click OK to continue anyway (not recommended).";
+                MessageBoxA(NULL, message.c_str(), "COLMAP Path Warning", MB_OK | MB_ICONWARNING | MB_TOPMOST);
+            }
+#endif
         }
     }
     
+    MatchingOptions matching;
+    matching.mode = config.matchingMode;
+    matching.vocabTreePath = findVocabTree(config.vocabTreePath, logCallback);
+    
+    // Metashape and RealityScan write their own sparse/ output over COLMAP's
+    if (config.method != ReconMethod::COLMAP) {
+        for (const auto& stage : manifest.stages("colmap ")) {
+            manifest.remove(stage);
+        }
+    }
+    
+    GeoRegistrationOptions geoOptions;
+    geoOptions.maxError = config.geoMaxError;
+    PartitionOptions partition;
+    partition.maxFrames = config.tileMaxFrames > 0 ? static_cast<size_t>(config.tileMaxFrames) : 0;
+    partition.overlap = config.tileOverlap;
+    
     bool success = false;
     switch (config.method) {
         case ReconMethod::COLMAP:
-            success = runColmap(actualFramesDir, config.outputBaseDir, logCallback);
+            success = runColmap(tools.colmap, actualFramesDir, config.outputBaseDir, frames, matching,
+                                config.colmapMapperOptions, config.geoRegistration, geoOptions, partition,
+                                config.tileJobs, config.cleanupIntermediates, manifest, output,
+                                report, progress, logCallback);
             break;
         case ReconMethod::METASHAPE:
-            success = runMetashape(actualFramesDir, config.outputBaseDir, 
-                                  config.metashapeExePath, logCallback);
+            success = runMetashape(actualFramesDir, config.outputBaseDir, frames.size(),
+                                  config.metashapeExePath, output, report, progress, store, logCallback);
             break;
         case ReconMethod::REALITYSCAN:
-            success = runRealityScan(actualFramesDir, config.outputBaseDir, 
-                                    config.realityscanExePath, logCallback);
+            success = runRealityScan(actualFramesDir, config.outputBaseDir, frames.size(),
+                                    config.realityscanExePath, output, report, progress, logCallback);
             break;
     }
     
+    if (isCancelled(output)) {
+        return false;
+    }
     if (!success) {
         logCallback("ERROR: 3D reconstruction failed");
         return false;
@@ -857,6 +2415,46 @@ bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
     logCallback("3D reconstruction completed successfully");
     logCallback("");
     
+    // Nothing after this reads the frames, only the method's own images
+    if (config.removeDistortedFrames) {
+        if (config.method == ReconMethod::METASHAPE) {
+            logCallback("ℹ The extracted frames are kept: Metashape's images are links to them");
+        } else if (config.method == ReconMethod::REALITYSCAN || !manifest.stages("colmap undistort").empty()) {
+            removeExtractedFrames(framesDir, combinedFramesDir, framePrefixes, logCallback);
+        } else {
+            logCallback("⚠ WARNING: The extracted frames are kept because image undistortion failed");
+        }
+        logCallback("");
+    }
+    
+    if (config.pyramidLevels > 0) {
+        // RealityScan exports its undistorted images below undistorted/
+        fs::path imagesDir = config.method == ReconMethod::REALITYSCAN ? outputBase / "undistorted" / "images"
+                                                                       : outputBase / "images";
+        logCallback("=======================================================");
+        logCallback("STEP 3: Image Pyramid");
+        logCallback("=======================================================");
+        if (!writeImagesPyramid(tools.ffmpeg, imagesDir, combinedFramesDir, frames, config, manifest, output, report,
+                                progress, store, logCallback)) {
+            if (isCancelled(output)) {
+                return false;
+            }
+            logCallback("⚠ WARNING: Image pyramid of " + imagesDir.string() + " is incomplete");
+        }
+        logCallback("");
+    }
+    
+    // Objects of frames that were re-extracted or removed
+    const FrameStore::Stats stored = store.stats();
+    const size_t pruned = store.prune();
+    if (stored.linked + stored.reflinked + stored.copied > 0 || pruned > 0) {
+        char summary[160];
+        snprintf(summary, sizeof(summary), "%.1f MB placed without copying, %zu duplicates merged, %zu unused objects removed",
+                 stored.bytesShared / (1024.0 * 1024.0), stored.deduplicated, pruned);
+        logCallback("Frame store: " + std::string(summary));
+        logCallback("");
+    }
+    
     logCallback("=======================================================");
     logCallback("Pipeline completed successfully!");
     logCallback("=======================================================");
@@ -865,3 +2463,32 @@ bool runPipeline(const PipelineConfig& config, LogCallback logCallback) {
     
     return true;
 }
+
+bool runPipeline(const PipelineConfig& config, LogCallback logCallback, ProgressCallback progressCallback,
+                 const std::atomic<bool>* cancel) {
+    RunReport report;
+    ProgressModel progress(progressCallback);
+    bool success = runPipelineStages(config, logCallback, report, progress, cancel);
+    if (cancel && *cancel) {
+        // Stages finished before the cancel are in the manifest, so the next run resumes after them
+        logCallback("");
+        logCallback("ERROR: Pipeline cancelled - completed stages are kept for the next run");
+        success = false;
+    }
+    
+    // Where the time went, also for failed runs
+    if (!report.stages().empty()) {
+        logCallback("");
+        logCallback("Performance summary:");
+        for (const auto& line : report.summaryTable()) {
+            logCallback("  " + line);
+        }
+        fs::path reportPath = fs::path(config.outputBaseDir) / "run_report.json";
+        if (report.writeJson(reportPath.string(), success)) {
+            logCallback("Run report: " + reportPath.string());
+        } else {
+            logCallback("⚠ WARNING: Could not write " + reportPath.string());
+        }
+    }
+    return success;
+}
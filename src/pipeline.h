@@ -1,12 +1,34 @@
 #ifndef PIPELINE_H
 #define PIPELINE_H
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <functional>
+#include <map>
+#include <vector>
 
 // Callback for logging messages
 using LogCallback = std::function<void(const std::string&)>;
 
+// Progress of one stage and of the whole run. Published by runPipeline from
+// its worker threads at most a few times per second per stage, and once more
+// when a stage finishes.
+struct ProgressEvent {
+    std::string stage;                // "extract DJI_0001", "colmap matching", ...
+    double done = 0.0;                // work finished in this stage, in units
+    double total = 0.0;               // 0 = unknown
+    std::string unit;                 // "seconds" (of video), "images", "blocks"
+    double rate = 0.0;                // units per second, 0 = not known yet
+    double etaSeconds = -1.0;         // stage time remaining, -1 = unknown
+    double overallFraction = 0.0;     // whole run 0..1, stages weighted by expected cost
+    double overallEtaSeconds = -1.0;  // whole run time remaining, -1 = unknown
+    double elapsedSeconds = 0.0;      // since the run started
+    bool finished = false;            // the stage completed or was skipped
+};
+
+using ProgressCallback = std::function<void(const ProgressEvent&)>;
+
 // Reconstruction method options
 enum class ReconMethod {
     COLMAP,
@@ -14,6 +36,29 @@ enum class ReconMethod {
     REALITYSCAN
 };
 
+// How COLMAP chooses image pairs to match
+enum class MatchingMode {
+    Auto,        // pick from frame count, GPS coverage and vocabulary tree availability
+    Exhaustive,  // every pair, O(n^2)
+    Sequential,  // neighbours in video order (+ loop detection with a vocabulary tree)
+    Spatial,     // COLMAP spatial_matcher on the embedded geotags
+    VocabTree,   // image retrieval with a vocabulary tree
+    PairList     // our own video-order + GPS-neighbour pairs via matches_importer
+};
+
+// What a run does when its estimated peak disk use exceeds the budget
+enum class DiskBudgetAction {
+    Warn,    // log it and run anyway
+    Refuse,  // fail before extracting anything
+    Adapt    // clean up intermediates, then lower JPEG quality and fps until it fits
+};
+
+// Watchdog limits for the external tool of a stage (0 = no limit)
+struct ToolTimeout {
+    double seconds = 0.0;       // wall-clock time
+    double stallSeconds = 0.0;  // time without any output
+};
+
 // Pipeline configuration
 struct PipelineConfig {
     std::string videoPath;
@@ -22,9 +67,98 @@ struct PipelineConfig {
     ReconMethod method;
     std::string metashapeExePath;
     std::string realityscanExePath;
+    
+    // Folder mode: number of videos extracted at the same time (0 = auto)
+    int maxParallelVideos = 0;
+    // Threads per ffmpeg process (0 = share the cores between parallel jobs)
+    int ffmpegThreads = 0;
+    // Folder mode: also expose each video's frames as frames/<video>/ (hard links)
+    bool perVideoFrameLinks = false;
+    
+    // Tool locations (empty = bundled vendor/ copy, then the PATH)
+    std::string ffmpegPath;
+    std::string colmapPath;
+    // False for batch/headless runs: no message boxes that wait for a click
+    bool interactive = true;
+    // Tool output lines forwarded to the log per second and process (0 = all)
+    int maxLogLinesPerSecond = 0;
+    
+    // COLMAP feature matching
+    MatchingMode matchingMode = MatchingMode::Auto;
+    // Vocabulary tree file (empty = vendor/colmap/vocab_tree*.bin if present)
+    std::string vocabTreePath;
+    // Extra arguments for COLMAP's mapper, e.g. "--Mapper.ba_global_max_num_iterations 30"
+    std::string colmapMapperOptions;
+    // Fit COLMAP's model to the frames' GPS positions (RANSAC + Umeyama):
+    // sparse/0 comes out in metres, east-north-up, with the transform in
+    // sparse/0/geo_registration.txt. Cameras further than geoMaxError metres
+    // from their position are outliers.
+    bool geoRegistration = true;
+    double geoMaxError = 5.0;
+    // Partitioned reconstruction (COLMAP): with more than tileMaxFrames
+    // frames, split the flight into spatial tiles of at most that many frames
+    // plus the frames within tileOverlap metres, reconstruct the tiles as
+    // independent jobs (tileJobs at a time, 0 = a quarter of the cores) and
+    // merge them through the frames they share. 0 = one model for all frames.
+    int tileMaxFrames = 0;
+    double tileOverlap = 30.0;
+    int tileJobs = 0;
+    
+    // Watchdogs for the external tools, by stage: "extract", "features",
+    // "matching", "mapper", "undistort", "pyramid", "metashape" and
+    // "realityscan"; "all" holds the limits a stage does not set itself. A
+    // tool that runs longer, or stays silent longer, is killed together with
+    // every process it started, and its stage fails.
+    std::map<std::string, ToolTimeout> toolTimeouts;
+    
+    // Disk budget: peak disk use of the output directory is estimated before
+    // extraction (videos probed with ffmpeg) and checked against
+    // diskBudgetBytes and the free space of its volume (0 = free space only)
+    uint64_t diskBudgetBytes = 0;
+    DiskBudgetAction diskBudgetAction = DiskBudgetAction::Warn;
+    // Streaming cleanup: remove the COLMAP database(s) once the model is built,
+    // and the extracted frames once the method has written its own undistorted
+    // images (COLMAP, RealityScan). A rerun extracts the frames again; COLMAP
+    // keys on their content, so the model and images are kept while the
+    // inputs are unchanged, and the database is only rebuilt for a stage that
+    // has to run again.
+    bool cleanupIntermediates = false;
+    bool removeDistortedFrames = false;
+    
+    // Skip stages recorded in <output>/pipeline_manifest.txt as completed with
+    // the same inputs (false = rerun everything)
+    bool resume = true;
+    
+    // Keyframe selection: decode keyframeOversample candidates per 1/frameRate
+    // interval and keep only the sharpest (variance of the Laplacian)
+    bool keyframeSelection = false;
+    int keyframeOversample = 4;
+    // Skip an interval whose sharpest candidate scores below this fraction of
+    // the recent median, i.e. is motion-blurred throughout (0 = never skip)
+    double keyframeBlurRatio = 0.3;
+    
+    // Adaptive sampling: frame times from the SRT track (distance flown and
+    // height) instead of a fixed frameRate; frameRate is used without a track
+    bool adaptiveSampling = false;
+    double samplingOverlap = 0.8;          // forward overlap between consecutive frames
+    double samplingGroundDistance = 0.0;   // metres between frames, overrides the overlap when > 0
+    double cameraFovDegrees = 45.0;        // along-track field of view (vertical FOV of 16:9 video)
+    double samplingHeight = 0.0;           // metres above ground, 0 = altitude above the track's lowest point
+    double samplingMaxInterval = 10.0;     // seconds, a frame at least this often when hovering (0 = never)
+    
+    // Image pyramid for Gaussian splatting trainers: every frame is also written
+    // at 1/2, 1/4, ... size from the same decode (frames/<folder>_2/, ...), and
+    // the reconstruction's images/ gets images_2/, ... with the same file names.
+    // GPS tags are embedded at every level.
+    int pyramidLevels = 0;                           // downscaled levels, 0 = off, 3 = _2, _4 and _8
+    std::vector<int> pyramidQuality = {2, 3, 3, 4};  // ffmpeg -q:v per level, full size first
 };
 
-// Main pipeline entry point
-bool runPipeline(const PipelineConfig& config, LogCallback logCallback);
+// Main pipeline entry point. progressCallback (optional) may be called from
+// any thread and should return quickly. Setting *cancel (from any thread)
+// stops the run: running tools are killed, no new work is started, partial
+// outputs are removed, and runPipeline returns false within seconds.
+bool runPipeline(const PipelineConfig& config, LogCallback logCallback,
+                 ProgressCallback progressCallback = nullptr, const std::atomic<bool>* cancel = nullptr);
 
 #endif // PIPELINE_H
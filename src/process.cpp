@@ -0,0 +1,537 @@
+#include "process.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// A killed command gets this long to exit before it is forced to, and then
+// this much longer before its output pipe is given up on (a process that
+// left the process group may still hold it open)
+const auto kStopGrace = std::chrono::seconds(3);
+const auto kAbandonGrace = std::chrono::seconds(2);
+
+// "colmap mapper" for "\"C:/vendor/colmap/colmap.bat\" mapper --database_path ...":
+// the program's file name and a following subcommand, for log lines
+std::string commandName(const std::string& command) {
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (words.size() < 2 && i < command.size()) {
+        while (i < command.size() && command[i] == ' ') i++;
+        if (i >= command.size()) break;
+        size_t end;
+        if (command[i] == '"') {
+            end = command.find('"', i + 1);
+            words.push_back(command.substr(i + 1, end == std::string::npos ? std::string::npos : end - i - 1));
+            end = end == std::string::npos ? command.size() : end + 1;
+        } else {
+            end = std::min(command.find(' ', i), command.size());
+            words.push_back(command.substr(i, end - i));
+        }
+        i = end;
+    }
+    if (words.empty()) {
+        return "command";
+    }
+    std::string name = fs::path(words[0]).filename().string();
+    if (words.size() > 1 && !words[1].empty() && words[1][0] != '-' && words[1][0] != '>') {
+        name += " " + words[1];
+    }
+    return name;
+}
+
+// Watches one running command on its own thread and has it killed when the
+// run is cancelled or the command exceeds its time limits. kill(step) is
+// called with 0 to stop the process tree, 1 to force it after kStopGrace and
+// 2 to stop reading its output after kAbandonGrace more. Without a cancel
+// flag or limits no thread is started.
+class Watchdog {
+public:
+    enum class Reason { None, Cancelled, TimedOut, Stalled };
+
+    Watchdog(const ProcessOutputOptions& options, std::function<void(int)> kill)
+        : m_cancel(options.cancel), m_timeout(options.timeoutSeconds), m_stall(options.stallSeconds),
+          m_kill(std::move(kill)), m_started(Clock::now()) {
+        if (active()) {
+            m_thread = std::thread([this]() { run(); });
+        }
+    }
+
+    ~Watchdog() { stop(); }
+
+    bool active() const { return m_cancel != nullptr || m_timeout > 0.0 || m_stall > 0.0; }
+
+    // The command wrote something
+    void output() {
+        m_lastOutput.store((Clock::now() - m_started).count(), std::memory_order_relaxed);
+    }
+
+    // True once the output of the killed command is no longer waited for
+    bool abandoned() const { return m_abandoned; }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopped = true;
+        }
+        m_wake.notify_all();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    // After stop(): exitCode, or the watchdog's result once it has logged why
+    // it killed the command
+    int result(int exitCode, const std::string& command, const LogCallback& logCallback) const {
+        char text[160];
+        switch (m_reason) {
+            case Reason::None:
+                return exitCode;
+            case Reason::Cancelled:
+                logCallback("ERROR: Cancelled - stopped " + commandName(command));
+                return kProcessCancelled;
+            case Reason::TimedOut:
+                snprintf(text, sizeof(text), " after its time limit of %g s", m_timeout);
+                break;
+            case Reason::Stalled:
+                snprintf(text, sizeof(text), " after %g s without output", m_stall);
+                break;
+        }
+        logCallback("ERROR: Killed " + commandName(command) + text);
+        return kProcessTimedOut;
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        int step = -1;
+        Clock::time_point killed;
+        while (!m_stopped) {
+            m_wake.wait_for(lock, std::chrono::milliseconds(100));
+            if (m_stopped) {
+                break;
+            }
+            const auto now = Clock::now();
+            if (step < 0) {
+                const Clock::duration lastOutput(m_lastOutput.load(std::memory_order_relaxed));
+                const double elapsed = std::chrono::duration<double>(now - m_started).count();
+                const double silent = std::chrono::duration<double>(now - m_started - lastOutput).count();
+                if (m_cancel && m_cancel->load()) {
+                    m_reason = Reason::Cancelled;
+                } else if (m_timeout > 0.0 && elapsed > m_timeout) {
+                    m_reason = Reason::TimedOut;
+                } else if (m_stall > 0.0 && silent > m_stall) {
+                    m_reason = Reason::Stalled;
+                } else {
+                    continue;
+                }
+                killed = now;
+            } else if (step == 2 || now - killed < (step == 0 ? kStopGrace : kStopGrace + kAbandonGrace)) {
+                continue;
+            }
+            step++;
+            if (step == 2) {
+                m_abandoned = true;
+            }
+            lock.unlock();
+            m_kill(step);
+            lock.lock();
+        }
+    }
+
+    const std::atomic<bool>* m_cancel;
+    double m_timeout;
+    double m_stall;
+    std::function<void(int)> m_kill;
+    Clock::time_point m_started;
+    std::atomic<Clock::rep> m_lastOutput{0};
+    std::atomic<bool> m_abandoned{false};
+    Reason m_reason = Reason::None;  // written by the thread, read after stop()
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopped = false;
+    std::thread m_thread;
+};
+
+} // namespace
+
+#ifdef _WIN32
+
+std::string getExecutableDir() {
+    char buffer[MAX_PATH];
+    GetModuleFileNameA(NULL, buffer, MAX_PATH);
+    fs::path exePath(buffer);
+    return exePath.parent_path().string();
+}
+
+std::string getShortPathName(const std::string& longPath) {
+    char shortPath[MAX_PATH];
+    DWORD length = GetShortPathNameA(longPath.c_str(), shortPath, MAX_PATH);
+    if (length > 0 && length < MAX_PATH) {
+        return std::string(shortPath);
+    }
+    // If conversion fails, return original path
+    return longPath;
+}
+
+// Run command with hidden console window and capture output to GUI log
+int runCommandHidden(const std::string& command, LogCallback logCallback, const ProcessOutputOptions& options,
+                     ProcessStats* stats) {
+    const auto started = Clock::now();
+    if (options.cancel && *options.cancel) {
+        logCallback("ERROR: Cancelled - " + commandName(command) + " not started");
+        return kProcessCancelled;
+    }
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(SECURITY_ATTRIBUTES);
+    sa.bInheritHandle = TRUE;
+    sa.lpSecurityDescriptor = NULL;
+    
+    // Create pipes for stdout/stderr
+    HANDLE hReadPipe, hWritePipe;
+    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
+        logCallback("ERROR: Failed to create pipe");
+        return -1;
+    }
+    
+    SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
+    
+    STARTUPINFOA si = {};
+    si.cb = sizeof(STARTUPINFOA);
+    si.hStdOutput = hWritePipe;
+    si.hStdError = hWritePipe;
+    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+    si.wShowWindow = SW_HIDE;  // Hide the console window!
+    
+    PROCESS_INFORMATION pi = {};
+    
+    // Wrap command in cmd.exe; the outer quotes keep quoted paths intact
+    std::string fullCommand = "cmd.exe /c \"" + command + "\"";
+    char* cmdLine = _strdup(fullCommand.c_str());
+    
+    BOOL success = CreateProcessA(
+        NULL, cmdLine, NULL, NULL, TRUE,
+        CREATE_NO_WINDOW | CREATE_SUSPENDED, NULL, NULL, &si, &pi
+    );
+    
+    free(cmdLine);
+    CloseHandle(hWritePipe);
+    
+    if (!success) {
+        CloseHandle(hReadPipe);
+        DWORD error = GetLastError();
+        logCallback("ERROR: Failed to start process (error code: " + std::to_string(error) + ")");
+        return -1;
+    }
+    
+    // cmd.exe starts the real tool as its own process; a job object collects
+    // the accounting of both and lets the watchdog end them together. The
+    // process is started suspended so nothing runs outside the job. Without
+    // a job (nested jobs need Windows 8) only the wall time is reported and
+    // only cmd.exe itself can be killed.
+    HANDLE job = CreateJobObjectA(NULL, NULL);
+    if (job && !AssignProcessToJobObject(job, pi.hProcess)) {
+        CloseHandle(job);
+        job = NULL;
+    }
+    ResumeThread(pi.hThread);
+    
+    // The reader's thread handle, so a ReadFile the killed tree's pipe never
+    // completes can be cancelled
+    std::atomic<HANDLE> readerThread{NULL};
+    Watchdog watchdog(options, [&](int step) {
+        if (step == 0) {
+            if (!job || !TerminateJobObject(job, 1)) {
+                TerminateProcess(pi.hProcess, 1);
+            }
+        } else if (step == 2 && readerThread.load()) {
+            CancelSynchronousIo(readerThread.load());
+        }
+    });
+    
+    // Drain the pipe on its own thread so a slow log never blocks the child
+    OutputCapture capture(logCallback, options);
+    std::thread reader([&]() {
+        HANDLE self = NULL;
+        if (watchdog.active() && DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &self,
+                                                 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+            readerThread = self;
+        }
+        char buffer[64 * 1024];
+        DWORD bytesRead;
+        while (!watchdog.abandoned() && ReadFile(hReadPipe, buffer, sizeof(buffer), &bytesRead, NULL) &&
+               bytesRead > 0) {
+            watchdog.output();
+            capture.write(buffer, bytesRead);
+        }
+        capture.close();
+    });
+    capture.deliver();
+    reader.join();
+    WaitForSingleObject(pi.hProcess, INFINITE);
+    watchdog.stop();
+    if (readerThread.load()) {
+        CloseHandle(readerThread.load());
+    }
+    
+    DWORD exitCode;
+    GetExitCodeProcess(pi.hProcess, &exitCode);
+    
+    if (stats) {
+        *stats = ProcessStats();
+        stats->wallSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+    }
+    if (job && stats) {
+        JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accounting = {};
+        if (QueryInformationJobObject(job, JobObjectBasicAndIoAccountingInformation, &accounting,
+                                      sizeof(accounting), NULL)) {
+            // 100 ns units
+            stats->cpuSeconds = (accounting.BasicInfo.TotalUserTime.QuadPart +
+                                 accounting.BasicInfo.TotalKernelTime.QuadPart) * 1e-7;
+            stats->bytesRead = accounting.IoInfo.ReadTransferCount;
+            stats->bytesWritten = accounting.IoInfo.WriteTransferCount;
+        }
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits = {};
+        if (QueryInformationJobObject(job, JobObjectExtendedLimitInformation, &limits, sizeof(limits), NULL)) {
+            stats->peakMemoryBytes = limits.PeakProcessMemoryUsed;
+        }
+    }
+    if (job) {
+        CloseHandle(job);
+    }
+    
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+    CloseHandle(hReadPipe);
+    
+    return watchdog.result(static_cast<int>(exitCode), command, logCallback);
+}
+
+uint64_t currentProcessPeakMemory() {
+    PROCESS_MEMORY_COUNTERS counters = {};
+    counters.cb = sizeof(counters);
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+}
+
+#else
+
+std::string getExecutableDir() {
+    char buffer[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+    if (length > 0) {
+        buffer[length] = '\0';
+        return fs::path(buffer).parent_path().string();
+    }
+    return fs::current_path().string();
+}
+
+std::string getShortPathName(const std::string& longPath) {
+    return longPath;
+}
+
+namespace {
+
+// ru_maxrss is in kilobytes on Linux and in bytes on macOS
+uint64_t maxRssBytes(const struct rusage& usage) {
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+// rchar/wchar of an exited but not yet reaped child (Linux only). The kernel
+// has already added the totals of the children it waited for.
+void readProcIo(pid_t pid, ProcessStats& stats) {
+    std::ifstream io("/proc/" + std::to_string(pid) + "/io");
+    std::string key;
+    uint64_t value = 0;
+    while (io >> key >> value) {
+        if (key == "rchar:") {
+            stats.bytesRead = value;
+        } else if (key == "wchar:") {
+            stats.bytesWritten = value;
+        }
+    }
+}
+
+} // namespace
+
+int runCommandHidden(const std::string& command, LogCallback logCallback, const ProcessOutputOptions& options,
+                     ProcessStats* stats) {
+    const auto started = Clock::now();
+    if (options.cancel && *options.cancel) {
+        logCallback("ERROR: Cancelled - " + commandName(command) + " not started");
+        return kProcessCancelled;
+    }
+    int fds[2];
+#ifdef __linux__
+    // Close-on-exec so concurrently started children do not inherit each other's pipes
+    if (pipe2(fds, O_CLOEXEC) != 0) {
+#else
+    if (pipe(fds) != 0 || fcntl(fds[0], F_SETFD, FD_CLOEXEC) != 0 || fcntl(fds[1], F_SETFD, FD_CLOEXEC) != 0) {
+#endif
+        logCallback("ERROR: Failed to create pipe");
+        return -1;
+    }
+    
+    // Under a watchdog the command gets a process group of its own, so it
+    // can be killed with everything it starts (and a terminal's Ctrl-C only
+    // reaches this process, which cancels the run)
+    const bool ownGroup = options.cancel != nullptr || options.timeoutSeconds > 0.0 || options.stallSeconds > 0.0;
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        logCallback("ERROR: Failed to start process (errno: " + std::to_string(errno) + ")");
+        return -1;
+    }
+    
+    if (pid == 0) {
+        // Child: only async-signal-safe calls until exec
+        if (ownGroup) {
+            setpgid(0, 0);
+        }
+        int devNull = open("/dev/null", O_RDONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDIN_FILENO);
+        }
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+    
+    close(fds[1]);
+    if (ownGroup) {
+        setpgid(pid, pid);  // also here, in case the watchdog fires before the child ran
+    }
+    
+    Watchdog watchdog(options, [pid](int step) {
+        if (step < 2) {
+            const int signal = step == 0 ? SIGTERM : SIGKILL;
+            if (kill(-pid, signal) != 0) {
+                kill(pid, signal);
+            }
+        }
+    });
+    
+    // Drain the pipe on its own thread so a slow log never blocks the child.
+    // With a watchdog the reader wakes up regularly to see whether it should
+    // give up on the pipe.
+    OutputCapture capture(logCallback, options);
+    std::thread reader([&]() {
+        char buffer[64 * 1024];
+        const int timeout = watchdog.active() ? 100 : -1;
+        while (!watchdog.abandoned()) {
+            struct pollfd readable = {fds[0], POLLIN, 0};
+            const int ready = poll(&readable, 1, timeout);
+            if (ready == 0 || (ready < 0 && errno == EINTR)) continue;
+            ssize_t bytesRead = ready < 0 ? -1 : read(fds[0], buffer, sizeof(buffer));
+            if (bytesRead < 0 && errno == EINTR) continue;
+            if (bytesRead <= 0) break;
+            watchdog.output();
+            capture.write(buffer, static_cast<size_t>(bytesRead));
+        }
+        capture.close();
+    });
+    capture.deliver();
+    reader.join();
+    close(fds[0]);
+    
+    // Wait without reaping so /proc/<pid>/io is still there, and so the pid
+    // (and process group id) cannot be reused while the watchdog may signal it
+    siginfo_t info;
+    while (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) < 0 && errno == EINTR) {}
+    watchdog.stop();
+    if (stats) {
+        *stats = ProcessStats();
+        readProcIo(pid, *stats);
+    }
+    
+    int status = 0;
+    struct rusage usage = {};
+    while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {}
+    
+    if (stats) {
+        stats->wallSeconds = std::chrono::duration<double>(Clock::now() - started).count();
+        stats->cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+                            usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+        stats->peakMemoryBytes = maxRssBytes(usage);
+    }
+    
+    int exitCode = 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    if (WIFEXITED(status)) {
+        exitCode = WEXITSTATUS(status);
+    }
+    return watchdog.result(exitCode, command, logCallback);
+}
+
+uint64_t currentProcessPeakMemory() {
+    struct rusage usage = {};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? maxRssBytes(usage) : 0;
+}
+
+#endif
+
+std::string resolveTool(const std::string& configuredPath, const std::string& vendorRelative,
+                        const std::string& name) {
+    if (!configuredPath.empty()) {
+        return fs::exists(configuredPath) ? configuredPath : std::string();
+    }
+    
+    fs::path bundled = fs::path(getExecutableDir()) / "vendor" / vendorRelative;
+    if (fs::exists(bundled)) {
+        return bundled.string();
+    }
+    
+#ifndef _WIN32
+    // Installed tools on Linux render nodes
+    if (const char* path = std::getenv("PATH")) {
+        std::string dirs(path);
+        size_t start = 0;
+        while (start <= dirs.size()) {
+            size_t end = dirs.find(':', start);
+            if (end == std::string::npos) end = dirs.size();
+            fs::path candidate = fs::path(dirs.substr(start, end - start)) / name;
+            if (end > start && access(candidate.c_str(), X_OK) == 0) {
+                return candidate.string();
+            }
+            start = end + 1;
+        }
+    }
+#else
+    (void)name;
+#endif
+    return std::string();
+}
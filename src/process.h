@@ -0,0 +1,56 @@
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include "pipeline.h"
+#include "output_capture.h"
+#include <cstdint>
+#include <string>
+
+// Directory containing the running executable (vendor/ lives next to it)
+std::string getExecutableDir();
+
+// Convert path to Windows short path name (8.3 format) to avoid space issues.
+// Returns the path unchanged on other platforms.
+std::string getShortPathName(const std::string& longPath);
+
+// Locate a bundled or installed tool. Order: explicit path, vendor/<vendorRelative>
+// next to the executable, then (outside Windows) <name> on the PATH.
+// Returns an empty string if nothing was found.
+std::string resolveTool(const std::string& configuredPath, const std::string& vendorRelative,
+                        const std::string& name);
+
+// Resources used by a finished command, including every process it started
+// (on Windows all processes of its job object, elsewhere the shell and its
+// waited-for children). Fields that the platform cannot report stay 0.
+struct ProcessStats {
+    double wallSeconds = 0.0;
+    double cpuSeconds = 0.0;         // user + kernel time
+    uint64_t peakMemoryBytes = 0;    // largest single process: peak RSS (POSIX), peak commit (Windows)
+    uint64_t bytesRead = 0;          // read()/ReadFile() bytes, including page-cache hits
+    uint64_t bytesWritten = 0;
+};
+
+// runCommandHidden's result when its watchdog killed the command
+const int kProcessCancelled = -2;  // *options.cancel was set
+const int kProcessTimedOut = -3;   // it exceeded timeoutSeconds or stallSeconds
+
+// Run a shell command line without a console window, forwarding its combined
+// stdout/stderr line by line to logCallback. Windows runs it through "cmd.exe /c",
+// other platforms through "/bin/sh -c". The pipe is drained on a separate thread
+// (see OutputCapture), so the child never waits for logCallback. Returns the exit
+// code, or -1 if it could not be started. If stats is given it receives the
+// command's resource usage.
+//
+// With a cancel flag or time limit in options, a watchdog thread ends the
+// command together with every process it started: the Windows job object is
+// terminated; elsewhere the command runs in its own process group, which
+// gets SIGTERM and, 3 seconds later, SIGKILL. The reason is logged as an
+// ERROR line and kProcessCancelled or kProcessTimedOut returned.
+int runCommandHidden(const std::string& command, LogCallback logCallback,
+                     const ProcessOutputOptions& options = ProcessOutputOptions(),
+                     ProcessStats* stats = nullptr);
+
+// Peak memory of the running process itself (resident set / working set), in bytes
+uint64_t currentProcessPeakMemory();
+
+#endif // PROCESS_H
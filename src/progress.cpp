@@ -0,0 +1,398 @@
+#include "progress.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <memory>
+
+namespace {
+
+// Rates are re-measured at most this often and smoothed with this weight
+const double kRateSampleSeconds = 1.0;
+const double kRateSmoothing = 0.3;
+
+// The overall ETA is only published once it rests on this much evidence
+const double kMinWorkSeconds = 5.0;
+
+template <typename Number>
+bool readNumber(std::string_view text, size_t& pos, Number& value) {
+    const char* begin = text.data() + pos;
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    pos = result.ptr - text.data();
+    return true;
+}
+
+// "<keyword> [i/n" -> i, n; the rest of the bracket is left at pos
+bool findCounter(std::string_view line, std::string_view keyword, size_t& pos, long& done, long& total) {
+    size_t found = line.find(keyword);
+    if (found == std::string_view::npos) {
+        return false;
+    }
+    pos = found + keyword.size();
+    while (pos < line.size() && line[pos] == ' ') pos++;
+    if (pos >= line.size() || line[pos] != '[') {
+        return false;
+    }
+    pos++;
+    if (!readNumber(line, pos, done) || pos >= line.size() || line[pos] != '/') {
+        return false;
+    }
+    pos++;
+    return readNumber(line, pos, total) && total > 0;
+}
+
+} // namespace
+
+bool parseFfmpegClock(std::string_view text, double& seconds) {
+    size_t pos = 0;
+    long hours = 0, minutes = 0;
+    double secs = 0.0;
+    if (!readNumber(text, pos, hours) || pos >= text.size() || text[pos++] != ':' ||
+        !readNumber(text, pos, minutes) || pos >= text.size() || text[pos++] != ':' ||
+        !readNumber(text, pos, secs)) {
+        return false;
+    }
+    seconds = hours * 3600.0 + minutes * 60.0 + secs;
+    return true;
+}
+
+std::string formatDuration(double seconds) {
+    const long total = static_cast<long>(std::max(0.0, seconds) + 0.5);
+    char text[32];
+    if (total < 60) {
+        std::snprintf(text, sizeof(text), "%lds", total);
+    } else if (total < 3600) {
+        std::snprintf(text, sizeof(text), "%ldm %02lds", total / 60, total % 60);
+    } else {
+        std::snprintf(text, sizeof(text), "%ldh %02ldm", total / 3600, (total / 60) % 60);
+    }
+    return text;
+}
+
+std::string describeProgress(const ProgressEvent& event) {
+    char text[256];
+    std::string line = event.stage;
+    if (event.finished) {
+        line += ": done";
+    } else if (event.total > 0.0) {
+        std::snprintf(text, sizeof(text), ": %.0f/%.0f %s", event.done, event.total, event.unit.c_str());
+        line += text;
+        if (event.rate > 0.0) {
+            std::snprintf(text, sizeof(text), ", %.3g/s", event.rate);
+            line += text;
+        }
+        if (event.etaSeconds >= 0.0) {
+            line += ", " + formatDuration(event.etaSeconds) + " left";
+        }
+    } else {
+        line += ": running for " + formatDuration(event.elapsedSeconds);
+    }
+    std::snprintf(text, sizeof(text), " | overall %.0f%%", event.overallFraction * 100.0);
+    line += text;
+    if (event.overallEtaSeconds >= 0.0) {
+        line += ", about " + formatDuration(event.overallEtaSeconds) + " left";
+    }
+    return line;
+}
+
+const char* ffmpegProgressArguments() {
+    return " -progress pipe:1 -nostats";
+}
+
+ProgressParser::ProgressParser(ProgressSource source, double total) : m_source(source), m_total(total) {}
+
+bool ProgressParser::set(double done, double total) {
+    if (done == m_done && total == m_total) {
+        return false;
+    }
+    m_done = done;
+    m_total = total;
+    return true;
+}
+
+bool ProgressParser::parse(std::string_view line, bool& consumed) {
+    consumed = false;
+    size_t pos = 0;
+    long done = 0, total = 0;
+    switch (m_source) {
+        case ProgressSource::None:
+            return false;
+        case ProgressSource::Ffmpeg:
+        case ProgressSource::FfmpegFrames:
+            return parseFfmpeg(line, consumed);
+        case ProgressSource::ColmapFeatures:
+            return findCounter(line, "Processed file", pos, done, total) && set(done, total);
+        case ProgressSource::ColmapUndistort:
+            return findCounter(line, "Undistorting image", pos, done, total) && set(done, total);
+        case ProgressSource::ColmapMatching: {
+            if (findCounter(line, "Matching image", pos, done, total)) {
+                return set(done, total);
+            }
+            if (!findCounter(line, "Matching block", pos, done, total)) {
+                return false;
+            }
+            // Exhaustive matching walks an n x m grid of blocks: "[i/n, j/m]"
+            long inner = 0, innerTotal = 0;
+            if (pos + 1 < line.size() && line[pos] == ',') {
+                pos++;
+                while (pos < line.size() && line[pos] == ' ') pos++;
+                if (readNumber(line, pos, inner) && pos < line.size() && line[pos] == '/' &&
+                    readNumber(line, ++pos, innerTotal) && innerTotal > 0) {
+                    return set(static_cast<double>(done - 1) * innerTotal + inner,
+                               static_cast<double>(total) * innerTotal);
+                }
+            }
+            return set(done, total);
+        }
+        case ProgressSource::ColmapMapper: {
+            // "Registering image #123 (45)": 45 images registered so far
+            size_t found = line.find("Registering image #");
+            if (found == std::string_view::npos) {
+                return false;
+            }
+            pos = line.find('(', found);
+            if (pos == std::string_view::npos || !readNumber(line, ++pos, done)) {
+                return false;
+            }
+            return set(static_cast<double>(done), m_total);
+        }
+    }
+    return false;
+}
+
+bool ProgressParser::parseFfmpeg(std::string_view line, bool& consumed) {
+    // The input's length from the banner: "  Duration: 00:05:12.34, start: ..."
+    size_t duration = line.find("Duration: ");
+    if (duration != std::string_view::npos && m_source == ProgressSource::Ffmpeg) {
+        double seconds = 0.0;
+        if (m_total <= 0.0 && parseFfmpegClock(line.substr(duration + 10), seconds) && seconds > 0.0) {
+            return set(m_done, seconds);
+        }
+        return false;
+    }
+
+    // -progress output: "key=value" lines without spaces
+    size_t eq = line.find('=');
+    if (eq == std::string_view::npos || eq == 0 || line.find(' ') != std::string_view::npos) {
+        return false;
+    }
+    std::string_view key = line.substr(0, eq);
+    auto keyChar = [](char c) { return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_'; };
+    if (!std::all_of(key.begin(), key.end(), keyChar)) {
+        return false;
+    }
+    consumed = true;
+
+    std::string_view value = line.substr(eq + 1);
+    if (m_source == ProgressSource::FfmpegFrames) {
+        // Frames of the first output; each input image is one frame
+        size_t pos = 0;
+        long long frames = 0;
+        if (key == "frame" && readNumber(value, pos, frames) && frames >= 0) {
+            return set(m_total > 0.0 ? std::min<double>(frames, m_total) : frames, m_total);
+        }
+    }
+    if (m_source == ProgressSource::Ffmpeg && (key == "out_time_us" || key == "out_time_ms")) {
+        // Both are microseconds (out_time_ms is misnamed in ffmpeg)
+        size_t pos = 0;
+        long long microseconds = 0;
+        if (readNumber(value, pos, microseconds) && microseconds >= 0) {
+            double seconds = microseconds / 1e6;
+            if (m_total > 0.0) {
+                seconds = std::min(seconds, m_total);
+            }
+            return set(seconds, m_total);
+        }
+    } else if (key == "progress" && value == "end" && m_total > 0.0) {
+        return set(m_total, m_total);
+    }
+    return false;
+}
+
+ProgressModel::ProgressModel(ProgressCallback callback, double publishInterval)
+    : m_callback(std::move(callback)), m_publishInterval(publishInterval), m_start(Clock::now()) {}
+
+ProgressModel::Stage& ProgressModel::stageLocked(const std::string& name) {
+    return m_stages[name];
+}
+
+void ProgressModel::plan(const std::string& stage, double cost) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stageLocked(stage).cost = std::max(0.0, cost);
+}
+
+void ProgressModel::unplan(const std::string& stage) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_stages.find(stage);
+    if (it != m_stages.end() && !it->second.started) {
+        m_stages.erase(it);
+    }
+}
+
+void ProgressModel::start(const std::string& stage, double total, const std::string& unit) {
+    if (!m_callback) {
+        return;
+    }
+    ProgressEvent event;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Clock::time_point now = Clock::now();
+        Stage& entry = stageLocked(stage);
+        entry.started = true;
+        entry.finished = false;
+        entry.skipped = false;
+        entry.done = 0.0;
+        entry.total = total;
+        entry.unit = unit;
+        entry.rate = 0.0;
+        entry.startTime = now;
+        entry.sampleTime = now;
+        entry.sampleDone = 0.0;
+        entry.lastPublish = now;
+        if (!m_working) {
+            m_working = true;
+            m_workStart = now;
+        }
+        event = eventLocked(stage, entry, now);
+    }
+    publish(event);
+}
+
+void ProgressModel::update(const std::string& stage, double done, double total) {
+    if (!m_callback) {
+        return;
+    }
+    ProgressEvent event;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Clock::time_point now = Clock::now();
+        Stage& entry = stageLocked(stage);
+        entry.done = done;
+        if (total > 0.0) {
+            entry.total = total;
+        }
+
+        const double sampleSeconds = std::chrono::duration<double>(now - entry.sampleTime).count();
+        if (sampleSeconds >= kRateSampleSeconds) {
+            const double rate = (done - entry.sampleDone) / sampleSeconds;
+            entry.rate = entry.rate > 0.0 ? entry.rate + kRateSmoothing * (rate - entry.rate) : rate;
+            entry.sampleTime = now;
+            entry.sampleDone = done;
+        }
+
+        if (std::chrono::duration<double>(now - entry.lastPublish).count() < m_publishInterval) {
+            return;
+        }
+        entry.lastPublish = now;
+        event = eventLocked(stage, entry, now);
+    }
+    publish(event);
+}
+
+void ProgressModel::finish(const std::string& stage) {
+    if (!m_callback) {
+        return;
+    }
+    ProgressEvent event;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stage& entry = stageLocked(stage);
+        entry.finished = true;
+        if (entry.total > 0.0) {
+            entry.done = entry.total;
+        }
+        event = eventLocked(stage, entry, Clock::now());
+    }
+    publish(event);
+}
+
+void ProgressModel::skip(const std::string& stage) {
+    if (!m_callback) {
+        return;
+    }
+    ProgressEvent event;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stage& entry = stageLocked(stage);
+        entry.finished = true;
+        entry.skipped = true;
+        event = eventLocked(stage, entry, Clock::now());
+    }
+    publish(event);
+}
+
+ProgressEvent ProgressModel::eventLocked(const std::string& name, Stage& stage, Clock::time_point now) {
+    ProgressEvent event;
+    event.stage = name;
+    event.done = stage.done;
+    event.total = stage.total;
+    event.unit = stage.unit;
+    event.finished = stage.finished;
+    event.elapsedSeconds = std::chrono::duration<double>(now - m_start).count();
+
+    // Until the first rate sample, the average since the stage started
+    double rate = stage.rate;
+    const double stageSeconds = std::chrono::duration<double>(now - stage.startTime).count();
+    if (rate <= 0.0 && stage.started && stageSeconds > 0.0 && stage.done > 0.0) {
+        rate = stage.done / stageSeconds;
+    }
+    event.rate = rate;
+    if (stage.finished) {
+        event.etaSeconds = 0.0;
+    } else if (stage.total > 0.0 && rate > 0.0) {
+        event.etaSeconds = std::max(0.0, stage.total - stage.done) / rate;
+    }
+
+    double totalCost = 0.0, doneCost = 0.0, workedCost = 0.0;
+    for (const auto& entry : m_stages) {
+        const Stage& s = entry.second;
+        double fraction = s.finished ? 1.0 : (s.total > 0.0 ? std::min(1.0, s.done / s.total) : 0.0);
+        totalCost += s.cost;
+        doneCost += s.cost * fraction;
+        if (!s.skipped) {
+            workedCost += s.cost * fraction;
+        }
+    }
+    if (totalCost > 0.0) {
+        event.overallFraction = doneCost / totalCost;
+    }
+
+    // Remaining expected cost, scaled by how the estimates have compared with
+    // the wall clock so far (covers a slow disk, a fast GPU, parallel videos)
+    const double workSeconds = m_working ? std::chrono::duration<double>(now - m_workStart).count() : 0.0;
+    if (workedCost > 0.0 && workSeconds >= kMinWorkSeconds) {
+        event.overallEtaSeconds = (totalCost - doneCost) * workSeconds / workedCost;
+    }
+    return event;
+}
+
+void ProgressModel::publish(const ProgressEvent& event) {
+    if (m_callback) {
+        m_callback(event);
+    }
+}
+
+ProcessOutputOptions ProgressModel::observe(const ProcessOutputOptions& output, const std::string& stage,
+                                            ProgressSource source, double total) {
+    ProcessOutputOptions options = output;
+    // ffmpeg runs with -progress either way, so its key=value blocks are
+    // parsed (and kept out of the log) even when nobody listens
+    const bool listening = static_cast<bool>(m_callback);
+    const bool ffmpeg = source == ProgressSource::Ffmpeg || source == ProgressSource::FfmpegFrames;
+    if (source == ProgressSource::None || (!listening && !ffmpeg)) {
+        return options;
+    }
+    auto parser = std::make_shared<ProgressParser>(source, total);
+    auto previous = output.lineObserver;
+    options.lineObserver = [this, parser, stage, previous, listening](std::string_view line) {
+        bool consumed = false;
+        if (parser->parse(line, consumed) && listening) {
+            update(stage, parser->done(), parser->total());
+        }
+        return consumed || (previous && previous(line));
+    };
+    return options;
+}
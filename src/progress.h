@@ -0,0 +1,121 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include "output_capture.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Which tool output a ProgressParser understands
+enum class ProgressSource {
+    None,
+    Ffmpeg,           // "-progress pipe:1" key=value blocks plus the "Duration:" banner line
+    FfmpegFrames,     // the same blocks counted in output frames ("frame="), total = frame count
+    ColmapFeatures,   // "Processed file [i/n]"
+    ColmapMatching,   // "Matching block [i/n, j/m]", "Matching block [i/n]", "Matching image [i/n]"
+    ColmapMapper,     // "Registering image #id (registered)", total = image count
+    ColmapUndistort   // "Undistorting image [i/n]"
+};
+
+// "45s", "12m 30s", "3h 05m"
+std::string formatDuration(double seconds);
+
+// ffmpeg's "HH:MM:SS.ss" (as in its "Duration:" banner line) -> seconds; any
+// number of fractional digits. False for "N/A" and anything else.
+bool parseFfmpegClock(std::string_view text, double& seconds);
+
+// One-line summary for a status bar, e.g.
+// "colmap matching: 120/300 images, 2.5/s, 1m 12s left | overall 43%, about 15m 00s left"
+std::string describeProgress(const ProgressEvent& event);
+
+// Arguments that make ffmpeg write machine-readable progress to stdout
+// instead of its carriage-return status line; run such a command with
+// ProgressModel::observe(..., ProgressSource::Ffmpeg or FfmpegFrames) options
+const char* ffmpegProgressArguments();
+
+// Reads done/total counts from one tool's output lines
+class ProgressParser {
+public:
+    // total: known amount of work (images for the mapper, video seconds for
+    // ffmpeg when the length is known in advance); 0 = take it from the output
+    explicit ProgressParser(ProgressSource source, double total = 0.0);
+
+    // Returns true if done() or total() changed. consumed is set for lines
+    // that only carry progress and should not be logged.
+    bool parse(std::string_view line, bool& consumed);
+
+    double done() const { return m_done; }
+    double total() const { return m_total; }
+
+private:
+    bool parseFfmpeg(std::string_view line, bool& consumed);
+    bool set(double done, double total);
+
+    ProgressSource m_source;
+    double m_done = 0.0;
+    double m_total = 0.0;
+};
+
+// Turns per-stage done/total counts into ProgressEvents with rates and ETAs.
+// Every stage of the run is planned up front with its expected cost (rough
+// seconds); the overall fraction weights stages by that cost, and the overall
+// ETA scales the remaining cost by how fast the run has actually been going.
+// Thread-safe; the callback is called without the internal lock held.
+class ProgressModel {
+public:
+    explicit ProgressModel(ProgressCallback callback, double publishInterval = 0.5);
+
+    // Add a stage or replace its estimate (e.g. once the frame count is known)
+    void plan(const std::string& stage, double cost);
+    // Drop a planned stage that will not run
+    void unplan(const std::string& stage);
+
+    void start(const std::string& stage, double total, const std::string& unit);
+    void update(const std::string& stage, double done, double total);
+    void finish(const std::string& stage);
+    // Stage already done (resumed run): counts as complete but took no time
+    void skip(const std::string& stage);
+
+    // Output options that feed a tool's progress lines into stage. ffmpeg's
+    // -progress lines (ffmpegProgressArguments) are always consumed, with or
+    // without a callback, so they never reach the log.
+    ProcessOutputOptions observe(const ProcessOutputOptions& output, const std::string& stage,
+                                 ProgressSource source, double total = 0.0);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stage {
+        double cost = 0.0;
+        double done = 0.0;
+        double total = 0.0;
+        std::string unit;
+        bool started = false;
+        bool finished = false;
+        bool skipped = false;
+        Clock::time_point startTime;
+        Clock::time_point lastPublish;
+        // Rate smoothing
+        Clock::time_point sampleTime;
+        double sampleDone = 0.0;
+        double rate = 0.0;
+    };
+
+    Stage& stageLocked(const std::string& name);
+    ProgressEvent eventLocked(const std::string& name, Stage& stage, Clock::time_point now);
+    void publish(const ProgressEvent& event);
+
+    ProgressCallback m_callback;
+    const double m_publishInterval;
+    const Clock::time_point m_start;
+
+    std::mutex m_mutex;
+    std::map<std::string, Stage> m_stages;
+    bool m_working = false;          // a stage that does real work has started
+    Clock::time_point m_workStart;   // ... at this time (skipped stages take none)
+};
+
+#endif // PROGRESS_H
@@ -0,0 +1,158 @@
+#include "sharpness.h"
+#include <cstdlib>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHARPNESS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Skip whitespace and '#' comments in a PNM header
+bool readPnmToken(std::istream& in, std::string& token) {
+    token.clear();
+    int c;
+    while ((c = in.get()) != EOF) {
+        if (c == '#') {
+            while ((c = in.get()) != EOF && c != '\n') {}
+        } else if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            break;
+        }
+    }
+    while (c != EOF && c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+        token += static_cast<char>(c);
+        c = in.get();
+    }
+    return !token.empty();
+}
+
+double finish(int64_t sum, int64_t sumSquares, size_t count) {
+    if (count == 0) {
+        return 0.0;
+    }
+    const double mean = static_cast<double>(sum) / count;
+    return static_cast<double>(sumSquares) / count - mean * mean;
+}
+
+} // namespace
+
+bool readPgm(const std::string& path, GrayImage& image, std::string* error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+
+    std::string magic, width, height, maxValue;
+    if (!readPnmToken(file, magic) || magic != "P5" || !readPnmToken(file, width) ||
+        !readPnmToken(file, height) || !readPnmToken(file, maxValue)) {
+        if (error) *error = "not a binary PGM: " + path;
+        return false;
+    }
+    image.width = std::strtoul(width.c_str(), nullptr, 10);
+    image.height = std::strtoul(height.c_str(), nullptr, 10);
+    if (std::strtoul(maxValue.c_str(), nullptr, 10) > 255 || image.width == 0 || image.height == 0) {
+        if (error) *error = "unsupported PGM (16-bit or empty): " + path;
+        return false;
+    }
+
+    // The single whitespace byte after maxval was consumed by readPnmToken
+    image.pixels.resize(image.width * image.height);
+    file.read(reinterpret_cast<char*>(image.pixels.data()), image.pixels.size());
+    if (file.gcount() != static_cast<std::streamsize>(image.pixels.size())) {
+        if (error) *error = "truncated PGM: " + path;
+        return false;
+    }
+    return true;
+}
+
+double laplacianVarianceScalar(const uint8_t* pixels, size_t width, size_t height, size_t stride) {
+    if (width < 3 || height < 3) {
+        return 0.0;
+    }
+    int64_t sum = 0;
+    int64_t sumSquares = 0;
+    for (size_t y = 1; y + 1 < height; y++) {
+        const uint8_t* up = pixels + (y - 1) * stride;
+        const uint8_t* row = pixels + y * stride;
+        const uint8_t* down = pixels + (y + 1) * stride;
+        for (size_t x = 1; x + 1 < width; x++) {
+            const int laplacian = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+            sum += laplacian;
+            sumSquares += laplacian * laplacian;
+        }
+    }
+    return finish(sum, sumSquares, (width - 2) * (height - 2));
+}
+
+#ifdef SHARPNESS_SSE2
+
+double laplacianVariance(const uint8_t* pixels, size_t width, size_t height, size_t stride) {
+    if (width < 3 || height < 3) {
+        return 0.0;
+    }
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    int64_t sum = 0;
+    int64_t sumSquares = 0;
+
+    for (size_t y = 1; y + 1 < height; y++) {
+        const uint8_t* up = pixels + (y - 1) * stride;
+        const uint8_t* row = pixels + y * stride;
+        const uint8_t* down = pixels + (y + 1) * stride;
+
+        // |L| <= 1020, so one madd lane adds at most 2 * 1020^2 per step; the
+        // 32-bit accumulators are spilled every 512 steps (4096 pixels)
+        __m128i rowSum = zero;
+        __m128i rowSquares = zero;
+        size_t steps = 0;
+        size_t x = 1;
+        for (; x + 8 + 1 <= width; x += 8) {
+            __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x)), zero);
+            __m128i l = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x - 1)), zero);
+            __m128i r = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + x + 1)), zero);
+            __m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(up + x)), zero);
+            __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(down + x)), zero);
+
+            __m128i laplacian = _mm_slli_epi16(c, 2);
+            laplacian = _mm_sub_epi16(laplacian, _mm_add_epi16(_mm_add_epi16(l, r), _mm_add_epi16(u, d)));
+
+            rowSum = _mm_add_epi32(rowSum, _mm_madd_epi16(laplacian, ones));
+            rowSquares = _mm_add_epi32(rowSquares, _mm_madd_epi16(laplacian, laplacian));
+
+            if (++steps == 512) {
+                steps = 0;
+                alignas(16) int32_t lanes[8];
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes), rowSum);
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes + 4), rowSquares);
+                sum += static_cast<int64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+                sumSquares += static_cast<int64_t>(lanes[4]) + lanes[5] + lanes[6] + lanes[7];
+                rowSum = zero;
+                rowSquares = zero;
+            }
+        }
+
+        alignas(16) int32_t lanes[8];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), rowSum);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes + 4), rowSquares);
+        sum += static_cast<int64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+        sumSquares += static_cast<int64_t>(lanes[4]) + lanes[5] + lanes[6] + lanes[7];
+
+        // Remaining columns
+        for (; x + 1 < width; x++) {
+            const int laplacian = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+            sum += laplacian;
+            sumSquares += laplacian * laplacian;
+        }
+    }
+    return finish(sum, sumSquares, (width - 2) * (height - 2));
+}
+
+#else
+
+double laplacianVariance(const uint8_t* pixels, size_t width, size_t height, size_t stride) {
+    return laplacianVarianceScalar(pixels, width, height, stride);
+}
+
+#endif
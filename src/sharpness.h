@@ -0,0 +1,32 @@
+#ifndef SHARPNESS_H
+#define SHARPNESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8-bit single-channel image (e.g. the downscaled luma plane ffmpeg writes as PGM)
+struct GrayImage {
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<uint8_t> pixels;  // row-major, stride == width
+};
+
+// Read a binary (P5) 8-bit PGM file
+bool readPgm(const std::string& path, GrayImage& image, std::string* error = nullptr);
+
+// Sharpness score: variance of the 4-neighbour Laplacian over the interior
+// pixels. Motion blur and defocus flatten edges and give low values; the
+// absolute value depends on content, so compare frames of the same video.
+// Uses SSE2 where available (x86-64 always), otherwise the scalar version.
+double laplacianVariance(const uint8_t* pixels, size_t width, size_t height, size_t stride);
+
+// Portable reference implementation (same result as laplacianVariance)
+double laplacianVarianceScalar(const uint8_t* pixels, size_t width, size_t height, size_t stride);
+
+inline double laplacianVariance(const GrayImage& image) {
+    return laplacianVariance(image.pixels.data(), image.width, image.height, image.width);
+}
+
+#endif // SHARPNESS_H
@@ -0,0 +1,297 @@
+#include "stage_manifest.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const kHeader = "# DroneRecon stage manifest - delete this file to rerun every stage";
+
+std::string hex(uint64_t value) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+std::string formatNumber(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.12g", value);
+    return text;
+}
+
+// "size mtime" of a file, or empty if it does not exist
+std::string fileStamp(const fs::path& path) {
+    std::error_code ec;
+    const uintmax_t size = fs::file_size(path, ec);
+    if (ec) {
+        return std::string();
+    }
+    const auto modified = fs::last_write_time(path, ec);
+    if (ec) {
+        return std::string();
+    }
+    return std::to_string(size) + " " + std::to_string(modified.time_since_epoch().count());
+}
+
+// A frame's record and content hash, tab-separated
+std::string frameRecordLine(const FrameRecord& frame) {
+    std::ostringstream line;
+    line << frame.name << '\t' << frame.index << '\t' << formatNumber(frame.timestamp) << '\t'
+         << (frame.hasGps ? 1 : 0) << '\t' << formatNumber(frame.latitude) << '\t'
+         << formatNumber(frame.longitude) << '\t' << formatNumber(frame.altitude) << '\t' << hex(frame.contentHash);
+    return line.str();
+}
+
+std::vector<std::string> splitTabs(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == std::string::npos) {
+            return fields;
+        }
+        start = tab + 1;
+    }
+}
+
+} // namespace
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void StageInputs::add(const std::string& name, double value) {
+    add(name, formatNumber(value));
+}
+
+void StageInputs::addFile(const std::string& name, const std::string& path) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(path, ec);
+    std::string stamp = fileStamp(path);
+    add(name, (ec ? fs::path(path) : absolute).string() + " " + (stamp.empty() ? "missing" : stamp));
+}
+
+bool hashFile(const std::string& path, uint64_t& hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    hash = fnv1a(nullptr, 0);
+    std::vector<char> buffer(1 << 16);
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+        hash = fnv1a(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+    return file.eof();
+}
+
+void StageInputs::addFileContents(const std::string& name, const std::string& path) {
+    uint64_t hash = 0;
+    add(name, hashFile(path, hash) ? hex(hash) : std::string("missing"));
+}
+
+std::string StageInputs::digest() const {
+    uint64_t hash = fnv1a(nullptr, 0);
+    for (const auto& value : m_values) {
+        hash = fnv1a(value.first.data(), value.first.size(), hash);
+        hash = fnv1a("=", 1, hash);
+        hash = fnv1a(value.second.data(), value.second.size(), hash);
+        hash = fnv1a("\n", 1, hash);
+    }
+    return hex(hash);
+}
+
+std::string StageInputs::digestOf(const std::vector<std::string>& lines) {
+    uint64_t hash = fnv1a(nullptr, 0);
+    for (const auto& line : lines) {
+        hash = fnv1a(line.data(), line.size(), hash);
+        hash = fnv1a("\n", 1, hash);
+    }
+    return hex(hash);
+}
+
+bool StageManifest::load() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stages.clear();
+    m_loaded = false;
+    std::ifstream file(m_path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != kHeader) {
+        return false;
+    }
+    m_loaded = true;
+    Stage* current = nullptr;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.size() > 2 && line.front() == '[' && line.back() == ']') {
+            current = &m_stages[line.substr(1, line.size() - 2)];
+        } else if (current && line.rfind("in ", 0) == 0) {
+            size_t eq = line.find('=', 3);
+            if (eq != std::string::npos) {
+                current->inputs.emplace_back(line.substr(3, eq - 3), line.substr(eq + 1));
+            }
+        } else if (current && line.rfind("out ", 0) == 0) {
+            current->outputs.push_back(line.substr(4));
+        }
+    }
+    return true;
+}
+
+bool StageManifest::isCurrent(const std::string& stage, const StageInputs& inputs, std::string* reason) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_stages.find(stage);
+    if (it == m_stages.end()) {
+        if (reason) *reason = "no completed run recorded";
+        return false;
+    }
+    const auto& recorded = it->second.inputs;
+    const auto& current = inputs.values();
+    for (size_t i = 0; i < current.size(); i++) {
+        if (i >= recorded.size() || recorded[i] != current[i]) {
+            if (reason) *reason = current[i].first + " changed";
+            return false;
+        }
+    }
+    if (recorded.size() != current.size()) {
+        if (reason) *reason = "inputs changed";
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> StageManifest::outputs(const std::string& stage) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_stages.find(stage);
+    return it == m_stages.end() ? std::vector<std::string>() : it->second.outputs;
+}
+
+std::vector<std::string> StageManifest::stages(const std::string& prefix) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> names;
+    for (const auto& stage : m_stages) {
+        if (stage.first.rfind(prefix, 0) == 0) {
+            names.push_back(stage.first);
+        }
+    }
+    return names;
+}
+
+void StageManifest::begin(const std::string& stage) {
+    remove(stage);
+}
+
+void StageManifest::complete(const std::string& stage, const StageInputs& inputs, std::vector<std::string> outputs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stage& entry = m_stages[stage];
+    entry.inputs = inputs.values();
+    entry.outputs = std::move(outputs);
+    saveLocked();
+}
+
+void StageManifest::remove(const std::string& stage) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stages.erase(stage) > 0) {
+        saveLocked();
+    }
+}
+
+size_t StageManifest::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stages.size();
+}
+
+bool StageManifest::saveLocked() const {
+    // Write a new file and rename it over the old one, so an interrupted
+    // write never leaves a truncated manifest behind
+    const std::string temporary = m_path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file << kHeader << '\n';
+        for (const auto& stage : m_stages) {
+            file << '[' << stage.first << "]\n";
+            for (const auto& input : stage.second.inputs) {
+                file << "in " << input.first << '=' << input.second << '\n';
+            }
+            for (const auto& output : stage.second.outputs) {
+                file << "out " << output << '\n';
+            }
+        }
+        if (!file.good()) {
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(temporary, m_path, ec);
+    return !ec;
+}
+
+std::vector<std::string> frameManifestEntries(const std::string& framesDir, const std::vector<FrameRecord>& frames) {
+    std::vector<std::string> entries;
+    entries.reserve(frames.size());
+    for (const auto& frame : frames) {
+        std::string stamp = fileStamp(fs::path(framesDir) / frame.name);
+        size_t space = stamp.find(' ');
+        entries.push_back(frameRecordLine(frame) + '\t' +
+                          (space == std::string::npos ? "0\t0" : stamp.substr(0, space) + '\t' + stamp.substr(space + 1)));
+    }
+    return entries;
+}
+
+bool restoreFrames(const std::string& framesDir, const std::vector<std::string>& entries,
+                   std::vector<FrameRecord>& frames) {
+    std::vector<FrameRecord> restored;
+    restored.reserve(entries.size());
+    for (const auto& entry : entries) {
+        std::vector<std::string> fields = splitTabs(entry);
+        if (fields.size() != 10) {
+            return false;  // also manifests from before content hashes
+        }
+        const fs::path path = fs::path(framesDir) / fields[0];
+        const uint64_t contentHash = std::strtoull(fields[7].c_str(), nullptr, 16);
+        uint64_t hash = 0;
+        if (fileStamp(path) != fields[8] + " " + fields[9] &&
+            (!hashFile(path.string(), hash) || hash != contentHash)) {
+            return false;
+        }
+        FrameRecord frame;
+        frame.name = fields[0];
+        frame.index = std::strtoull(fields[1].c_str(), nullptr, 10);
+        frame.timestamp = std::strtod(fields[2].c_str(), nullptr);
+        frame.hasGps = fields[3] == "1";
+        frame.latitude = std::strtod(fields[4].c_str(), nullptr);
+        frame.longitude = std::strtod(fields[5].c_str(), nullptr);
+        frame.altitude = std::strtod(fields[6].c_str(), nullptr);
+        frame.contentHash = contentHash;
+        restored.push_back(std::move(frame));
+    }
+    frames = std::move(restored);
+    return true;
+}
+
+std::string frameListDigest(const std::string& framesDir, const std::vector<FrameRecord>& frames) {
+    std::vector<std::string> lines;
+    lines.reserve(frames.size());
+    for (const auto& frame : frames) {
+        lines.push_back(frameRecordLine(frame) +
+                        (frame.contentHash != 0 ? std::string() : '\t' + fileStamp(fs::path(framesDir) / frame.name)));
+    }
+    return StageInputs::digestOf(lines);
+}
@@ -0,0 +1,101 @@
+#ifndef STAGE_MANIFEST_H
+#define STAGE_MANIFEST_H
+
+#include "frame_record.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// What a pipeline stage depends on, as ordered "name = value" pairs.
+// Two runs of a stage with equal inputs produce the same outputs.
+class StageInputs {
+public:
+    void add(const std::string& name, const std::string& value) { m_values.emplace_back(name, value); }
+    void add(const std::string& name, double value);
+    // File identity without reading it: absolute path, size and modification time
+    void addFile(const std::string& name, const std::string& path);
+    // Content hash, for small files such as SRT tracks
+    void addFileContents(const std::string& name, const std::string& path);
+
+    const std::vector<std::pair<std::string, std::string>>& values() const { return m_values; }
+
+    // 16 hex digits identifying all inputs; later stages add it to their own inputs
+    std::string digest() const;
+    // Digest of a list, e.g. a frame list, to use as a single input value
+    static std::string digestOf(const std::vector<std::string>& lines);
+
+private:
+    std::vector<std::pair<std::string, std::string>> m_values;
+};
+
+// Per-output-directory record of completed stages ("pipeline_manifest.txt").
+// A stage is complete when it finished with the recorded inputs; begin()
+// drops the record first, so a stage interrupted half-way always reruns.
+// The file is rewritten (write + rename) after every change; all methods are
+// thread safe so parallel extraction jobs can share one manifest.
+class StageManifest {
+public:
+    explicit StageManifest(std::string path) : m_path(std::move(path)) {}
+
+    // Read the file; false if there is none or it is not a manifest
+    bool load();
+
+    // True if the stage completed with exactly these inputs. Otherwise, if
+    // reason is given, it says which input differs.
+    bool isCurrent(const std::string& stage, const StageInputs& inputs, std::string* reason = nullptr) const;
+
+    // Output lines recorded when the stage completed
+    std::vector<std::string> outputs(const std::string& stage) const;
+
+    // Stages recorded under a name prefix, e.g. every "extract " stage
+    std::vector<std::string> stages(const std::string& prefix) const;
+
+    void begin(const std::string& stage);
+    void complete(const std::string& stage, const StageInputs& inputs, std::vector<std::string> outputs = {});
+    void remove(const std::string& stage);
+
+    size_t size() const;
+    // True if load() found an earlier manifest (there is something to resume)
+    bool wasLoaded() const { return m_loaded; }
+    const std::string& path() const { return m_path; }
+
+private:
+    struct Stage {
+        std::vector<std::pair<std::string, std::string>> inputs;
+        std::vector<std::string> outputs;
+    };
+
+    bool saveLocked() const;
+
+    std::string m_path;
+    mutable std::mutex m_mutex;
+    std::map<std::string, Stage> m_stages;
+    bool m_loaded = false;
+};
+
+// 64-bit FNV-1a, continued from `hash`
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+// FNV-1a of a file's bytes; false if it cannot be read
+bool hashFile(const std::string& path, uint64_t& hash);
+
+// Frame list of an extraction stage: one tab-separated line per frame with
+// its record, content hash, and the file's size and modification time
+std::vector<std::string> frameManifestEntries(const std::string& framesDir, const std::vector<FrameRecord>& frames);
+
+// Rebuild the frame records from frameManifestEntries() output. A frame whose
+// size and date still match is taken as is; otherwise its bytes are hashed
+// again, so frames rewritten with identical content (a deterministic
+// re-extraction, a copy) are still current. False if any frame is missing or
+// its content differs, i.e. the stage has to rerun.
+bool restoreFrames(const std::string& framesDir, const std::vector<std::string>& entries,
+                   std::vector<FrameRecord>& frames);
+
+// Digest of the frames as later stages see them: names, records and content
+// hashes, not file dates. Frames without a known hash count by size and date.
+std::string frameListDigest(const std::string& framesDir, const std::vector<FrameRecord>& frames);
+
+#endif // STAGE_MANIFEST_H
@@ -0,0 +1,136 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker pool with one task deque per worker. A worker runs its own newest
+// task first (cache-warm, and nested submissions stay local) and steals the
+// oldest task of another worker when its own deque is empty, so uneven tasks
+// such as frames of different sizes keep every core busy. Tasks submitted
+// from outside the pool are spread round-robin over the deques.
+class WorkStealingPool {
+public:
+    // threadCount == 0 uses one worker per hardware thread
+    explicit WorkStealingPool(size_t threadCount = 0) {
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < threadCount; i++) {
+            m_queues.push_back(std::make_unique<Queue>());
+        }
+        m_workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            m_workers.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    // Runs every task still queued, then joins the workers
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Process-wide pool for per-frame work, created on first use
+    static WorkStealingPool& shared() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+    size_t size() const { return m_workers.size(); }
+
+    void submit(std::function<void()> task) {
+        const size_t queue = t_pool == this ? t_index : m_next++ % m_queues.size();
+        {
+            std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+            m_queues[queue]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_pending++;
+        }
+        m_wake.notify_one();
+    }
+
+    // Run one queued task on the calling thread, e.g. while waiting for a
+    // batch to finish. False if nothing was queued.
+    bool runOne() {
+        std::function<void()> task;
+        if (!take(t_pool == this ? t_index : m_next++ % m_queues.size(), task)) {
+            return false;
+        }
+        task();
+        return true;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Own deque from the back, then the others from the front
+    bool take(size_t self, std::function<void()>& task) {
+        for (size_t offset = 0; offset < m_queues.size(); offset++) {
+            Queue& queue = *m_queues[(self + offset) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            m_pending--;
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        t_pool = this;
+        t_index = index;
+        for (;;) {
+            std::function<void()> task;
+            if (take(index, task)) {
+                task();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this]() { return m_stopping || m_pending > 0; });
+            if (m_stopping && m_pending <= 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_next{0};
+    // Queued tasks; briefly negative while a task is taken before its submit() counted it
+    std::atomic<long> m_pending{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+
+    // Which pool and deque the current thread works for
+    inline static thread_local WorkStealingPool* t_pool = nullptr;
+    inline static thread_local size_t t_index = 0;
+};
@@ -0,0 +1,177 @@
+// Test: a rerun after the disk budget's cleanup removed the extracted frames
+// (and the COLMAP database) extracts the frames again but keeps the
+// reconstruction, since the frames come out with the same bytes.
+//
+// Usage: test_resume
+// ffmpeg and COLMAP are replaced by shell stubs that write deterministic
+// frames and a fixed model, and log which COLMAP commands were run.
+
+#include "colmap_model.h"
+#include "frame_paths.h"
+#include "pipeline.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static const int kFrames = 6;
+
+static bool writeFile(const fs::path& path, const std::string& text, bool executable = false) {
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << text;
+        if (!file.good()) {
+            return false;
+        }
+    }
+    if (executable) {
+        std::error_code ec;
+        fs::permissions(path, fs::perms::owner_all, fs::perm_options::add, ec);
+        return !ec;
+    }
+    return true;
+}
+
+static std::string readFile(const fs::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+// The mapper's model: one camera, every frame registered, a point per frame
+static ColmapModel makeModel() {
+    ColmapModel model;
+    ColmapCamera camera;
+    camera.id = 1;
+    camera.model = colmapCameraModelId("SIMPLE_RADIAL");
+    camera.width = 64;
+    camera.height = 48;
+    camera.params = {50.0, 32.0, 24.0, 0.0};
+    model.cameras.push_back(camera);
+    for (int i = 1; i <= kFrames; i++) {
+        ColmapImage image;
+        image.id = static_cast<uint32_t>(i);
+        image.camera = 1;
+        image.name = frameFileName("flight", static_cast<size_t>(i));
+        image.tvec[0] = i;
+        image.points.push_back({10.0, 10.0, static_cast<uint64_t>(i)});
+        model.images.push_back(image);
+
+        ColmapPoint3D point;
+        point.id = static_cast<uint64_t>(i);
+        point.xyz[2] = 5.0;
+        point.error = 0.5;
+        point.track.push_back({image.id, 0});
+        model.points.push_back(point);
+    }
+    return model;
+}
+
+static bool writeStubs(const fs::path& dir) {
+    const std::string ffmpeg =
+        "#!/bin/sh\n"
+        "for a; do case \"$a\" in *%04d.jpg)\n"
+        "  i=1; while [ $i -le " + std::to_string(kFrames) + " ]; do\n"
+        "    printf '\\377\\330frame %d\\377\\331' $i > \"$(printf \"$a\" $i)\"; i=$((i+1)); done ;;\n"
+        "esac; done\n"
+        "echo '  Duration: 00:00:0" + std::to_string(kFrames) + ".00, start: 0.000000, bitrate: 1000 kb/s' >&2\n"
+        "echo progress=end\n";
+    const std::string model = (dir / "model").string();
+    const std::string colmap =
+        "#!/bin/sh\n"
+        "echo \"$1\" >> \"" + (dir / "calls.txt").string() + "\"\n"
+        "cmd=$1; shift\n"
+        "while [ $# -gt 0 ]; do case \"$1\" in\n"
+        "  --database_path) db=$2 ;; --output_path) out=$2 ;; --image_path) img=$2 ;;\n"
+        "esac; shift; done\n"
+        "case \"$cmd\" in\n"
+        "  feature_extractor) mkdir -p \"$(dirname \"$db\")\"; echo features > \"$db\" ;;\n"
+        "  mapper) mkdir -p \"$out/0\"; cp \"" + model + "\"/* \"$out/0/\" ;;\n"
+        "  image_undistorter) mkdir -p \"$out/sparse\" \"$out/images\"; cp \"" + model + "\"/* \"$out/sparse/\";"
+        " cp \"$img\"/*.jpg \"$out/images/\" ;;\n"
+        "esac\n";
+    std::error_code ec;
+    fs::create_directories(dir / "videos", ec);
+    fs::create_directories(dir / "model", ec);
+    return writeFile(dir / "ffmpeg", ffmpeg, true) && writeFile(dir / "colmap", colmap, true) &&
+           writeFile(dir / "videos" / "flight.mp4", "not a video") &&
+           writeColmapModel(makeModel(), dir / "model", ColmapFormat::Binary);
+}
+
+static bool extractedFramesLeft(const fs::path& output) {
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(output / "frames", ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() == ".jpg") {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Run the pipeline twice with the given cleanup; the second run must not
+// start feature extraction, the mapper or the undistorter
+static bool testRerun(const fs::path& dir, const std::string& name, bool cleanupIntermediates) {
+    PipelineConfig config;
+    config.videoPath = (dir / "videos").string();
+    config.outputBaseDir = (dir / name).string();
+    config.frameRate = 1.0;
+    config.method = ReconMethod::COLMAP;
+    config.ffmpegPath = (dir / "ffmpeg").string();
+    config.colmapPath = (dir / "colmap").string();
+    config.interactive = false;
+    config.removeDistortedFrames = true;
+    config.cleanupIntermediates = cleanupIntermediates;
+
+    std::string log;
+    auto logCallback = [&](const std::string& line) { log += line + "\n"; };
+    auto fail = [&](const std::string& message) {
+        std::printf("%s\n%s: FAILED - %s\n", log.c_str(), name.c_str(), message.c_str());
+        return false;
+    };
+
+    const fs::path calls = dir / "calls.txt";
+    for (int run = 1; run <= 2; run++) {
+        std::error_code ec;
+        fs::remove(calls, ec);
+        if (!runPipeline(config, logCallback)) {
+            return fail("run " + std::to_string(run) + " failed");
+        }
+        if (extractedFramesLeft(config.outputBaseDir)) {
+            return fail("run " + std::to_string(run) + " left extracted frames behind");
+        }
+        const std::string commands = readFile(calls);
+        for (const char* command : {"feature_extractor", "mapper", "image_undistorter"}) {
+            const bool ran = commands.find(command) != std::string::npos;
+            if (ran != (run == 1)) {
+                return fail(std::string(command) + (ran ? " ran again on the rerun" : " did not run"));
+            }
+        }
+    }
+    if (!fs::exists(fs::path(config.outputBaseDir) / "sparse" / "0" / "images.bin")) {
+        return fail("sparse/0 is missing after the rerun");
+    }
+    std::printf("%s: ok\n", name.c_str());
+    return true;
+}
+
+int main() {
+    const fs::path dir = fs::temp_directory_path() / ("dronerecon_test_resume_" + std::to_string(getpid()));
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    fs::create_directories(dir, ec);
+    if (ec || !writeStubs(dir)) {
+        std::printf("Could not set up %s\n", dir.string().c_str());
+        return 1;
+    }
+
+    bool ok = testRerun(dir, "frames_removed", false);
+    ok = testRerun(dir, "frames_and_database_removed", true) && ok;
+
+    fs::remove_all(dir, ec);
+    return ok ? 0 : 1;
+}